@@ -42,9 +42,6 @@ void Camera::Update(float dt)
 		transform->SetRotation(currentRot);
 	}
 
-	//called every frame
-	UpdateViewMatrix();
-
 	XMFLOAT3 move = { 0.0f, 0.0f, 0.0f };
 
 	//keyboard movement input
@@ -72,7 +69,6 @@ void Camera::UpdateViewMatrix()
 	XMFLOAT3 pos = transform->GetPosition();
 	XMFLOAT3 direction = transform->GetForward();
 	XMFLOAT3 up = transform->GetUp();
-	XMFLOAT3 right = transform->GetRight();
 
 	//create and store view matrix
 	XMMATRIX view = XMMatrixLookToLH(XMLoadFloat3(&pos), XMLoadFloat3(&direction), XMLoadFloat3(&up));
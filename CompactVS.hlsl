@@ -0,0 +1,43 @@
+#include "ShaderStructs.hlsli"
+
+cbuffer ExternalData : register(b0)
+{
+    matrix worldMatrix;
+    matrix worldInvTrans;
+    matrix viewMatrix;
+    matrix projectionMatrix;
+
+    matrix lightView;
+    matrix lightProjection;
+
+    // From the mesh's CompactVertexParams
+    float3 positionOffset;
+    float3 positionScale;
+}
+
+// --------------------------------------------------------
+// VertexShader.hlsl for meshes that store CompactVertex
+// (see Mesh::SetBuildCompactVertices)
+//
+// - Unpacks the vertex first, everything after that is the
+//   same as the full vertex version
+// --------------------------------------------------------
+VertexToPixel main(CompactVertexShaderInput packed)
+{
+    VertexShaderInput input = DecodeCompactVertex(packed, positionOffset, positionScale);
+    VertexToPixel output;
+
+    matrix wvp = mul(projectionMatrix, mul(viewMatrix, worldMatrix));
+    output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+
+	//passing through other data
+    output.uv = input.uv;
+    output.normal = normalize(mul((float3x3) worldInvTrans, input.normal));
+    output.tangent = normalize(mul((float3x3) worldMatrix, input.tangent));
+    output.worldPos = mul(worldMatrix, float4(input.localPosition, 1.0f)).xyz;
+
+	//calculate where this vertex is from lights pov
+    matrix shadowWVP = mul(lightProjection, mul(lightView, worldMatrix));
+    output.shadowMapPos = mul(shadowWVP, float4(input.localPosition, 1.0f));
+    return output;
+}
@@ -0,0 +1,133 @@
+#include "EntityStore.h"
+#include <mutex>
+
+namespace
+{
+	// Guards the column makers, component types can be first used from any thread
+	std::mutex componentMutex;
+}
+
+std::vector<std::unique_ptr<EntityStore::Column>(*)()>& EntityStore::ColumnMakers()
+{
+	static std::vector<std::unique_ptr<Column>(*)()> makers;
+	return makers;
+}
+
+uint32_t EntityStore::RegisterComponent(std::unique_ptr<Column>(*makeColumn)())
+{
+	std::lock_guard<std::mutex> lock(componentMutex);
+	auto& makers = ColumnMakers();
+	if (makers.size() >= MaxComponentTypes)
+		throw std::length_error("EntityStore only supports 64 component types");
+	makers.push_back(makeColumn);
+	return (uint32_t)makers.size() - 1;
+}
+
+std::unique_ptr<EntityStore::Column> EntityStore::MakeColumn(uint32_t id)
+{
+	std::lock_guard<std::mutex> lock(componentMutex);
+	return ColumnMakers()[id]();
+}
+
+
+void EntityStore::Destroy(EntityHandle entity)
+{
+	const Record* record = FindRecord(entity);
+	if (!record)
+		return;
+
+	RemoveRow(record->archetype, record->row);
+	records[entity.index].archetype = NoArchetype;
+	records[entity.index].generation++;
+	freeIndices.push_back(entity.index);
+}
+
+bool EntityStore::IsAlive(EntityHandle entity) const
+{
+	return FindRecord(entity) != nullptr;
+}
+
+
+// --------------------------------------------------------
+// Index of the archetype for exactly these components,
+// made (with empty columns) the first time it's asked for
+// --------------------------------------------------------
+uint32_t EntityStore::FindArchetype(ComponentMask mask)
+{
+	auto found = archetypeIndices.find(mask);
+	if (found != archetypeIndices.end())
+		return found->second;
+
+	Archetype archetype;
+	archetype.mask = mask;
+	for (ComponentMask bits = mask; bits; bits &= bits - 1)
+		archetype.columns.push_back(MakeColumn((uint32_t)std::countr_zero(bits)));
+
+	uint32_t index = (uint32_t)archetypes.size();
+	archetypes.push_back(std::move(archetype));
+	archetypeIndices[mask] = index;
+	return index;
+}
+
+const EntityStore::Record* EntityStore::FindRecord(EntityHandle entity) const
+{
+	if (entity.index >= records.size())
+		return nullptr;
+	const Record& record = records[entity.index];
+	return record.archetype != NoArchetype && record.generation == entity.generation ? &record : nullptr;
+}
+
+EntityHandle EntityStore::AddRecord(uint32_t archetype, uint32_t row)
+{
+	uint32_t index;
+	if (!freeIndices.empty())
+	{
+		index = freeIndices.back();
+		freeIndices.pop_back();
+	}
+	else
+	{
+		index = (uint32_t)records.size();
+		records.push_back({ NoArchetype, 0, 0 });
+	}
+	records[index].archetype = archetype;
+	records[index].row = row;
+	return { index, records[index].generation };
+}
+
+
+void EntityStore::MoveEntity(EntityHandle entity, uint32_t destination)
+{
+	Record& record = records[entity.index];
+	Archetype& from = archetypes[record.archetype];
+	Archetype& to = archetypes[destination];
+
+	ComponentMask kept = from.mask & to.mask;
+	for (ComponentMask bits = kept; bits; bits &= bits - 1)
+	{
+		uint32_t id = (uint32_t)std::countr_zero(bits);
+		from.columns[ColumnIndex(from.mask, id)]->MoveBack(record.row, *to.columns[ColumnIndex(to.mask, id)]);
+	}
+
+	//the moved-from leftovers go with the old row
+	uint32_t row = (uint32_t)to.entities.size();
+	to.entities.push_back(entity);
+	RemoveRow(record.archetype, record.row);
+	record.archetype = destination;
+	record.row = row;
+}
+
+// Fills the gap with the archetype's last entity
+void EntityStore::RemoveRow(uint32_t archetype, uint32_t row)
+{
+	Archetype& from = archetypes[archetype];
+	for (auto& column : from.columns)
+		column->SwapRemove(row);
+
+	if (row + 1 < from.entities.size())
+	{
+		from.entities[row] = from.entities.back();
+		records[from.entities[row].index].row = row;
+	}
+	from.entities.pop_back();
+}
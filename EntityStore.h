@@ -0,0 +1,212 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// An entity's index in its store, and the generation that index
+// was on when the entity was made; once the entity is destroyed the
+// index gets a new generation, so old handles stop matching
+struct EntityHandle
+{
+	uint32_t index;
+	uint32_t generation;
+
+	bool operator==(const EntityHandle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const EntityHandle& other) const { return !(*this == other); }
+};
+
+
+// --------------------------------------------------------
+// Entities grouped by which components they have (their
+// archetype), each component type of an archetype in its
+// own array
+//
+// - Each<A, B>() visits every entity with at least an A and
+//   a B, walking the arrays of each matching archetype front
+//   to back
+// - Adding or removing a component moves the entity to the
+//   archetype for its new set; destroying one moves the last
+//   entity of its archetype into the gap, so arrays stay packed
+// - Component pointers are only good until the next entity is
+//   created, destroyed or changes archetype, and Each() mustn't
+//   do any of those (collect handles and do it afterwards)
+// - Components are any movable type, up to 64 types in all
+// --------------------------------------------------------
+class EntityStore
+{
+public:
+	static constexpr uint32_t MaxComponentTypes = 64;
+
+	template<typename... Components> EntityHandle Create(Components&&... components);
+	void Destroy(EntityHandle entity);	// Does nothing if it's already gone
+	bool IsAlive(EntityHandle entity) const;
+
+	template<typename T> T* Get(EntityHandle entity);	// nullptr if it has none (or is gone)
+	template<typename T> bool Has(EntityHandle entity) const
+	{
+		const Record* record = FindRecord(entity);
+		return record && (archetypes[record->archetype].mask & ComponentBit<T>());
+	}
+	template<typename T> void Add(EntityHandle entity, T&& component);	// Replaces one it already has
+	template<typename T> void Remove(EntityHandle entity);
+
+	// function(EntityHandle, Components&...) for every entity with all of them
+	template<typename... Components, typename Function> void Each(Function&& function);
+
+	size_t GetCount() const { return records.size() - freeIndices.size(); }
+
+private:
+	using ComponentMask = uint64_t;
+
+	// One component type's array in an archetype; virtual only for
+	// moving entities around, queries use the typed array directly
+	struct Column
+	{
+		virtual ~Column() = default;
+		virtual void MoveBack(size_t row, Column& destination) = 0;	// Appends row to destination
+		virtual void SwapRemove(size_t row) = 0;
+	};
+
+	template<typename T> struct TypedColumn : Column
+	{
+		std::vector<T> data;
+
+		void MoveBack(size_t row, Column& destination) override { static_cast<TypedColumn&>(destination).data.push_back(std::move(data[row])); }
+		void SwapRemove(size_t row) override
+		{
+			if (row + 1 < data.size())
+				data[row] = std::move(data.back());
+			data.pop_back();
+		}
+	};
+
+	// Columns are in component id order, so a component's column is
+	// the number of set mask bits below its id
+	struct Archetype
+	{
+		ComponentMask mask;
+		std::vector<std::unique_ptr<Column>> columns;
+		std::vector<EntityHandle> entities;	// One per row
+	};
+
+	// Where each index's entity lives, archetype is NoArchetype for free indices
+	struct Record
+	{
+		uint32_t archetype;
+		uint32_t row;
+		uint32_t generation;
+	};
+
+	static constexpr uint32_t NoArchetype = ~0u;
+
+	std::vector<Archetype> archetypes;
+	std::unordered_map<ComponentMask, uint32_t> archetypeIndices;
+	std::vector<Record> records;
+	std::vector<uint32_t> freeIndices;
+
+	// Ids are shared by every store, handed out the first time a type is used
+	static std::vector<std::unique_ptr<Column>(*)()>& ColumnMakers();
+	static uint32_t RegisterComponent(std::unique_ptr<Column>(*makeColumn)());
+	static std::unique_ptr<Column> MakeColumn(uint32_t id);
+	template<typename T> static uint32_t ComponentId()
+	{
+		static const uint32_t id = RegisterComponent([]() -> std::unique_ptr<Column> { return std::make_unique<TypedColumn<T>>(); });
+		return id;
+	}
+	template<typename T> static ComponentMask ComponentBit() { return ComponentMask(1) << ComponentId<T>(); }
+	static size_t ColumnIndex(ComponentMask mask, uint32_t id) { return (size_t)std::popcount(mask & ((ComponentMask(1) << id) - 1)); }
+	template<typename T> static std::vector<T>& ColumnData(Archetype& archetype)
+	{
+		return static_cast<TypedColumn<T>&>(*archetype.columns[ColumnIndex(archetype.mask, ComponentId<T>())]).data;
+	}
+
+	uint32_t FindArchetype(ComponentMask mask);
+	const Record* FindRecord(EntityHandle entity) const;
+	EntityHandle AddRecord(uint32_t archetype, uint32_t row);
+
+	// Moves an entity's components into another archetype (any it doesn't
+	// have there are left for the caller to append), or drops them
+	void MoveEntity(EntityHandle entity, uint32_t destination);
+	void RemoveRow(uint32_t archetype, uint32_t row);
+};
+
+
+template<typename... Components>
+EntityHandle EntityStore::Create(Components&&... components)
+{
+	ComponentMask mask = (ComponentMask(0) | ... | ComponentBit<std::decay_t<Components>>());
+	if (std::popcount(mask) != (int)sizeof...(Components))
+		throw std::invalid_argument("EntityStore::Create was given the same component type twice");
+
+	uint32_t index = FindArchetype(mask);
+	Archetype& archetype = archetypes[index];
+	(ColumnData<std::decay_t<Components>>(archetype).push_back(std::forward<Components>(components)), ...);
+	EntityHandle entity = AddRecord(index, (uint32_t)archetype.entities.size());
+	archetype.entities.push_back(entity);
+	return entity;
+}
+
+template<typename T>
+T* EntityStore::Get(EntityHandle entity)
+{
+	const Record* record = FindRecord(entity);
+	if (!record)
+		return nullptr;
+	Archetype& archetype = archetypes[record->archetype];
+	if (!(archetype.mask & ComponentBit<T>()))
+		return nullptr;
+	return &ColumnData<T>(archetype)[record->row];
+}
+
+template<typename T>
+void EntityStore::Add(EntityHandle entity, T&& component)
+{
+	using Component = std::decay_t<T>;
+	if (Component* existing = Get<Component>(entity))
+	{
+		*existing = std::forward<T>(component);
+		return;
+	}
+	const Record* record = FindRecord(entity);
+	if (!record)
+		throw std::invalid_argument("EntityStore::Add on an entity that's been destroyed");
+
+	uint32_t destination = FindArchetype(archetypes[record->archetype].mask | ComponentBit<Component>());
+	MoveEntity(entity, destination);
+	ColumnData<Component>(archetypes[destination]).push_back(std::forward<T>(component));
+}
+
+template<typename T>
+void EntityStore::Remove(EntityHandle entity)
+{
+	if (!Get<T>(entity))
+		return;
+	const Record* record = FindRecord(entity);
+	MoveEntity(entity, FindArchetype(archetypes[record->archetype].mask & ~ComponentBit<T>()));
+}
+
+template<typename... Components, typename Function>
+void EntityStore::Each(Function&& function)
+{
+	ComponentMask mask = (ComponentMask(0) | ... | ComponentBit<Components>());
+	for (Archetype& archetype : archetypes)
+	{
+		if ((archetype.mask & mask) != mask || archetype.entities.empty())
+			continue;
+
+		//columns are looked up once per archetype, then it's plain arrays
+		const EntityHandle* entities = archetype.entities.data();
+		size_t count = archetype.entities.size();
+		[&](Components*... columns)
+		{
+			for (size_t row = 0; row < count; row++)
+				function(entities[row], columns[row]...);
+		}(ColumnData<Components>(archetype).data()...);
+	}
+}
@@ -0,0 +1,52 @@
+#include "FixedTimestep.h"
+#include <stdexcept>
+
+FixedTimestep::FixedTimestep(int64_t ticksPerSecond, unsigned int stepsPerSecond, unsigned int maxStepsPerFrame) :
+	ticksPerSecond(ticksPerSecond),
+	stepsPerSecond(stepsPerSecond),
+	maxStepsPerFrame(maxStepsPerFrame),
+	accumulator(0),
+	pendingSteps(0),
+	stepCount(0),
+	droppedSteps(0),
+	simulationTime(0.0)
+{
+	if (ticksPerSecond <= 0 || stepsPerSecond == 0)
+		throw std::invalid_argument("FixedTimestep needs a positive tick rate and step rate");
+}
+
+unsigned int FixedTimestep::Advance(int64_t elapsedTicks)
+{
+	if (elapsedTicks > 0)
+		accumulator += elapsedTicks * stepsPerSecond;
+
+	int64_t steps = pendingSteps + accumulator / ticksPerSecond;
+	accumulator %= ticksPerSecond;
+
+	//too far behind to catch up, drop the rest but keep the fraction so alpha doesn't jump
+	if (steps > maxStepsPerFrame)
+	{
+		droppedSteps += steps - maxStepsPerFrame;
+		steps = maxStepsPerFrame;
+	}
+	pendingSteps = (unsigned int)steps;
+	return pendingSteps;
+}
+
+bool FixedTimestep::Step()
+{
+	if (pendingSteps == 0)
+		return false;
+	pendingSteps--;
+	stepCount++;
+	simulationTime += 1.0 / stepsPerSecond;
+	return true;
+}
+
+void FixedTimestep::SetStepsPerSecond(unsigned int stepsPerSecond)
+{
+	if (stepsPerSecond == 0)
+		throw std::invalid_argument("FixedTimestep needs a positive step rate");
+	//the accumulator counts in fractions of a step whatever the rate, so it stays put
+	this->stepsPerSecond = stepsPerSecond;
+}
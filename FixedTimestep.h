@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+
+// --------------------------------------------------------
+// Turns variable frame times into whole simulation steps of
+// a fixed length
+//
+// - Advance() adds a frame's time (in clock ticks, so a fake
+//   clock can drive it exactly), then Step() hands out the
+//   steps it adds up to one at a time; the remainder carries
+//   over to the next frame
+// - No more than maxStepsPerFrame are handed out at once, time
+//   past that is dropped rather than owed, so frames that fall
+//   behind don't make the next ones slower still
+// - GetAlpha() is how far the frame got towards the next step,
+//   for drawing things part way between their last two steps
+// - Time is kept in whole ticks times steps per second, so
+//   nothing drifts however long it runs
+// --------------------------------------------------------
+class FixedTimestep
+{
+public:
+	FixedTimestep(int64_t ticksPerSecond, unsigned int stepsPerSecond = 60, unsigned int maxStepsPerFrame = 8);
+
+	// Adds a frame that took elapsedTicks (negative counts as none),
+	// returns how many steps are waiting
+	unsigned int Advance(int64_t elapsedTicks);
+
+	// Takes one waiting step, false once there are none
+	// - while (timestep.Step()) Simulate(timestep.GetStepSeconds());
+	bool Step();
+
+	void SetStepsPerSecond(unsigned int stepsPerSecond);	// Keeps how far into the next step it is
+	void SetMaxStepsPerFrame(unsigned int maxStepsPerFrame) { this->maxStepsPerFrame = maxStepsPerFrame; }
+
+	unsigned int GetStepsPerSecond() const { return stepsPerSecond; }
+	unsigned int GetMaxStepsPerFrame() const { return maxStepsPerFrame; }
+	float GetStepSeconds() const { return 1.0f / stepsPerSecond; }
+	float GetAlpha() const { return (float)((double)accumulator / ticksPerSecond); }	// 0 up to (not including) 1
+	unsigned int GetPendingSteps() const { return pendingSteps; }
+	uint64_t GetStepCount() const { return stepCount; }			// Steps taken so far
+	double GetSimulationTime() const { return simulationTime; }	// Seconds those steps add up to, including the current one
+	uint64_t GetDroppedSteps() const { return droppedSteps; }	// Steps skipped by the per frame limit
+
+private:
+	int64_t ticksPerSecond;
+	unsigned int stepsPerSecond;
+	unsigned int maxStepsPerFrame;
+	int64_t accumulator;	// Ticks times stepsPerSecond, a whole step is ticksPerSecond
+	unsigned int pendingSteps;
+	uint64_t stepCount;
+	uint64_t droppedSteps;
+	double simulationTime;
+};
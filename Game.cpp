@@ -1,11 +1,15 @@
 #include "Graphics.h"
 #include "Game.h"
 #include "Vertex.h"
+#include "VertexInputLayout.h"
 #include "Input.h"
 #include "PathHelpers.h"
 #include "Window.h"
 #include <math.h>
+#include <algorithm>
 #include "BufferStructs.h"
+#include "MeshGenerator.h"
+#include "StaticBatcher.h"
 #include "ImGui/imgui.h"
 #include "ImGui/imgui_impl_dx11.h"
 #include "ImGui/imgui_impl_win32.h"
@@ -26,6 +30,21 @@ void Game::Initialize()
 	// Helper methods for loading shaders, creating some basic
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
+	//  - Meshes share the pool's buffers, so drawing them doesn't rebind anything
+	//  - Set compactVertices to store CompactVertex (20 bytes instead of 44)
+	//    and draw with CompactVS, off until that path is verified on D3D
+	const bool compactVertices = false;
+	geometryPool = std::make_shared<GeometryPool>(65536, 262144, compactVertices ? sizeof(CompactVertex) : sizeof(Vertex));
+	Mesh::SetGeometryPool(geometryPool);
+	Mesh::SetBuildCompactVertices(compactVertices);
+	Mesh::SetBuildPositionStreams(true);
+	Mesh::SetBuildOrientedBounds(true);
+	Mesh::SetBuildBvhs(true);
+
+	//  - Entities and cameras keep their transforms in one pool,
+	//    see the start of Draw()
+	transformPool = std::make_shared<TransformPool>();
+	Transform::SetPool(transformPool);
 	CreateGeometry();
 
 	// Set initial graphics API state
@@ -87,6 +106,9 @@ Game::~Game()
 	ImGui_ImplDX11_Shutdown();
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
+
+	Mesh::SetGeometryPool(nullptr);
+	Transform::SetPool(nullptr);
 }
 
 //helper methods for creating geometry, materials, textures, shaders...
@@ -140,9 +162,15 @@ void Game::CreateGeometry()
 	LoadMaterialTextures(L"wood", woodA.GetAddressOf(), woodN.GetAddressOf(), woodR.GetAddressOf(), woodM.GetAddressOf());
 
 	//creating shaders
-	shadowVS = std::make_shared<SimpleVertexShader>(Graphics::Device, Graphics::Context, FixPath(L"ShadowMapVS.cso").c_str());
+	//input layouts come from the C++ vertex formats (see VertexFormat.h), not reflection
+	shadowVS = std::make_shared<SimpleVertexShader>(Graphics::Device, Graphics::Context, FixPath(L"ShadowMapVS.cso").c_str(),
+		VertexFormats::CreateInputLayout<DepthVertexFormat>(Graphics::Device.Get(), FixPath(L"ShadowMapVS.cso")), false);
 	std::shared_ptr<SimpleVertexShader> vertexShader = std::make_shared<SimpleVertexShader>(
-		Graphics::Device, Graphics::Context, FixPath(L"VertexShader.cso").c_str());
+		Graphics::Device, Graphics::Context, FixPath(L"VertexShader.cso").c_str(),
+		VertexFormats::CreateInputLayout<StandardVertexFormat>(Graphics::Device.Get(), FixPath(L"VertexShader.cso")), false);
+	std::shared_ptr<SimpleVertexShader> compactVS = std::make_shared<SimpleVertexShader>(
+		Graphics::Device, Graphics::Context, FixPath(L"CompactVS.cso").c_str(),
+		VertexFormats::CreateInputLayout<CompactVertexFormat<Mesh::CompactPositions>>(Graphics::Device.Get(), FixPath(L"CompactVS.cso")), false);
 	std::shared_ptr<SimplePixelShader> pixelShader = std::make_shared<SimplePixelShader>(
 		Graphics::Device, Graphics::Context, FixPath(L"PixelShader.cso").c_str());
 	std::shared_ptr<SimplePixelShader> uvShader = std::make_shared<SimplePixelShader>(
@@ -155,20 +183,33 @@ void Game::CreateGeometry()
 		Graphics::Device, Graphics::Context, FixPath(L"MultiplyPS.cso").c_str());
 	std::shared_ptr<SimplePixelShader> pixelPBRShader = std::make_shared<SimplePixelShader>(
 		Graphics::Device, Graphics::Context, FixPath(L"PixelLightingShader.cso").c_str());
-	std::shared_ptr<SimpleVertexShader> skyVS = std::make_shared<SimpleVertexShader>(Graphics::Device, Graphics::Context, FixPath(L"SkyVS.cso").c_str());
+	std::shared_ptr<SimpleVertexShader> skyVS = std::make_shared<SimpleVertexShader>(Graphics::Device, Graphics::Context, FixPath(L"SkyVS.cso").c_str(),
+		VertexFormats::CreateInputLayout<StandardVertexFormat>(Graphics::Device.Get(), FixPath(L"SkyVS.cso")), false);
 	std::shared_ptr<SimplePixelShader> skyPS = std::make_shared<SimplePixelShader>(Graphics::Device, Graphics::Context, FixPath(L"SkyPS.cso").c_str());
 
 
-	//loading models
-	std::shared_ptr<Mesh> sphereMesh = std::make_shared<Mesh>("sphere0", FixPath(L"../../Assets/Models/sphere.obj").c_str());
+	//loading models - the primitives are generated instead of read from disk
+	CookedMesh sphereData, torusData, cylinderData, cubeData;
+	MeshGenerator::Sphere(32, 16, sphereData);
+	MeshGenerator::Torus(40, 20, GeneratedTorusRadius, GeneratedTorusTubeRadius, torusData);
+	MeshGenerator::Cylinder(32, 1, cylinderData);
+	MeshGenerator::Cube(1, cubeData);
+
+	std::shared_ptr<Mesh> sphereMesh = std::make_shared<Mesh>("sphere0", sphereData);
 	std::shared_ptr<Mesh> helixMesh = std::make_shared<Mesh>("sphere0", FixPath(L"../../Assets/Models/helix.obj").c_str());
-	std::shared_ptr<Mesh> torusMesh = std::make_shared<Mesh>("sphere0", FixPath(L"../../Assets/Models/torus.obj").c_str());
-	std::shared_ptr<Mesh> cylinderMesh = std::make_shared<Mesh>("sphere0", FixPath(L"../../Assets/Models/cylinder.obj").c_str());
-	std::shared_ptr<Mesh> cubeMesh = std::make_shared<Mesh>("cube", FixPath(L"../../Assets/Models/cube.obj").c_str());
+	std::shared_ptr<Mesh> torusMesh = std::make_shared<Mesh>("sphere0", torusData);
+	std::shared_ptr<Mesh> cylinderMesh = std::make_shared<Mesh>("sphere0", cylinderData);
+	std::shared_ptr<Mesh> cubeMesh = std::make_shared<Mesh>("cube", cubeData);
 
 	//updating mesh vector
 	meshes.insert(meshes.end(), { sphereMesh, cubeMesh, helixMesh, torusMesh, cylinderMesh });
 
+	//the sky's shader reads full vertices, so it gets a cube of its own
+	bool compactVertices = Mesh::GetBuildCompactVertices();
+	Mesh::SetBuildCompactVertices(false);
+	std::shared_ptr<Mesh> skyMesh = std::make_shared<Mesh>("sky cube", cubeData);
+	Mesh::SetBuildCompactVertices(compactVertices);
+
 	sky = std::make_shared<Sky>(
 		FixPath(L"../../Assets/Textures/Skies/Clouds Pink/right.png").c_str(),
 		FixPath(L"../../Assets/Textures/Skies/Clouds Pink/left.png").c_str(),
@@ -176,7 +217,7 @@ void Game::CreateGeometry()
 		FixPath(L"../../Assets/Textures/Skies/Clouds Pink/down.png").c_str(),
 		FixPath(L"../../Assets/Textures/Skies/Clouds Pink/front.png").c_str(),
 		FixPath(L"../../Assets/Textures/Skies/Clouds Pink/back.png").c_str(),
-		cubeMesh,
+		skyMesh,
 		skyVS,
 		skyPS,
 		sampler);
@@ -238,26 +279,45 @@ void Game::CreateGeometry()
 
 	//updating mats vector
 	mats.insert(mats.end(), { matUV, matNorm, matCustom, cobbleMat4x, floorMat, paintMat, scratchedMat, bronzeMat, roughMat, woodMat });
+	for (std::shared_ptr<Material>& mat : mats)
+		mat->SetCompactVertexShader(compactVS);
 
 	//updating entities vector
-	entities.push_back(std::make_shared<GameEntity>(sphereMesh, cobbleMat4x));
-	entities.push_back(std::make_shared<GameEntity>(helixMesh, paintMat));
-	entities.push_back(std::make_shared<GameEntity>(helixMesh, scratchedMat));
-	entities.push_back(std::make_shared<GameEntity>(torusMesh, roughMat));
-	entities.push_back(std::make_shared<GameEntity>(cylinderMesh, bronzeMat));
-
-	std::shared_ptr<GameEntity> floor = std::make_shared<GameEntity>(cubeMesh, woodMat);
-	floor->GetTransform()->SetScale(50, 1, 50);
-	floor->GetTransform()->SetPosition(0, -5, 0);
+	entities.push_back(GameEntity::Create(scene, sphereMesh, cobbleMat4x));
+	entities.push_back(GameEntity::Create(scene, helixMesh, paintMat));
+	entities.push_back(GameEntity::Create(scene, helixMesh, scratchedMat));
+	entities.push_back(GameEntity::Create(scene, torusMesh, roughMat));
+	entities.push_back(GameEntity::Create(scene, cylinderMesh, bronzeMat));
+
+	GameEntity floor = GameEntity::Create(scene, cubeMesh, woodMat);
+	floor.GetTransform()->SetScale(50, 1, 50);
+	floor.GetTransform()->SetPosition(0, -5, 0);
+	floor.SetStatic(true);
 	entities.push_back(floor);
 
 
 	//place entities in scene
-	entities[0]->GetTransform()->MoveAbsolute(-9, 0, 5);
-	entities[1]->GetTransform()->MoveAbsolute(-6, 0, 5);
-	entities[2]->GetTransform()->MoveAbsolute(-3, 0, 5);
-	entities[3]->GetTransform()->MoveAbsolute(0, 0, 5);
-	entities[4]->GetTransform()->MoveAbsolute(3, 0, 5);
+	entities[0].GetTransform()->MoveAbsolute(-9, 0, 5);
+	entities[1].GetTransform()->MoveAbsolute(-6, 0, 5);
+	entities[2].GetTransform()->MoveAbsolute(-3, 0, 5);
+	entities[3].GetTransform()->MoveAbsolute(0, 0, 5);
+	entities[4].GetTransform()->MoveAbsolute(3, 0, 5);
+
+	//how the fixed steps move them, kept on the entities themselves so
+	//batching and reordering the list can't hand it to the wrong ones
+	scene.Add(entities[0].GetHandle(), Oscillation{ XMFLOAT3(-9, 0, 0), XMFLOAT3(0, -1, 0) });
+	scene.Add(entities[1].GetHandle(), Oscillation{ XMFLOAT3(-6, 0, 0), XMFLOAT3(0, 1, 0) });
+	scene.Add(entities[2].GetHandle(), Oscillation{ XMFLOAT3(-3, 0, 0), XMFLOAT3(-1, 0, 0) });
+	scene.Add(entities[3].GetHandle(), Oscillation{ XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1) });
+	scene.Add(entities[4].GetHandle(), Oscillation{ XMFLOAT3(3, 0, 0), XMFLOAT3(1, 0, 0) });
+
+	//merge static entities by material, only the generated meshes
+	//still have their vertices on the CPU so only those can be batched
+	BatchStaticEntities({
+		{ sphereMesh.get(), &sphereData },
+		{ torusMesh.get(), &torusData },
+		{ cylinderMesh.get(), &cylinderData },
+		{ cubeMesh.get(), &cubeData } });
 
 
 
@@ -335,6 +395,74 @@ void Game::CreateGeometry()
 	Graphics::Device->CreateSamplerState(&ppSampDesc, ppSampler.GetAddressOf());
 }
 
+
+// --------------------------------------------------------
+// Replaces static entities with one entity per batch of
+// pre-transformed geometry (see StaticBatcher), cutting a
+// material setup and draw call per entity
+// - Each mesh subset is batched with its own material, so
+//   multi-material entities keep their per-subset overrides
+// - meshData has the CPU-side data for each mesh, entities
+//   whose mesh isn't in it are left alone
+// - Other entities keep their order, batches go at the end
+// --------------------------------------------------------
+void Game::BatchStaticEntities(const std::unordered_map<Mesh*, const CookedMesh*>& meshData)
+{
+	std::vector<StaticBatchSource> sources;
+	std::vector<std::shared_ptr<Material>> batchMats; //StaticBatchSource::material indexes this
+	std::vector<EntityHandle> batched; //destroyed once the query is done, it can't change the store itself
+	scene.Each<StaticEntity, TransformRef, MeshRef, MaterialRef>([&](EntityHandle entity, StaticEntity&, TransformRef& transform, MeshRef& mesh, MaterialRef& mats)
+	{
+		auto data = meshData.find(mesh.mesh.get());
+		if (data == meshData.end())
+			return;
+
+		//one source per subset, so each keeps its own material
+		const CookedMesh& cooked = *data->second;
+		MeshSubset whole = {};
+		whole.lods[0] = cooked.lods[0];
+		whole.meshletCount = (unsigned int)cooked.meshlets.size();
+		const MeshSubset* subsets = cooked.subsets.empty() ? &whole : cooked.subsets.data();
+		for (size_t s = 0; s < std::max<size_t>(cooked.subsets.size(), 1); s++)
+		{
+			const std::shared_ptr<Material>& subsetMat = s < mats.subsetMats.size() && mats.subsetMats[s] ? mats.subsetMats[s] : mats.mat;
+			auto mat = std::find(batchMats.begin(), batchMats.end(), subsetMat);
+			if (mat == batchMats.end())
+				mat = batchMats.insert(batchMats.end(), subsetMat);
+
+			const MeshLod& lod0 = subsets[s].lods[0];
+			StaticBatchSource source = {};
+			source.vertices = cooked.vertices.data();
+			source.vertexCount = cooked.vertices.size();
+			source.indices = cooked.indices.data() + lod0.startIndex;
+			source.indexCount = lod0.indexCount;
+			source.meshlets = cooked.meshlets.data() + subsets[s].firstMeshlet;
+			source.meshletCount = subsets[s].meshletCount;
+			source.meshletIndexBase = lod0.startIndex;
+			source.world = transform.transform->GetWorldMatrix();
+			source.material = (unsigned int)(mat - batchMats.begin());
+			sources.push_back(source);
+		}
+		batched.push_back(entity);
+	});
+
+	if (sources.empty())
+		return;
+
+	std::vector<StaticBatch> batches;
+	StaticBatcher::Build(sources.data(), sources.size(), batches);
+
+	for (EntityHandle entity : batched)
+		scene.Destroy(entity);
+	std::erase_if(entities, [&](GameEntity& entity) { return !scene.IsAlive(entity.GetHandle()); });
+	for (const StaticBatch& batch : batches)
+	{
+		std::shared_ptr<Mesh> batchMesh = std::make_shared<Mesh>("static batch", batch.mesh);
+		meshes.push_back(batchMesh);
+		entities.push_back(GameEntity::Create(scene, batchMesh, batchMats[batch.material]));
+	}
+}
+
 void Game::CreateShadowMapResources()
 {
 	shadowOptions.ShadowDSV.Reset();
@@ -491,19 +619,16 @@ void Game::Update(float deltaTime, float totalTime)
 
 	//update entity transforms each frame
 	//float scale = (float)sin(totalTime * 5) * 0.5f + 1.0f;
-	//entities[0]->GetTransform()->SetScale(scale, scale, scale);
+	//entities[0].GetTransform()->SetScale(scale, scale, scale);
 
 	if (cameras.size() > 0)
 	{
 		cameras[activeCameraIndex]->Update(deltaTime);
 	}
 
-	//entity movement
-	entities[0]->GetTransform()->SetPosition(-9, -sin(totalTime), 0);
-	entities[1]->GetTransform()->SetPosition(-6, sin(totalTime), 0);
-	entities[2]->GetTransform()->SetPosition(-3 - sin(totalTime), 0, 0);
-	entities[3]->GetTransform()->SetPosition(0, 0, sin(totalTime));
-	entities[4]->GetTransform()->SetPosition(3 + sin(totalTime), 0, 0);
+	//right click picks whatever is under the mouse
+	if (Input::MouseRightPress())
+		PickEntity();
 
 	//updating lightView matrix if light direction changes
 	XMFLOAT3 lightDirFloat3 = lights[0].Direction;
@@ -515,14 +640,92 @@ void Game::Update(float deltaTime, float totalTime)
 
 	// Store the new matrix
 	XMStoreFloat4x4(&shadowOptions.ShadowViewMatrix, lightView);
+}
 
+// --------------------------------------------------------
+// Moves the simulation on by one fixed step, run as many
+// times a frame as Main's FixedTimestep says (maybe none)
+// - Entities are put back where the last step left them
+//   first, Draw() shows them part way to the next one
+// --------------------------------------------------------
+void Game::FixedUpdate(float stepTime, float simulationTime)
+{
+	scene.Each<TransformRef, TransformHistory>([](EntityHandle, TransformRef& transform, TransformHistory& history)
+	{
+		GameEntity::BeginStep(*transform.transform, history);
+	});
+
+	//entity movement; static entities have no history, so they stay put
+	float swing = sin(simulationTime);
+	scene.Each<TransformRef, TransformHistory, Oscillation>([swing](EntityHandle, TransformRef& transform, TransformHistory&, Oscillation& motion)
+	{
+		transform.transform->SetPosition(
+			motion.center.x + motion.offset.x * swing,
+			motion.center.y + motion.offset.y * swing,
+			motion.center.z + motion.offset.z * swing);
+	});
+
+	scene.Each<TransformRef, TransformHistory>([](EntityHandle, TransformRef& transform, TransformHistory& history)
+	{
+		GameEntity::EndStep(*transform.transform, history);
+	});
+}
+
+// --------------------------------------------------------
+// Casts a ray from the camera through the mouse and keeps
+// the closest entity it hits
+// - The ray runs from the near plane (distance 0) to the
+//   far plane (distance 1), unprojected from both, so the
+//   hit distance is scaled by the ray's length for display
+// --------------------------------------------------------
+void Game::PickEntity()
+{
+	std::shared_ptr<Camera> camera = cameras[activeCameraIndex];
+	XMFLOAT4X4 viewFloat = camera->GetView();
+	XMFLOAT4X4 projFloat = camera->GetProjection();
+	XMMATRIX invViewProj = XMMatrixInverse(0, XMLoadFloat4x4(&viewFloat) * XMLoadFloat4x4(&projFloat));
+
+	float ndcX = (Input::GetMouseX() + 0.5f) / Window::Width() * 2.0f - 1.0f;
+	float ndcY = 1.0f - (Input::GetMouseY() + 0.5f) / Window::Height() * 2.0f;
+	XMVECTOR start = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 0.0f, 1.0f), invViewProj);
+	XMVECTOR end = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 1.0f, 1.0f), invViewProj);
+	XMFLOAT3 origin, direction;
+	XMStoreFloat3(&origin, start);
+	XMStoreFloat3(&direction, end - start);
+	float rayLength = XMVectorGetX(XMVector3Length(end - start));
+
+	//each hit shortens the ray, so farther entities bail out on their bounds
+	pickedEntity = -1;
+	float closest = 1.0f;
+	for (int i = 0; i < entities.size(); i++)
+	{
+		BvhRayHit hit;
+		if (entities[i].Raycast(origin, direction, closest, hit))
+		{
+			pickedEntity = i;
+			pickedHit = hit;
+			pickedDistance = hit.distance * rayLength;
+			closest = hit.distance;
+		}
+	}
 }
 
 // --------------------------------------------------------
 // Clear the screen, redraw everything, present to the user
+// - alpha is how far this frame is between the last two
+//   fixed steps, moving entities are drawn that far along
 // --------------------------------------------------------
-void Game::Draw(float deltaTime, float totalTime)
+void Game::Draw(float deltaTime, float totalTime, float alpha)
 {
+	scene.Each<TransformRef, TransformHistory>([&](EntityHandle, TransformRef& transform, TransformHistory& history)
+	{
+		GameEntity::ShowInterpolated(*transform.transform, history, alpha);
+	});
+
+	//everything that moved this frame gets its matrices in one pass,
+	//so the shadow and main passes only read them
+	transformPool->Update();
+
 	// Frame START
 	// - These things should happen ONCE PER FRAME
 	// - At the beginning of Game::Draw() before drawing *anything*
@@ -531,6 +734,9 @@ void Game::Draw(float deltaTime, float totalTime)
 		const float color[4] = { 0.4f, 0.6f, 0.75f, 0.0f };
 		Graphics::Context->ClearRenderTargetView(Graphics::BackBufferRTV.Get(),	colorPkr);
 		Graphics::Context->ClearDepthStencilView(Graphics::DepthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+
+		// ImGui binds its own buffers at the end of every frame
+		GeometryPool::Invalidate();
 	}
 
 	//post processing pre draw phase
@@ -551,41 +757,50 @@ void Game::Draw(float deltaTime, float totalTime)
 	// - Other Direct3D calls will also be necessary to do more complex things
 	//get matrices from the camera
 	//copy data to constant buffer
-	for (auto& entity : entities)
+	Camera& camera = *cameras[activeCameraIndex];
+	scene.Each<TransformRef, MeshRef, MaterialRef, DrawState>([&](EntityHandle, TransformRef& transform, MeshRef& mesh, MaterialRef& mats, DrawState& state)
 	{
-		std::shared_ptr<SimpleVertexShader> vs = entity->GetMat()->GetVertexShader();
-		vs->SetMatrix4x4("lightView", shadowOptions.ShadowViewMatrix);
-		vs->SetMatrix4x4("lightProjection", shadowOptions.ShadowProjectionMatrix);
-
-		std::shared_ptr<SimplePixelShader> ps = entity->GetMat()->GetPixelShader();
-		ps->SetFloat("time", totalTime);
-		ps->SetFloat3("ambientColor", ambientColor);
-		//entity->GetMat()->GetPixelShader()->SetData("lights", &lights[0], sizeof(Light) * (int)lights.size());
-		ps->SetInt("lightCount", (int)lights.size());
-		ps->SetData(
-			"lights", &lights[0], // The address of the data to set
-			sizeof(Light) * (int)lights.size());// The address of the data to set
-
-		//sending cam pos to pixle shader for specualr lighting
-		ps->SetFloat3("cameraPos", cameras[activeCameraIndex]->GetTransform()->GetPosition());
-
-		ps->SetShaderResourceView("ShadowMap", shadowOptions.ShadowSRV);
-		ps->SetSamplerState("ShadowSampler", shadowSampler);
-
-		//setting fog values
-		ps->SetFloat("farClipDist", cameras[activeCameraIndex]->GetFarCP());
-		ps->SetInt("fogType", fogType);
-		ps->SetFloat3("fogColor", fogColor);
-		ps->SetFloat("fogStartDist", fogStartDist);
-		ps->SetFloat("fogEndDist", fogEndDist);
-		ps->SetFloat("fogDensity", fogDensity);
-		ps->SetInt("heightBasedFog", heightBasedFog);
-		ps->SetFloat("fogHeight", fogHeight);
-		ps->SetFloat("fogVerticalDensity", fogVerticalDensity);
-
-		entity->Draw(cameras[activeCameraIndex]);
+		//every material the entity draws with needs this frame's data
+		for (size_t s = 0; s < mesh.mesh->GetSubsets().size(); s++)
+		{
+			Material* mat = mats.Get(s);
+			for (SimpleVertexShader* vs : { mat->GetVertexShader().get(), mat->GetCompactVertexShader().get() })
+			{
+				if (!vs)
+					continue;
+				vs->SetMatrix4x4("lightView", shadowOptions.ShadowViewMatrix);
+				vs->SetMatrix4x4("lightProjection", shadowOptions.ShadowProjectionMatrix);
+			}
 
-	}
+			std::shared_ptr<SimplePixelShader> ps = mat->GetPixelShader();
+			ps->SetFloat("time", totalTime);
+			ps->SetFloat3("ambientColor", ambientColor);
+			//mat->GetPixelShader()->SetData("lights", &lights[0], sizeof(Light) * (int)lights.size());
+			ps->SetInt("lightCount", (int)lights.size());
+			ps->SetData(
+				"lights", &lights[0], // The address of the data to set
+				sizeof(Light) * (int)lights.size());// The address of the data to set
+
+			//sending cam pos to pixle shader for specualr lighting
+			ps->SetFloat3("cameraPos", cameras[activeCameraIndex]->GetTransform()->GetPosition());
+
+			ps->SetShaderResourceView("ShadowMap", shadowOptions.ShadowSRV);
+			ps->SetSamplerState("ShadowSampler", shadowSampler);
+
+			//setting fog values
+			ps->SetFloat("farClipDist", cameras[activeCameraIndex]->GetFarCP());
+			ps->SetInt("fogType", fogType);
+			ps->SetFloat3("fogColor", fogColor);
+			ps->SetFloat("fogStartDist", fogStartDist);
+			ps->SetFloat("fogEndDist", fogEndDist);
+			ps->SetFloat("fogDensity", fogDensity);
+			ps->SetInt("heightBasedFog", heightBasedFog);
+			ps->SetFloat("fogHeight", fogHeight);
+			ps->SetFloat("fogVerticalDensity", fogVerticalDensity);
+		}
+
+		GameEntity::Draw(*transform.transform, *mesh.mesh, mats, state, camera);
+	});
 
 	sky->Draw(cameras[activeCameraIndex]);
 
@@ -659,14 +874,14 @@ void Game::RenderShadowMap()
 	Graphics::Context->PSSetShader(0, 0, 0);
 
 	// Loop and draw all entities
-	for (auto& e : entities)
+	scene.Each<TransformRef, MeshRef>([&](EntityHandle, TransformRef& transform, MeshRef& mesh)
 	{
-		shadowVS->SetMatrix4x4("world", e->GetTransform()->GetWorldMatrix());
+		shadowVS->SetMatrix4x4("world", transform.GetWorldMatrix());
 		shadowVS->CopyAllBufferData();
-		// Draw the mesh directly to avoid the entity's material
-		// Note: Your code may differ significantly here!
-		e->GetMesh()->Draw();
-	}
+		// Draw the mesh directly to avoid the entity's material,
+		// only positions are needed so use the packed stream
+		mesh.mesh->DrawDepthOnly();
+	});
 
 	//set up output merger stage
 
@@ -725,13 +940,25 @@ void Game::BuildUI()
 		//mesh ui info
 		if (ImGui::CollapsingHeader("Mesh Debug Information"))
 		{
+			//shared buffer usage, free blocks show how fragmented it is
+			const RangeAllocator& poolVerts = geometryPool->GetVertexRanges();
+			const RangeAllocator& poolIndices = geometryPool->GetIndexRanges();
+			ImGui::Text("Pool Vertices: %u / %u (%zu free blocks)", poolVerts.GetUsed(), poolVerts.GetCapacity(), poolVerts.GetFreeBlockCount());
+			ImGui::Text("Pool Indices: %u / %u (%zu free blocks)", poolIndices.GetUsed(), poolIndices.GetCapacity(), poolIndices.GetFreeBlockCount());
+			if (ImGui::Button("Defragment Pool"))
+				geometryPool->Defragment();
+			ImGui::Separator();
+
 			for (size_t i = 0; i < meshes.size(); i++)
 			{
 				auto& mesh = meshes[i];
 				ImGui::Text("Mesh %zu: %s", i, meshes[i]->GetShapeName());
 				ImGui::Text("Triangle Count: %d", (meshes[i]->GetIndexCount()/3));
-				ImGui::Text("Vertex Count: %d", meshes[i]->GetVertexCount());
+				ImGui::Text("Vertex Count: %d (%s)", meshes[i]->GetVertexCount(), meshes[i]->GetCompactParams() ? "compact" : "full");
+				ImGui::Text("Vertex Reduction (Welding): %d -> %d (%.2fx)", meshes[i]->GetSourceVertexCount(), meshes[i]->GetVertexCount(),
+					(float)meshes[i]->GetSourceVertexCount() / max(meshes[i]->GetVertexCount(), 1u));
 				ImGui::Text("Index Count: %d", meshes[i]->GetIndexCount());
+				ImGui::Text("Depth Stream Positions: %d", meshes[i]->GetPositionCount());
 				ImGui::Separator();
 			}
 		}
@@ -739,37 +966,66 @@ void Game::BuildUI()
 		//entity ui info
 		if (ImGui::CollapsingHeader("Entity Debug Information"))
 		{
+			if (pickedEntity >= 0)
+				ImGui::Text("Picked: Entity %d, triangle %u, %.2f units from the near plane (right click to pick)", pickedEntity, pickedHit.triangle, pickedDistance);
+			else
+				ImGui::Text("Picked: nothing (right click to pick)");
 			for (int i = 0; i < entities.size(); i++)
 			{
-				std::shared_ptr<Transform> trans = entities[i]->GetTransform();
+				std::shared_ptr<Transform> trans = entities[i].GetTransform();
 				XMFLOAT3 pos = trans->GetPosition();
 				XMFLOAT3 rot = trans->GetPitchYawRoll();
 				XMFLOAT3 sca = trans->GetScale();
-				XMFLOAT3 colorTint = entities[i]->GetMat()->GetColorTint();
-				XMFLOAT2 uvScale = entities[i]->GetMat()->GetUVScale();
-				XMFLOAT2 uvOffset = entities[i]->GetMat()->GetUVOffset();
+				XMFLOAT3 colorTint = entities[i].GetMat()->GetColorTint();
+				XMFLOAT2 uvScale = entities[i].GetMat()->GetUVScale();
+				XMFLOAT2 uvOffset = entities[i].GetMat()->GetUVOffset();
 				ImGui::PushID(i);
 				if (ImGui::TreeNode("Entity Node", "Entity %d", i))
 				{	
-					ImGui::Text("Mesh Shape: %s", entities[i]->GetMesh()->GetShapeName());
-					ImGui::Text("Material Name: %s", entities[i]->GetMat()->GetName());
-					ImGui::Text("Index Count: %d", entities[i]->GetMesh()->GetIndexCount());
+					ImGui::Text("Mesh Shape: %s", entities[i].GetMesh()->GetShapeName());
+					ImGui::Text("Material Name: %s", entities[i].GetMat()->GetName());
+					ImGui::Text("Index Count: %d", entities[i].GetMesh()->GetIndexCount());
+					ImGui::Text("Meshlets: %d", (int)entities[i].GetMesh()->GetMeshlets().size());
+					ImGui::Text("Triangles Culled: %d / %d", (int)entities[i].GetCulledTriangleCount(), entities[i].GetMesh()->GetIndexCount() / 3);
+					ImGui::Text("LOD: %d of %d", entities[i].GetCurrentLod(), (int)entities[i].GetMesh()->GetLods().size());
+					ImGui::Text("Material Subsets: %d", (int)entities[i].GetSubsetCount());
 					if (ImGui::DragFloat3("Position", &pos.x, 0.01f)) trans->SetPosition(pos);
 					if (ImGui::DragFloat3("Rotation (Radians)", &rot.x, 0.01f)) trans->SetRotation(rot);
 					if (ImGui::DragFloat3("Scale", &sca.x, 0.01f)) trans->SetScale(sca);
+					//attaching keeps the local values, so the entity moves into its parent's space
+					std::shared_ptr<Transform> parent = trans->GetParent();
+					int parentIndex = -1;
+					for (int j = 0; j < entities.size(); j++)
+						if (entities[j].GetTransform() == parent) parentIndex = j;
+					std::string preview = parentIndex < 0 ? "None" : "Entity " + std::to_string(parentIndex);
+					if (ImGui::BeginCombo("Parent", preview.c_str()))
+					{
+						if (ImGui::Selectable("None", parentIndex < 0)) trans->SetParent(nullptr);
+						for (int j = 0; j < entities.size(); j++)
+						{
+							//skip anything that would end up its own ancestor
+							bool cycle = false;
+							for (std::shared_ptr<Transform> t = entities[j].GetTransform(); t; t = t->GetParent())
+								cycle |= t == trans;
+							if (cycle) continue;
+							std::string label = "Entity " + std::to_string(j);
+							if (ImGui::Selectable(label.c_str(), j == parentIndex)) trans->SetParent(entities[j].GetTransform());
+						}
+						ImGui::EndCombo();
+					}
 
 					//material color tint adjsut
 					if (ImGui::ColorEdit4("Color Tint", &colorTint.x))
-						entities[i]->GetMat()->SetColorTint(colorTint);
+						entities[i].GetMat()->SetColorTint(colorTint);
 
 					//UV Scale and Offset Adjust
 					if (ImGui::DragFloat2("UV Scale", &uvScale.x, 0.01f))
-						entities[i]->GetMat()->SetUVScale(uvScale);
+						entities[i].GetMat()->SetUVScale(uvScale);
 					if (ImGui::DragFloat2("UV Offset", &uvOffset.x, 0.01f))
-						entities[i]->GetMat()->SetUVOffset(uvOffset);
+						entities[i].GetMat()->SetUVOffset(uvOffset);
 
 					//for each of the entities textures [there is amax 2 right now]
-					for (auto& it : entities[i]->GetMat()->GetTextureSRVMap())
+					for (auto& it : entities[i].GetMat()->GetTextureSRVMap())
 					{
 						//display texture name
 						ImGui::Text(it.first.c_str());
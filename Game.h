@@ -7,11 +7,13 @@
 #include "GameEntity.h"
 #include <vector>
 #include <memory>
+#include <unordered_map>
 #include <DirectXMath.h>
 #include "Material.h"
 #include "SimpleShader.h"
 #include "Lights.h"
 #include "Sky.h"
+#include "TransformPool.h"
 
 class Game
 {
@@ -25,18 +27,21 @@ public:
 	// Primary functions
 	void Initialize();
 	void Update(float deltaTime, float totalTime);
-	void Draw(float deltaTime, float totalTime);
+	void FixedUpdate(float stepTime, float simulationTime);
+	void Draw(float deltaTime, float totalTime, float alpha);
 	void OnResize();
 
 private:
 
 	// Initialization helper methods - feel free to customize, combine, remove, etc.
 	void CreateGeometry();
+	void BatchStaticEntities(const std::unordered_map<Mesh*, const CookedMesh*>& meshData);
 	void ImGuiFrame(float deltaTime);
 	void BuildUI();
 	void CreateShadowMapResources();
 	void CreatePostProcessingResources();
 	void RenderShadowMap();
+	void PickEntity();
 
 	// Note the usage of ComPtr below
 	//  - This is a smart pointer for objects that abide by the
@@ -65,13 +70,27 @@ private:
 	//window toggle button
 	bool demoWindowShown = false;
 
+	//shared vertex/index buffers for the meshes
+	std::shared_ptr<GeometryPool> geometryPool;
+
+	//every transform's data, matrices rebuilt once per frame
+	std::shared_ptr<TransformPool> transformPool;
+
+	//every entity's components, grouped by archetype so the per frame loops run over arrays
+	EntityStore scene;
+
 	//meshes / entities / cameras stored in vectors
 	std::vector<std::shared_ptr<Mesh>> meshes;
-	std::vector<std::shared_ptr<GameEntity>> entities;
+	std::vector<GameEntity> entities; //in the order the UI lists them, components live in scene
 	std::vector < std::shared_ptr<Material>> mats;
 	std::vector<std::shared_ptr<Camera>> cameras;
 	int activeCameraIndex;
 
+	//last right click pick, -1 when it missed everything
+	int pickedEntity = -1;
+	BvhRayHit pickedHit = {};
+	float pickedDistance = 0.0f;  //world units from the near plane
+
 	DirectX::XMFLOAT4 meshColor = DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);  //white
 	DirectX::XMFLOAT3 meshOffset = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);       // no offset
 
@@ -1,31 +1,313 @@
 #include "GameEntity.h"
 #include "BufferStructs.h"
 #include "Graphics.h"
+#include "Window.h"
+#include <cmath>
 
 using namespace DirectX;
 
-GameEntity::GameEntity(std::shared_ptr<Mesh> mesh,
-	std::shared_ptr<Material> mat) : 
-	mesh(mesh), 
-	mat(mat), 
-	transform(std::make_shared<Transform>())
+namespace
 {
-	transform = std::make_shared<Transform>();
+	// Largest simplification error allowed on screen, in pixels
+	const float LodPixelError = 1.0f;
+
+	// Only switch to a coarser LOD once its error is comfortably under the
+	// limit, so objects sitting right at a threshold don't flicker between LODs
+	const float LodHysteresis = 0.75f;
+
+	bool Equal(const XMFLOAT3& a, const XMFLOAT3& b) { return a.x == b.x && a.y == b.y && a.z == b.z; }
+
+	XMFLOAT3 Lerp(const XMFLOAT3& a, const XMFLOAT3& b, float t)
+	{
+		XMFLOAT3 result;
+		XMStoreFloat3(&result, XMVectorLerp(XMLoadFloat3(&a), XMLoadFloat3(&b), t));
+		return result;
+	}
+}
+
+GameEntity::GameEntity(EntityStore& store, EntityHandle handle) : store(&store), handle(handle)
+{
+}
+
+GameEntity GameEntity::Create(EntityStore& store, std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> mat)
+{
+	return GameEntity(store, store.Create(TransformRef{ std::make_shared<Transform>() }, MeshRef{ mesh }, MaterialRef{ mat, {} }, DrawState(), TransformHistory()));
 }
 
 //getters
-std::shared_ptr<Mesh> GameEntity::GetMesh() { return mesh; }
-std::shared_ptr<Transform> GameEntity::GetTransform() { return transform; }
-std::shared_ptr<Material> GameEntity::GetMat() { return mat; }
+std::shared_ptr<Mesh> GameEntity::GetMesh() { return store->Get<MeshRef>(handle)->mesh; }
+std::shared_ptr<Transform> GameEntity::GetTransform() { return store->Get<TransformRef>(handle)->transform; }
+std::shared_ptr<Material> GameEntity::GetMat() { return store->Get<MaterialRef>(handle)->mat; }
+std::shared_ptr<Material> GameEntity::GetSubsetMat(size_t subset)
+{
+	const MaterialRef& mats = *store->Get<MaterialRef>(handle);
+	return subset < mats.subsetMats.size() && mats.subsetMats[subset] ? mats.subsetMats[subset] : mats.mat;
+}
+const BoundingVolumes& GameEntity::GetWorldBounds()
+{
+	return GetWorldBounds(*GetTransform(), *GetMesh(), *store->Get<DrawState>(handle));
+}
+const BoundingVolumes& GameEntity::GetWorldBounds(Transform& transform, Mesh& mesh, DrawState& state)
+{
+	unsigned int version = transform.GetWorldMatrixVersion();
+	if (!state.worldBoundsValid || version != state.worldBoundsVersion)
+	{
+		state.worldBounds = MeshBounds::Transform(mesh.GetBounds(), transform.GetWorldMatrix());
+		state.worldBoundsVersion = version;
+		state.worldBoundsValid = true;
+	}
+	return state.worldBounds;
+}
 
 //setters
-void GameEntity::SetMesh(std::shared_ptr<Mesh> mesh) { this->mesh = mesh; }
-void GameEntity::SetMat(std::shared_ptr<Material> mat) { this->mat = mat; }
+void GameEntity::SetMesh(std::shared_ptr<Mesh> mesh)
+{
+	store->Get<MeshRef>(handle)->mesh = mesh;
+	store->Get<DrawState>(handle)->worldBoundsValid = false;
+}
+void GameEntity::SetMat(std::shared_ptr<Material> mat) { store->Get<MaterialRef>(handle)->mat = mat; }
+void GameEntity::SetSubsetMat(size_t subset, std::shared_ptr<Material> mat)
+{
+	std::vector<std::shared_ptr<Material>>& subsetMats = store->Get<MaterialRef>(handle)->subsetMats;
+	if (subset >= subsetMats.size())
+		subsetMats.resize(subset + 1);
+	subsetMats[subset] = mat;
+}
+void GameEntity::SetStatic(bool isStatic)
+{
+	//static entities get their own archetype, so batching only visits them
+	if (isStatic)
+	{
+		store->Add(handle, StaticEntity());
+		store->Remove<TransformHistory>(handle);
+	}
+	else
+	{
+		store->Remove<StaticEntity>(handle);
+		store->Add(handle, TransformHistory());
+	}
+}
 
 //other methods
-void GameEntity::Draw(std::shared_ptr<Camera> camera)
+// - Entities entirely outside the view are skipped before anything else
+// - The geometry is bound once, then each subset of the mesh
+//   is drawn with its own material
+void GameEntity::Draw(Transform& transform, Mesh& mesh, const MaterialRef& mats, DrawState& state, Camera& camera)
 {
-	mat->PrepareMaterial(transform, camera);
+	//drawing is single threaded, so one list of ranges does for every entity
+	static std::vector<IndexRange> visibleRanges;
+
+	const std::vector<MeshSubset>& subsets = mesh.GetSubsets();
+	Material* prepared = nullptr;
+	auto prepare = [&](size_t subset)
+	{
+		//neighbouring subsets often share a material
+		Material* subsetMat = mats.Get(subset);
+		if (subsetMat != prepared)
+			subsetMat->PrepareMaterial(transform, camera, mesh.GetCompactParams());
+		prepared = subsetMat;
+	};
+
+	XMFLOAT4X4 viewFloat = camera.GetView();
+	XMFLOAT4X4 projFloat = camera.GetProjection();
+	XMFLOAT3 cameraPos = camera.GetTransform()->GetPosition();
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, XMLoadFloat4x4(&viewFloat) * XMLoadFloat4x4(&projFloat));
+	MeshletCullParams viewParams = Meshlets::MakeCullParams(viewProj, cameraPos, false);
+
+	//nothing to draw when the whole entity is outside the view
+	if (!MeshBounds::IntersectsFrustum(GetWorldBounds(transform, mesh, state), viewParams.frustum))
+	{
+		state.culledTriangles = mesh.GetIndexCount() / 3;
+		return;
+	}
+
+	XMFLOAT4X4 worldFloat = transform.GetWorldMatrix();
+	state.currentLod = SelectLod(transform, mesh, state, camera);
+	state.culledTriangles = 0;
+	if (state.currentLod > 0)
+	{
+		//simplified LODs are small enough to just draw whole
+		mesh.SetBuffers();
+		for (size_t i = 0; i < subsets.size(); i++)
+		{
+			const MeshLod& lod = subsets[i].lods[state.currentLod];
+			IndexRange range = { lod.startIndex, lod.indexCount };
+			prepare(i);
+			mesh.DrawRanges(&range, 1);
+		}
+		return;
+	}
 
-	mesh->Draw();
-}
\ No newline at end of file
+	//cull meshlets in the mesh's local space so their bounds can be used as-is
+	XMMATRIX world = XMLoadFloat4x4(&worldFloat);
+	XMMATRIX worldViewProj = world * XMLoadFloat4x4(&viewFloat) * XMLoadFloat4x4(&projFloat);
+
+	XMVECTOR det;
+	XMMATRIX invWorld = XMMatrixInverse(&det, world);
+	XMFLOAT3 localCameraPos;
+	XMStoreFloat3(&localCameraPos, XMVector3TransformCoord(XMLoadFloat3(&cameraPos), invWorld));
+
+	//mirrored transforms flip the winding, so the backface cones would be inside out
+	XMFLOAT4X4 wvp;
+	XMStoreFloat4x4(&wvp, worldViewProj);
+	MeshletCullParams cullParams = Meshlets::MakeCullParams(wvp, localCameraPos, XMVectorGetX(det) > 0.0f);
+
+	const std::vector<Meshlet>& meshlets = mesh.GetMeshlets();
+	mesh.SetBuffers();
+	for (size_t i = 0; i < subsets.size(); i++)
+	{
+		visibleRanges.clear();
+		state.culledTriangles += Meshlets::Cull(meshlets.data() + subsets[i].firstMeshlet, subsets[i].meshletCount, cullParams, visibleRanges);
+		if (visibleRanges.empty())
+			continue;
+
+		prepare(i);
+		mesh.DrawRanges(visibleRanges.data(), visibleRanges.size());
+	}
+}
+
+
+// --------------------------------------------------------
+// Rays are moved into the mesh's local space rather than
+// the BVH into world space
+// - The direction isn't renormalized there, so hit distances
+//   along it stay the same in both spaces, scaled or not
+// --------------------------------------------------------
+bool GameEntity::Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, BvhRayHit& hit)
+{
+	return Raycast(*GetTransform(), *GetMesh(), *store->Get<DrawState>(handle), origin, direction, maxDistance, hit);
+}
+
+bool GameEntity::Raycast(Transform& transform, Mesh& mesh, DrawState& state,
+	const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, BvhRayHit& hit)
+{
+	const MeshBvh* bvh = mesh.GetBvh();
+	if (!bvh || !MeshBounds::IntersectsRay(GetWorldBounds(transform, mesh, state), origin, direction, maxDistance))
+		return false;
+
+	//the inverse transpose is already kept up to date, transposing it back is cheaper than inverting
+	XMFLOAT4X4 invTransposeFloat = transform.GetWorldInverseTransposeMatrix();
+	XMMATRIX invWorld = XMMatrixTranspose(XMLoadFloat4x4(&invTransposeFloat));
+
+	BvhRay ray;
+	XMStoreFloat3(&ray.origin, XMVector3TransformCoord(XMLoadFloat3(&origin), invWorld));
+	XMStoreFloat3(&ray.direction, XMVector3TransformNormal(XMLoadFloat3(&direction), invWorld));
+	ray.maxDistance = maxDistance;
+	return bvh->Intersect(ray, hit);
+}
+
+
+// --------------------------------------------------------
+// Picks the coarsest LOD whose simplification error would
+// project to less than LodPixelError pixels, measured at
+// the closest point of the mesh's bounding sphere
+// --------------------------------------------------------
+unsigned int GameEntity::SelectLod(Transform& transform, Mesh& mesh, DrawState& state, Camera& camera)
+{
+	const std::vector<MeshLod>& lods = mesh.GetLods();
+	if (lods.size() <= 1)
+		return 0;
+
+	//errors scale with the world matrix's longest row (its biggest scale axis,
+	//parents included), which keeps them conservative
+	const BoundingVolumes& bounds = GetWorldBounds(transform, mesh, state);
+	XMFLOAT4X4 world = transform.GetWorldMatrix();
+	float maxScale = 0.0f;
+	for (int row = 0; row < 3; row++)
+		maxScale = max(maxScale, XMVectorGetX(XMVector3Length(XMVectorSet(world.m[row][0], world.m[row][1], world.m[row][2], 0.0f))));
+
+	XMFLOAT3 cameraPos = camera.GetTransform()->GetPosition();
+	float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.sphereCenter) - XMLoadFloat3(&cameraPos))) - bounds.sphereRadius;
+	if (distance <= 0.0f)
+		return 0;
+
+	//how many pixels one world unit covers at that distance
+	float pixelsPerUnit = Window::Height() / (2.0f * distance * tanf(camera.Getfov() * 0.5f));
+	auto pixelError = [&](size_t lod) { return lods[lod].error * maxScale * pixelsPerUnit; };
+
+	size_t lod = min((size_t)state.currentLod, lods.size() - 1);
+	if (pixelError(lod) > LodPixelError)
+	{
+		while (lod > 0 && pixelError(lod) > LodPixelError)
+			lod--;
+	}
+	else
+	{
+		while (lod + 1 < lods.size() && pixelError(lod + 1) <= LodPixelError * LodHysteresis)
+			lod++;
+	}
+	return (unsigned int)lod;
+}
+
+
+// --------------------------------------------------------
+// Fixed step interpolation
+// - Between steps the transform holds what was last shown,
+//   so the stepped values go back in before the next step
+//   or the next blend
+// - Anything changed since it was shown (the UI, a parent
+//   being reassigned) was set from outside the steps and is
+//   kept as both ends, so it sticks and doesn't blend
+// - Only what differs gets set, so entities the steps leave
+//   alone don't dirty their matrices every frame
+// --------------------------------------------------------
+void GameEntity::RestoreStepped(Transform& transform, TransformHistory& history)
+{
+	if (!history.shown)
+		return;
+	history.shown = false;
+
+	XMFLOAT3 position = transform.GetPosition();
+	if (!Equal(position, history.shownPosition))
+		history.previousPosition = history.position = position;
+	else if (!Equal(position, history.position))
+		transform.SetPosition(history.position);
+
+	XMFLOAT3 rotation = transform.GetPitchYawRoll();
+	if (!Equal(rotation, history.shownRotation))
+		history.previousRotation = history.rotation = rotation;
+	else if (!Equal(rotation, history.rotation))
+		transform.SetRotation(history.rotation);
+
+	XMFLOAT3 scale = transform.GetScale();
+	if (!Equal(scale, history.shownScale))
+		history.previousScale = history.scale = scale;
+	else if (!Equal(scale, history.scale))
+		transform.SetScale(history.scale);
+}
+
+void GameEntity::BeginStep(Transform& transform, TransformHistory& history)
+{
+	RestoreStepped(transform, history);
+	history.previousPosition = transform.GetPosition();
+	history.previousRotation = transform.GetPitchYawRoll();
+	history.previousScale = transform.GetScale();
+}
+
+void GameEntity::EndStep(Transform& transform, TransformHistory& history)
+{
+	history.position = transform.GetPosition();
+	history.rotation = transform.GetPitchYawRoll();
+	history.scale = transform.GetScale();
+	history.stepped = true;
+}
+
+void GameEntity::ShowInterpolated(Transform& transform, TransformHistory& history, float alpha)
+{
+	RestoreStepped(transform, history);
+	if (!history.stepped)
+		return;
+
+	history.shownPosition = Lerp(history.previousPosition, history.position, alpha);
+	history.shownRotation = Lerp(history.previousRotation, history.rotation, alpha);
+	history.shownScale = Lerp(history.previousScale, history.scale, alpha);
+	history.shown = true;
+
+	if (!Equal(history.shownPosition, transform.GetPosition()))
+		transform.SetPosition(history.shownPosition);
+	if (!Equal(history.shownRotation, transform.GetPitchYawRoll()))
+		transform.SetRotation(history.shownRotation);
+	if (!Equal(history.shownScale, transform.GetScale()))
+		transform.SetScale(history.shownScale);
+}
@@ -1,32 +1,156 @@
 #pragma once
 #include <wrl/client.h>
 #include <memory>
+#include <vector>
+#include "EntityStore.h"
 #include "Mesh.h"
 #include "Transform.h"
+#include "TransformPool.h"
 #include "Camera.h"
 #include "Material.h"
 
+// Components of an entity that gets drawn, kept in an EntityStore
+// - Transforms, meshes and materials stay shared, the UI and
+//   parenting hold on to them too
+struct TransformRef
+{
+	std::shared_ptr<Transform> transform;
+
+	//the pool slot behind transform, so loops that only read matrices
+	//go straight to the pool's arrays rather than through each Transform
+	TransformPool* pool;
+	uint32_t slot;
+
+	TransformRef(std::shared_ptr<Transform> transform) : transform(transform), pool(transform->GetPool()), slot(transform->GetPoolSlot()) {}
+
+	DirectX::XMFLOAT4X4 GetWorldMatrix() const
+	{
+		if (!pool)
+			return transform->GetWorldMatrix();
+		pool->UpdateSlot(slot);
+		return pool->GetWorldMatrix(slot);
+	}
+};
+
+struct MeshRef
+{
+	std::shared_ptr<Mesh> mesh;
+};
+
+struct MaterialRef
+{
+	std::shared_ptr<Material> mat;
+
+	//per mesh subset overrides of mat, null where there isn't one
+	std::vector<std::shared_ptr<Material>> subsetMats;
+
+	Material* Get(size_t subset) const { return subset < subsetMats.size() && subsetMats[subset] ? subsetMats[subset].get() : mat.get(); }
+};
+
+// What drawing worked out last time
+struct DrawState
+{
+	//meshlet culling results from the last Draw()
+	size_t culledTriangles = 0;
+
+	//level of detail used last frame, kept for hysteresis
+	unsigned int currentLod = 0;
+
+	//world space bounds and the transform version they were made from
+	BoundingVolumes worldBounds = {};
+	unsigned int worldBoundsVersion = 0;
+	bool worldBoundsValid = false;
+};
+
+// Never moves, so it can be batched
+struct StaticEntity
+{
+};
+
+// Swings back and forth, center + offset * sin(time), on every
+// fixed step (see Game::FixedUpdate)
+struct Oscillation
+{
+	DirectX::XMFLOAT3 center;
+	DirectX::XMFLOAT3 offset;
+};
+
+// Where the fixed steps last left an entity, so frames between
+// steps can draw it part way (see GameEntity::ShowInterpolated)
+// - Rotations are pitch/yaw/roll like Transform's, and blended
+//   that way too; fine for the small turns of one step
+struct TransformHistory
+{
+	//before and after the latest step
+	DirectX::XMFLOAT3 previousPosition, previousRotation, previousScale;
+	DirectX::XMFLOAT3 position, rotation, scale;
+
+	//what was put in the transform to be drawn, anything else found there was set from outside the steps
+	DirectX::XMFLOAT3 shownPosition, shownRotation, shownScale;
+
+	bool stepped = false;	//nothing to blend before the first step
+	bool shown = false;		//the transform holds the shown values rather than the stepped ones
+};
+
+
+// --------------------------------------------------------
+// One drawn entity in an EntityStore, with getters and
+// setters over its components
+//
+// - Just a handle and the store, cheap to copy; it stops
+//   working once the entity is destroyed
+// - Per frame loops query the components instead of going
+//   through this, so Draw() and the rest have static versions
+//   that work straight on them
+// --------------------------------------------------------
 class GameEntity
 {
 public:
-	GameEntity(std::shared_ptr<Mesh> mesh,
-		std::shared_ptr<Material> mat);
-	
+	GameEntity(EntityStore& store, EntityHandle handle);
+
+	//a new entity with everything drawing and interpolation need, at the origin
+	static GameEntity Create(EntityStore& store, std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> mat);
+
 	//getters
+	EntityHandle GetHandle() { return handle; }
 	std::shared_ptr<Mesh> GetMesh();
 	std::shared_ptr<Transform> GetTransform();
 	std::shared_ptr<Material> GetMat();
+	std::shared_ptr<Material> GetSubsetMat(size_t subset); //falls back to GetMat()
+	size_t GetSubsetCount() { return GetMesh()->GetSubsets().size(); }
+	size_t GetCulledTriangleCount() { return store->Get<DrawState>(handle)->culledTriangles; }
+	unsigned int GetCurrentLod() { return store->Get<DrawState>(handle)->currentLod; }
+	bool IsStatic() { return store->Has<StaticEntity>(handle); }
+	const BoundingVolumes& GetWorldBounds(); //the mesh's bounds moved by the transform, redone only after either changes
 
 	//setters
 	void SetMesh(std::shared_ptr<Mesh> mesh);
 	void SetMat(std::shared_ptr<Material> mat);
+	void SetSubsetMat(size_t subset, std::shared_ptr<Material> mat); //nullptr goes back to GetMat()
+	void SetStatic(bool isStatic); //never moves, so it can be batched (and isn't interpolated)
+
+	//closest hit of a world space ray on the mesh, maxDistance and the hit
+	//distance are in multiples of direction; false if nothing is hit or
+	//the mesh has no BVH (see Mesh::SetBuildBvhs)
+	bool Raycast(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance, BvhRayHit& hit);
+
+	//the same over components
+	static void Draw(Transform& transform, Mesh& mesh, const MaterialRef& mats, DrawState& state, Camera& camera);
+	static const BoundingVolumes& GetWorldBounds(Transform& transform, Mesh& mesh, DrawState& state);
+	static bool Raycast(Transform& transform, Mesh& mesh, DrawState& state,
+		const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance, BvhRayHit& hit);
 
-	//other methods
-	void Draw(std::shared_ptr<Camera> camera);
+	//fixed step interpolation: BeginStep() and EndStep() go either side of
+	//each step's changes, ShowInterpolated() puts the transform alpha of the
+	//way from the last step's start to its end for drawing
+	static void BeginStep(Transform& transform, TransformHistory& history);
+	static void EndStep(Transform& transform, TransformHistory& history);
+	static void ShowInterpolated(Transform& transform, TransformHistory& history, float alpha);
 
 private:
-	std::shared_ptr<Mesh> mesh;
-	std::shared_ptr<Transform> transform;
-	std::shared_ptr<Material> mat;
-};
+	EntityStore* store;
+	EntityHandle handle;
 
+	static unsigned int SelectLod(Transform& transform, Mesh& mesh, DrawState& state, Camera& camera);
+	static void RestoreStepped(Transform& transform, TransformHistory& history);
+};
@@ -0,0 +1,144 @@
+#include "GeometryPool.h"
+#include "Graphics.h"
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+	Microsoft::WRL::ComPtr<ID3D11Buffer> CreatePoolBuffer(UINT byteWidth, UINT bindFlags)
+	{
+		//default usage so ranges can be updated and copied around
+		D3D11_BUFFER_DESC desc = {};
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.ByteWidth = byteWidth;
+		desc.BindFlags = bindFlags;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+		if (FAILED(Graphics::Device->CreateBuffer(&desc, 0, buffer.GetAddressOf())))
+			throw std::runtime_error("Could not create geometry pool buffer");
+		return buffer;
+	}
+
+	D3D11_BOX ByteRange(uint32_t first, uint32_t count, UINT stride)
+	{
+		D3D11_BOX box = {};
+		box.left = first * stride;
+		box.right = (first + count) * stride;
+		box.bottom = 1;
+		box.back = 1;
+		return box;
+	}
+}
+
+GeometryPool::GeometryPool(unsigned int vertexCapacity, unsigned int indexCapacity, unsigned int vertexStride) :
+	vertexRanges(vertexCapacity),
+	indexRanges(indexCapacity),
+	vertexStride(vertexStride)
+{
+	vertexBuffer = CreatePoolBuffer(vertexCapacity * vertexStride, D3D11_BIND_VERTEX_BUFFER);
+	indexBuffer = CreatePoolBuffer(indexCapacity * sizeof(uint16_t), D3D11_BIND_INDEX_BUFFER);
+}
+
+
+GeometryAllocation GeometryPool::Add(const void* verts, size_t numVerts, const unsigned int* indices, size_t numIndices)
+{
+	if (!Fits(numVerts))
+		throw std::invalid_argument("Mesh has too many vertices for 16-bit pool indices");
+
+	GeometryAllocation allocation = {};
+	allocation.vertices = Allocate(vertexRanges, vertexBuffer, vertexStride, D3D11_BIND_VERTEX_BUFFER, (uint32_t)numVerts);
+	allocation.indices = Allocate(indexRanges, indexBuffer, sizeof(uint16_t), D3D11_BIND_INDEX_BUFFER, (uint32_t)numIndices);
+
+	D3D11_BOX vertexBox = ByteRange(vertexRanges.GetOffset(allocation.vertices), (uint32_t)numVerts, vertexStride);
+	Graphics::Context->UpdateSubresource(vertexBuffer.Get(), 0, &vertexBox, verts, 0, 0);
+
+	std::vector<uint16_t> shortIndices(indices, indices + numIndices);
+	D3D11_BOX indexBox = ByteRange(indexRanges.GetOffset(allocation.indices), (uint32_t)numIndices, sizeof(uint16_t));
+	Graphics::Context->UpdateSubresource(indexBuffer.Get(), 0, &indexBox, shortIndices.data(), 0, 0);
+	return allocation;
+}
+
+
+void GeometryPool::Remove(const GeometryAllocation& allocation)
+{
+	vertexRanges.Free(allocation.vertices);
+	indexRanges.Free(allocation.indices);
+}
+
+
+void GeometryPool::Defragment()
+{
+	Repack(vertexRanges, vertexBuffer, vertexStride, D3D11_BIND_VERTEX_BUFFER);
+	Repack(indexRanges, indexBuffer, sizeof(uint16_t), D3D11_BIND_INDEX_BUFFER);
+}
+
+
+void GeometryPool::Bind()
+{
+	if (boundPool == this)
+		return;
+
+	UINT stride = vertexStride;
+	UINT offset = 0;
+	Graphics::Context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
+	Graphics::Context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R16_UINT, 0);
+	boundPool = this;
+}
+
+
+// --------------------------------------------------------
+// Allocates from ranges, and if nothing fits, defragments
+// (when there's enough free space in total) or grows the
+// buffer to make room
+// --------------------------------------------------------
+RangeHandle GeometryPool::Allocate(RangeAllocator& ranges, Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer, UINT stride, UINT bindFlags, uint32_t size)
+{
+	RangeHandle handle = ranges.Allocate(size);
+	if (handle != InvalidRange)
+		return handle;
+
+	if (ranges.GetCapacity() - ranges.GetUsed() >= size)
+	{
+		Repack(ranges, buffer, stride, bindFlags);
+		return ranges.Allocate(size);
+	}
+
+	//copy everything over as-is, the new space goes on the end
+	uint32_t oldCapacity = ranges.GetCapacity();
+	uint32_t newCapacity = max(oldCapacity * 2, ranges.GetUsed() + size);
+	Microsoft::WRL::ComPtr<ID3D11Buffer> grown = CreatePoolBuffer(newCapacity * stride, bindFlags);
+	D3D11_BOX box = ByteRange(0, oldCapacity, stride);
+	Graphics::Context->CopySubresourceRegion(grown.Get(), 0, 0, 0, 0, buffer.Get(), 0, &box);
+	buffer = grown;
+	ranges.Grow(newCapacity);
+	Invalidate();
+	return ranges.Allocate(size);
+}
+
+
+// --------------------------------------------------------
+// Copies every live range to its defragmented offset in a
+// new buffer (copies within one buffer can't overlap)
+// --------------------------------------------------------
+void GeometryPool::Repack(RangeAllocator& ranges, Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer, UINT stride, UINT bindFlags)
+{
+	std::vector<RangeMove> moves = ranges.Defragment();
+	Microsoft::WRL::ComPtr<ID3D11Buffer> packed = CreatePoolBuffer(ranges.GetCapacity() * stride, bindFlags);
+
+	//ranges that were already next to each other go in one copy
+	for (size_t i = 0; i < moves.size();)
+	{
+		uint32_t from = moves[i].from;
+		uint32_t to = moves[i].to;
+		uint32_t count = 0;
+		do
+		{
+			count += moves[i].size;
+			i++;
+		} while (i < moves.size() && moves[i].from == from + count);
+
+		D3D11_BOX box = ByteRange(from, count, stride);
+		Graphics::Context->CopySubresourceRegion(packed.Get(), 0, to * stride, 0, 0, buffer.Get(), 0, &box);
+	}
+	buffer = packed;
+	Invalidate();
+}
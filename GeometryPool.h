@@ -0,0 +1,68 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include "RangeAllocator.h"
+#include "Vertex.h"
+
+// Where one mesh's geometry lives inside a GeometryPool
+struct GeometryAllocation
+{
+	RangeHandle vertices;
+	RangeHandle indices;
+};
+
+
+// --------------------------------------------------------
+// One big vertex buffer and index buffer shared by many
+// meshes, so drawing them doesn't rebind anything
+//
+// - Indices are 16-bit and relative to the mesh's first
+//   vertex (drawn with a base vertex), so only meshes with
+//   up to 65536 vertices fit
+// - Buffers grow (doubling) when an allocation doesn't fit,
+//   defragmenting first if that would be enough
+// - Offsets change when defragmenting, so always ask for
+//   them at draw time rather than keeping them around
+// - Every mesh in a pool has the same vertex layout, Vertex
+//   or CompactVertex, picked by the stride it's created with
+// --------------------------------------------------------
+class GeometryPool
+{
+public:
+	GeometryPool(unsigned int vertexCapacity, unsigned int indexCapacity, unsigned int vertexStride = sizeof(Vertex));
+
+	static bool Fits(size_t numVerts) { return numVerts <= 65536; }
+
+	GeometryAllocation Add(const void* verts, size_t numVerts, const unsigned int* indices, size_t numIndices); //vertexStride bytes per vertex
+	void Remove(const GeometryAllocation& allocation);
+
+	// Packs everything to the front of fresh buffers
+	void Defragment();
+
+	// Binds the buffers unless they already are, see Invalidate()
+	void Bind();
+
+	// Call whenever something else may have bound vertex or index
+	// buffers (other meshes, UI, the start of a frame)
+	static void Invalidate() { boundPool = nullptr; }
+
+	unsigned int GetBaseVertex(const GeometryAllocation& allocation) const { return vertexRanges.GetOffset(allocation.vertices); }
+	unsigned int GetStartIndex(const GeometryAllocation& allocation) const { return indexRanges.GetOffset(allocation.indices); }
+	unsigned int GetVertexStride() const { return vertexStride; }
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer() { return vertexBuffer; }
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer() { return indexBuffer; }
+	const RangeAllocator& GetVertexRanges() const { return vertexRanges; }
+	const RangeAllocator& GetIndexRanges() const { return indexRanges; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+	RangeAllocator vertexRanges;
+	RangeAllocator indexRanges;
+	unsigned int vertexStride;
+
+	inline static GeometryPool* boundPool = nullptr;
+
+	RangeHandle Allocate(RangeAllocator& ranges, Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer, UINT stride, UINT bindFlags, uint32_t size);
+	void Repack(RangeAllocator& ranges, Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer, UINT stride, UINT bindFlags);
+};
@@ -0,0 +1,754 @@
+#include "GlbLoader.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t GlbMagic = 0x46546C67;		// "glTF"
+	const uint32_t GlbChunkJson = 0x4E4F534A;	// "JSON"
+	const uint32_t GlbChunkBin = 0x004E4942;	// "BIN\0"
+
+	//glTF accessor component types
+	const unsigned int ComponentByte = 5120;
+	const unsigned int ComponentUnsignedByte = 5121;
+	const unsigned int ComponentShort = 5122;
+	const unsigned int ComponentUnsignedShort = 5123;
+	const unsigned int ComponentUnsignedInt = 5125;
+	const unsigned int ComponentFloat = 5126;
+
+	//glTF primitive modes
+	const unsigned int ModeTriangles = 4;
+	const unsigned int ModeTriangleStrip = 5;
+	const unsigned int ModeTriangleFan = 6;
+
+	//deeper than any real glTF, just keeps bad files from blowing the stack
+	const int MaxJsonDepth = 64;
+
+	enum JsonType { JsonNull, JsonBool, JsonNumber, JsonString, JsonArray, JsonObject };
+
+	// Just enough of a JSON DOM for glTF
+	struct JsonValue
+	{
+		JsonType type = JsonNull;
+		bool boolean = false;
+		double number = 0.0;
+		std::string string;
+		std::vector<JsonValue> items;
+		std::vector<std::pair<std::string, JsonValue>> members;
+
+		// Missing members and items come back as null
+		const JsonValue& operator[](const char* key) const
+		{
+			static const JsonValue null;
+			for (auto& member : members)
+			{
+				if (member.first == key)
+					return member.second;
+			}
+			return null;
+		}
+
+		const JsonValue& operator[](size_t index) const
+		{
+			static const JsonValue null;
+			return index < items.size() ? items[index] : null;
+		}
+
+		bool IsNull() const { return type == JsonNull; }
+		size_t Size() const { return items.size(); }
+		double Number(double fallback) const { return type == JsonNumber ? number : fallback; }
+
+		// For glTF's integer properties (indices, counts, enums)
+		size_t Index(size_t fallback) const
+		{
+			if (type != JsonNumber)
+				return fallback;
+			if (number < 0.0 || number != floor(number))
+				throw std::invalid_argument("glTF index isn't a non-negative integer");
+			return (size_t)number;
+		}
+	};
+
+	// Recursive descent, throws on anything malformed
+	class JsonParser
+	{
+	public:
+		JsonParser(const char* data, size_t size) : p(data), end(data + size) {}
+
+		JsonValue ParseDocument()
+		{
+			JsonValue value = ParseValue(0);
+			SkipWhitespace();
+			if (p != end)
+				Fail();
+			return value;
+		}
+
+	private:
+		const char* p;
+		const char* end;
+
+		[[noreturn]] void Fail() { throw std::invalid_argument("Invalid glTF JSON"); }
+
+		void SkipWhitespace()
+		{
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+		}
+
+		void Expect(char c)
+		{
+			SkipWhitespace();
+			if (p >= end || *p != c)
+				Fail();
+			p++;
+		}
+
+		bool Literal(const char* text)
+		{
+			size_t length = strlen(text);
+			if ((size_t)(end - p) < length || memcmp(p, text, length) != 0)
+				return false;
+			p += length;
+			return true;
+		}
+
+		JsonValue ParseValue(int depth)
+		{
+			if (depth > MaxJsonDepth)
+				Fail();
+
+			SkipWhitespace();
+			if (p >= end)
+				Fail();
+
+			JsonValue value;
+			if (*p == '{')
+			{
+				value.type = JsonObject;
+				p++;
+				SkipWhitespace();
+				if (p < end && *p == '}') { p++; return value; }
+				while (true)
+				{
+					SkipWhitespace();
+					std::string key = ParseString();
+					Expect(':');
+					value.members.emplace_back(std::move(key), ParseValue(depth + 1));
+					SkipWhitespace();
+					if (p < end && *p == ',') { p++; continue; }
+					Expect('}');
+					return value;
+				}
+			}
+			if (*p == '[')
+			{
+				value.type = JsonArray;
+				p++;
+				SkipWhitespace();
+				if (p < end && *p == ']') { p++; return value; }
+				while (true)
+				{
+					value.items.push_back(ParseValue(depth + 1));
+					SkipWhitespace();
+					if (p < end && *p == ',') { p++; continue; }
+					Expect(']');
+					return value;
+				}
+			}
+			if (*p == '"')
+			{
+				value.type = JsonString;
+				value.string = ParseString();
+				return value;
+			}
+			if (Literal("true")) { value.type = JsonBool; value.boolean = true; return value; }
+			if (Literal("false")) { value.type = JsonBool; return value; }
+			if (Literal("null")) return value;
+
+			//locale independent, unlike strtod
+			auto result = std::from_chars(p, end, value.number);
+			if (result.ec != std::errc() || result.ptr == p)
+				Fail();
+			p = result.ptr;
+			value.type = JsonNumber;
+			return value;
+		}
+
+		unsigned int ParseHex4()
+		{
+			if (end - p < 4)
+				Fail();
+			unsigned int code = 0;
+			auto result = std::from_chars(p, p + 4, code, 16);
+			if (result.ptr != p + 4)
+				Fail();
+			p += 4;
+			return code;
+		}
+
+		void AppendUtf8(std::string& out, unsigned int code)
+		{
+			if (code < 0x80)
+				out += (char)code;
+			else if (code < 0x800)
+			{
+				out += (char)(0xC0 | (code >> 6));
+				out += (char)(0x80 | (code & 0x3F));
+			}
+			else if (code < 0x10000)
+			{
+				out += (char)(0xE0 | (code >> 12));
+				out += (char)(0x80 | ((code >> 6) & 0x3F));
+				out += (char)(0x80 | (code & 0x3F));
+			}
+			else
+			{
+				out += (char)(0xF0 | (code >> 18));
+				out += (char)(0x80 | ((code >> 12) & 0x3F));
+				out += (char)(0x80 | ((code >> 6) & 0x3F));
+				out += (char)(0x80 | (code & 0x3F));
+			}
+		}
+
+		std::string ParseString()
+		{
+			if (p >= end || *p != '"')
+				Fail();
+			p++;
+
+			std::string out;
+			while (true)
+			{
+				//copy everything up to the next quote or escape in one go
+				const char* run = p;
+				while (p < end && *p != '"' && *p != '\\') p++;
+				out.append(run, p);
+				if (p >= end)
+					Fail();
+				if (*p++ == '"')
+					return out;
+
+				if (p >= end)
+					Fail();
+				char escape = *p++;
+				switch (escape)
+				{
+				case '"': out += '"'; break;
+				case '\\': out += '\\'; break;
+				case '/': out += '/'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u':
+				{
+					unsigned int code = ParseHex4();
+					//surrogate pairs
+					if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+					{
+						p += 2;
+						unsigned int low = ParseHex4();
+						if (low < 0xDC00 || low > 0xDFFF)
+							Fail();
+						code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+					}
+					AppendUtf8(out, code);
+					break;
+				}
+				default:
+					Fail();
+				}
+			}
+		}
+	};
+
+	// Where one accessor's elements are inside the BIN chunk
+	struct Accessor
+	{
+		const unsigned char* data;
+		size_t stride;
+		size_t count;
+		unsigned int componentType;
+		unsigned int components;
+		bool normalized;
+	};
+
+	unsigned int ComponentSize(unsigned int componentType)
+	{
+		switch (componentType)
+		{
+		case ComponentByte: case ComponentUnsignedByte: return 1;
+		case ComponentShort: case ComponentUnsignedShort: return 2;
+		case ComponentUnsignedInt: case ComponentFloat: return 4;
+		}
+		throw std::invalid_argument("glTF accessor has an unknown component type");
+	}
+
+	unsigned int ComponentCount(const std::string& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		throw std::invalid_argument("glTF accessor type isn't supported: " + type);
+	}
+
+	// Looks up an accessor and checks that every element lies inside the BIN chunk
+	Accessor GetAccessor(const JsonValue& gltf, size_t index, const unsigned char* bin, size_t binSize)
+	{
+		const JsonValue& json = gltf["accessors"][index];
+		if (json.IsNull())
+			throw std::out_of_range("glTF references an accessor that doesn't exist");
+		if (!json["sparse"].IsNull())
+			throw std::invalid_argument("Sparse glTF accessors aren't supported");
+
+		Accessor accessor = {};
+		accessor.count = json["count"].Index(0);
+		accessor.componentType = (unsigned int)json["componentType"].Index(0);
+		accessor.components = ComponentCount(json["type"].string);
+		accessor.normalized = json["normalized"].boolean;
+		size_t elementSize = (size_t)ComponentSize(accessor.componentType) * accessor.components;
+
+		const JsonValue& view = gltf["bufferViews"][json["bufferView"].Index(SIZE_MAX)];
+		if (view.IsNull())
+			throw std::invalid_argument("glTF accessors without a buffer view aren't supported");
+		if (view["buffer"].Index(0) != 0 || !bin)
+			throw std::invalid_argument("Only the .glb's own BIN buffer is supported");
+
+		size_t viewOffset = view["byteOffset"].Index(0);
+		size_t viewLength = view["byteLength"].Index(0);
+		size_t offset = json["byteOffset"].Index(0);
+		accessor.stride = std::max(view["byteStride"].Index(0), elementSize);
+		if (viewOffset > binSize || viewLength > binSize - viewOffset)
+			throw std::out_of_range("glTF buffer view runs past the end of the BIN chunk");
+
+		//the last element has to end inside the view (written so nothing can overflow)
+		if (accessor.count > 0 && (offset > viewLength || elementSize > viewLength - offset ||
+			(accessor.count - 1) > (viewLength - offset - elementSize) / accessor.stride))
+			throw std::out_of_range("glTF accessor reads past the end of its buffer view");
+
+		accessor.data = bin + viewOffset + offset;
+		return accessor;
+	}
+
+	// One element as floats, handling normalized integer components
+	inline void ReadFloats(const Accessor& accessor, size_t index, float* out)
+	{
+		const unsigned char* element = accessor.data + index * accessor.stride;
+		if (accessor.componentType == ComponentFloat)
+		{
+			memcpy(out, element, sizeof(float) * accessor.components);
+			return;
+		}
+
+		for (unsigned int c = 0; c < accessor.components; c++)
+		{
+			float value = 0.0f;
+			switch (accessor.componentType)
+			{
+			case ComponentUnsignedByte: value = element[c] / (accessor.normalized ? 255.0f : 1.0f); break;
+			case ComponentByte: value = std::max((int8_t)element[c] / (accessor.normalized ? 127.0f : 1.0f), -1.0f); break;
+			case ComponentUnsignedShort: { uint16_t v; memcpy(&v, element + c * 2, 2); value = v / (accessor.normalized ? 65535.0f : 1.0f); break; }
+			case ComponentShort: { int16_t v; memcpy(&v, element + c * 2, 2); value = std::max(v / (accessor.normalized ? 32767.0f : 1.0f), -1.0f); break; }
+			default: throw std::invalid_argument("glTF vertex attribute has an unsupported component type");
+			}
+			out[c] = value;
+		}
+	}
+
+	inline unsigned int ReadIndex(const Accessor& accessor, size_t index)
+	{
+		const unsigned char* element = accessor.data + index * accessor.stride;
+		switch (accessor.componentType)
+		{
+		case ComponentUnsignedByte: return element[0];
+		case ComponentUnsignedShort: { uint16_t v; memcpy(&v, element, 2); return v; }
+		case ComponentUnsignedInt: { uint32_t v; memcpy(&v, element, 4); return v; }
+		}
+		throw std::invalid_argument("glTF indices must be unsigned bytes, shorts or ints");
+	}
+
+	// Vertices already imported for a mesh, by the accessors they came from
+	// - Exporters commonly give every primitive of a mesh the same vertex
+	//   accessors with its own indices, those only get read once
+	struct ImportedVertices
+	{
+		size_t position, uv, normal, tangent;
+		size_t base;
+	};
+
+	// Appends one primitive's vertices (unless an earlier primitive already
+	// did) and (list, flipped) indices and returns whether it had tangents
+	bool ImportPrimitive(const JsonValue& gltf, const JsonValue& primitive, const unsigned char* bin, size_t binSize,
+		std::vector<Vertex>& verts, std::vector<unsigned int>& indices, std::vector<ImportedVertices>& imported)
+	{
+		const JsonValue& attributes = primitive["attributes"];
+		ImportedVertices key = {
+			attributes["POSITION"].Index(SIZE_MAX), attributes["TEXCOORD_0"].Index(SIZE_MAX),
+			attributes["NORMAL"].Index(SIZE_MAX), attributes["TANGENT"].Index(SIZE_MAX), verts.size() };
+		Accessor positions = GetAccessor(gltf, attributes["POSITION"].Index(SIZE_MAX), bin, binSize);
+		if (positions.components != 3)
+			throw std::invalid_argument("glTF POSITION must be a VEC3");
+
+		//every attribute has to have one element per vertex
+		auto optional = [&](const char* name, unsigned int components, Accessor& accessor)
+		{
+			if (attributes[name].IsNull())
+				return false;
+			accessor = GetAccessor(gltf, attributes[name].Index(SIZE_MAX), bin, binSize);
+			if (accessor.count != positions.count || accessor.components != components)
+				throw std::invalid_argument(std::string("glTF ") + name + " doesn't match POSITION");
+			return true;
+		};
+		Accessor uvs, normals, tangents;
+		bool hasUVs = optional("TEXCOORD_0", 2, uvs);
+		bool hasNormals = optional("NORMAL", 3, normals);
+		bool hasTangents = optional("TANGENT", 4, tangents);
+
+		auto previous = std::find_if(imported.begin(), imported.end(), [&](const ImportedVertices& i) {
+			return i.position == key.position && i.uv == key.uv && i.normal == key.normal && i.tangent == key.tangent; });
+		bool shared = previous != imported.end();
+		if (shared)
+			key = *previous;
+		else
+			imported.push_back(key);
+
+		//straight from the buffer views into the final vertices, flipping Z on the way
+		size_t base = key.base;
+		if (!shared)
+			verts.resize(base + positions.count);
+		for (size_t i = 0; !shared && i < positions.count; i++)
+		{
+			Vertex& v = verts[base + i];
+			float value[4] = {};
+			ReadFloats(positions, i, value);
+			v.Position = XMFLOAT3(value[0], value[1], -value[2]);
+			if (hasUVs)
+			{
+				ReadFloats(uvs, i, value);
+				v.uv = XMFLOAT2(value[0], value[1]); //glTF already has (0,0) top left
+			}
+			if (hasNormals)
+			{
+				ReadFloats(normals, i, value);
+				v.normal = XMFLOAT3(value[0], value[1], -value[2]);
+			}
+			if (hasTangents)
+			{
+				ReadFloats(tangents, i, value);
+				v.tangent = XMFLOAT3(value[0], value[1], -value[2]);
+			}
+		}
+
+		//non-indexed primitives just use every vertex in order
+		size_t count = positions.count;
+		Accessor source = {};
+		bool indexed = !primitive["indices"].IsNull();
+		if (indexed)
+		{
+			source = GetAccessor(gltf, primitive["indices"].Index(SIZE_MAX), bin, binSize);
+			count = source.count;
+		}
+		auto index = [&](size_t i)
+		{
+			unsigned int value = indexed ? ReadIndex(source, i) : (unsigned int)i;
+			if (value >= positions.count)
+				throw std::out_of_range("glTF index references a vertex that doesn't exist");
+			return (unsigned int)base + value;
+		};
+
+		//everything becomes a list with the winding flipped (0, 2, 1)
+		size_t mode = primitive["mode"].Index(ModeTriangles);
+		auto triangle = [&](size_t a, size_t b, size_t c)
+		{
+			indices.push_back(index(a));
+			indices.push_back(index(c));
+			indices.push_back(index(b));
+		};
+		if (mode == ModeTriangles)
+		{
+			indices.reserve(indices.size() + count);
+			for (size_t i = 0; i + 2 < count; i += 3)
+				triangle(i, i + 1, i + 2);
+		}
+		else if (mode == ModeTriangleStrip)
+		{
+			for (size_t i = 0; i + 2 < count; i++)
+			{
+				if (i % 2 == 0) triangle(i, i + 1, i + 2);
+				else triangle(i + 1, i, i + 2);
+			}
+		}
+		else if (mode == ModeTriangleFan)
+		{
+			for (size_t i = 1; i + 1 < count; i++)
+				triangle(0, i, i + 1);
+		}
+		return hasTangents;
+	}
+
+	// A node's local matrix, from "matrix" or translation/rotation/scale
+	// - glTF matrices are column major for column vectors, which is the
+	//   same memory layout as ours (row major for row vectors)
+	XMMATRIX LocalMatrix(const JsonValue& node)
+	{
+		const JsonValue& matrix = node["matrix"];
+		if (matrix.Size() == 16)
+		{
+			XMFLOAT4X4 m;
+			for (size_t i = 0; i < 16; i++)
+				(&m._11)[i] = (float)matrix[i].Number(0.0);
+			return XMLoadFloat4x4(&m);
+		}
+
+		auto component = [&](const char* property, size_t i, double fallback) { return (float)node[property][i].Number(fallback); };
+		XMFLOAT4 rotation(component("rotation", 0, 0.0), component("rotation", 1, 0.0), component("rotation", 2, 0.0), component("rotation", 3, 1.0));
+		return
+			XMMatrixScaling(component("scale", 0, 1.0), component("scale", 1, 1.0), component("scale", 2, 1.0)) *
+			XMMatrixRotationQuaternion(XMLoadFloat4(&rotation)) *
+			XMMatrixTranslation(component("translation", 0, 0.0), component("translation", 1, 0.0), component("translation", 2, 0.0));
+	}
+
+	// Splits a world matrix into a Transform's scale, pitch/yaw/roll and position
+	// - Transform builds scale * RollPitchYaw * translation, and
+	//   RollPitchYaw is Z * X * Y, which is where the angles come from
+	// - Shear (non-uniform scale under a rotated parent) can't be represented
+	//   and gets dropped
+	void Decompose(const XMFLOAT4X4& m, Transform& transform)
+	{
+		XMFLOAT3 rows[3] = { XMFLOAT3(m._11, m._12, m._13), XMFLOAT3(m._21, m._22, m._23), XMFLOAT3(m._31, m._32, m._33) };
+		float scale[3];
+		for (int i = 0; i < 3; i++)
+		{
+			scale[i] = sqrtf(rows[i].x * rows[i].x + rows[i].y * rows[i].y + rows[i].z * rows[i].z);
+			float inverse = scale[i] > 0.0f ? 1.0f / scale[i] : 0.0f;
+			rows[i] = XMFLOAT3(rows[i].x * inverse, rows[i].y * inverse, rows[i].z * inverse);
+		}
+
+		//mirrored, put the flip on Z
+		XMFLOAT3 cross(
+			rows[0].y * rows[1].z - rows[0].z * rows[1].y,
+			rows[0].z * rows[1].x - rows[0].x * rows[1].z,
+			rows[0].x * rows[1].y - rows[0].y * rows[1].x);
+		if (cross.x * rows[2].x + cross.y * rows[2].y + cross.z * rows[2].z < 0.0f)
+		{
+			scale[2] = -scale[2];
+			rows[2] = XMFLOAT3(-rows[2].x, -rows[2].y, -rows[2].z);
+		}
+
+		float pitch = asinf(std::clamp(-rows[2].y, -1.0f, 1.0f));
+		float yaw, roll;
+		if (fabsf(rows[2].y) < 0.9999f)
+		{
+			yaw = atan2f(rows[2].x, rows[2].z);
+			roll = atan2f(rows[0].y, rows[1].y);
+		}
+		else
+		{
+			//looking straight up or down, yaw and roll do the same thing
+			yaw = atan2f(-rows[0].z, rows[0].x);
+			roll = 0.0f;
+		}
+
+		transform.SetScale(scale[0], scale[1], scale[2]);
+		transform.SetRotation(pitch, yaw, roll);
+		transform.SetPosition(m._41, m._42, m._43);
+	}
+}
+
+
+// --------------------------------------------------------
+// Memory maps the file and imports it in place
+// --------------------------------------------------------
+void GlbLoader::ParseFile(const std::wstring& glbFile, GlbScene& out)
+{
+	MappedFile file(glbFile);
+
+	// Check for successful open
+	if (!file.IsOpen())
+		throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
+
+	ParseBuffer(file.GetData(), file.GetSize(), out);
+}
+
+
+// --------------------------------------------------------
+// Splits the .glb into its JSON and BIN chunks, imports
+// every mesh, then walks the default scene for the nodes
+// --------------------------------------------------------
+void GlbLoader::ParseBuffer(const char* data, size_t size, GlbScene& out)
+{
+	out = {};
+
+	//12 byte header, then chunks of (length, type, data padded to 4 bytes)
+	uint32_t header[3];
+	if (size < sizeof(header))
+		throw std::invalid_argument("File is too small to be a .glb");
+	memcpy(header, data, sizeof(header));
+	if (header[0] != GlbMagic || header[1] != 2)
+		throw std::invalid_argument("Not a glTF 2.0 binary file");
+	size = std::min(size, (size_t)header[2]);
+
+	const char* json = nullptr;
+	size_t jsonSize = 0;
+	const unsigned char* bin = nullptr;
+	size_t binSize = 0;
+	for (size_t offset = sizeof(header); offset + 8 <= size;)
+	{
+		uint32_t chunk[2];
+		memcpy(chunk, data + offset, sizeof(chunk));
+		offset += sizeof(chunk);
+		if (chunk[0] > size - offset)
+			throw std::out_of_range(".glb chunk runs past the end of the file");
+
+		//only the first of each counts, unknown chunks are skipped
+		if (chunk[1] == GlbChunkJson && !json)
+		{
+			json = data + offset;
+			jsonSize = chunk[0];
+		}
+		else if (chunk[1] == GlbChunkBin && !bin)
+		{
+			bin = (const unsigned char*)data + offset;
+			binSize = chunk[0];
+		}
+		offset += chunk[0];
+	}
+	if (!json)
+		throw std::invalid_argument(".glb has no JSON chunk");
+
+	JsonValue gltf = JsonParser(json, jsonSize).ParseDocument();
+
+	//meshes, with primitives sorted by material so each material is one subset
+	const JsonValue& meshes = gltf["meshes"];
+	std::vector<unsigned int> meshRemap(meshes.Size(), UINT32_MAX);
+	for (size_t m = 0; m < meshes.Size(); m++)
+	{
+		const JsonValue& primitives = meshes[m]["primitives"];
+		std::vector<size_t> order;
+		for (size_t p = 0; p < primitives.Size(); p++)
+		{
+			size_t mode = primitives[p]["mode"].Index(ModeTriangles);
+			if (mode == ModeTriangles || mode == ModeTriangleStrip || mode == ModeTriangleFan)
+				order.push_back(p);
+		}
+		auto material = [&](size_t p) { return primitives[p]["material"].Index(SIZE_MAX); };
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return material(a) < material(b); });
+
+		CookedMesh mesh;
+		std::vector<ImportedVertices> imported;
+		bool hasTangents = true;
+		size_t lastMaterial = 0;
+		for (size_t p : order)
+		{
+			size_t start = mesh.indices.size();
+			hasTangents &= ImportPrimitive(gltf, primitives[p], bin, binSize, mesh.vertices, mesh.indices, imported);
+			if (mesh.indices.size() == start)
+				continue;
+
+			//same material as the last subset, so it just gets longer
+			size_t materialIndex = material(p);
+			if (!mesh.subsets.empty() && lastMaterial == materialIndex)
+			{
+				mesh.subsets.back().lods[0].indexCount += (unsigned int)(mesh.indices.size() - start);
+				continue;
+			}
+			lastMaterial = materialIndex;
+
+			MeshSubset subset = {};
+			subset.lods[0] = { (unsigned int)start, (unsigned int)(mesh.indices.size() - start), 0.0f };
+			mesh.subsets.push_back(subset);
+
+			const JsonValue& materialJson = gltf["materials"][materialIndex];
+			std::string name = materialJson["name"].string;
+			if (name.empty() && !materialJson.IsNull())
+				name = "material" + std::to_string(materialIndex);
+			mesh.subsetMaterials.push_back(name);
+		}
+		if (mesh.indices.empty())
+			continue;
+		if (mesh.vertices.size() > UINT32_MAX)
+			throw std::out_of_range("glTF mesh has more vertices than 32-bit indices can address");
+
+		meshRemap[m] = (unsigned int)out.meshes.size();
+		out.meshes.push_back(std::move(mesh));
+		out.meshNames.push_back(meshes[m]["name"].string);
+		out.meshHasTangents.push_back(hasTangents);
+	}
+
+	//roots come from the default scene, or every node nothing else has as a child
+	const JsonValue& nodes = gltf["nodes"];
+	std::vector<size_t> roots;
+	const JsonValue& scene = gltf["scenes"][gltf["scene"].Index(0)];
+	if (!scene.IsNull())
+	{
+		for (const JsonValue& root : scene["nodes"].items)
+			roots.push_back(root.Index(SIZE_MAX));
+	}
+	else
+	{
+		std::vector<bool> isChild(nodes.Size(), false);
+		for (const JsonValue& node : nodes.items)
+		{
+			for (const JsonValue& child : node["children"].items)
+			{
+				if (child.Index(SIZE_MAX) < isChild.size())
+					isChild[child.Index(SIZE_MAX)] = true;
+			}
+		}
+		for (size_t n = 0; n < nodes.Size(); n++)
+		{
+			if (!isChild[n])
+				roots.push_back(n);
+		}
+	}
+
+	//depth first, world = local * parent, every node visited at most once
+	//- a right-handed matrix M becomes F * M * F in left-handed space,
+	//  where F flips Z (the vertices already had F applied)
+	XMMATRIX flip = XMMatrixScaling(1, 1, -1);
+	std::vector<bool> visited(nodes.Size(), false);
+	std::vector<std::pair<size_t, XMFLOAT4X4>> stack;
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	for (auto it = roots.rbegin(); it != roots.rend(); it++)
+		stack.push_back({ *it, identity });
+	while (!stack.empty())
+	{
+		auto [n, parent] = stack.back();
+		stack.pop_back();
+		if (n >= nodes.Size() || visited[n])
+			throw std::invalid_argument("glTF node hierarchy isn't a tree");
+		visited[n] = true;
+
+		const JsonValue& node = nodes[n];
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, LocalMatrix(node) * XMLoadFloat4x4(&parent));
+
+		size_t mesh = node["mesh"].Index(SIZE_MAX);
+		if (mesh < meshRemap.size() && meshRemap[mesh] != UINT32_MAX)
+		{
+			XMFLOAT4X4 converted;
+			XMStoreFloat4x4(&converted, flip * XMLoadFloat4x4(&world) * flip);
+
+			GlbNode imported = {};
+			imported.name = node["name"].string;
+			imported.mesh = meshRemap[mesh];
+			imported.transform = std::make_shared<Transform>();
+			Decompose(converted, *imported.transform);
+			out.nodes.push_back(imported);
+		}
+
+		const std::vector<JsonValue>& children = node["children"].items;
+		for (auto it = children.rbegin(); it != children.rend(); it++)
+			stack.push_back({ it->Index(SIZE_MAX), world });
+	}
+}
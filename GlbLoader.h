@@ -0,0 +1,47 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "MeshCache.h"
+#include "Transform.h"
+
+// A node of a glTF scene that has a mesh
+// - transform is the node's world transform (parents already
+//   applied), converted into our left-handed space
+struct GlbNode
+{
+	std::string name;
+	unsigned int mesh;	// Index into GlbScene::meshes
+	std::shared_ptr<Transform> transform;
+};
+
+// Everything imported from a .glb file
+// - Each glTF mesh is one CookedMesh, its primitives sharing the
+//   vertex and index data with one subset per material
+// - Meshes come out imported but not cooked (LOD0 indices and
+//   subset ranges only), run MeshCache::Cook() on each one
+struct GlbScene
+{
+	std::vector<CookedMesh> meshes;
+	std::vector<std::string> meshNames;
+	std::vector<bool> meshHasTangents;	// Cook these without generating tangents
+	std::vector<GlbNode> nodes;
+};
+
+// --------------------------------------------------------
+// Binary glTF 2.0 (.glb) importing
+//
+// - The file is memory mapped and every accessor is read
+//   straight out of the BIN chunk into the final Vertex and
+//   index arrays, converting to left-handed space (flipped
+//   Z, flipped winding) in the same pass
+// - Only the embedded BIN buffer is supported, not external
+//   or data: URI buffers, and not sparse accessors
+// - Triangle lists, strips and fans are imported, points
+//   and lines are skipped
+// --------------------------------------------------------
+namespace GlbLoader
+{
+	void ParseFile(const std::wstring& glbFile, GlbScene& out);
+	void ParseBuffer(const char* data, size_t size, GlbScene& out);
+}
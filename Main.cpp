@@ -6,6 +6,7 @@
 #include "Graphics.h"
 #include "Game.h"
 #include "Input.h"
+#include "FixedTimestep.h"
 
 // Annonymous namespace to hold variables
 // only accessible in this file
@@ -56,6 +57,8 @@ int WINAPI WinMain(
 	const wchar_t* windowTitle = L"Direct3D11 Game";
 	bool statsInTitleBar = true;
 	bool vsync = false;
+	unsigned int simulationHz = 60;		// Fixed steps per second for Game::FixedUpdate()
+	unsigned int maxStepsPerFrame = 8;	// Past this a slow frame drops time instead of catching up
 
 	// The main application object
 	game = new Game();
@@ -96,6 +99,7 @@ int WINAPI WinMain(
 	// Query for accurate timing information
 	QueryPerformanceFrequency(&perfFreq);
 	perfSeconds = 1.0 / (double)perfFreq.QuadPart;
+	FixedTimestep timestep(perfFreq.QuadPart, simulationHz, maxStepsPerFrame);
 
 	// Performance Counter gives high-resolution time stamps
 	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
@@ -120,6 +124,7 @@ int WINAPI WinMain(
 			QueryPerformanceCounter((LARGE_INTEGER*)&currentTime);
 			float deltaTime = max((float)((currentTime - previousTime) * perfSeconds), 0.0f);
 			float totalTime = (float)((currentTime - startTime) * perfSeconds);
+			__int64 elapsedTicks = currentTime - previousTime;
 			previousTime = currentTime;
 
 			// Calculate basic fps
@@ -128,9 +133,13 @@ int WINAPI WinMain(
 			// Input updating
 			Input::Update();
 
-			// Update and draw
+			// Update, then as many fixed steps as the frame time adds
+			// up to, then draw part way to the next step
 			game->Update(deltaTime, totalTime);
-			game->Draw(deltaTime, totalTime);
+			timestep.Advance(elapsedTicks);
+			while (timestep.Step())
+				game->FixedUpdate(timestep.GetStepSeconds(), (float)timestep.GetSimulationTime());
+			game->Draw(deltaTime, totalTime, timestep.GetAlpha());
 
 			// Notify Input system about end of frame
 			Input::EndOfFrame();
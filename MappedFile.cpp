@@ -0,0 +1,81 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::wstring& path) :
+	data(nullptr),
+	size(0),
+	isOpen(false),
+	fileHandle(nullptr),
+	mappingHandle(nullptr),
+	fileDescriptor(-1)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	fileHandle = file;
+	isOpen = true;
+
+	LARGE_INTEGER fileSize = {};
+	GetFileSizeEx(file, &fileSize);
+	size = (size_t)fileSize.QuadPart;
+
+	//zero sized files can't be mapped, but they are still "open"
+	if (size == 0)
+		return;
+
+	HANDLE mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (!mapping)
+	{
+		isOpen = false;
+		return;
+	}
+	mappingHandle = mapping;
+	data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+		isOpen = false;
+#else
+	std::string narrowPath = std::filesystem::path(path).string();
+	fileDescriptor = open(narrowPath.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+		return;
+	isOpen = true;
+
+	struct stat info = {};
+	fstat(fileDescriptor, &info);
+	size = (size_t)info.st_size;
+	if (size == 0)
+		return;
+
+	void* mapped = mmap(0, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (mapped == MAP_FAILED)
+	{
+		isOpen = false;
+		return;
+	}
+	//we always walk these front to back
+	madvise(mapped, size, MADV_SEQUENTIAL);
+	data = (const char*)mapped;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle((HANDLE)mappingHandle);
+	if (fileHandle) CloseHandle((HANDLE)fileHandle);
+#else
+	if (data) munmap((void*)data, size);
+	if (fileDescriptor >= 0) close(fileDescriptor);
+#endif
+}
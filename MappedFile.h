@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+
+// --------------------------------------------------------
+// Read-only memory mapping of an entire file
+//
+// - The file contents are exposed directly from the OS page
+//   cache, so nothing is copied until someone reads it
+// - Not null terminated! Always respect GetSize()
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile(const std::wstring& path);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool IsOpen() const { return isOpen; }
+	const char* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	const char* data;
+	size_t size;
+	bool isOpen;
+
+	//native handles (HANDLEs on windows, a file descriptor elsewhere)
+	void* fileHandle;
+	void* mappingHandle;
+	int fileDescriptor;
+};
@@ -20,6 +20,7 @@ Material::Material(std::shared_ptr<SimplePixelShader> pixelShader,
 
 std::shared_ptr<SimplePixelShader> Material::GetPixelShader() { return pixelShader; }
 std::shared_ptr<SimpleVertexShader> Material::GetVertexShader() { return vertexShader; }
+std::shared_ptr<SimpleVertexShader> Material::GetCompactVertexShader() { return compactVertexShader; }
 DirectX::XMFLOAT3 Material::GetColorTint() { return colorTint; }
 const char* Material::GetName() { return name; }
 DirectX::XMFLOAT2 Material::GetUVScale() { return uvScale; }
@@ -61,32 +62,42 @@ std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>>& Mat
 
 void Material::SetPixelShader(std::shared_ptr<SimplePixelShader> pixelShader) { this->pixelShader = pixelShader; }
 void Material::SetVertexShader(std::shared_ptr<SimpleVertexShader> vertexShader) { this->vertexShader = vertexShader; }
+void Material::SetCompactVertexShader(std::shared_ptr<SimpleVertexShader> vertexShader) { compactVertexShader = vertexShader; }
 void Material::SetColorTint(DirectX::XMFLOAT3 tint) { this->colorTint = tint; }
 void Material::SetUVScale(DirectX::XMFLOAT2 scale) { uvScale = scale; }
 void Material::SetUVOffset(DirectX::XMFLOAT2 offset) { uvOffset = offset; }
 void Material::SetRoughness(float rough) { roughness = rough; }
 
-void Material::PrepareMaterial(std::shared_ptr<Transform> transform, std::shared_ptr<Camera> camera)
+//compactVertices is the mesh's CompactVertexParams when it stores CompactVertex,
+//which needs the compact vertex shader to unpack it
+void Material::PrepareMaterial(Transform& transform, Camera& camera, const CompactVertexParams* compactVertices)
 {
+	std::shared_ptr<SimpleVertexShader> vs = compactVertices ? compactVertexShader : vertexShader;
+
 	//activating shaders
-	vertexShader->SetShader();
+	vs->SetShader();
 	pixelShader->SetShader();
 
 	//preparing data for the GPU
-	vertexShader->SetMatrix4x4("worldMatrix", transform->GetWorldMatrix());
-	vertexShader->SetMatrix4x4("worldInvTrans", transform->GetWorldInverseTransposeMatrix());
-	vertexShader->SetMatrix4x4("viewMatrix", camera->GetView());
-	vertexShader->SetMatrix4x4("projectionMatrix", camera->GetProjection());
+	vs->SetMatrix4x4("worldMatrix", transform.GetWorldMatrix());
+	vs->SetMatrix4x4("worldInvTrans", transform.GetWorldInverseTransposeMatrix());
+	vs->SetMatrix4x4("viewMatrix", camera.GetView());
+	vs->SetMatrix4x4("projectionMatrix", camera.GetProjection());
+	if (compactVertices)
+	{
+		vs->SetFloat3("positionOffset", compactVertices->positionOffset);
+		vs->SetFloat3("positionScale", compactVertices->positionScale);
+	}
 
 	//copy data to GPU
-	vertexShader->CopyAllBufferData();
+	vs->CopyAllBufferData();
 
 	// Send data to the pixel shader
 	pixelShader->SetFloat3("colorTint", colorTint);
 	pixelShader->SetFloat2("uvScale", uvScale);
 	pixelShader->SetFloat2("uvOffset", uvOffset);
 	pixelShader->SetFloat("roughness", roughness);
-	pixelShader->SetFloat3("cameraPosition", camera->GetTransform()->GetPosition());
+	pixelShader->SetFloat3("cameraPosition", camera.GetTransform()->GetPosition());
 
 	//copy data to GPU
 	pixelShader->CopyAllBufferData();
@@ -9,6 +9,7 @@
 #include "SimpleShader.h"
 #include "Camera.h"
 #include "Transform.h"
+#include "VertexQuantize.h"
 #include <unordered_map> 
 
 class Material
@@ -25,6 +26,7 @@ public:
 
 	std::shared_ptr<SimplePixelShader> GetPixelShader();
 	std::shared_ptr<SimpleVertexShader> GetVertexShader();
+	std::shared_ptr<SimpleVertexShader> GetCompactVertexShader();
 	DirectX::XMFLOAT3 GetColorTint();
 	const char* GetName();
 	DirectX::XMFLOAT2 GetUVScale();
@@ -38,12 +40,13 @@ public:
 
 	void SetPixelShader(std::shared_ptr<SimplePixelShader> pixelShader);
 	void SetVertexShader(std::shared_ptr<SimpleVertexShader> vertexShader);
+	void SetCompactVertexShader(std::shared_ptr<SimpleVertexShader> vertexShader); //for meshes of CompactVertex
 	void SetColorTint(DirectX::XMFLOAT3 tint);
 	void SetUVScale(DirectX::XMFLOAT2 scale);
 	void SetUVOffset(DirectX::XMFLOAT2 offset);
 	void SetRoughness(float rough);
 
-	void PrepareMaterial(std::shared_ptr<Transform> transform, std::shared_ptr<Camera> camera);
+	void PrepareMaterial(Transform& transform, Camera& camera, const CompactVertexParams* compactVertices = nullptr);
 
 	void AddTextureSRV(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	void AddSampler(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
@@ -56,6 +59,7 @@ private:
 
 	std::shared_ptr<SimplePixelShader> pixelShader;
 	std::shared_ptr<SimpleVertexShader> vertexShader;
+	std::shared_ptr<SimpleVertexShader> compactVertexShader;
 	DirectX::XMFLOAT3 colorTint;
 	DirectX::XMFLOAT2 uvOffset;
 	DirectX::XMFLOAT2 uvScale;
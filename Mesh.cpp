@@ -3,16 +3,29 @@
 #include <wrl/client.h>
 #include "Graphics.h" // For device context access
 #include "Vertex.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshSimplifier.h"
+#include "MeshTools.h"
+#include "VertexQuantize.h"
+#include <filesystem>
 #include <stdexcept>
 #include <vector>
-#include <fstream>
 using namespace DirectX;
 
 	//constructor
 Mesh::Mesh(const char* name, Vertex* vertArray, size_t numVerts, unsigned int* indexArray, size_t numIndices) :
+	numSourceVertices((unsigned int)numVerts),
 	name(name)
 {
-	CreateBuffers(vertArray, numVerts, indexArray, numIndices);
+	//calc the tangent value before creating the buffers
+	MeshTools::CalculateTangents(vertArray, numVerts, indexArray, numIndices);
+	meshlets = Meshlets::Build(vertArray, numVerts, indexArray, numIndices);
+
+	//LODs are appended after the original indices
+	std::vector<unsigned int> indices(indexArray, indexArray + numIndices);
+	lods = MeshSimplifier::BuildLodChain(vertArray, numVerts, indices);
+	CreateBuffers(vertArray, numVerts, indices.data(), indices.size());
 }
 
 
@@ -21,307 +34,241 @@ Mesh::Mesh(const char* name, const std::wstring& objFile) :
 {
 	numIndices = 0;
 	numVertices = 0;
-	// Author: Chris Cascioli
-// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
-// 
-// - You are allowed to directly copy/paste this into your code base
-//   for assignments, given that you clearly cite that this is not
-//   code of your own design.
-
-// *************************************
-//      IMPLEMENTATION NOTES (1/2)
-//
-//  - You'll need to #include both
-//      <fstream> and <stdexcept>
-//
-//  - This is code you will need to 
-//      integrate into a function or
-//      constructor of your own making
-//
-//  - There is MORE TO DO after pasting 
-//      this code in - see the bottom for
-//      what to do *after* including 
-//      this code in your mesh class
-//
-// *************************************
-
-// File input object
-	std::ifstream obj(objFile);
+
+	MappedFile obj(objFile);
 
 	// Check for successful open
-	if (!obj.is_open())
+	if (!obj.IsOpen())
 		throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
 
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;	// Positions from the file
-	std::vector<XMFLOAT3> normals;		// Normals from the file
-	std::vector<XMFLOAT2> uvs;		// UVs from the file
-	std::vector<Vertex> verts;		// Verts we're assembling
-	std::vector<UINT> indices;		// Indices of these verts
-	int vertCounter = 0;			// Count of vertices
-	int indexCounter = 0;			// Count of indices
-	char chars[100];			// String for line reading
-
-	// Still have data left?
-	while (obj.good())
+	//use the baked binary version if it was cooked from this exact file
+	uint64_t sourceHash = MeshCache::HashBytes(obj.GetData(), obj.GetSize());
+	std::wstring cachePath = MeshCache::GetCachePath(objFile);
 	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
-
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
+		MeshCacheFile cache(cachePath);
+		if (cache.IsValid() && cache.GetHeader().sourceHash == sourceHash)
 		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
-		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			unsigned int i[12];
-			int numbersRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// If we only got the first number, chances are the OBJ
-			// file has no UV coordinates.  This isn't great, but we
-			// still want to load the model without crashing, so we
-			// need to re-read a different pattern (in which we assume
-			// there are no UVs denoted for any of the vertices)
-			if (numbersRead == 1)
-			{
-				// Re-read with a different pattern
-				numbersRead = sscanf_s(
-					chars,
-					"f %d//%d %d//%d %d//%d %d//%d",
-					&i[0], &i[2],
-					&i[3], &i[5],
-					&i[6], &i[8],
-					&i[9], &i[11]);
-
-				// The following indices are where the UVs should 
-				// have been, so give them a valid value
-				i[1] = 1;
-				i[4] = 1;
-				i[7] = 1;
-				i[10] = 1;
-
-				// If we have no UVs, create a single UV coordinate
-				// that will be used for all vertices
-				if (uvs.size() == 0)
-					uvs.push_back(XMFLOAT2(0, 0));
-			}
-
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.uv = uvs[i[1] - 1];
-			v1.normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.uv = uvs[i[4] - 1];
-			v2.normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.uv = uvs[i[7] - 1];
-			v3.normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.uv.y = 1.0f - v1.uv.y;
-			v2.uv.y = 1.0f - v2.uv.y;
-			v3.uv.y = 1.0f - v3.uv.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal's Z
-			v1.normal.z *= -1.0f;
-			v2.normal.z *= -1.0f;
-			v3.normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-			vertCounter += 3;
-
-			// Add three more indices
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-
-			// Was there a 4th face?
-			// - 12 numbers read means 4 faces WITH uv's
-			// - 8 numbers read means 4 faces WITHOUT uv's
-			if (numbersRead == 12 || numbersRead == 8)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.uv = uvs[i[10] - 1];
-				v4.normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal's Z
-				v4.uv.y = 1.0f - v4.uv.y;
-				v4.Position.z *= -1.0f;
-				v4.normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-				vertCounter += 3;
-
-				// Add three more indices
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-			}
+			//straight from the mapped file into the GPU buffers
+			const MeshCacheHeader& header = cache.GetHeader();
+			numSourceVertices = header.sourceVertexCount;
+			meshlets.assign(cache.GetMeshlets(), cache.GetMeshlets() + header.meshletCount);
+			lods.assign(cache.GetLods(), cache.GetLods() + header.lodCount);
+			subsets.assign(cache.GetSubsets(), cache.GetSubsets() + header.subsetCount);
+			LoadMaterials(objFile, cache.GetSubsetMaterials(), cache.GetMaterialLibraries());
+			CreateBuffers(cache.GetVertices(), header.vertexCount, cache.GetIndices(), header.indexCount);
+			return;
 		}
 	}
 
-	// Close the file and create the actual buffers
-	obj.close();
-
-	CreateBuffers(&verts[0], vertCounter, &indices[0], indexCounter);
-
-	// *************************************
-	//      IMPLEMENTATION NOTES (2/2)
-	//
-	// - At this point, "verts" is a std::vector 
-	//     of Vertex structs, and can be used
-	//     to create your mesh's vertex buffer
-	//
-	// - NOTE: Use &verts[0] for the address of 
-	//     the first vertx, NOT JUST &verts
-	//
-	// - The vector "indices" is similar. It's 
-	//     a std::vector of unsigned ints and
-	//     can be used to create the index 
-	//     buffer (again, &indices[0] is the 
-	//     address of the first integer)
-	//
-	// - Make sure your mesh class actually SAVES
-	//     the number of vertices and indices, or
-	//     drawing may have unintended problems.
-	//     - "vertCounter" is the number of vertices
-	//     - "indexCounter" is the number of indices
-	//
-	// - If you dig into the code, you may notice 
-	//     that  "vertCounter" and "indexCounter" 
-	//     end up being the same.  Recall that OBJs 
-	//     do not index entire vertices, making
-	//     it complex to detect duplicate vertices.
-	//     This also means an index buffer isn't
-	//     doing much for us.  We could try to 
-	//     detect duplicate vertices ourselves, 
-	//     but at that point it would be better 
-	//     to use a more sophisticated mesh loading
-	//     library like TinyOBJLoader or 
-	//     The Open Asset Importer Library, both
-	//     of which are unnecessary for now.
-	//
-	// *************************************
+	//missing or stale cache: parse (memory mapped + multithreaded, see ObjLoader),
+	//weld, optimize, simplify and generate tangents, then save the result for next time
+	CookedMesh cooked;
+	MeshCookStats stats = MeshCache::CookObj(obj.GetData(), obj.GetSize(), cooked);
+	numSourceVertices = (unsigned int)stats.sourceVertexCount;
+	MeshCache::Save(cachePath, sourceHash, numSourceVertices, cooked);
+
+	meshlets = std::move(cooked.meshlets);
+	lods = std::move(cooked.lods);
+	subsets = std::move(cooked.subsets);
+	LoadMaterials(objFile, cooked.subsetMaterials, cooked.materialLibraries);
+	CreateBuffers(cooked.vertices.data(), cooked.vertices.size(), cooked.indices.data(), cooked.indices.size());
+}
+
+Mesh::Mesh(const char* name, const CookedMesh& cooked) :
+	numSourceVertices((unsigned int)cooked.vertices.size()),
+	name(name),
+	meshlets(cooked.meshlets),
+	lods(cooked.lods),
+	subsets(cooked.subsets)
+{
+	CreateBuffers(cooked.vertices.data(), cooked.vertices.size(), cooked.indices.data(), cooked.indices.size());
+}
 
+Mesh::~Mesh()
+{
+	if (pool)
+		pool->Remove(poolAllocation);
 }
 
+
 //helper method using Direct3D buffer creation code
 //instead of duplicating it in both constructors
-void Mesh::CreateBuffers(Vertex* vertArray, size_t numVerts, unsigned int* indexArray, size_t numIndices)
+void Mesh::CreateBuffers(const Vertex* vertArray, size_t numVerts, const unsigned int* indexArray, size_t numIndices)
 {
-	//calc the tangent value before creating the buffers
-	CalculateTangents(vertArray, numVerts, indexArray, numIndices);
+	// Save the counts (just LOD0, the rest of the index buffer holds the other LODs)
+	this->numIndices = lods[0].indexCount;
+	this->numVertices = (unsigned int)numVerts;
+
+	// Meshes without materials are one subset covering everything
+	if (subsets.empty())
+	{
+		MeshSubset whole = {};
+		for (size_t i = 0; i < lods.size() && i < MeshMaxLods; i++)
+			whole.lods[i] = lods[i];
+		whole.meshletCount = (unsigned int)meshlets.size();
+		subsets.push_back(whole);
+	}
+	subsetMaterials.resize(subsets.size());
+
+	// Bounds for culling and LOD selection, while the vertices are still around
+	bounds = MeshBounds::Calculate(vertArray, numVerts, buildOrientedBounds);
+
+	if (buildBvhs)
+	{
+		std::vector<XMFLOAT3> positions(numVerts);
+		for (size_t i = 0; i < numVerts; i++)
+			positions[i] = vertArray[i].Position;
+		bvh = std::make_unique<MeshBvh>(positions.data(), numVerts, indexArray + lods[0].startIndex, lods[0].indexCount);
+	}
+
+	// Quantize the vertices if asked to, they're only decoded in the vertex shader
+	std::vector<CompactVertex> compactVerts;
+	const void* vertexData = vertArray;
+	if (buildCompactVertices)
+	{
+		compactParams = VertexQuantize::MakeParams(vertArray, numVerts, CompactPositions);
+		compactVerts.resize(numVerts);
+		VertexQuantize::Encode(vertArray, numVerts, compactParams, compactVerts.data());
+		vertexData = compactVerts.data();
+		vertexStride = sizeof(CompactVertex);
+		compact = true;
+	}
+
+	// Depth-only shaders read a float3 position, which compact vertices don't have
+	if (buildPositionStreams || compact)
+		CreatePositionStream(vertArray, numVerts, indexArray);
+
+	// Suballocate from the shared pool if there is one (always 16-bit indices)
+	if (geometryPool && GeometryPool::Fits(numVerts) && geometryPool->GetVertexStride() == vertexStride)
+	{
+		pool = geometryPool;
+		poolAllocation = pool->Add(vertexData, numVerts, indexArray, numIndices);
+		indexFormat = DXGI_FORMAT_R16_UINT;
+		return;
+	}
 
 	// Create the vertex buffer
 	D3D11_BUFFER_DESC vbd = {};
 	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * (UINT)numVerts; // Number of vertices
+	vbd.ByteWidth = vertexStride * (UINT)numVerts; // Number of vertices
 	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	vbd.CPUAccessFlags = 0;
 	vbd.MiscFlags = 0;
 	vbd.StructureByteStride = 0;
 	D3D11_SUBRESOURCE_DATA initialVertexData = {};
-	initialVertexData.pSysMem = vertArray;
+	initialVertexData.pSysMem = vertexData;
 	Graphics::Device->CreateBuffer(&vbd, &initialVertexData, vertexBuffer.GetAddressOf());
 
+	// Use 16-bit indices when the mesh is small enough, halving the index buffer
+	std::vector<uint16_t> shortIndices;
+	const void* indexData = indexArray;
+	UINT indexSize = sizeof(unsigned int);
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	if (numVerts <= 65536)
+	{
+		shortIndices.assign(indexArray, indexArray + numIndices);
+		indexData = shortIndices.data();
+		indexSize = sizeof(uint16_t);
+		indexFormat = DXGI_FORMAT_R16_UINT;
+	}
+
 	// Create the index buffer
 	D3D11_BUFFER_DESC ibd = {};
 	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(unsigned int) * (UINT)numIndices; // Number of indices
+	ibd.ByteWidth = indexSize * (UINT)numIndices; // Number of indices
 	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	ibd.CPUAccessFlags = 0;
 	ibd.MiscFlags = 0;
 	ibd.StructureByteStride = 0;
 	D3D11_SUBRESOURCE_DATA initialIndexData = {};
-	initialIndexData.pSysMem = indexArray;
+	initialIndexData.pSysMem = indexData;
 	Graphics::Device->CreateBuffer(&ibd, &initialIndexData, indexBuffer.GetAddressOf());
+}
 
-	// Save the counts
-	this->numIndices = (unsigned int)numIndices;
-	this->numVertices = (unsigned int)numVerts;
+
+//separate buffers for depth-only passes, built from LOD0
+void Mesh::CreatePositionStream(const Vertex* vertArray, size_t numVerts, const unsigned int* indexArray)
+{
+	std::vector<XMFLOAT3> positions;
+	std::vector<unsigned int> positionIndices;
+	MeshTools::BuildPositionStream(vertArray, numVerts, indexArray, lods[0].indexCount, positions, positionIndices);
+	if (positionIndices.empty())
+		return;
+
+	D3D11_BUFFER_DESC vbd = {};
+	vbd.Usage = D3D11_USAGE_IMMUTABLE;
+	vbd.ByteWidth = sizeof(XMFLOAT3) * (UINT)positions.size();
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	D3D11_SUBRESOURCE_DATA initialVertexData = {};
+	initialVertexData.pSysMem = positions.data();
+	Graphics::Device->CreateBuffer(&vbd, &initialVertexData, positionBuffer.GetAddressOf());
+
+	std::vector<uint16_t> shortIndices;
+	const void* indexData = positionIndices.data();
+	UINT indexSize = sizeof(unsigned int);
+	positionIndexFormat = DXGI_FORMAT_R32_UINT;
+	if (positions.size() <= 65536)
+	{
+		shortIndices.assign(positionIndices.begin(), positionIndices.end());
+		indexData = shortIndices.data();
+		indexSize = sizeof(uint16_t);
+		positionIndexFormat = DXGI_FORMAT_R16_UINT;
+	}
+
+	D3D11_BUFFER_DESC ibd = {};
+	ibd.Usage = D3D11_USAGE_IMMUTABLE;
+	ibd.ByteWidth = indexSize * (UINT)positionIndices.size();
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	D3D11_SUBRESOURCE_DATA initialIndexData = {};
+	initialIndexData.pSysMem = indexData;
+	Graphics::Device->CreateBuffer(&ibd, &initialIndexData, positionIndexBuffer.GetAddressOf());
+
+	numPositions = (unsigned int)positions.size();
+	numPositionIndices = (unsigned int)positionIndices.size();
 }
 
 
-void Mesh::Draw()
+//descriptions for each subset's material, from the OBJ's .mtl libraries
+//- anything missing (or a missing library) just keeps the defaults
+void Mesh::LoadMaterials(const std::wstring& objFile, const std::vector<std::string>& names, const std::vector<std::string>& libraries)
 {
-	UINT stride = sizeof(Vertex);
+	std::vector<ObjMaterial> library;
+	std::filesystem::path folder = std::filesystem::path(objFile).parent_path();
+	for (const std::string& file : libraries)
+		ObjLoader::ParseMaterialFile((folder / file).wstring(), library);
+
+	subsetMaterials.resize(names.size());
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		subsetMaterials[i].name = names[i];
+		for (const ObjMaterial& material : library)
+		{
+			if (material.name == names[i])
+				subsetMaterials[i] = material;
+		}
+	}
+}
+
+
+void Mesh::SetBuffers()
+{
+	// Pooled meshes only bind when another buffer got in the way
+	if (pool)
+	{
+		pool->Bind();
+		return;
+	}
+
+	GeometryPool::Invalidate();
 	UINT offset = 0;
-	Graphics::Context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-	Graphics::Context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	Graphics::Context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &vertexStride, &offset);
+	Graphics::Context->IASetIndexBuffer(indexBuffer.Get(), indexFormat, 0);
+}
+
+
+void Mesh::Draw()
+{
+	SetBuffers();
 
 	// Tell Direct3D to draw
 	//  - Begins the rendering pipeline on the GPU
@@ -331,97 +278,47 @@ void Mesh::Draw()
 	//     vertices in the currently set VERTEX BUFFER
 	Graphics::Context->DrawIndexed(
 		numIndices,     // The number of indices to use (we could draw a subset if we wanted)
-		0,     // Offset to the first index we want to use
-		0);    // Offset to add to each index when looking up vertices
+		GetStartIndex(),     // Offset to the first index we want to use
+		GetBaseVertex());    // Offset to add to each index when looking up vertices
 }
 
-// --------------------------------------------------------
-// Author: Chris Cascioli
-// Purpose: Calculates the tangents of the vertices in a mesh
-// 
-// - You are allowed to directly copy/paste this into your code base
-//   for assignments, given that you clearly cite that this is not
-//   code of your own design.
-//
-// - Code originally adapted from: http://www.terathon.com/code/tangent.html
-//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
-//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
-//
-// - Note: For this code to work, your Vertex format must
-//         contain an XMFLOAT3 called Tangent
-//
-// - Be sure to call this BEFORE creating your D3D vertex/index buffers
-// --------------------------------------------------------
-void Mesh::CalculateTangents(Vertex* verts, size_t numVerts, unsigned int* indices, size_t numIndices)
+
+//draws the ranges left over after culling (see Meshlets::Cull)
+void Mesh::Draw(const IndexRange* ranges, size_t numRanges)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
-	{
-		verts[i].tangent = XMFLOAT3(0, 0, 0);
-	}
+	if (numRanges == 0)
+		return;
 
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
-	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->uv.x - v1->uv.x;
-		float t1 = v2->uv.y - v1->uv.y;
-
-		float s2 = v3->uv.x - v1->uv.x;
-		float t2 = v3->uv.y - v1->uv.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->tangent.x += tx;
-		v1->tangent.y += ty;
-		v1->tangent.z += tz;
-
-		v2->tangent.x += tx;
-		v2->tangent.y += ty;
-		v2->tangent.z += tz;
-
-		v3->tangent.x += tx;
-		v3->tangent.y += ty;
-		v3->tangent.z += tz;
-	}
+	SetBuffers();
+	DrawRanges(ranges, numRanges);
+}
 
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
-	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].tangent);
 
-		// Use Gram-Schmidt orthonormalize to ensure
-		// the normal and tangent are exactly 90 degrees apart
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
+void Mesh::DrawRanges(const IndexRange* ranges, size_t numRanges)
+{
+	unsigned int startIndex = GetStartIndex();
+	unsigned int baseVertex = GetBaseVertex();
+	for (size_t i = 0; i < numRanges; i++)
+		Graphics::Context->DrawIndexed(ranges[i].indexCount, startIndex + ranges[i].startIndex, baseVertex);
+}
+
 
-		// Store the tangent
-		XMStoreFloat3(&verts[i].tangent, tangent);
+//the position stream has no LODs or meshlets, it's always all of LOD0
+void Mesh::DrawDepthOnly()
+{
+	// Compact vertices have no float3 position to fall back on, so those
+	// meshes skip the pass rather than feed it the wrong layout
+	if (!positionBuffer)
+	{
+		if (!compact)
+			Draw();
+		return;
 	}
-}
 
+	GeometryPool::Invalidate();
+	UINT stride = sizeof(XMFLOAT3);
+	UINT offset = 0;
+	Graphics::Context->IASetVertexBuffers(0, 1, positionBuffer.GetAddressOf(), &stride, &offset);
+	Graphics::Context->IASetIndexBuffer(positionIndexBuffer.Get(), positionIndexFormat, 0);
+	Graphics::Context->DrawIndexed(numPositionIndices, 0, 0);
+}
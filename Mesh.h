@@ -2,9 +2,18 @@
 #include <d3d11.h>
 #include <wrl/client.h>
 #include "Vertex.h"
+#include "GeometryPool.h"
+#include "MeshBounds.h"
+#include "MeshBvh.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "ObjLoader.h"
+#include "VertexQuantize.h"
 #include <memory>
 #include <string>
+#include <vector>
 
+struct CookedMesh;
 
 class Mesh
 {
@@ -12,30 +21,105 @@ public:
 	//constructor
 	Mesh(const char* name, Vertex* vertArray, size_t numVerts, unsigned int* indexArray, size_t numIndices);
 	Mesh(const char* name, const std::wstring& objFile);
+	Mesh(const char* name, const CookedMesh& cooked); //already optimized, see MeshGenerator
+
+	Mesh(const Mesh&) = delete; //would free its pool ranges twice
+	Mesh& operator=(const Mesh&) = delete;
+
+	//meshes created while a pool is set share its buffers (when they fit)
+	static void SetGeometryPool(std::shared_ptr<GeometryPool> pool) { geometryPool = pool; }
+
+	//meshes created while this is on also get a position-only stream for depth passes
+	static void SetBuildPositionStreams(bool enabled) { buildPositionStreams = enabled; }
+
+	//meshes created while this is on also fit an oriented box (see MeshBounds)
+	static void SetBuildOrientedBounds(bool enabled) { buildOrientedBounds = enabled; }
+
+	//meshes created while this is on also get a BVH over LOD0 for ray queries
+	static void SetBuildBvhs(bool enabled) { buildBvhs = enabled; }
+
+	//meshes created while this is on store CompactVertex (20 bytes instead of 44), which
+	//only shaders reading CompactVertexShaderInput can draw (see GetCompactParams)
+	static void SetBuildCompactVertices(bool enabled) { buildCompactVertices = enabled; }
+	static bool GetBuildCompactVertices() { return buildCompactVertices; }
+	static constexpr CompactPositionFormat CompactPositions = COMPACT_POSITION_UNORM16;
 
 	//methods
-	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer() { return vertexBuffer; }
-	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer() { return indexBuffer; }
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer() { return pool ? pool->GetVertexBuffer() : vertexBuffer; }
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer() { return pool ? pool->GetIndexBuffer() : indexBuffer; }
+	unsigned int GetBaseVertex() { return pool ? pool->GetBaseVertex(poolAllocation) : 0; }
+	unsigned int GetStartIndex() { return pool ? pool->GetStartIndex(poolAllocation) : 0; }
 	unsigned int GetIndexCount() { return numIndices; }
 	unsigned int GetVertexCount() { return numVertices; }
+	unsigned int GetSourceVertexCount() { return numSourceVertices; }
+	unsigned int GetPositionCount() { return numPositions; }
 	const char* GetShapeName() { return name; }
+	const std::vector<Meshlet>& GetMeshlets() { return meshlets; }
+	const std::vector<MeshLod>& GetLods() { return lods; }
+	const std::vector<MeshSubset>& GetSubsets() { return subsets; }
+	const std::vector<ObjMaterial>& GetSubsetMaterials() { return subsetMaterials; }
+	const BoundingVolumes& GetBounds() { return bounds; } //local space
+	const MeshBvh* GetBvh() { return bvh.get(); } //local space, null unless built with SetBuildBvhs
+	const CompactVertexParams* GetCompactParams() { return compact ? &compactParams : nullptr; } //null for full vertices
 
 	void Draw();
+	void Draw(const IndexRange* ranges, size_t numRanges); //only the given parts of the index buffer
+	void SetBuffers(); //Draw() does this itself, call it before DrawRanges()
+	void DrawRanges(const IndexRange* ranges, size_t numRanges); //with the buffers already bound, so subsets can switch materials in between
+	void DrawDepthOnly(); //LOD0 from the position stream if there is one (never the compact vertices), for shaders that only read POSITION
 	
 	//destructor
-	~Mesh() = default;
+	~Mesh();
 
 private:
-	//ID3D11 buffers
+	//ID3D11 buffers, unless the mesh lives in a pool
 	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
+	std::shared_ptr<GeometryPool> pool;
+	GeometryAllocation poolAllocation;
+	UINT vertexStride = sizeof(Vertex);
+	inline static std::shared_ptr<GeometryPool> geometryPool;
+
+	//how to unpack the vertex buffer when it holds CompactVertex
+	bool compact = false;
+	CompactVertexParams compactParams = {};
+	inline static bool buildCompactVertices = false;
+
+	//positions only, welded and ordered separately (see MeshTools::BuildPositionStream)
+	Microsoft::WRL::ComPtr<ID3D11Buffer> positionBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> positionIndexBuffer;
+	unsigned int numPositions = 0;
+	unsigned int numPositionIndices = 0;
+	DXGI_FORMAT positionIndexFormat;
+	inline static bool buildPositionStreams = false;
 
 	//indices and verticies in buffers
 	unsigned int numIndices;
 	unsigned int numVertices;
+	unsigned int numSourceVertices; //vertex count before welding (face corners for OBJs)
+	DXGI_FORMAT indexFormat; //16-bit whenever every index fits
 	const char* name;
 
-	void CreateBuffers(Vertex* vertexArray, size_t vertexCount, unsigned int* indexArray, size_t indexCount);
-	void CalculateTangents(Vertex* verts, size_t numVerts, unsigned int* indices, size_t numIndices);
+	//clusters for CPU culling, in index buffer order
+	std::vector<Meshlet> meshlets;
+
+	//LOD0 (the full mesh) first, then coarser ones
+	std::vector<MeshLod> lods;
+
+	//one per material (always at least one), with the .mtl description of each
+	std::vector<MeshSubset> subsets;
+	std::vector<ObjMaterial> subsetMaterials;
+
+	//local space box, sphere and oriented box
+	BoundingVolumes bounds;
+	inline static bool buildOrientedBounds = false;
+
+	//triangles of LOD0 for picking, hit triangles index LOD0's indices
+	std::unique_ptr<MeshBvh> bvh;
+	inline static bool buildBvhs = false;
+
+	void CreateBuffers(const Vertex* vertexArray, size_t vertexCount, const unsigned int* indexArray, size_t indexCount);
+	void CreatePositionStream(const Vertex* vertexArray, size_t vertexCount, const unsigned int* indexArray);
+	void LoadMaterials(const std::wstring& objFile, const std::vector<std::string>& names, const std::vector<std::string>& libraries);
 
 };
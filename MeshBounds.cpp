@@ -0,0 +1,572 @@
+#include "MeshBounds.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MESH_BOUNDS_SSE 1
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	//growing the sphere towards the farthest vertex settles in a few passes,
+	//after this many the farthest vertex just sets the radius
+	const int MaxSpherePasses = 8;
+
+	//Jacobi sweeps for a 3x3 matrix, it converges long before this
+	const int MaxJacobiSweeps = 16;
+
+	XMFLOAT3 Add(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x + b.x, a.y + b.y, a.z + b.z); }
+	XMFLOAT3 Sub(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	XMFLOAT3 Scale(const XMFLOAT3& a, float s) { return XMFLOAT3(a.x * s, a.y * s, a.z * s); }
+	float Dot(const XMFLOAT3& a, const XMFLOAT3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	XMFLOAT3 Abs(const XMFLOAT3& a) { return XMFLOAT3(fabsf(a.x), fabsf(a.y), fabsf(a.z)); }
+
+	OrientedBox BoxToOriented(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+	{
+		XMFLOAT3 half = Scale(Sub(boxMax, boxMin), 0.5f);
+		OrientedBox box;
+		box.center = Scale(Add(boxMin, boxMax), 0.5f);
+		box.axes[0] = XMFLOAT3(half.x, 0, 0);
+		box.axes[1] = XMFLOAT3(0, half.y, 0);
+		box.axes[2] = XMFLOAT3(0, 0, half.z);
+		return box;
+	}
+
+#ifdef MESH_BOUNDS_SSE
+	float HorizontalMin(__m128 v)
+	{
+		v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtss_f32(_mm_min_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1))));
+	}
+
+	float HorizontalMax(__m128 v)
+	{
+		v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtss_f32(_mm_max_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1))));
+	}
+
+	float HorizontalSum(__m128 v)
+	{
+		v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtss_f32(_mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1))));
+	}
+#endif
+
+	// Positions split into x, y and z arrays, so every pass after the first
+	// reads 12 bytes a vertex instead of the whole vertex
+	// - Padded to a multiple of four with copies of the last position,
+	//   which don't change any min, max or farthest point
+	struct PositionLanes
+	{
+		std::vector<float> x, y, z;
+		size_t count;
+		size_t padded;
+		XMFLOAT3 boxMin, boxMax;
+	};
+
+	// Splits out the positions and finds their box on the way
+	void LoadLanes(const Vertex* verts, size_t numVerts, PositionLanes& lanes)
+	{
+		lanes.count = numVerts;
+		lanes.padded = (numVerts + 3) & ~(size_t)3;
+		lanes.x.resize(lanes.padded);
+		lanes.y.resize(lanes.padded);
+		lanes.z.resize(lanes.padded);
+
+		XMFLOAT3 lo = verts[0].Position;
+		XMFLOAT3 hi = lo;
+		size_t i = 0;
+
+#ifdef MESH_BOUNDS_SSE
+		//the fourth float of each load is uv.x, still inside the vertex
+		static_assert(offsetof(Vertex, Position) + sizeof(float) * 4 <= sizeof(Vertex), "position loads would run past the vertex");
+		__m128 loV[3] = { _mm_set1_ps(lo.x), _mm_set1_ps(lo.y), _mm_set1_ps(lo.z) };
+		__m128 hiV[3] = { loV[0], loV[1], loV[2] };
+		for (; i + 4 <= numVerts; i += 4)
+		{
+			__m128 p0 = _mm_loadu_ps(&verts[i].Position.x);
+			__m128 p1 = _mm_loadu_ps(&verts[i + 1].Position.x);
+			__m128 p2 = _mm_loadu_ps(&verts[i + 2].Position.x);
+			__m128 p3 = _mm_loadu_ps(&verts[i + 3].Position.x);
+			_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+			_mm_storeu_ps(&lanes.x[i], p0);
+			_mm_storeu_ps(&lanes.y[i], p1);
+			_mm_storeu_ps(&lanes.z[i], p2);
+			loV[0] = _mm_min_ps(loV[0], p0);
+			loV[1] = _mm_min_ps(loV[1], p1);
+			loV[2] = _mm_min_ps(loV[2], p2);
+			hiV[0] = _mm_max_ps(hiV[0], p0);
+			hiV[1] = _mm_max_ps(hiV[1], p1);
+			hiV[2] = _mm_max_ps(hiV[2], p2);
+		}
+		lo = XMFLOAT3(HorizontalMin(loV[0]), HorizontalMin(loV[1]), HorizontalMin(loV[2]));
+		hi = XMFLOAT3(HorizontalMax(hiV[0]), HorizontalMax(hiV[1]), HorizontalMax(hiV[2]));
+#endif
+
+		for (; i < lanes.padded; i++)
+		{
+			const XMFLOAT3& p = verts[std::min(i, numVerts - 1)].Position;
+			lanes.x[i] = p.x;
+			lanes.y[i] = p.y;
+			lanes.z[i] = p.z;
+			lo = XMFLOAT3(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+			hi = XMFLOAT3(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+		}
+		lanes.boxMin = lo;
+		lanes.boxMax = hi;
+	}
+
+	XMFLOAT3 GetPosition(const PositionLanes& lanes, size_t i) { return XMFLOAT3(lanes.x[i], lanes.y[i], lanes.z[i]); }
+
+	// Squared distance from point to the farthest position, and that position
+	float FindFarthest(const PositionLanes& lanes, const XMFLOAT3& point, XMFLOAT3& farthestPosition)
+	{
+		size_t farthest = 0;
+		float farthestDistance = -1.0f;
+		size_t i = 0;
+
+#ifdef MESH_BOUNDS_SSE
+		__m128 px = _mm_set1_ps(point.x);
+		__m128 py = _mm_set1_ps(point.y);
+		__m128 pz = _mm_set1_ps(point.z);
+		__m128 maxDistance = _mm_set1_ps(-1.0f);
+		__m128i maxIndex = _mm_setzero_si128();
+		__m128i index = _mm_setr_epi32(0, 1, 2, 3);
+		const __m128i four = _mm_set1_epi32(4);
+		for (; i < lanes.padded; i += 4)
+		{
+			__m128 x = _mm_sub_ps(_mm_loadu_ps(&lanes.x[i]), px);
+			__m128 y = _mm_sub_ps(_mm_loadu_ps(&lanes.y[i]), py);
+			__m128 z = _mm_sub_ps(_mm_loadu_ps(&lanes.z[i]), pz);
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+
+			//each lane keeps its own farthest position, merged after the loop
+			__m128i farther = _mm_castps_si128(_mm_cmpgt_ps(d, maxDistance));
+			maxDistance = _mm_max_ps(maxDistance, d);
+			maxIndex = _mm_or_si128(_mm_and_si128(farther, index), _mm_andnot_si128(farther, maxIndex));
+			index = _mm_add_epi32(index, four);
+		}
+
+		alignas(16) float laneDistances[4];
+		alignas(16) int laneIndices[4];
+		_mm_store_ps(laneDistances, maxDistance);
+		_mm_store_si128((__m128i*)laneIndices, maxIndex);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if (laneDistances[lane] > farthestDistance)
+			{
+				farthestDistance = laneDistances[lane];
+				farthest = (size_t)laneIndices[lane];
+			}
+		}
+#endif
+
+		for (; i < lanes.padded; i++)
+		{
+			XMFLOAT3 d = Sub(GetPosition(lanes, i), point);
+			float dd = Dot(d, d);
+			if (dd > farthestDistance)
+			{
+				farthestDistance = dd;
+				farthest = i;
+			}
+		}
+		farthestPosition = GetPosition(lanes, farthest);
+		return farthestDistance;
+	}
+
+	void CalculateSphere(const PositionLanes& lanes, XMFLOAT3& center, float& radius)
+	{
+		//box center, reaching just the farthest position
+		XMFLOAT3 p;
+		center = Scale(Add(lanes.boxMin, lanes.boxMax), 0.5f);
+		radius = sqrtf(FindFarthest(lanes, center, p));
+
+		//Ritter: two far apart positions as a first diameter...
+		XMFLOAT3 a, b;
+		FindFarthest(lanes, GetPosition(lanes, 0), a);
+		float diameterSquared = FindFarthest(lanes, a, b);
+		XMFLOAT3 ritterCenter = Scale(Add(a, b), 0.5f);
+		float ritterRadius = sqrtf(diameterSquared) * 0.5f;
+
+		//...then grown just enough to take in the farthest position, until none are left outside
+		for (int pass = 0; pass < MaxSpherePasses; pass++)
+		{
+			float distanceSquared = FindFarthest(lanes, ritterCenter, p);
+			if (distanceSquared <= ritterRadius * ritterRadius)
+				break;
+
+			float distance = sqrtf(distanceSquared);
+			if (pass == MaxSpherePasses - 1)
+			{
+				ritterRadius = distance;
+				break;
+			}
+
+			float grown = (ritterRadius + distance) * 0.5f;
+			ritterCenter = Add(ritterCenter, Scale(Sub(p, ritterCenter), (grown - ritterRadius) / distance));
+			ritterRadius = grown;
+		}
+
+		if (ritterRadius < radius)
+		{
+			center = ritterCenter;
+			radius = ritterRadius;
+		}
+	}
+
+	// Eigenvectors of a symmetric 3x3 matrix as the columns of vectors,
+	// a ends up (close to) diagonal with the eigenvalues
+	void Eigenvectors(float a[3][3], float vectors[3][3])
+	{
+		for (int i = 0; i < 3; i++)
+			for (int j = 0; j < 3; j++)
+				vectors[i][j] = i == j ? 1.0f : 0.0f;
+
+		const int pairs[3][2] = { { 0, 1 }, { 0, 2 }, { 1, 2 } };
+		for (int sweep = 0; sweep < MaxJacobiSweeps; sweep++)
+		{
+			float off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+			float diagonal = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+			if (off <= diagonal * 1e-12f)
+				break;
+
+			for (const auto& pair : pairs)
+			{
+				int p = pair[0];
+				int q = pair[1];
+				if (a[p][q] == 0.0f)
+					continue;
+
+				//rotation that zeroes a[p][q]
+				float theta = (a[q][q] - a[p][p]) / (2.0f * a[p][q]);
+				float t = (theta >= 0.0f ? 1.0f : -1.0f) / (fabsf(theta) + sqrtf(theta * theta + 1.0f));
+				float c = 1.0f / sqrtf(t * t + 1.0f);
+				float s = t * c;
+
+				for (int k = 0; k < 3; k++)
+				{
+					float kp = a[k][p];
+					float kq = a[k][q];
+					a[k][p] = c * kp - s * kq;
+					a[k][q] = s * kp + c * kq;
+				}
+				for (int k = 0; k < 3; k++)
+				{
+					float pk = a[p][k];
+					float qk = a[q][k];
+					a[p][k] = c * pk - s * qk;
+					a[q][k] = s * pk + c * qk;
+				}
+				for (int k = 0; k < 3; k++)
+				{
+					float kp = vectors[k][p];
+					float kq = vectors[k][q];
+					vectors[k][p] = c * kp - s * kq;
+					vectors[k][q] = s * kp + c * kq;
+				}
+			}
+		}
+	}
+
+	// Box along the principal axes of the positions, false if it
+	// doesn't beat the axis aligned one
+	// - The covariance only picks the axes, the extents come from
+	//   projecting every position, so float sums are plenty
+	bool FitOrientedBox(const PositionLanes& lanes, OrientedBox& box)
+	{
+		//sums around the box center, close enough to the mean to avoid cancellation
+		//(only over real positions, the padding would skew them)
+		XMFLOAT3 origin = Scale(Add(lanes.boxMin, lanes.boxMax), 0.5f);
+		float sum[3] = {};
+		float squares[3] = {};
+		float products[3] = {}; //xy, yz, zx
+		size_t i = 0;
+
+#ifdef MESH_BOUNDS_SSE
+		__m128 ox = _mm_set1_ps(origin.x);
+		__m128 oy = _mm_set1_ps(origin.y);
+		__m128 oz = _mm_set1_ps(origin.z);
+		__m128 sumV[3] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+		__m128 squaresV[3] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+		__m128 productsV[3] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+		for (; i + 4 <= lanes.count; i += 4)
+		{
+			__m128 x = _mm_sub_ps(_mm_loadu_ps(&lanes.x[i]), ox);
+			__m128 y = _mm_sub_ps(_mm_loadu_ps(&lanes.y[i]), oy);
+			__m128 z = _mm_sub_ps(_mm_loadu_ps(&lanes.z[i]), oz);
+			sumV[0] = _mm_add_ps(sumV[0], x);
+			sumV[1] = _mm_add_ps(sumV[1], y);
+			sumV[2] = _mm_add_ps(sumV[2], z);
+			squaresV[0] = _mm_add_ps(squaresV[0], _mm_mul_ps(x, x));
+			squaresV[1] = _mm_add_ps(squaresV[1], _mm_mul_ps(y, y));
+			squaresV[2] = _mm_add_ps(squaresV[2], _mm_mul_ps(z, z));
+			productsV[0] = _mm_add_ps(productsV[0], _mm_mul_ps(x, y));
+			productsV[1] = _mm_add_ps(productsV[1], _mm_mul_ps(y, z));
+			productsV[2] = _mm_add_ps(productsV[2], _mm_mul_ps(z, x));
+		}
+		for (int k = 0; k < 3; k++)
+		{
+			sum[k] = HorizontalSum(sumV[k]);
+			squares[k] = HorizontalSum(squaresV[k]);
+			products[k] = HorizontalSum(productsV[k]);
+		}
+#endif
+
+		for (; i < lanes.count; i++)
+		{
+			XMFLOAT3 p = Sub(GetPosition(lanes, i), origin);
+			sum[0] += p.x;
+			sum[1] += p.y;
+			sum[2] += p.z;
+			squares[0] += p.x * p.x;
+			squares[1] += p.y * p.y;
+			squares[2] += p.z * p.z;
+			products[0] += p.x * p.y;
+			products[1] += p.y * p.z;
+			products[2] += p.z * p.x;
+		}
+
+		float n = (float)lanes.count;
+		float mean[3] = { sum[0] / n, sum[1] / n, sum[2] / n };
+		float covariance[3][3];
+		for (int k = 0; k < 3; k++)
+			covariance[k][k] = squares[k] / n - mean[k] * mean[k];
+		covariance[0][1] = covariance[1][0] = products[0] / n - mean[0] * mean[1];
+		covariance[1][2] = covariance[2][1] = products[1] / n - mean[1] * mean[2];
+		covariance[2][0] = covariance[0][2] = products[2] / n - mean[2] * mean[0];
+
+		float vectors[3][3];
+		Eigenvectors(covariance, vectors);
+		XMFLOAT3 axes[3];
+		for (int k = 0; k < 3; k++)
+			XMStoreFloat3(&axes[k], XMVector3Normalize(XMVectorSet(vectors[0][k], vectors[1][k], vectors[2][k], 0)));
+		XMStoreFloat3(&axes[2], XMVector3Cross(XMLoadFloat3(&axes[0]), XMLoadFloat3(&axes[1])));
+
+		//extents along each axis
+		float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		i = 0;
+
+#ifdef MESH_BOUNDS_SSE
+		__m128 loV[3], hiV[3], ax[3], ay[3], az[3];
+		for (int k = 0; k < 3; k++)
+		{
+			loV[k] = _mm_set1_ps(FLT_MAX);
+			hiV[k] = _mm_set1_ps(-FLT_MAX);
+			ax[k] = _mm_set1_ps(axes[k].x);
+			ay[k] = _mm_set1_ps(axes[k].y);
+			az[k] = _mm_set1_ps(axes[k].z);
+		}
+		for (; i < lanes.padded; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(&lanes.x[i]);
+			__m128 y = _mm_loadu_ps(&lanes.y[i]);
+			__m128 z = _mm_loadu_ps(&lanes.z[i]);
+			for (int k = 0; k < 3; k++)
+			{
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, ax[k]), _mm_mul_ps(y, ay[k])), _mm_mul_ps(z, az[k]));
+				loV[k] = _mm_min_ps(loV[k], d);
+				hiV[k] = _mm_max_ps(hiV[k], d);
+			}
+		}
+		for (int k = 0; k < 3; k++)
+		{
+			lo[k] = HorizontalMin(loV[k]);
+			hi[k] = HorizontalMax(hiV[k]);
+		}
+#endif
+
+		for (; i < lanes.padded; i++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				float d = Dot(GetPosition(lanes, i), axes[k]);
+				lo[k] = std::min(lo[k], d);
+				hi[k] = std::max(hi[k], d);
+			}
+		}
+
+		XMFLOAT3 size = Sub(lanes.boxMax, lanes.boxMin);
+		float fittedVolume = (hi[0] - lo[0]) * (hi[1] - lo[1]) * (hi[2] - lo[2]);
+		if (!(fittedVolume < size.x * size.y * size.z))
+			return false;
+
+		box.center = XMFLOAT3(0, 0, 0);
+		for (int k = 0; k < 3; k++)
+		{
+			box.center = Add(box.center, Scale(axes[k], (lo[k] + hi[k]) * 0.5f));
+			box.axes[k] = Scale(axes[k], (hi[k] - lo[k]) * 0.5f);
+		}
+		return true;
+	}
+}
+
+
+// --------------------------------------------------------
+// Box, sphere and (if asked for) oriented box of the
+// vertex positions
+// --------------------------------------------------------
+BoundingVolumes MeshBounds::Calculate(const Vertex* verts, size_t numVerts, bool orientedBox)
+{
+	BoundingVolumes bounds = {};
+	if (numVerts == 0)
+	{
+		bounds.orientedBox = BoxToOriented(bounds.boxMin, bounds.boxMax);
+		return bounds;
+	}
+
+	PositionLanes lanes;
+	LoadLanes(verts, numVerts, lanes);
+	bounds.boxMin = lanes.boxMin;
+	bounds.boxMax = lanes.boxMax;
+	CalculateSphere(lanes, bounds.sphereCenter, bounds.sphereRadius);
+
+	bounds.hasOrientedBox = orientedBox && FitOrientedBox(lanes, bounds.orientedBox);
+	if (!bounds.hasOrientedBox)
+		bounds.orientedBox = BoxToOriented(bounds.boxMin, bounds.boxMax);
+	return bounds;
+}
+
+
+// --------------------------------------------------------
+// Moves bounds into another space
+//
+// - The sphere scales by the matrix's largest stretch (its
+//   biggest singular value), which stays right for the
+//   sheared matrices nested non-uniform scales end up with
+// - The box is whichever of the moved axis aligned box's and
+//   moved oriented box's bounds is tighter on each side
+// --------------------------------------------------------
+BoundingVolumes MeshBounds::Transform(const BoundingVolumes& bounds, const XMFLOAT4X4& world)
+{
+	XMFLOAT3 rows[3] = {
+		XMFLOAT3(world._11, world._12, world._13),
+		XMFLOAT3(world._21, world._22, world._23),
+		XMFLOAT3(world._31, world._32, world._33) };
+	XMFLOAT3 translation(world._41, world._42, world._43);
+	auto transformDirection = [&](const XMFLOAT3& d)
+	{
+		return Add(Add(Scale(rows[0], d.x), Scale(rows[1], d.y)), Scale(rows[2], d.z));
+	};
+	auto transformPoint = [&](const XMFLOAT3& p) { return Add(transformDirection(p), translation); };
+
+	BoundingVolumes result;
+	result.hasOrientedBox = bounds.hasOrientedBox;
+
+	//largest eigenvalue of M^T M is the squared largest stretch
+	const float m[3][3] = {
+		{ world._11, world._12, world._13 },
+		{ world._21, world._22, world._23 },
+		{ world._31, world._32, world._33 } };
+	float gram[3][3];
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			gram[i][j] = m[0][i] * m[0][j] + m[1][i] * m[1][j] + m[2][i] * m[2][j];
+	float unusedVectors[3][3];
+	Eigenvectors(gram, unusedVectors);
+	float stretchSquared = std::max(gram[0][0], std::max(gram[1][1], gram[2][2]));
+	result.sphereCenter = transformPoint(bounds.sphereCenter);
+	result.sphereRadius = bounds.sphereRadius * sqrtf(std::max(stretchSquared, 0.0f));
+
+	const OrientedBox& box = bounds.orientedBox;
+	result.orientedBox.center = transformPoint(box.center);
+	XMFLOAT3 orientedHalf(0, 0, 0);
+	for (int k = 0; k < 3; k++)
+	{
+		result.orientedBox.axes[k] = transformDirection(box.axes[k]);
+		orientedHalf = Add(orientedHalf, Abs(result.orientedBox.axes[k]));
+	}
+
+	//Arvo: each world axis of the box gets the absolute matrix entries times the half sizes
+	XMFLOAT3 localHalf = Scale(Sub(bounds.boxMax, bounds.boxMin), 0.5f);
+	XMFLOAT3 boxCenter = transformPoint(Scale(Add(bounds.boxMin, bounds.boxMax), 0.5f));
+	XMFLOAT3 boxHalf = Add(Add(Scale(Abs(rows[0]), localHalf.x), Scale(Abs(rows[1]), localHalf.y)), Scale(Abs(rows[2]), localHalf.z));
+
+	const XMFLOAT3& oc = result.orientedBox.center;
+	result.boxMin = XMFLOAT3(
+		std::max(boxCenter.x - boxHalf.x, oc.x - orientedHalf.x),
+		std::max(boxCenter.y - boxHalf.y, oc.y - orientedHalf.y),
+		std::max(boxCenter.z - boxHalf.z, oc.z - orientedHalf.z));
+	result.boxMax = XMFLOAT3(
+		std::min(boxCenter.x + boxHalf.x, oc.x + orientedHalf.x),
+		std::min(boxCenter.y + boxHalf.y, oc.y + orientedHalf.y),
+		std::min(boxCenter.z + boxHalf.z, oc.z + orientedHalf.z));
+	return result;
+}
+
+
+// --------------------------------------------------------
+// Any one of the volumes being fully outside a plane is
+// enough, cheapest first
+// --------------------------------------------------------
+bool MeshBounds::IntersectsFrustum(const BoundingVolumes& bounds, const XMFLOAT4 frustum[6])
+{
+	XMFLOAT3 boxCenter = Scale(Add(bounds.boxMin, bounds.boxMax), 0.5f);
+	XMFLOAT3 boxHalf = Scale(Sub(bounds.boxMax, bounds.boxMin), 0.5f);
+	const OrientedBox& box = bounds.orientedBox;
+
+	for (int i = 0; i < 6; i++)
+	{
+		XMFLOAT3 normal(frustum[i].x, frustum[i].y, frustum[i].z);
+		float w = frustum[i].w;
+
+		if (Dot(normal, bounds.sphereCenter) + w < -bounds.sphereRadius)
+			return false;
+
+		if (Dot(normal, boxCenter) + w < -Dot(Abs(normal), boxHalf))
+			return false;
+
+		float reach = fabsf(Dot(normal, box.axes[0])) + fabsf(Dot(normal, box.axes[1])) + fabsf(Dot(normal, box.axes[2]));
+		if (Dot(normal, box.center) + w < -reach)
+			return false;
+	}
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Sphere first (closest point of the ray segment to its
+// center), then slabs of the axis aligned box
+// --------------------------------------------------------
+bool MeshBounds::IntersectsRay(const BoundingVolumes& bounds, const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance)
+{
+	float lengthSquared = Dot(direction, direction);
+	if (lengthSquared <= 0.0f)
+		return false;
+
+	XMFLOAT3 toCenter = Sub(bounds.sphereCenter, origin);
+	float closest = std::min(std::max(Dot(toCenter, direction) / lengthSquared, 0.0f), maxDistance);
+	XMFLOAT3 offset = Sub(toCenter, Scale(direction, closest));
+	if (Dot(offset, offset) > bounds.sphereRadius * bounds.sphereRadius)
+		return false;
+
+	float entry = 0.0f;
+	float exitDistance = maxDistance;
+	const float* o = &origin.x;
+	const float* d = &direction.x;
+	const float* boxMin = &bounds.boxMin.x;
+	const float* boxMax = &bounds.boxMax.x;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		//parallel to this slab, so either always inside it or never
+		if (d[axis] == 0.0f)
+		{
+			if (o[axis] < boxMin[axis] || o[axis] > boxMax[axis])
+				return false;
+			continue;
+		}
+
+		float t0 = (boxMin[axis] - o[axis]) / d[axis];
+		float t1 = (boxMax[axis] - o[axis]) / d[axis];
+		entry = std::max(entry, std::min(t0, t1));
+		exitDistance = std::min(exitDistance, std::max(t0, t1));
+	}
+	return entry <= exitDistance;
+}
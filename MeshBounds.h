@@ -0,0 +1,56 @@
+#pragma once
+#include <DirectXMath.h>
+#include "Vertex.h"
+
+// A box with its own axes
+// - axes are half of each side, so center +- an axis lands on
+//   a face; they start out orthogonal, a non-uniform scale can
+//   skew them once transformed, which everything here handles
+struct OrientedBox
+{
+	DirectX::XMFLOAT3 center;
+	DirectX::XMFLOAT3 axes[3];
+};
+
+// Where a mesh is, in whichever space it was calculated for
+struct BoundingVolumes
+{
+	DirectX::XMFLOAT3 boxMin;
+	DirectX::XMFLOAT3 boxMax;
+	DirectX::XMFLOAT3 sphereCenter;
+	float sphereRadius;
+	OrientedBox orientedBox;	// Same as the axis aligned box unless hasOrientedBox
+	bool hasOrientedBox;		// A fitted box, tighter than the axis aligned one
+};
+
+// --------------------------------------------------------
+// Bounding volumes for culling and LOD selection
+//
+// - Positions are split into x, y and z arrays once, then
+//   everything is SSE min/max reductions over those, cheap
+//   enough to do at load time
+// - The sphere is Ritter's (two farthest point hops for a
+//   starting diameter, then grown towards whatever is still
+//   outside) or the box's center with the farthest point as
+//   radius, whichever comes out smaller
+// - Oriented boxes follow the principal axes of the positions
+//   and are only kept when they have less volume than the
+//   axis aligned box
+// --------------------------------------------------------
+namespace MeshBounds
+{
+	BoundingVolumes Calculate(const Vertex* verts, size_t numVerts, bool orientedBox);
+
+	// Bounds after a (row vector, affine) world matrix
+	// - Still contain the whole mesh, the sphere and the box just
+	//   aren't as tight as recalculating from the moved vertices
+	BoundingVolumes Transform(const BoundingVolumes& bounds, const DirectX::XMFLOAT4X4& world);
+
+	// False once the bounds are fully behind any of the planes
+	// (normals pointing inwards, see Meshlets::MakeCullParams)
+	bool IntersectsFrustum(const BoundingVolumes& bounds, const DirectX::XMFLOAT4 frustum[6]);
+
+	// False when the ray can't reach the bounds within maxDistance
+	// (in multiples of direction, which doesn't have to be unit length)
+	bool IntersectsRay(const BoundingVolumes& bounds, const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance);
+}
@@ -0,0 +1,813 @@
+#include "MeshBvh.h"
+#include "WorkerThreads.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MESH_BVH_SSE 1
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	const unsigned int SahBins = 16;
+
+	// Cost of visiting a node, relative to testing one triangle
+	const float TraversalCost = 1.0f;
+
+	// Past this depth splits are plain median splits, which halve
+	// what's left each time, so the tree can never get deeper than
+	// MaxBvhDepth (and query stacks can't overflow)
+	const unsigned int SahMaxDepth = 32;
+	const unsigned int MaxBvhDepth = SahMaxDepth + 32;
+
+	// Nodes with at least this many triangles are split one at a time, as
+	// tasks any build thread can pick up; smaller ones are built whole
+	const uint32_t MinTaskTriangles = 1 << 12;
+
+	// Triangles per chunk of the bounds and centroids pass
+	const uint32_t PrepareChunkSize = 1 << 14;
+
+	struct Bounds
+	{
+		XMFLOAT3 min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+		void Grow(const XMFLOAT3& p)
+		{
+			min = XMFLOAT3(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+			max = XMFLOAT3(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+		}
+
+		void Grow(const Bounds& b)
+		{
+			min = XMFLOAT3(std::min(min.x, b.min.x), std::min(min.y, b.min.y), std::min(min.z, b.min.z));
+			max = XMFLOAT3(std::max(max.x, b.max.x), std::max(max.y, b.max.y), std::max(max.z, b.max.z));
+		}
+
+		float Area() const
+		{
+			if (min.x > max.x)
+				return 0.0f;
+			float dx = max.x - min.x, dy = max.y - min.y, dz = max.z - min.z;
+			return dx * dy + dy * dz + dz * dx;
+		}
+	};
+
+	inline float Component(const XMFLOAT3& v, int axis) { return (&v.x)[axis]; }
+
+	inline XMFLOAT3 Sub(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	inline XMFLOAT3 MulAdd(const XMFLOAT3& a, const XMFLOAT3& b, float s) { return XMFLOAT3(a.x + b.x * s, a.y + b.y * s, a.z + b.z * s); }
+	inline float Dot(const XMFLOAT3& a, const XMFLOAT3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline float LengthSquared(const XMFLOAT3& v) { return Dot(v, v); }
+
+	// Squared distance from p to a node's box, 0 inside it
+	inline float BoxDistanceSquared(const BvhNode& node, const XMFLOAT3& p)
+	{
+		float dx = std::max(std::max(node.boundsMin.x - p.x, p.x - node.boundsMax.x), 0.0f);
+		float dy = std::max(std::max(node.boundsMin.y - p.y, p.y - node.boundsMax.y), 0.0f);
+		float dz = std::max(std::max(node.boundsMin.z - p.z, p.z - node.boundsMax.z), 0.0f);
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	inline XMFLOAT3 ClosestPointOnSegment(const XMFLOAT3& p, const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		XMFLOAT3 ab = Sub(b, a);
+		float lengthSquared = LengthSquared(ab);
+		float t = lengthSquared > 0.0f ? std::clamp(Dot(Sub(p, a), ab) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+		return MulAdd(a, ab, t);
+	}
+
+	// Closest point on triangle abc to p, by Voronoi region
+	// (Ericson, Real-Time Collision Detection 5.1.5)
+	BvhFeature ClosestPointOnTriangle(const XMFLOAT3& p, const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c, XMFLOAT3& out)
+	{
+		XMFLOAT3 ab = Sub(b, a);
+		XMFLOAT3 ac = Sub(c, a);
+		XMFLOAT3 ap = Sub(p, a);
+		float d1 = Dot(ab, ap);
+		float d2 = Dot(ac, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f)
+		{
+			out = a;
+			return BVH_FEATURE_VERTEX_A;
+		}
+
+		XMFLOAT3 bp = Sub(p, b);
+		float d3 = Dot(ab, bp);
+		float d4 = Dot(ac, bp);
+		if (d3 >= 0.0f && d4 <= d3)
+		{
+			out = b;
+			return BVH_FEATURE_VERTEX_B;
+		}
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		{
+			out = MulAdd(a, ab, d1 / (d1 - d3));
+			return BVH_FEATURE_EDGE_AB;
+		}
+
+		XMFLOAT3 cp = Sub(p, c);
+		float d5 = Dot(ab, cp);
+		float d6 = Dot(ac, cp);
+		if (d6 >= 0.0f && d5 <= d6)
+		{
+			out = c;
+			return BVH_FEATURE_VERTEX_C;
+		}
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		{
+			out = MulAdd(a, ac, d2 / (d2 - d6));
+			return BVH_FEATURE_EDGE_CA;
+		}
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+		{
+			out = MulAdd(b, Sub(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+			return BVH_FEATURE_EDGE_BC;
+		}
+
+		//zero area triangles end up here with nothing to divide by, use the closest edge
+		float sum = va + vb + vc;
+		if (!(sum > 0.0f))
+		{
+			XMFLOAT3 onEdges[3] = { ClosestPointOnSegment(p, a, b), ClosestPointOnSegment(p, b, c), ClosestPointOnSegment(p, c, a) };
+			int best = 0;
+			for (int e = 1; e < 3; e++)
+			{
+				if (LengthSquared(Sub(p, onEdges[e])) < LengthSquared(Sub(p, onEdges[best])))
+					best = e;
+			}
+			out = onEdges[best];
+			return (BvhFeature)(BVH_FEATURE_EDGE_AB + best);
+		}
+
+		float v = vb / sum;
+		float w = vc / sum;
+		out = MulAdd(MulAdd(a, ab, v), ac, w);
+		return BVH_FEATURE_FACE;
+	}
+
+	struct BuildTask
+	{
+		uint32_t node;
+		uint32_t depth;
+	};
+
+	// What the build threads share; every node owns its own range
+	// of triangleIds, so threads never touch the same triangles
+	struct BuildState
+	{
+		const Bounds* triangleBounds;
+		const XMFLOAT3* centroids;
+		uint32_t* triangleIds;
+		BvhNode* nodes;
+		std::atomic<uint32_t> nodeCount;
+	};
+
+	// Fills in a node's bounds and splits it when that pays off,
+	// returning its first child (0 when it stays a leaf)
+	uint32_t SplitNode(BuildState& state, const BuildTask& task)
+	{
+		BvhNode& node = state.nodes[task.node];
+		uint32_t first = node.first;
+		uint32_t count = node.count;
+		const Bounds* triangleBounds = state.triangleBounds;
+		const XMFLOAT3* centroids = state.centroids;
+		uint32_t* triangleIds = state.triangleIds;
+
+		Bounds bounds, centroidBounds;
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			bounds.Grow(triangleBounds[triangleIds[i]]);
+			centroidBounds.Grow(centroids[triangleIds[i]]);
+		}
+		node.boundsMin = bounds.min;
+		node.boundsMax = bounds.max;
+		if (count <= 1)
+			return 0;
+
+		//best binned SAH split over all three axes
+		int bestAxis = -1;
+		unsigned int bestSplit = 0;
+		float bestCost = FLT_MAX;
+		for (int axis = 0; axis < 3 && task.depth < SahMaxDepth; axis++)
+		{
+			float lo = Component(centroidBounds.min, axis);
+			float extent = Component(centroidBounds.max, axis) - lo;
+			if (!(extent > 0.0f))
+				continue;
+
+			Bounds binBounds[SahBins];
+			uint32_t binCounts[SahBins] = {};
+			float scale = SahBins / extent;
+			for (uint32_t i = first; i < first + count; i++)
+			{
+				uint32_t t = triangleIds[i];
+				unsigned int bin = std::min(SahBins - 1, (unsigned int)((Component(centroids[t], axis) - lo) * scale));
+				binBounds[bin].Grow(triangleBounds[t]);
+				binCounts[bin]++;
+			}
+
+			//sweep from the right to get each plane's right side, then from the left
+			float rightAreas[SahBins];
+			uint32_t rightCounts[SahBins];
+			Bounds right;
+			uint32_t rightCount = 0;
+			for (unsigned int b = SahBins - 1; b > 0; b--)
+			{
+				right.Grow(binBounds[b]);
+				rightCount += binCounts[b];
+				rightAreas[b] = right.Area();
+				rightCounts[b] = rightCount;
+			}
+
+			Bounds left;
+			uint32_t leftCount = 0;
+			for (unsigned int split = 1; split < SahBins; split++)
+			{
+				left.Grow(binBounds[split - 1]);
+				leftCount += binCounts[split - 1];
+				if (leftCount == 0 || rightCounts[split] == 0)
+					continue;
+
+				float cost = leftCount * left.Area() + rightCounts[split] * rightAreas[split];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = split;
+				}
+			}
+		}
+
+		uint32_t leftCount;
+		if (bestAxis >= 0)
+		{
+			//SAH says keep it as a leaf if splitting costs more than testing everything
+			float area = bounds.Area();
+			if (count <= MeshBvh::MaxLeafTriangles && TraversalCost * area + bestCost >= count * area)
+				return 0;
+
+			float lo = Component(centroidBounds.min, bestAxis);
+			float scale = SahBins / (Component(centroidBounds.max, bestAxis) - lo);
+			uint32_t* middle = std::partition(triangleIds + first, triangleIds + first + count,
+				[&](uint32_t t) { return std::min(SahBins - 1, (unsigned int)((Component(centroids[t], bestAxis) - lo) * scale)) < bestSplit; });
+			leftCount = (uint32_t)(middle - (triangleIds + first));
+		}
+		else if (count <= MeshBvh::MaxLeafTriangles)
+		{
+			return 0;
+		}
+		else
+		{
+			//too deep, or every centroid in one spot: halve along the longest axis
+			XMFLOAT3 extent = Sub(centroidBounds.max, centroidBounds.min);
+			int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+			leftCount = count / 2;
+			std::nth_element(triangleIds + first, triangleIds + first + leftCount, triangleIds + first + count,
+				[&](uint32_t a, uint32_t b) { return Component(centroids[a], axis) < Component(centroids[b], axis); });
+		}
+
+		uint32_t leftNode = state.nodeCount.fetch_add(2);
+		state.nodes[leftNode] = { XMFLOAT3(), first, XMFLOAT3(), leftCount };
+		state.nodes[leftNode + 1] = { XMFLOAT3(), first + leftCount, XMFLOAT3(), count - leftCount };
+		node.first = leftNode;
+		node.count = 0;
+		return leftNode;
+	}
+
+	// Direction components of exactly 0 would make the slab tests
+	// multiply 0 by infinity for rays starting on a box's face
+	inline float SafeReciprocal(float d)
+	{
+		return 1.0f / (fabsf(d) > 1e-30f ? d : copysignf(1e-30f, d));
+	}
+
+	// Distance along the ray to where it enters a node's box, FLT_MAX
+	// if it misses the box or only gets there after maxDistance
+	inline float RayBoxEntry(const BvhNode& node, const XMFLOAT3& origin, const XMFLOAT3& inverseDirection, float maxDistance)
+	{
+		float x1 = (node.boundsMin.x - origin.x) * inverseDirection.x;
+		float x2 = (node.boundsMax.x - origin.x) * inverseDirection.x;
+		float y1 = (node.boundsMin.y - origin.y) * inverseDirection.y;
+		float y2 = (node.boundsMax.y - origin.y) * inverseDirection.y;
+		float z1 = (node.boundsMin.z - origin.z) * inverseDirection.z;
+		float z2 = (node.boundsMax.z - origin.z) * inverseDirection.z;
+		float entry = std::max(std::max(std::min(x1, x2), std::min(y1, y2)), std::max(std::min(z1, z2), 0.0f));
+		float exitDistance = std::min(std::min(std::max(x1, x2), std::max(y1, y2)), std::min(std::max(z1, z2), maxDistance));
+		return entry <= exitDistance ? entry : FLT_MAX;
+	}
+
+	inline XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	// Moller-Trumbore, either side of the triangle counts
+	inline bool RayTriangle(const XMFLOAT3& origin, const XMFLOAT3& direction, const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c,
+		float maxDistance, float& distance, float& u, float& v)
+	{
+		XMFLOAT3 e1 = Sub(b, a);
+		XMFLOAT3 e2 = Sub(c, a);
+		XMFLOAT3 p = Cross(direction, e2);
+		float det = Dot(e1, p);
+		if (det == 0.0f)
+			return false;
+
+		float inverseDet = 1.0f / det;
+		XMFLOAT3 s = Sub(origin, a);
+		u = Dot(s, p) * inverseDet;
+		if (u < 0.0f || u > 1.0f)
+			return false;
+
+		XMFLOAT3 q = Cross(s, e1);
+		v = Dot(direction, q) * inverseDet;
+		if (v < 0.0f || u + v > 1.0f)
+			return false;
+
+		distance = Dot(e2, q) * inverseDet;
+		return distance >= 0.0f && distance < maxDistance;
+	}
+
+#ifdef MESH_BVH_SSE
+	// Four rays across SSE lanes
+	struct RayPacket
+	{
+		__m128 originX, originY, originZ;
+		__m128 directionX, directionY, directionZ;
+		__m128 inverseX, inverseY, inverseZ;
+	};
+
+	// Lanes whose ray enters the box before their closest hit so far
+	inline int PacketBoxMask(const BvhNode& node, const RayPacket& rays, __m128 maxDistance)
+	{
+		__m128 x1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin.x), rays.originX), rays.inverseX);
+		__m128 x2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax.x), rays.originX), rays.inverseX);
+		__m128 y1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin.y), rays.originY), rays.inverseY);
+		__m128 y2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax.y), rays.originY), rays.inverseY);
+		__m128 z1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin.z), rays.originZ), rays.inverseZ);
+		__m128 z2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax.z), rays.originZ), rays.inverseZ);
+		__m128 entry = _mm_max_ps(_mm_max_ps(_mm_min_ps(x1, x2), _mm_min_ps(y1, y2)), _mm_max_ps(_mm_min_ps(z1, z2), _mm_setzero_ps()));
+		__m128 exitDistance = _mm_min_ps(_mm_min_ps(_mm_max_ps(x1, x2), _mm_max_ps(y1, y2)), _mm_min_ps(_mm_max_ps(z1, z2), maxDistance));
+		return _mm_movemask_ps(_mm_cmple_ps(entry, exitDistance));
+	}
+#endif
+}
+
+
+MeshBvh::MeshBvh() :
+	buildMilliseconds(0.0)
+{
+}
+
+
+// --------------------------------------------------------
+// Builds the tree over every triangle of the index buffer
+//
+// - Each split tries SahBins planes per axis and keeps the
+//   cheapest by surface area heuristic, or makes a leaf when
+//   splitting wouldn't pay off
+// - Nodes get allocated in whatever order threads finish
+//   them, then copied out depth first (left subtree right
+//   after its parent's children), which is also the order
+//   queries tend to walk them in
+// --------------------------------------------------------
+MeshBvh::MeshBvh(const XMFLOAT3* positions, size_t numPositions, const unsigned int* indices, size_t numIndices, unsigned int threadCount) :
+	buildMilliseconds(0.0)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	uint32_t triangleCount = (uint32_t)(numIndices / 3);
+	if (triangleCount == 0 || numPositions == 0)
+		return;
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	if (triangleCount < MinTaskTriangles)
+		threadCount = 1; //not worth starting threads for
+
+	std::vector<Bounds> triangleBounds(triangleCount);
+	std::vector<XMFLOAT3> centroids(triangleCount);
+	triangleIds.resize(triangleCount);
+	std::atomic<uint32_t> nextChunk(0);
+	RunOnThreads(threadCount, [&]()
+		{
+			for (uint32_t chunk = nextChunk++; chunk * PrepareChunkSize < triangleCount; chunk = nextChunk++)
+			{
+				uint32_t last = std::min(triangleCount, (chunk + 1) * PrepareChunkSize);
+				for (uint32_t t = chunk * PrepareChunkSize; t < last; t++)
+				{
+					const XMFLOAT3& a = positions[indices[t * 3]];
+					const XMFLOAT3& b = positions[indices[t * 3 + 1]];
+					const XMFLOAT3& c = positions[indices[t * 3 + 2]];
+					triangleBounds[t].Grow(a);
+					triangleBounds[t].Grow(b);
+					triangleBounds[t].Grow(c);
+					centroids[t] = XMFLOAT3((a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f, (a.z + b.z + c.z) / 3.0f);
+					triangleIds[t] = t;
+				}
+			}
+		});
+
+	//a binary tree with at least one triangle per leaf never needs more nodes than this
+	std::vector<BvhNode> buildNodes(triangleCount * 2);
+	buildNodes[0] = { XMFLOAT3(), 0, XMFLOAT3(), triangleCount };
+	BuildState state;
+	state.triangleBounds = triangleBounds.data();
+	state.centroids = centroids.data();
+	state.triangleIds = triangleIds.data();
+	state.nodes = buildNodes.data();
+	state.nodeCount = 1;
+
+	//shared tasks, and how many are either queued or being worked on
+	std::mutex taskMutex;
+	std::condition_variable taskAdded;
+	std::vector<BuildTask> tasks = { { 0, 0 } };
+	unsigned int unfinished = 1;
+	RunOnThreads(threadCount, [&]()
+		{
+			std::vector<BuildTask> subtree;
+			while (true)
+			{
+				BuildTask task;
+				{
+					std::unique_lock<std::mutex> lock(taskMutex);
+					taskAdded.wait(lock, [&]() { return !tasks.empty() || unfinished == 0; });
+					if (tasks.empty())
+						return;
+					task = tasks.back();
+					tasks.pop_back();
+				}
+
+				if (buildNodes[task.node].count >= MinTaskTriangles)
+				{
+					uint32_t left = SplitNode(state, task);
+					std::lock_guard<std::mutex> lock(taskMutex);
+					if (left != 0)
+					{
+						tasks.push_back({ left + 1, task.depth + 1 });
+						tasks.push_back({ left, task.depth + 1 });
+						unfinished += 2;
+					}
+					unfinished--;
+					taskAdded.notify_all();
+					continue;
+				}
+
+				//small enough to finish here
+				subtree.assign(1, task);
+				while (!subtree.empty())
+				{
+					BuildTask next = subtree.back();
+					subtree.pop_back();
+					uint32_t left = SplitNode(state, next);
+					if (left != 0)
+					{
+						subtree.push_back({ left + 1, next.depth + 1 });
+						subtree.push_back({ left, next.depth + 1 });
+					}
+				}
+
+				std::lock_guard<std::mutex> lock(taskMutex);
+				if (--unfinished == 0)
+					taskAdded.notify_all();
+			}
+		});
+
+	//depth first copy, children of a node stay next to each other
+	struct CopyTask
+	{
+		uint32_t to;
+		uint32_t from;
+	};
+	nodes.reserve(state.nodeCount);
+	nodes.push_back(buildNodes[0]);
+	std::vector<CopyTask> copies = { { 0, 0 } };
+	while (!copies.empty())
+	{
+		CopyTask copy = copies.back();
+		copies.pop_back();
+		if (nodes[copy.to].count > 0)
+			continue;
+
+		uint32_t from = buildNodes[copy.from].first;
+		uint32_t to = (uint32_t)nodes.size();
+		nodes.push_back(buildNodes[from]);
+		nodes.push_back(buildNodes[from + 1]);
+		nodes[copy.to].first = to;
+		copies.push_back({ to + 1, from + 1 });
+		copies.push_back({ to, from });
+	}
+
+	triangles.resize(triangleCount);
+	for (uint32_t i = 0; i < triangleCount; i++)
+	{
+		uint32_t t = triangleIds[i];
+		triangles[i] = { positions[indices[t * 3]], positions[indices[t * 3 + 1]], positions[indices[t * 3 + 2]] };
+	}
+
+	buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+
+// --------------------------------------------------------
+// Nearest first traversal: the closer child is visited first
+// and anything farther than the best hit so far is skipped
+// --------------------------------------------------------
+bool MeshBvh::FindClosest(const XMFLOAT3& point, float maxDistance, BvhClosestHit& hit) const
+{
+	if (nodes.empty())
+		return false;
+
+	struct StackEntry
+	{
+		uint32_t node;
+		float distanceSquared;
+	};
+	StackEntry stack[MaxBvhDepth + 1];
+	int stackSize = 0;
+
+	float best = maxDistance * maxDistance;
+	bool found = false;
+	uint32_t node = 0;
+	if (BoxDistanceSquared(nodes[0], point) > best)
+		return false;
+
+	while (true)
+	{
+		const BvhNode& current = nodes[node];
+		if (current.count > 0)
+		{
+			for (uint32_t i = current.first; i < current.first + current.count; i++)
+			{
+				const Triangle& t = triangles[i];
+				XMFLOAT3 closest;
+				BvhFeature feature = ClosestPointOnTriangle(point, t.a, t.b, t.c, closest);
+				float distanceSquared = LengthSquared(Sub(point, closest));
+				if (distanceSquared <= best)
+				{
+					best = distanceSquared;
+					found = true;
+					hit.point = closest;
+					hit.distanceSquared = distanceSquared;
+					hit.triangle = triangleIds[i];
+					hit.feature = feature;
+				}
+			}
+		}
+		else
+		{
+			uint32_t nearChild = current.first;
+			uint32_t farChild = current.first + 1;
+			float nearDistance = BoxDistanceSquared(nodes[nearChild], point);
+			float farDistance = BoxDistanceSquared(nodes[farChild], point);
+			if (farDistance < nearDistance)
+			{
+				std::swap(nearChild, farChild);
+				std::swap(nearDistance, farDistance);
+			}
+
+			if (farDistance <= best)
+				stack[stackSize++] = { farChild, farDistance };
+			if (nearDistance <= best)
+			{
+				node = nearChild;
+				continue;
+			}
+		}
+
+		//next node that could still hold something closer
+		while (stackSize > 0 && stack[stackSize - 1].distanceSquared > best)
+			stackSize--;
+		if (stackSize == 0)
+			break;
+		node = stack[--stackSize].node;
+	}
+	return found;
+}
+
+
+// --------------------------------------------------------
+// Front to back: both children are tested before going down,
+// the one the ray enters first is visited first and the other
+// waits on the stack until it's known whether a hit already
+// closer than it was found
+// --------------------------------------------------------
+bool MeshBvh::Intersect(const BvhRay& ray, BvhRayHit& hit) const
+{
+	if (nodes.empty())
+		return false;
+
+	XMFLOAT3 inverseDirection(SafeReciprocal(ray.direction.x), SafeReciprocal(ray.direction.y), SafeReciprocal(ray.direction.z));
+	float best = ray.maxDistance;
+	if (RayBoxEntry(nodes[0], ray.origin, inverseDirection, best) == FLT_MAX)
+		return false;
+
+	struct StackEntry
+	{
+		uint32_t node;
+		float entry;
+	};
+	StackEntry stack[MaxBvhDepth + 1];
+	int stackSize = 0;
+
+	bool found = false;
+	uint32_t node = 0;
+	while (true)
+	{
+		const BvhNode& current = nodes[node];
+		if (current.count > 0)
+		{
+			for (uint32_t i = current.first; i < current.first + current.count; i++)
+			{
+				const Triangle& t = triangles[i];
+				float distance, u, v;
+				if (RayTriangle(ray.origin, ray.direction, t.a, t.b, t.c, best, distance, u, v))
+				{
+					best = distance;
+					found = true;
+					hit = { distance, triangleIds[i], u, v };
+				}
+			}
+		}
+		else
+		{
+			uint32_t nearChild = current.first;
+			uint32_t farChild = current.first + 1;
+			float nearEntry = RayBoxEntry(nodes[nearChild], ray.origin, inverseDirection, best);
+			float farEntry = RayBoxEntry(nodes[farChild], ray.origin, inverseDirection, best);
+			if (farEntry < nearEntry)
+			{
+				std::swap(nearChild, farChild);
+				std::swap(nearEntry, farEntry);
+			}
+
+			if (farEntry != FLT_MAX)
+				stack[stackSize++] = { farChild, farEntry };
+			if (nearEntry != FLT_MAX)
+			{
+				node = nearChild;
+				continue;
+			}
+		}
+
+		//next node the ray could still hit something closer in
+		while (stackSize > 0 && stack[stackSize - 1].entry >= best)
+			stackSize--;
+		if (stackSize == 0)
+			break;
+		node = stack[--stackSize].node;
+	}
+	return found;
+}
+
+
+// --------------------------------------------------------
+// The packet goes down a node if any of its rays enter it,
+// children are ordered by the first ray's direction, and a
+// triangle is tested against all four rays at once
+// --------------------------------------------------------
+unsigned int MeshBvh::IntersectPacket(const BvhRay rays[4], BvhRayHit hits[4]) const
+{
+#ifdef MESH_BVH_SSE
+	if (nodes.empty())
+		return 0;
+
+	RayPacket packet;
+	packet.originX = _mm_setr_ps(rays[0].origin.x, rays[1].origin.x, rays[2].origin.x, rays[3].origin.x);
+	packet.originY = _mm_setr_ps(rays[0].origin.y, rays[1].origin.y, rays[2].origin.y, rays[3].origin.y);
+	packet.originZ = _mm_setr_ps(rays[0].origin.z, rays[1].origin.z, rays[2].origin.z, rays[3].origin.z);
+	packet.directionX = _mm_setr_ps(rays[0].direction.x, rays[1].direction.x, rays[2].direction.x, rays[3].direction.x);
+	packet.directionY = _mm_setr_ps(rays[0].direction.y, rays[1].direction.y, rays[2].direction.y, rays[3].direction.y);
+	packet.directionZ = _mm_setr_ps(rays[0].direction.z, rays[1].direction.z, rays[2].direction.z, rays[3].direction.z);
+	packet.inverseX = _mm_setr_ps(SafeReciprocal(rays[0].direction.x), SafeReciprocal(rays[1].direction.x), SafeReciprocal(rays[2].direction.x), SafeReciprocal(rays[3].direction.x));
+	packet.inverseY = _mm_setr_ps(SafeReciprocal(rays[0].direction.y), SafeReciprocal(rays[1].direction.y), SafeReciprocal(rays[2].direction.y), SafeReciprocal(rays[3].direction.y));
+	packet.inverseZ = _mm_setr_ps(SafeReciprocal(rays[0].direction.z), SafeReciprocal(rays[1].direction.z), SafeReciprocal(rays[2].direction.z), SafeReciprocal(rays[3].direction.z));
+
+	__m128 best = _mm_setr_ps(rays[0].maxDistance, rays[1].maxDistance, rays[2].maxDistance, rays[3].maxDistance);
+	__m128 bestU = _mm_setzero_ps();
+	__m128 bestV = _mm_setzero_ps();
+	__m128i bestTriangle = _mm_setzero_si128();
+	int found = 0;
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const XMFLOAT3& leadDirection = rays[0].direction;
+
+	uint32_t stack[MaxBvhDepth + 1];
+	int stackSize = 0;
+	uint32_t node = 0;
+	while (true)
+	{
+		const BvhNode& current = nodes[node];
+		if (PacketBoxMask(current, packet, best) != 0)
+		{
+			if (current.count > 0)
+			{
+				for (uint32_t i = current.first; i < current.first + current.count; i++)
+				{
+					//Moller-Trumbore for all four rays, same steps as RayTriangle
+					const Triangle& t = triangles[i];
+					XMFLOAT3 e1 = Sub(t.b, t.a);
+					XMFLOAT3 e2 = Sub(t.c, t.a);
+					__m128 e1x = _mm_set1_ps(e1.x), e1y = _mm_set1_ps(e1.y), e1z = _mm_set1_ps(e1.z);
+					__m128 e2x = _mm_set1_ps(e2.x), e2y = _mm_set1_ps(e2.y), e2z = _mm_set1_ps(e2.z);
+
+					__m128 px = _mm_sub_ps(_mm_mul_ps(packet.directionY, e2z), _mm_mul_ps(packet.directionZ, e2y));
+					__m128 py = _mm_sub_ps(_mm_mul_ps(packet.directionZ, e2x), _mm_mul_ps(packet.directionX, e2z));
+					__m128 pz = _mm_sub_ps(_mm_mul_ps(packet.directionX, e2y), _mm_mul_ps(packet.directionY, e2x));
+					__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+					__m128 inverseDet = _mm_div_ps(one, det);
+
+					__m128 sx = _mm_sub_ps(packet.originX, _mm_set1_ps(t.a.x));
+					__m128 sy = _mm_sub_ps(packet.originY, _mm_set1_ps(t.a.y));
+					__m128 sz = _mm_sub_ps(packet.originZ, _mm_set1_ps(t.a.z));
+					__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverseDet);
+
+					__m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+					__m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+					__m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+					__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(packet.directionX, qx), _mm_mul_ps(packet.directionY, qy)), _mm_mul_ps(packet.directionZ, qz)), inverseDet);
+					__m128 distance = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDet);
+
+					__m128 hit = _mm_and_ps(_mm_cmpneq_ps(det, zero), _mm_cmpge_ps(u, zero));
+					hit = _mm_and_ps(hit, _mm_cmple_ps(u, one));
+					hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+					hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), one));
+					hit = _mm_and_ps(hit, _mm_cmpge_ps(distance, zero));
+					hit = _mm_and_ps(hit, _mm_cmplt_ps(distance, best));
+					int hitMask = _mm_movemask_ps(hit);
+					if (hitMask == 0)
+						continue;
+
+					found |= hitMask;
+					best = _mm_or_ps(_mm_and_ps(hit, distance), _mm_andnot_ps(hit, best));
+					bestU = _mm_or_ps(_mm_and_ps(hit, u), _mm_andnot_ps(hit, bestU));
+					bestV = _mm_or_ps(_mm_and_ps(hit, v), _mm_andnot_ps(hit, bestV));
+					__m128i hitBits = _mm_castps_si128(hit);
+					bestTriangle = _mm_or_si128(_mm_and_si128(hitBits, _mm_set1_epi32((int)triangleIds[i])), _mm_andnot_si128(hitBits, bestTriangle));
+				}
+			}
+			else
+			{
+				//whichever child is further along the lead ray goes on the stack
+				const BvhNode& left = nodes[current.first];
+				const BvhNode& right = nodes[current.first + 1];
+				float along =
+					(right.boundsMin.x + right.boundsMax.x - left.boundsMin.x - left.boundsMax.x) * leadDirection.x +
+					(right.boundsMin.y + right.boundsMax.y - left.boundsMin.y - left.boundsMax.y) * leadDirection.y +
+					(right.boundsMin.z + right.boundsMax.z - left.boundsMin.z - left.boundsMax.z) * leadDirection.z;
+				bool rightFirst = along < 0.0f;
+				stack[stackSize++] = rightFirst ? current.first : current.first + 1;
+				node = rightFirst ? current.first + 1 : current.first;
+				continue;
+			}
+		}
+
+		if (stackSize == 0)
+			break;
+		node = stack[--stackSize];
+	}
+
+	alignas(16) float distances[4], us[4], vs[4];
+	alignas(16) uint32_t triangleHits[4];
+	_mm_store_ps(distances, best);
+	_mm_store_ps(us, bestU);
+	_mm_store_ps(vs, bestV);
+	_mm_store_si128((__m128i*)triangleHits, bestTriangle);
+	for (int lane = 0; lane < 4; lane++)
+	{
+		if (found & (1 << lane))
+			hits[lane] = { distances[lane], triangleHits[lane], us[lane], vs[lane] };
+	}
+	return (unsigned int)found;
+#else
+	unsigned int found = 0;
+	for (int lane = 0; lane < 4; lane++)
+	{
+		if (Intersect(rays[lane], hits[lane]))
+			found |= 1u << lane;
+	}
+	return found;
+#endif
+}
+
+
+size_t MeshBvh::GetMemoryBytes() const
+{
+	return nodes.size() * sizeof(BvhNode) + triangles.size() * sizeof(Triangle) + triangleIds.size() * sizeof(uint32_t);
+}
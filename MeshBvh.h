@@ -0,0 +1,105 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// A node of a MeshBvh, 32 bytes so two share a cache line
+// - Interior nodes have count 0 and their children at
+//   first and first + 1
+struct BvhNode
+{
+	DirectX::XMFLOAT3 boundsMin;
+	uint32_t first;		// First triangle for leaves, left child for interior nodes
+	DirectX::XMFLOAT3 boundsMax;
+	uint32_t count;		// Triangles in a leaf, 0 for interior nodes
+};
+static_assert(sizeof(BvhNode) == 32, "BvhNode should stay 32 bytes");
+
+// Which part of a triangle a closest point landed on
+enum BvhFeature
+{
+	BVH_FEATURE_FACE,
+	BVH_FEATURE_EDGE_AB,
+	BVH_FEATURE_EDGE_BC,
+	BVH_FEATURE_EDGE_CA,
+	BVH_FEATURE_VERTEX_A,
+	BVH_FEATURE_VERTEX_B,
+	BVH_FEATURE_VERTEX_C
+};
+
+struct BvhClosestHit
+{
+	DirectX::XMFLOAT3 point;
+	float distanceSquared;
+	uint32_t triangle;	// In the original index buffer order
+	BvhFeature feature;
+};
+
+// A ray for MeshBvh::Intersect, the direction doesn't have to be unit length
+struct BvhRay
+{
+	DirectX::XMFLOAT3 origin;
+	DirectX::XMFLOAT3 direction;
+	float maxDistance;	// In multiples of direction, like the hit distance
+};
+
+struct BvhRayHit
+{
+	float distance;		// origin + direction * distance is the hit
+	uint32_t triangle;	// In the original index buffer order
+	float u, v;			// Barycentric weights of the triangle's second and third corners
+};
+
+// --------------------------------------------------------
+// Bounding volume hierarchy over a triangle mesh
+//
+// - Built top down with binned SAH splits on the triangle
+//   centroids, leaves hold up to MaxLeafTriangles
+// - Triangles are copied into leaf order so a leaf's
+//   triangles sit next to each other in memory
+// - Big nodes are split as tasks any build thread can take,
+//   small ones are built whole by one thread; nodes are put
+//   in depth first order afterwards, so the tree comes out
+//   the same whatever the thread count
+// - Ray queries hit both sides of triangles
+// - Nothing here touches Direct3D, so it works for offline
+//   bakers (see MeshSdf) as well as for Mesh
+// --------------------------------------------------------
+class MeshBvh
+{
+public:
+	static const uint32_t MaxLeafTriangles = 4;
+
+	MeshBvh();
+	MeshBvh(const DirectX::XMFLOAT3* positions, size_t numPositions, const unsigned int* indices, size_t numIndices, unsigned int threadCount = 0); //0 picks one thread per hardware core
+
+	// Closest point on the mesh to point, ignoring anything farther
+	// than maxDistance; false if nothing is that close
+	bool FindClosest(const DirectX::XMFLOAT3& point, float maxDistance, BvhClosestHit& hit) const;
+
+	// Closest hit along the ray, false if there's none before maxDistance
+	bool Intersect(const BvhRay& ray, BvhRayHit& hit) const;
+
+	// Four rays at once, SSE across the rays, so every node and triangle
+	// is tested against all four together (pays off for rays that travel
+	// together, like neighbouring pixels); bit i of the result is set if
+	// rays[i] hit, with the hit in hits[i]
+	unsigned int IntersectPacket(const BvhRay rays[4], BvhRayHit hits[4]) const;
+
+	const std::vector<BvhNode>& GetNodes() const { return nodes; }
+	size_t GetTriangleCount() const { return triangleIds.size(); }
+	size_t GetMemoryBytes() const;
+	double GetBuildMilliseconds() const { return buildMilliseconds; }
+
+private:
+	// Corners of one triangle, in leaf order
+	struct Triangle
+	{
+		DirectX::XMFLOAT3 a, b, c;
+	};
+
+	std::vector<BvhNode> nodes;
+	std::vector<Triangle> triangles;
+	std::vector<uint32_t> triangleIds;
+	double buildMilliseconds;
+};
@@ -0,0 +1,363 @@
+#include "MeshCache.h"
+#include "MeshCodec.h"
+#include "MeshTools.h"
+#include "ObjLoader.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+	const uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+	const uint64_t Prime3 = 0x165667B19E3779F9ULL;
+
+	inline uint64_t RotateLeft(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+	inline uint64_t ReadWord(const unsigned char* p)
+	{
+		uint64_t w;
+		memcpy(&w, p, sizeof(w));
+		return w;
+	}
+
+	inline uint64_t Round(uint64_t acc, uint64_t word)
+	{
+		acc += word * Prime2;
+		acc = RotateLeft(acc, 31);
+		return acc * Prime1;
+	}
+
+	// start + count fits in limit, without 32-bit overflow
+	inline bool RangeFits(uint64_t start, uint64_t count, uint64_t limit) { return start + count <= limit; }
+
+	// Stable sorts the triangles by material and returns a subset (with
+	// just its LOD0 range set) for every material that has any
+	std::vector<MeshSubset> GroupByMaterial(const ObjData& obj, std::vector<unsigned int>& indices, std::vector<std::string>& names)
+	{
+		std::vector<unsigned int> offsets(obj.materials.size() + 1, 0);
+		for (unsigned int m : obj.triangleMaterials)
+			offsets[m + 1]++;
+		for (size_t m = 1; m < offsets.size(); m++)
+			offsets[m] += offsets[m - 1];
+
+		std::vector<MeshSubset> subsets;
+		names.clear();
+		for (size_t m = 0; m < obj.materials.size(); m++)
+		{
+			if (offsets[m + 1] == offsets[m])
+				continue;
+			MeshSubset subset = {};
+			subset.lods[0] = { offsets[m] * 3, (offsets[m + 1] - offsets[m]) * 3, 0.0f };
+			subsets.push_back(subset);
+			names.push_back(obj.materials[m]);
+		}
+
+		std::vector<unsigned int> grouped(indices.size());
+		for (size_t t = 0; t < obj.triangleMaterials.size(); t++)
+		{
+			unsigned int dest = offsets[obj.triangleMaterials[t]]++ * 3;
+			std::copy(indices.begin() + t * 3, indices.begin() + t * 3 + 3, grouped.begin() + dest);
+		}
+		indices.swap(grouped);
+		return subsets;
+	}
+}
+
+MeshCacheFile::MeshCacheFile(const std::wstring& path) :
+	file(path),
+	valid(false),
+	header(nullptr),
+	vertices(nullptr),
+	indices(nullptr),
+	meshlets(nullptr),
+	lods(nullptr),
+	subsets(nullptr)
+{
+	if (!file.IsOpen() || file.GetSize() < sizeof(MeshCacheHeader))
+		return;
+
+	header = (const MeshCacheHeader*)file.GetData();
+	if (header->magic != MeshCacheMagic ||
+		header->version != MeshCacheVersion ||
+		header->layout != MESH_CACHE_LAYOUT_FULL ||
+		header->vertexStride != sizeof(Vertex) ||
+		header->indexCount % 3 != 0 ||
+		header->lodCount == 0 ||
+		header->lodCount > MeshMaxLods)
+		return;
+
+	//raw data has to be exactly the size the counts say
+	bool compressed = header->encoding == MESH_CACHE_ENCODING_COMPRESSED;
+	if (!compressed && (header->encoding != MESH_CACHE_ENCODING_RAW ||
+		header->vertexBytes != (uint64_t)header->vertexCount * header->vertexStride ||
+		header->indexBytes != (uint64_t)header->indexCount * sizeof(unsigned int)))
+		return;
+
+	//the file must be exactly header + payload, which also catches partial writes
+	uint64_t expectedSize = sizeof(MeshCacheHeader) +
+		(uint64_t)header->meshletCount * sizeof(Meshlet) +
+		(uint64_t)header->lodCount * sizeof(MeshLod) +
+		(uint64_t)header->subsetCount * sizeof(MeshSubset) +
+		header->vertexBytes +
+		header->indexBytes +
+		header->stringBytes;
+	if (file.GetSize() != expectedSize)
+		return;
+
+	meshlets = (const Meshlet*)(file.GetData() + sizeof(MeshCacheHeader));
+	lods = (const MeshLod*)(meshlets + header->meshletCount);
+	subsets = (const MeshSubset*)(lods + header->lodCount);
+	const unsigned char* vertexData = (const unsigned char*)(subsets + header->subsetCount);
+	const unsigned char* indexData = vertexData + header->vertexBytes;
+	if (compressed)
+	{
+		decodedVertices.resize(header->vertexCount);
+		decodedIndices.resize(header->indexCount);
+		if (!MeshCodec::DecodeVertices(decodedVertices.data(), header->vertexCount, sizeof(Vertex), vertexData, header->vertexBytes) ||
+			!MeshCodec::DecodeIndices(decodedIndices.data(), header->indexCount, header->vertexCount, indexData, header->indexBytes))
+			return;
+		vertices = decodedVertices.data();
+		indices = decodedIndices.data();
+	}
+	else
+	{
+		//the decoder already rejects indices past the vertices, raw ones need a look
+		vertices = (const Vertex*)vertexData;
+		indices = (const unsigned int*)indexData;
+		unsigned int largestIndex = 0;
+		for (uint32_t i = 0; i < header->indexCount; i++)
+			largestIndex = std::max(largestIndex, indices[i]);
+		if (header->indexCount > 0 && largestIndex >= header->vertexCount)
+			return;
+	}
+
+	//Mesh builds bounds, BVHs and depth streams from these on the CPU,
+	//so a stale or corrupt file mustn't point anywhere outside the data
+	for (uint32_t i = 0; i < header->lodCount; i++)
+		if (!RangeFits(lods[i].startIndex, lods[i].indexCount, header->indexCount))
+			return;
+	for (uint32_t i = 0; i < header->meshletCount; i++)
+		if (!RangeFits(meshlets[i].startIndex, (uint64_t)meshlets[i].triangleCount * 3, header->indexCount))
+			return;
+	for (uint32_t i = 0; i < header->subsetCount; i++)
+	{
+		if (!RangeFits(subsets[i].firstMeshlet, subsets[i].meshletCount, header->meshletCount))
+			return;
+		for (uint32_t lod = 0; lod < header->lodCount; lod++)
+			if (!RangeFits(subsets[i].lods[lod].startIndex, subsets[i].lods[lod].indexCount, header->indexCount))
+				return;
+	}
+
+	//split the names, there has to be exactly one per subset and library
+	const char* strings = (const char*)(indexData + header->indexBytes);
+	const char* stringsEnd = strings + header->stringBytes;
+	std::vector<std::string> names;
+	for (const char* s = strings; s < stringsEnd; s += names.back().size() + 1)
+	{
+		const char* terminator = std::find(s, stringsEnd, '\0');
+		if (terminator == stringsEnd)
+			return;
+		names.emplace_back(s, terminator);
+	}
+	if (names.size() != (size_t)header->subsetCount + header->materialLibraryCount)
+		return;
+	subsetMaterials.assign(names.begin(), names.begin() + header->subsetCount);
+	materialLibraries.assign(names.begin() + header->subsetCount, names.end());
+	valid = true;
+}
+
+
+// --------------------------------------------------------
+// 64-bit hash over four independent lanes so it runs at
+// memory speed on large source files
+// --------------------------------------------------------
+uint64_t MeshCache::HashBytes(const void* data, size_t size)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	const unsigned char* end = p + size;
+
+	uint64_t lanes[4] = { Prime1 + Prime2, Prime2, 0, 0 - Prime1 };
+	while (end - p >= 32)
+	{
+		lanes[0] = Round(lanes[0], ReadWord(p));
+		lanes[1] = Round(lanes[1], ReadWord(p + 8));
+		lanes[2] = Round(lanes[2], ReadWord(p + 16));
+		lanes[3] = Round(lanes[3], ReadWord(p + 24));
+		p += 32;
+	}
+
+	uint64_t h = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+	h += (uint64_t)size;
+
+	//remaining whole words, then bytes
+	while (end - p >= 8)
+	{
+		h ^= Round(0, ReadWord(p));
+		h = RotateLeft(h, 27) * Prime1 + Prime3;
+		p += 8;
+	}
+	while (p < end)
+	{
+		h ^= (*p) * Prime3;
+		h = RotateLeft(h, 11) * Prime1;
+		p++;
+	}
+
+	//final avalanche
+	h ^= h >> 33;
+	h *= Prime2;
+	h ^= h >> 29;
+	h *= Prime3;
+	h ^= h >> 32;
+	return h;
+}
+
+
+// --------------------------------------------------------
+// Everything that happens to an OBJ between the text file
+// and the GPU buffers
+// --------------------------------------------------------
+MeshCookStats MeshCache::CookObj(const char* objData, size_t objSize, CookedMesh& mesh)
+{
+	mesh = {};
+	auto importStart = std::chrono::high_resolution_clock::now();
+	ObjData obj;
+	ObjLoader::ParseBuffer(objData, objSize, obj);
+	ObjLoader::BuildVertices(obj, mesh.vertices, mesh.indices);
+	double importMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - importStart).count();
+
+	//one contiguous range of triangles per material, so they're one draw each
+	if (!obj.triangleMaterials.empty())
+		mesh.subsets = GroupByMaterial(obj, mesh.indices, mesh.subsetMaterials);
+	mesh.materialLibraries = obj.materialLibraries;
+
+	MeshCookStats stats = Cook(mesh);
+	stats.sourceVertexCount = obj.corners.size();
+	stats.importMilliseconds = importMilliseconds;
+	return stats;
+}
+
+
+// --------------------------------------------------------
+// The format independent part of cooking, for vertices and
+// LOD0 indices that have already been imported
+// --------------------------------------------------------
+MeshCookStats MeshCache::Cook(CookedMesh& mesh, bool generateTangents)
+{
+	MeshCookStats stats = {};
+	std::vector<Vertex>& verts = mesh.vertices;
+	std::vector<unsigned int>& indices = mesh.indices;
+	std::vector<MeshSubset>& subsets = mesh.subsets;
+	stats.sourceVertexCount = verts.size();
+	stats.cacheBefore = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), verts.size());
+
+	//reorder for the post-transform cache, then group into meshlets (which also
+	//sorts them outward-facing first to cut overdraw)
+	//- both only move triangles around within a subset
+	MeshSubset whole = {};
+	whole.lods[0] = { 0, (unsigned int)indices.size(), 0.0f };
+	MeshSubset* ranges = subsets.empty() ? &whole : subsets.data();
+	for (size_t i = 0; i < std::max<size_t>(subsets.size(), 1); i++)
+	{
+		MeshSubset& subset = ranges[i];
+		unsigned int* range = indices.data() + subset.lods[0].startIndex;
+		MeshOptimizer::OptimizeVertexCache(range, subset.lods[0].indexCount, verts.size());
+		std::vector<Meshlet> meshlets = Meshlets::Build(verts.data(), verts.size(), range, subset.lods[0].indexCount);
+		for (Meshlet& meshlet : meshlets)
+			meshlet.startIndex += subset.lods[0].startIndex;
+
+		subset.firstMeshlet = (unsigned int)mesh.meshlets.size();
+		subset.meshletCount = (unsigned int)meshlets.size();
+		mesh.meshlets.insert(mesh.meshlets.end(), meshlets.begin(), meshlets.end());
+	}
+
+	//simplified LODs get appended to the index buffer, sharing the vertices
+	auto lodStart = std::chrono::high_resolution_clock::now();
+	mesh.lods = subsets.empty() ?
+		MeshSimplifier::BuildLodChain(verts.data(), verts.size(), indices) :
+		MeshSimplifier::BuildLodChain(verts.data(), verts.size(), indices, subsets.data(), subsets.size());
+	stats.lodMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - lodStart).count();
+
+	//reorder the vertices for fetch (first use is in LOD0), which leaves triangles alone
+	MeshOptimizer::OptimizeVertexFetch(verts, indices.data(), indices.size());
+	size_t numLod0Indices = mesh.lods[0].indexCount;
+	stats.cacheAfter = MeshOptimizer::AnalyzeVertexCache(indices.data(), numLod0Indices, verts.size());
+
+	//only LOD0, the others would count every triangle twice
+	if (generateTangents)
+		MeshTools::CalculateTangents(verts.data(), verts.size(), indices.data(), numLod0Indices);
+	return stats;
+}
+
+
+bool MeshCache::Save(const std::wstring& path, uint64_t sourceHash, size_t sourceVertexCount, const CookedMesh& mesh, bool compress)
+{
+	MeshCacheHeader header = {};
+	header.magic = MeshCacheMagic;
+	header.version = MeshCacheVersion;
+	header.layout = MESH_CACHE_LAYOUT_FULL;
+	header.vertexStride = sizeof(Vertex);
+	header.vertexCount = (uint32_t)mesh.vertices.size();
+	header.indexCount = (uint32_t)mesh.indices.size();
+	header.sourceVertexCount = (uint32_t)sourceVertexCount;
+	header.meshletCount = (uint32_t)mesh.meshlets.size();
+	header.lodCount = (uint32_t)mesh.lods.size();
+	header.subsetCount = (uint32_t)mesh.subsets.size();
+	header.materialLibraryCount = (uint32_t)mesh.materialLibraries.size();
+	header.sourceHash = sourceHash;
+	MeshTools::CalculateBounds(mesh.vertices.data(), mesh.vertices.size(), header.boundsMin, header.boundsMax);
+
+	std::string strings;
+	for (const std::vector<std::string>* names : { &mesh.subsetMaterials, &mesh.materialLibraries })
+	{
+		for (const std::string& name : *names)
+			strings.append(name.c_str(), name.size() + 1);
+	}
+	header.stringBytes = (uint32_t)strings.size();
+
+	//tiny meshes can come out bigger compressed, those stay raw
+	size_t rawBytes = sizeof(Vertex) * mesh.vertices.size() + sizeof(unsigned int) * mesh.indices.size();
+	std::vector<unsigned char> vertexData, indexData;
+	if (compress)
+	{
+		MeshCodec::EncodeVertices(mesh.vertices.data(), mesh.vertices.size(), sizeof(Vertex), vertexData);
+		MeshCodec::EncodeIndices(mesh.indices.data(), mesh.indices.size(), indexData);
+		compress = vertexData.size() + indexData.size() < rawBytes;
+	}
+	if (!compress)
+	{
+		vertexData.clear();
+		indexData.clear();
+		const unsigned char* vertexBytes = (const unsigned char*)mesh.vertices.data();
+		const unsigned char* indexBytes = (const unsigned char*)mesh.indices.data();
+		vertexData.assign(vertexBytes, vertexBytes + sizeof(Vertex) * mesh.vertices.size());
+		indexData.assign(indexBytes, indexBytes + sizeof(unsigned int) * mesh.indices.size());
+	}
+	header.encoding = compress ? MESH_CACHE_ENCODING_COMPRESSED : MESH_CACHE_ENCODING_RAW;
+	header.vertexBytes = (uint32_t)vertexData.size();
+	header.indexBytes = (uint32_t)indexData.size();
+
+	std::ofstream out(std::filesystem::path(path), std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)mesh.meshlets.data(), sizeof(Meshlet) * mesh.meshlets.size());
+	out.write((const char*)mesh.lods.data(), sizeof(MeshLod) * mesh.lods.size());
+	out.write((const char*)mesh.subsets.data(), sizeof(MeshSubset) * mesh.subsets.size());
+	out.write((const char*)vertexData.data(), vertexData.size());
+	out.write((const char*)indexData.data(), indexData.size());
+	out.write(strings.data(), strings.size());
+	return out.good();
+}
+
+
+std::wstring MeshCache::GetCachePath(const std::wstring& sourceFile)
+{
+	return sourceFile + L".meshcache";
+}
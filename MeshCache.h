@@ -0,0 +1,154 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "Vertex.h"
+
+// Bump this whenever the cooking pipeline or the file layout changes,
+// so stale caches are rebuilt instead of loaded
+const uint32_t MeshCacheVersion = 6;
+const uint32_t MeshCacheMagic = 0x4843534D; // "MSCH"
+
+// Vertex layouts a cache file can hold
+enum MeshCacheLayout : uint32_t
+{
+	MESH_CACHE_LAYOUT_FULL = 0	// Vertex: position, uv, normal, tangent (all floats)
+};
+
+// How the vertex and index data is stored
+enum MeshCacheEncoding : uint32_t
+{
+	MESH_CACHE_ENCODING_RAW = 0,	// As is, used straight from the mapping
+	MESH_CACHE_ENCODING_COMPRESSED = 1	// MeshCodec streams, decoded on load
+};
+
+// --------------------------------------------------------
+// Header at the start of every .meshcache file
+// - Followed directly by meshletCount Meshlets, lodCount
+//   MeshLods and subsetCount MeshSubsets
+// - Then vertexBytes of vertices and indexBytes of indices
+//   (every LOD): vertexCount Vertex structs and indexCount
+//   32-bit indices when raw, MeshCodec streams when compressed
+// - Then stringBytes of null-terminated names: one material
+//   per subset, then materialLibraryCount .mtl files
+// --------------------------------------------------------
+struct MeshCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t layout;
+	uint32_t vertexStride;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t sourceVertexCount;	// Vertex count before welding, for stats
+	uint32_t meshletCount;
+	DirectX::XMFLOAT3 boundsMin;
+	DirectX::XMFLOAT3 boundsMax;
+	uint64_t sourceHash;	// Hash of the source file this was cooked from
+	uint32_t lodCount;
+	uint32_t subsetCount;	// 0 if the source had no materials
+	uint32_t materialLibraryCount;
+	uint32_t stringBytes;
+	uint32_t encoding;
+	uint32_t vertexBytes;
+	uint32_t indexBytes;
+	uint32_t reserved;
+};
+static_assert(sizeof(MeshCacheHeader) == 96, "MeshCacheHeader layout changed, bump MeshCacheVersion");
+
+
+// --------------------------------------------------------
+// A memory mapped, validated .meshcache file
+//
+// - Raw vertex and index data point straight into the
+//   mapping, so they can be handed to buffer creation
+//   without a copy
+// - Compressed data is decoded once when the file is opened
+// --------------------------------------------------------
+class MeshCacheFile
+{
+public:
+	MeshCacheFile(const std::wstring& path);
+
+	// True if the file exists, is intact and matches this build's format
+	bool IsValid() const { return valid; }
+	const MeshCacheHeader& GetHeader() const { return *header; }
+	const Vertex* GetVertices() const { return vertices; }
+	const unsigned int* GetIndices() const { return indices; }
+	const Meshlet* GetMeshlets() const { return meshlets; }
+	const MeshLod* GetLods() const { return lods; }
+	const MeshSubset* GetSubsets() const { return subsets; }
+	const std::vector<std::string>& GetSubsetMaterials() const { return subsetMaterials; }
+	const std::vector<std::string>& GetMaterialLibraries() const { return materialLibraries; }
+
+private:
+	MappedFile file;
+	bool valid;
+	const MeshCacheHeader* header;
+	const Vertex* vertices;
+	const unsigned int* indices;
+	std::vector<Vertex> decodedVertices;
+	std::vector<unsigned int> decodedIndices;
+	const Meshlet* meshlets;
+	const MeshLod* lods;
+	const MeshSubset* subsets;
+	std::vector<std::string> subsetMaterials;
+	std::vector<std::string> materialLibraries;
+};
+
+
+// Render-ready mesh data, as produced by cooking
+// - indices holds LOD0 followed by the other LODs
+// - meshlets cover LOD0 only
+// - subsets are empty unless the source assigned materials,
+//   subsetMaterials has each one's material name
+struct CookedMesh
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshLod> lods;
+	std::vector<MeshSubset> subsets;
+	std::vector<std::string> subsetMaterials;
+	std::vector<std::string> materialLibraries;	// .mtl files, relative to the source
+};
+
+
+// What happened while cooking a mesh, for reporting
+struct MeshCookStats
+{
+	size_t sourceVertexCount;	// Before welding
+	double importMilliseconds;	// Parsing the source into vertices and indices
+	VertexCacheStats cacheBefore;	// File order
+	VertexCacheStats cacheAfter;	// After the optimizer passes (LOD0)
+	double lodMilliseconds;	// Time spent simplifying
+};
+
+
+namespace MeshCache
+{
+	// Fast non-cryptographic 64-bit hash, used to detect source changes
+	uint64_t HashBytes(const void* data, size_t size);
+
+	// The full OBJ -> render-ready pipeline (parse, weld, group by material,
+	// optimize, meshlets, LODs, tangents)
+	MeshCookStats CookObj(const char* objData, size_t objSize, CookedMesh& mesh);
+
+	// Just the optimize, meshlets, LODs and tangents part, for meshes imported some other
+	// way (see GlbLoader); indices must hold LOD0 only, grouped by subset if there are any
+	MeshCookStats Cook(CookedMesh& mesh, bool generateTangents = true);
+
+	// Writes a cache file, returns false if it couldn't be written
+	// - Compressed files are smaller (indices shrink 6-10x, vertices
+	//   1.1-2.5x) but cost a decode pass to load (see MeshCodec),
+	//   meshes that don't shrink are stored raw anyway
+	bool Save(const std::wstring& path, uint64_t sourceHash, size_t sourceVertexCount, const CookedMesh& mesh, bool compress = true);
+
+	// Where the cache for a given source file lives
+	std::wstring GetCachePath(const std::wstring& sourceFile);
+}
@@ -0,0 +1,580 @@
+#include "MeshCodec.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+// x64 always has SSE2, the decoder uses it to rebuild whole
+// registers of vertex bytes at once (elsewhere it falls back
+// to 32-bit arithmetic)
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MESH_CODEC_SSE2
+#endif
+
+namespace
+{
+	// First byte of each stream, so a stream of the wrong kind (or a
+	// future version) is rejected instead of decoded into garbage
+	const unsigned char VertexStreamHeader = 0xA0;
+	const unsigned char IndexStreamHeader = 0xE0;
+
+	// Vertices are coded in blocks so a block's byte planes stay in L1
+	const size_t BlockBytes = 8192;
+	const size_t MaxBlockVertices = 256;
+	const size_t GroupSize = 16;
+	const size_t MaxStride = 256;
+
+	// Bits per byte for each 2-bit group mode
+	const unsigned int GroupBits[4] = { 0, 2, 4, 8 };
+
+	// Index FIFOs; code 15 is reserved in both, so 15 edges and 14 vertices are usable
+	const unsigned int EdgeFifoSize = 16;
+	const unsigned int VertexFifoSize = 16;
+	const unsigned int ExplicitCode = 15;
+	const unsigned int NoEdgeCode = 15;
+
+	// Whole groups, so each plane of a block starts on a group
+	inline size_t BlockVertexCount(size_t stride)
+	{
+		return std::min(MaxBlockVertices, BlockBytes / stride / GroupSize * GroupSize);
+	}
+
+	inline uint32_t ZigZag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+	inline int32_t UnZigZag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+	// --------------------------------------------------------
+	// Byte planes
+	// - A header of 2 bits per group of 16 bytes picks how
+	//   many bits each byte of the group takes, then the
+	//   groups' packed data follows in order
+	// --------------------------------------------------------
+	void EncodePlane(const unsigned char* bytes, size_t count, std::vector<unsigned char>& out)
+	{
+		size_t groups = (count + GroupSize - 1) / GroupSize;
+		size_t header = out.size();
+		out.resize(header + (groups + 3) / 4, 0);
+
+		for (size_t g = 0; g < groups; g++)
+		{
+			//the last group is padded with zeroes
+			unsigned char group[GroupSize] = {};
+			memcpy(group, bytes + g * GroupSize, std::min(GroupSize, count - g * GroupSize));
+
+			unsigned char largest = *std::max_element(group, group + GroupSize);
+			unsigned int mode = largest == 0 ? 0 : largest < 4 ? 1 : largest < 16 ? 2 : 3;
+			out[header + g / 4] |= (unsigned char)(mode << ((g % 4) * 2));
+
+			unsigned int bits = GroupBits[mode];
+			if (bits == 0)
+				continue;
+			if (bits == 8)
+			{
+				out.insert(out.end(), group, group + GroupSize);
+				continue;
+			}
+
+			//byte i of the packed data holds group[i], group[i + length], ... from the low bits up
+			//(so UnpackGroup can spread whole words back out)
+			size_t start = out.size();
+			size_t length = bits * GroupSize / 8;
+			out.resize(start + length, 0);
+			for (size_t i = 0; i < GroupSize; i++)
+				out[start + i % length] |= (unsigned char)(group[i] << (i / length * bits));
+		}
+	}
+
+	// Unpacks one group of 16 deltas, with at least 16 bytes
+	// of data readable (whatever the mode) so it can unpack
+	// every width and pick one instead of branching on the
+	// mode, which is close to random between groups
+	// - 2 bits: byte i of the first 4 holds group[i], [i + 4], [i + 8], [i + 12]
+	// - 4 bits: byte i of the first 8 holds group[i] and [i + 8]
+#ifdef MESH_CODEC_SSE2
+	inline void UnpackGroup(unsigned int mode, const unsigned char* data, unsigned char* group)
+	{
+		const __m128i low2 = _mm_set1_epi8(3), low4 = _mm_set1_epi8(15), low7 = _mm_set1_epi8(0x7F), one = _mm_set1_epi8(1);
+		__m128i packed = _mm_loadu_si128((const __m128i*)data);
+		__m128i bits01 = _mm_and_si128(packed, low2), bits23 = _mm_and_si128(_mm_srli_epi16(packed, 2), low2);
+		__m128i bits45 = _mm_and_si128(_mm_srli_epi16(packed, 4), low2), bits67 = _mm_and_si128(_mm_srli_epi16(packed, 6), low2);
+
+		__m128i widths[4];
+		widths[0] = _mm_setzero_si128();
+		widths[1] = _mm_unpacklo_epi64(_mm_unpacklo_epi32(bits01, bits23), _mm_unpacklo_epi32(bits45, bits67));
+		widths[2] = _mm_unpacklo_epi64(_mm_and_si128(packed, low4), _mm_and_si128(_mm_srli_epi16(packed, 4), low4));
+		widths[3] = packed;
+
+		//and back from zigzag to signed deltas
+		__m128i v = widths[mode];
+		v = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(v, 1), low7), _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(v, one)));
+		_mm_storeu_si128((__m128i*)group, v);
+	}
+#else
+	inline uint64_t UnZigZagBytes(uint64_t v)
+	{
+		return ((v >> 1) & 0x7F7F7F7F7F7F7F7FULL) ^ ((v & 0x0101010101010101ULL) * 0xFF);
+	}
+
+	inline void UnpackGroup(unsigned int mode, const unsigned char* data, unsigned char* group)
+	{
+		uint64_t first, second;
+		memcpy(&first, data, 8);
+		memcpy(&second, data + 8, 8);
+		uint64_t spread = (first & 0xFFFFFFFF) | (first << 30);
+
+		const uint64_t lows[4] = { 0, spread & 0x0303030303030303ULL, first & 0x0F0F0F0F0F0F0F0FULL, first };
+		const uint64_t highs[4] = { 0, (spread >> 4) & 0x0303030303030303ULL, (first >> 4) & 0x0F0F0F0F0F0F0F0FULL, second };
+		uint64_t deltas[2] = { UnZigZagBytes(lows[mode]), UnZigZagBytes(highs[mode]) };
+		memcpy(group, deltas, GroupSize);
+	}
+#endif
+
+	// Where each of the four groups one header byte describes starts
+	// in the packed data, and how much they take altogether
+	struct HeaderLayout
+	{
+		unsigned char offsets[256][4];
+		unsigned char lengths[256];
+
+		HeaderLayout()
+		{
+			for (unsigned int h = 0; h < 256; h++)
+			{
+				unsigned int length = 0;
+				for (unsigned int g = 0; g < 4; g++)
+				{
+					offsets[h][g] = (unsigned char)length;
+					length += GroupBits[(h >> (g * 2)) & 3] * GroupSize / 8;
+				}
+				lengths[h] = (unsigned char)length;
+			}
+		}
+	};
+	const HeaderLayout headerLayout;
+
+	// Unpacks count deltas (rounded up to a whole group) into bytes,
+	// returns the data after the plane or nullptr if it runs out
+	// - The header says how long the plane is, so the bounds are
+	//   checked once up front instead of per group
+	// - Groups are found through HeaderLayout four at a time, rather
+	//   than each one waiting for the length of the one before it
+	const unsigned char* DecodePlane(const unsigned char* data, const unsigned char* end, size_t count, unsigned char* bytes)
+	{
+		size_t groups = (count + GroupSize - 1) / GroupSize;
+		size_t headerSize = (groups + 3) / 4;
+		if ((size_t)(end - data) < headerSize)
+			return nullptr;
+
+		//a partial last header byte has zeroes (empty groups) in its unused bits
+		const unsigned char* header = data;
+		size_t length = 0;
+		for (size_t h = 0; h < headerSize; h++)
+			length += headerLayout.lengths[header[h]];
+		data += headerSize;
+		if ((size_t)(end - data) < length)
+			return nullptr;
+
+		//near the end of the data, groups are copied out first so they can't be overread
+		bool padded = (size_t)(end - data) < length + GroupSize;
+		for (size_t h = 0; h < headerSize; h++)
+		{
+			unsigned int modes = header[h];
+			size_t headerGroups = std::min<size_t>(4, groups - h * 4);
+			unsigned char* target = bytes + h * 4 * GroupSize;
+			for (size_t g = 0; g < headerGroups && !padded; g++)
+				UnpackGroup((modes >> (g * 2)) & 3, data + headerLayout.offsets[modes][g], target + g * GroupSize);
+			for (size_t g = 0; g < headerGroups && padded; g++)
+			{
+				unsigned int mode = (modes >> (g * 2)) & 3;
+				unsigned char copy[GroupSize] = {};
+				memcpy(copy, data + headerLayout.offsets[modes][g], GroupBits[mode] * GroupSize / 8);
+				UnpackGroup(mode, copy, target + g * GroupSize);
+			}
+			data += headerLayout.lengths[modes];
+		}
+		return data;
+	}
+
+#ifdef MESH_CODEC_SSE2
+	// 16 x 16 byte transpose: four rounds of interleaving row j with row j + 8
+	// (written out so the rows stay in registers as much as they can)
+	inline void Transpose(__m128i* rows)
+	{
+		for (int round = 0; round < 4; round++)
+		{
+			__m128i a0 = _mm_unpacklo_epi8(rows[0], rows[8]), a1 = _mm_unpackhi_epi8(rows[0], rows[8]);
+			__m128i a2 = _mm_unpacklo_epi8(rows[1], rows[9]), a3 = _mm_unpackhi_epi8(rows[1], rows[9]);
+			__m128i a4 = _mm_unpacklo_epi8(rows[2], rows[10]), a5 = _mm_unpackhi_epi8(rows[2], rows[10]);
+			__m128i a6 = _mm_unpacklo_epi8(rows[3], rows[11]), a7 = _mm_unpackhi_epi8(rows[3], rows[11]);
+			__m128i a8 = _mm_unpacklo_epi8(rows[4], rows[12]), a9 = _mm_unpackhi_epi8(rows[4], rows[12]);
+			__m128i a10 = _mm_unpacklo_epi8(rows[5], rows[13]), a11 = _mm_unpackhi_epi8(rows[5], rows[13]);
+			__m128i a12 = _mm_unpacklo_epi8(rows[6], rows[14]), a13 = _mm_unpackhi_epi8(rows[6], rows[14]);
+			__m128i a14 = _mm_unpacklo_epi8(rows[7], rows[15]), a15 = _mm_unpackhi_epi8(rows[7], rows[15]);
+			rows[0] = a0; rows[1] = a1; rows[2] = a2; rows[3] = a3;
+			rows[4] = a4; rows[5] = a5; rows[6] = a6; rows[7] = a7;
+			rows[8] = a8; rows[9] = a9; rows[10] = a10; rows[11] = a11;
+			rows[12] = a12; rows[13] = a13; rows[14] = a14; rows[15] = a15;
+		}
+	}
+
+	// Transposes the planes of deltas (row k holding byte k of every
+	// vertex) back into vertices, 16 x 16 bytes at a time, adding each
+	// vertex onto the one before it (running holds the last vertex, in
+	// 16 byte columns)
+	// - Column tiles go right to left, so a tile hanging past the end of a
+	//   vertex spills into the next one before that gets written properly;
+	//   only the very last vertex of the output has to be written exactly
+	void RebuildBlock(const unsigned char* planes, size_t blockVertices, size_t count, size_t stride, __m128i* running, unsigned char* target, bool lastBlock)
+	{
+		for (size_t i = 0; i < count; i += 16)
+		{
+			size_t vertices = std::min<size_t>(16, count - i);
+			for (size_t k = (stride - 1) / 16 * 16; k < stride; k -= 16)
+			{
+				__m128i rows[16];
+				for (size_t r = 0; r < 16; r++)
+					rows[r] = _mm_load_si128((const __m128i*)(planes + (k + r) * blockVertices + i));
+				Transpose(rows);
+
+				size_t bytes = std::min<size_t>(16, stride - k);
+				__m128i vertex = running[k / 16];
+				for (size_t v = 0; v < vertices; v++)
+				{
+					vertex = _mm_add_epi8(vertex, rows[v]);
+					unsigned char* write = target + (i + v) * stride + k;
+					if (bytes == 16 || !(lastBlock && i + v + 1 == count))
+						_mm_storeu_si128((__m128i*)write, vertex);
+					else
+					{
+						alignas(16) unsigned char exact[16];
+						_mm_store_si128((__m128i*)exact, vertex);
+						memcpy(write, exact, bytes);
+					}
+				}
+				running[k / 16] = vertex;
+			}
+		}
+	}
+#else
+	// Adds four 8-bit deltas to the bytes of a word, with no carries between them
+	inline uint32_t AddBytes(uint32_t previous, uint32_t deltas)
+	{
+		return ((previous & 0x7F7F7F7F) + (deltas & 0x7F7F7F7F)) ^ ((previous ^ deltas) & 0x80808080);
+	}
+#endif
+
+	// --------------------------------------------------------
+	// Index stream helpers
+	// --------------------------------------------------------
+	void WriteVarint(uint32_t v, std::vector<unsigned char>& out)
+	{
+		while (v >= 0x80)
+		{
+			out.push_back((unsigned char)(v | 0x80));
+			v >>= 7;
+		}
+		out.push_back((unsigned char)v);
+	}
+
+	inline bool ReadVarint(const unsigned char*& data, const unsigned char* end, uint32_t& v)
+	{
+		v = 0;
+		for (unsigned int shift = 0; shift < 35; shift += 7)
+		{
+			if (data == end)
+				return false;
+			unsigned char byte = *data++;
+			v |= (uint32_t)(byte & 0x7F) << shift;
+			if (byte < 0x80)
+				return true;
+		}
+		return false;
+	}
+
+	// What the encoder and decoder both track, updated identically on each side
+	struct IndexState
+	{
+		uint32_t edges[EdgeFifoSize][2];
+		uint32_t vertices[VertexFifoSize];
+		unsigned int edgeHead = 0;
+		unsigned int vertexHead = 0;
+		uint32_t next = 0;	// The next vertex used for the first time, if they come in order
+		uint32_t last = 0;	// The last explicitly coded vertex
+
+		IndexState()
+		{
+			memset(edges, 0xFF, sizeof(edges));
+			memset(vertices, 0xFF, sizeof(vertices));
+		}
+
+		void PushEdge(uint32_t a, uint32_t b)
+		{
+			edges[edgeHead][0] = a;
+			edges[edgeHead][1] = b;
+			edgeHead = (edgeHead + 1) % EdgeFifoSize;
+		}
+
+		void PushVertex(uint32_t v)
+		{
+			vertices[vertexHead] = v;
+			vertexHead = (vertexHead + 1) % VertexFifoSize;
+		}
+
+		// i = 0 is the most recent
+		const uint32_t* Edge(unsigned int i) const { return edges[(edgeHead - 1 - i) % EdgeFifoSize]; }
+		uint32_t Vertex(unsigned int i) const { return vertices[(vertexHead - 1 - i) % VertexFifoSize]; }
+
+		// A neighbour across an edge walks it the other way, so those are what get remembered
+		void PushTriangleEdges(uint32_t a, uint32_t b, uint32_t c, bool includeFirst)
+		{
+			if (includeFirst)
+				PushEdge(b, a);
+			PushEdge(c, b);
+			PushEdge(a, c);
+		}
+	};
+
+	// 0 = next, 1-14 = vertex FIFO, 15 = explicit (zigzag delta from last)
+	unsigned int EncodeVertex(IndexState& state, uint32_t v, std::vector<unsigned char>& extra)
+	{
+		if (v == state.next)
+		{
+			state.next++;
+			state.PushVertex(v);
+			return 0;
+		}
+		for (unsigned int i = 0; i < ExplicitCode - 1; i++)
+		{
+			if (state.Vertex(i) == v)
+				return 1 + i;
+		}
+		WriteVarint(ZigZag((int32_t)(v - state.last)), extra);
+		state.last = v;
+		state.PushVertex(v);
+		return ExplicitCode;
+	}
+
+	inline bool DecodeVertex(IndexState& state, unsigned int code, const unsigned char*& data, const unsigned char* end, uint32_t& v)
+	{
+		if (code == 0)
+		{
+			v = state.next++;
+			state.PushVertex(v);
+		}
+		else if (code < ExplicitCode)
+		{
+			v = state.Vertex(code - 1);
+		}
+		else
+		{
+			uint32_t delta;
+			if (!ReadVarint(data, end, delta))
+				return false;
+			v = state.last + (uint32_t)UnZigZag(delta);
+			state.last = v;
+			state.PushVertex(v);
+		}
+		return true;
+	}
+}
+
+
+// --------------------------------------------------------
+// Vertices, a block at a time: every byte becomes its
+// zigzagged difference from the same byte of the previous
+// vertex, stored as byte planes so the (mostly small) high
+// bytes of floats pack separately from the noisy low ones
+// --------------------------------------------------------
+void MeshCodec::EncodeVertices(const void* vertices, size_t count, size_t stride, std::vector<unsigned char>& out)
+{
+	if (stride == 0 || stride % 4 != 0 || stride > MaxStride)
+		throw std::invalid_argument("Vertex stride must be a multiple of 4 bytes, up to 256");
+
+	const unsigned char* source = (const unsigned char*)vertices;
+	size_t blockVertices = BlockVertexCount(stride);
+	unsigned char previous[MaxStride] = {};
+	unsigned char planes[BlockBytes];
+
+	out.push_back(VertexStreamHeader);
+	for (size_t blockStart = 0; blockStart < count; blockStart += blockVertices)
+	{
+		size_t blockCount = std::min(blockVertices, count - blockStart);
+		for (size_t i = 0; i < blockCount; i++)
+		{
+			const unsigned char* vertex = source + (blockStart + i) * stride;
+			for (size_t k = 0; k < stride; k++)
+			{
+				int8_t delta = (int8_t)(vertex[k] - previous[k]);
+				planes[k * blockVertices + i] = (unsigned char)((delta << 1) ^ (delta >> 7));
+			}
+			memcpy(previous, vertex, stride);
+		}
+
+		for (size_t k = 0; k < stride; k++)
+			EncodePlane(planes + k * blockVertices, blockCount, out);
+	}
+}
+
+
+// --------------------------------------------------------
+// Unpacks every plane of a block first, then transposes
+// the planes back into vertices while adding up the deltas
+// (without SSE2, a vertex at a time so the lanes' additions
+// don't wait on each other)
+// --------------------------------------------------------
+bool MeshCodec::DecodeVertices(void* destination, size_t count, size_t stride, const unsigned char* data, size_t size)
+{
+	if (stride == 0 || stride % 4 != 0 || stride > MaxStride)
+		return false;
+
+	const unsigned char* end = data + size;
+	if (size == 0 || *data++ != VertexStreamHeader)
+		return false;
+
+	unsigned char* target = (unsigned char*)destination;
+	size_t blockVertices = BlockVertexCount(stride);
+
+#ifdef MESH_CODEC_SSE2
+	//room for the transpose to read whole tiles of 16 planes past the stride
+	__m128i previous[MaxStride / 16] = {};
+	alignas(16) unsigned char planes[BlockBytes + GroupSize * MaxBlockVertices] = {};
+#else
+	size_t lanes = stride / 4;
+	uint32_t previous[MaxStride / 4] = {};
+	unsigned char planes[BlockBytes];
+#endif
+
+	for (size_t blockStart = 0; blockStart < count; blockStart += blockVertices)
+	{
+		size_t blockCount = std::min(blockVertices, count - blockStart);
+		for (size_t k = 0; k < stride; k++)
+		{
+			data = DecodePlane(data, end, blockCount, planes + k * blockVertices);
+			if (!data)
+				return false;
+		}
+
+#ifdef MESH_CODEC_SSE2
+		RebuildBlock(planes, blockVertices, blockCount, stride, previous, target + blockStart * stride, blockStart + blockCount == count);
+#else
+		for (size_t i = 0; i < blockCount; i++)
+		{
+			unsigned char* write = target + (blockStart + i) * stride;
+			for (size_t lane = 0; lane < lanes; lane++)
+			{
+				const unsigned char* bytes = planes + lane * 4 * blockVertices + i;
+				uint32_t delta = bytes[0] | (bytes[blockVertices] << 8) | (bytes[blockVertices * 2] << 16) | ((uint32_t)bytes[blockVertices * 3] << 24);
+				previous[lane] = AddBytes(previous[lane], delta);
+				memcpy(write + lane * 4, &previous[lane], 4);
+			}
+		}
+#endif
+	}
+	return data == end;
+}
+
+
+// --------------------------------------------------------
+// Triangles, one code byte each (plus any explicit vertices
+// as varints right after it)
+// - High nibble 0-14: the triangle starts with that recent
+//   edge, the low nibble codes the third vertex
+// - High nibble 15: no shared edge, the low nibble and the
+//   next byte's two nibbles code all three vertices
+// --------------------------------------------------------
+void MeshCodec::EncodeIndices(const unsigned int* indices, size_t count, std::vector<unsigned char>& out)
+{
+	if (count % 3 != 0)
+		throw std::invalid_argument("Index count must be a multiple of 3");
+
+	IndexState state;
+	std::vector<unsigned char> extra;
+	out.push_back(IndexStreamHeader);
+	for (size_t t = 0; t < count; t += 3)
+	{
+		//any rotation keeps the winding, look for one that starts with a recent edge
+		const unsigned int* tri = indices + t;
+		unsigned int edge = NoEdgeCode, rotation = 0;
+		for (unsigned int r = 0; r < 3 && edge == NoEdgeCode; r++)
+		{
+			for (unsigned int e = 0; e < NoEdgeCode; e++)
+			{
+				const uint32_t* candidate = state.Edge(e);
+				if (candidate[0] == tri[r] && candidate[1] == tri[(r + 1) % 3])
+				{
+					edge = e;
+					rotation = r;
+					break;
+				}
+			}
+		}
+		uint32_t a = tri[rotation], b = tri[(rotation + 1) % 3], c = tri[(rotation + 2) % 3];
+
+		extra.clear();
+		if (edge != NoEdgeCode)
+		{
+			unsigned int code = EncodeVertex(state, c, extra);
+			out.push_back((unsigned char)(edge << 4 | code));
+		}
+		else
+		{
+			unsigned int codeA = EncodeVertex(state, a, extra);
+			unsigned int codeB = EncodeVertex(state, b, extra);
+			unsigned int codeC = EncodeVertex(state, c, extra);
+			out.push_back((unsigned char)(NoEdgeCode << 4 | codeA));
+			out.push_back((unsigned char)(codeB << 4 | codeC));
+		}
+		out.insert(out.end(), extra.begin(), extra.end());
+		state.PushTriangleEdges(a, b, c, edge == NoEdgeCode);
+	}
+}
+
+
+bool MeshCodec::DecodeIndices(unsigned int* destination, size_t count, size_t vertexCount, const unsigned char* data, size_t size)
+{
+	if (count % 3 != 0)
+		return false;
+
+	const unsigned char* end = data + size;
+	if (size == 0 || *data++ != IndexStreamHeader)
+		return false;
+
+	IndexState state;
+	for (size_t t = 0; t < count; t += 3)
+	{
+		if (data == end)
+			return false;
+		unsigned int code = *data++;
+		unsigned int edge = code >> 4;
+
+		uint32_t a, b, c;
+		if (edge != NoEdgeCode)
+		{
+			const uint32_t* shared = state.Edge(edge);
+			a = shared[0];
+			b = shared[1];
+			if (!DecodeVertex(state, code & 15, data, end, c))
+				return false;
+		}
+		else
+		{
+			if (data == end)
+				return false;
+			unsigned int codes = *data++;
+			if (!DecodeVertex(state, code & 15, data, end, a) ||
+				!DecodeVertex(state, codes >> 4, data, end, b) ||
+				!DecodeVertex(state, codes & 15, data, end, c))
+				return false;
+		}
+
+		//edge vertices were checked when they first came in, but it's no slower to check all three
+		if (a >= vertexCount || b >= vertexCount || c >= vertexCount)
+			return false;
+
+		destination[t + 0] = a;
+		destination[t + 1] = b;
+		destination[t + 2] = c;
+		state.PushTriangleEdges(a, b, c, edge == NoEdgeCode);
+	}
+	return data == end;
+}
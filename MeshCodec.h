@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// --------------------------------------------------------
+// Lossless compression for vertex and index buffers, used
+// by .meshcache files to cut their size on disk
+//
+// - Each vertex byte is delta coded against the same byte of
+//   the previous vertex and stored in byte planes, each group
+//   of 16 deltas packed into 0, 2, 4 or 8 bits per byte
+// - Indices are coded per triangle against a FIFO of recent
+//   edges and vertices, so a triangle that shares an edge with
+//   a recent one costs a single byte
+// - Both decoders are single pass with no allocations; they
+//   return false on truncated or corrupt data and never read
+//   past the end of it, or return an index past vertexCount
+// - Compression works best on optimized meshes (see
+//   MeshOptimizer), where neighbouring vertices are close
+//   together and new vertices show up in order
+// --------------------------------------------------------
+namespace MeshCodec
+{
+	// Appends the encoded vertices to out (stride must be a multiple of 4)
+	void EncodeVertices(const void* vertices, size_t count, size_t stride, std::vector<unsigned char>& out);
+	bool DecodeVertices(void* destination, size_t count, size_t stride, const unsigned char* data, size_t size);
+
+	// Appends the encoded triangle list to out
+	// - Triangles can come back rotated (same winding, same
+	//   order), whichever rotation shares an edge compresses best
+	void EncodeIndices(const unsigned int* indices, size_t count, std::vector<unsigned char>& out);
+	bool DecodeIndices(unsigned int* destination, size_t count, size_t vertexCount, const unsigned char* data, size_t size);
+}
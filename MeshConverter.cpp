@@ -0,0 +1,1714 @@
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "GlbLoader.h"
+#include "MappedFile.h"
+#include "MeshBounds.h"
+#include "MeshBvh.h"
+#include "MeshCache.h"
+#include "MeshCodec.h"
+#include "MeshGenerator.h"
+#include "MeshOptimizer.h"
+#include "MeshSdf.h"
+#include "MeshTools.h"
+#include "ObjLoader.h"
+#include "ObjStreamer.h"
+#include "VertexFormat.h"
+#include "VertexQuantize.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// --------------------------------------------------------
+// Offline baker for .meshcache files
+//
+// Usage: MeshConverter [--stream <megabytes>] <model.obj> [more.obj ...]
+//        MeshConverter <model.glb> [more.glb ...]
+//        MeshConverter --parse-bench [model.obj ...]
+//        MeshConverter --stream-check [megabytes] [budget megabytes]
+//        MeshConverter --codec
+//        MeshConverter --generate
+//        MeshConverter --quantize [model.obj ...]
+//        MeshConverter --tangents [model.obj ...]
+//        MeshConverter --sdf <resolution> <model.obj> [more.obj ...]
+//        MeshConverter --bounds [model.obj ...]
+//        MeshConverter --rays [model.obj ...]
+//
+// - Writes <model.obj>.meshcache next to each source, which
+//   is exactly where Mesh looks for it at load time, and fails
+//   if the depth-only position stream doesn't draw the same
+//   triangles as the mesh, a meshlet's sphere or backface
+//   cone doesn't hold, or a vertex is outside the mesh's
+//   bounds
+// - With --stream, sources too big to load are imported out of
+//   core within the given memory budget and written to
+//   <model.obj>.meshchunks instead (see ObjStreamer)
+// - .glb files are imported and cooked for timing (import
+//   speed is comparable with the OBJ numbers), nothing is written
+// - --parse-bench times ObjLoader on one thread and on all of
+//   them, for each model and a large generated one, and fails
+//   if the two disagree
+// - --stream-check generates an OBJ of the given size (4 GB by
+//   default) and streams it in with the given budget (256 MB by
+//   default), failing if the process' peak resident memory goes
+//   over the budget or the chunks don't add up to the source
+// - --codec reports how well MeshCodec compresses dense
+//   generated meshes and how fast they decode, and fails if
+//   they don't decode back to the source or truncated and
+//   corrupted streams get through
+// - --generate times MeshGenerator's shapes with and without
+//   cooking, and fails if a triangle is wound against its
+//   normals or an analytic tangent is off from the computed one
+// - --quantize round trips each model (or generated meshes and
+//   random vertices) through CompactVertex and fails if any
+//   error is over VertexQuantize's documented bounds, the
+//   SIMD path disagrees with the scalar one, or VertexFormats'
+//   per-attribute conversion doesn't give the same bytes
+// - --tangents checks MeshTools::CalculateTangents against the
+//   original scalar version on each model (or generated and
+//   random meshes): bit-identical on one thread, within float
+//   rounding on several
+// - --sdf bakes dense and sparse distance volumes of each
+//   model and reports time and memory (see MeshSdf), failing
+//   if a sample is more than half a voxel off the closest
+//   triangle or (for closed models) on the wrong side of it
+// - --bounds calculates each model's (or generated and random
+//   meshes') bounding volumes and fails if the SSE results
+//   differ from plain loops over the vertices (see CheckBounds)
+// - --rays builds a BVH over each model (or dense generated
+//   meshes without any) and reports build time and single
+//   ray and packet query rates (see MeshBvh), failing if
+//   either one's hits differ from testing every triangle
+// - Benchmarks that have nothing to do with cooking or
+//   importing meshes live in SceneBench instead
+// --------------------------------------------------------
+
+// Fraction of triangles the meshlet backface cones reject, averaged
+// over cameras on a ring around the mesh (and above/below it)
+float MeasureConeCulling(const std::vector<Meshlet>& meshlets, const Vertex* verts, size_t numVerts, size_t numTris)
+{
+	DirectX::XMFLOAT3 boundsMin, boundsMax;
+	MeshTools::CalculateBounds(verts, numVerts, boundsMin, boundsMax);
+	DirectX::XMFLOAT3 center((boundsMin.x + boundsMax.x) * 0.5f, (boundsMin.y + boundsMax.y) * 0.5f, (boundsMin.z + boundsMax.z) * 0.5f);
+	float dx = boundsMax.x - boundsMin.x, dy = boundsMax.y - boundsMin.y, dz = boundsMax.z - boundsMin.z;
+	float distance = sqrtf(dx * dx + dy * dy + dz * dz) * 2.0f;
+
+	//no frustum planes, everything is in view
+	DirectX::XMFLOAT4X4 noFrustum = {};
+	noFrustum._44 = 1.0f;
+
+	const int ringSteps = 8;
+	const float heights[] = { -0.5f, 0.0f, 0.5f };
+	size_t culled = 0;
+	std::vector<IndexRange> ranges;
+	for (float height : heights)
+	{
+		for (int i = 0; i < ringSteps; i++)
+		{
+			float angle = DirectX::XM_2PI * i / ringSteps;
+			DirectX::XMFLOAT3 camera(
+				center.x + cosf(angle) * distance,
+				center.y + height * distance,
+				center.z + sinf(angle) * distance);
+
+			ranges.clear();
+			MeshletCullParams params = Meshlets::MakeCullParams(noFrustum, camera, true);
+			culled += Meshlets::Cull(meshlets.data(), meshlets.size(), params, ranges);
+		}
+	}
+	return (float)culled / (numTris * ringSteps * 3);
+}
+
+
+// True if the meshlets tile the indices within their size limits, every
+// sphere holds its meshlet's vertices, and no meshlet a cone rejects has a
+// front facing triangle, from random views around and inside the mesh
+bool CheckMeshlets(const std::vector<Meshlet>& meshlets, const Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices)
+{
+	//every triangle in exactly one meshlet
+	std::vector<std::pair<unsigned int, unsigned int>> runs;
+	for (const Meshlet& meshlet : meshlets)
+	{
+		if (meshlet.triangleCount > MeshletMaxTriangles || meshlet.vertexCount > MeshletMaxVertices ||
+			(uint64_t)meshlet.startIndex + meshlet.triangleCount * 3ull > numIndices)
+			return false;
+		runs.push_back({ meshlet.startIndex, meshlet.triangleCount * 3 });
+	}
+	std::sort(runs.begin(), runs.end());
+	size_t covered = 0;
+	for (auto& [start, count] : runs)
+	{
+		if (start != covered)
+			return false;
+		covered += count;
+	}
+	if (covered != numIndices)
+		return false;
+
+	for (const Meshlet& meshlet : meshlets)
+	{
+		for (unsigned int i = meshlet.startIndex; i < meshlet.startIndex + meshlet.triangleCount * 3; i++)
+		{
+			if (indices[i] >= numVerts)
+				return false;
+			const DirectX::XMFLOAT3& p = verts[indices[i]].Position;
+			float dx = p.x - meshlet.center.x, dy = p.y - meshlet.center.y, dz = p.z - meshlet.center.z;
+			if (sqrtf(dx * dx + dy * dy + dz * dz) > meshlet.radius * 1.0001f + 1e-6f)
+				return false;
+		}
+	}
+
+	DirectX::XMFLOAT3 boundsMin, boundsMax;
+	MeshTools::CalculateBounds(verts, numVerts, boundsMin, boundsMax);
+	DirectX::XMFLOAT3 center((boundsMin.x + boundsMax.x) * 0.5f, (boundsMin.y + boundsMax.y) * 0.5f, (boundsMin.z + boundsMax.z) * 0.5f);
+	float dx = boundsMax.x - boundsMin.x, dy = boundsMax.y - boundsMin.y, dz = boundsMax.z - boundsMin.z;
+	float reach = sqrtf(dx * dx + dy * dy + dz * dz) * 1.5f;
+
+	DirectX::XMFLOAT4X4 noFrustum = {};
+	noFrustum._44 = 1.0f;
+
+	std::mt19937 rng(6);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	for (int view = 0; view < 200; view++)
+	{
+		DirectX::XMFLOAT3 camera(center.x + unit(rng) * reach, center.y + unit(rng) * reach, center.z + unit(rng) * reach);
+		MeshletCullParams params = Meshlets::MakeCullParams(noFrustum, camera, true);
+		for (const Meshlet& meshlet : meshlets)
+		{
+			if (Meshlets::IsVisible(meshlet, params))
+				continue;
+
+			//clockwise front faces, so (b - a) x (c - a) points out, with some
+			//slack for triangles seen almost exactly edge on
+			for (unsigned int i = meshlet.startIndex; i < meshlet.startIndex + meshlet.triangleCount * 3; i += 3)
+			{
+				const DirectX::XMFLOAT3& a = verts[indices[i]].Position;
+				const DirectX::XMFLOAT3& b = verts[indices[i + 1]].Position;
+				const DirectX::XMFLOAT3& c = verts[indices[i + 2]].Position;
+				float ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+				float vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+				float nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+				float tx = camera.x - a.x, ty = camera.y - a.y, tz = camera.z - a.z;
+				float facing = nx * tx + ny * ty + nz * tz;
+				if (facing > 1e-3f * sqrtf(nx * nx + ny * ny + nz * nz) * sqrtf(tx * tx + ty * ty + tz * tz))
+					return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+// True if the depth-only position stream draws exactly the triangles of
+// the original indices (same corners, same winding, any order), less the
+// ones that only collapse because of welding, which have no area anyway
+bool MatchesPositionStream(const Vertex* verts, const unsigned int* indices, size_t numIndices,
+	const std::vector<DirectX::XMFLOAT3>& positions, const std::vector<unsigned int>& positionIndices)
+{
+	//a triangle as the bits of its corners, rotated to start at the lowest one
+	typedef std::array<uint32_t, 9> TriangleKey;
+	auto makeKey = [](const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b, const DirectX::XMFLOAT3& c)
+	{
+		TriangleKey corners[3];
+		const DirectX::XMFLOAT3* points[3] = { &a, &b, &c };
+		for (int rotation = 0; rotation < 3; rotation++)
+		{
+			for (int corner = 0; corner < 3; corner++)
+				memcpy(&corners[rotation][corner * 3], points[(rotation + corner) % 3], sizeof(DirectX::XMFLOAT3));
+		}
+		return std::min({ corners[0], corners[1], corners[2] });
+	};
+	auto samePosition = [](const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+	{
+		return memcmp(&a, &b, sizeof(a)) == 0;
+	};
+
+	std::vector<TriangleKey> original;
+	for (size_t i = 0; i + 2 < numIndices; i += 3)
+	{
+		const DirectX::XMFLOAT3& a = verts[indices[i]].Position;
+		const DirectX::XMFLOAT3& b = verts[indices[i + 1]].Position;
+		const DirectX::XMFLOAT3& c = verts[indices[i + 2]].Position;
+		if (!samePosition(a, b) && !samePosition(b, c) && !samePosition(a, c))
+			original.push_back(makeKey(a, b, c));
+	}
+
+	std::vector<TriangleKey> streamed;
+	for (size_t i = 0; i + 2 < positionIndices.size(); i += 3)
+	{
+		if (positionIndices[i] >= positions.size() || positionIndices[i + 1] >= positions.size() || positionIndices[i + 2] >= positions.size())
+			return false;
+		streamed.push_back(makeKey(positions[positionIndices[i]], positions[positionIndices[i + 1]], positions[positionIndices[i + 2]]));
+	}
+
+	std::sort(original.begin(), original.end());
+	std::sort(streamed.begin(), streamed.end());
+	return positionIndices.size() % 3 == 0 && original == streamed;
+}
+
+
+// Checks MeshBounds' SSE reductions against plain loops over the vertices:
+// the box has to be their exact min and max, the sphere and the oriented
+// box have to hold all of them, the sphere can't be bigger than the box
+// center's farthest vertex, and each side of the oriented box has to touch
+// a vertex; false with the reason in problem otherwise
+bool CheckBounds(const Vertex* verts, size_t numVerts, const BoundingVolumes& bounds, const char*& problem)
+{
+	problem = nullptr;
+	if (numVerts == 0)
+		return true;
+
+	DirectX::XMFLOAT3 lo = verts[0].Position, hi = verts[0].Position;
+	for (size_t i = 1; i < numVerts; i++)
+	{
+		const DirectX::XMFLOAT3& p = verts[i].Position;
+		lo = DirectX::XMFLOAT3(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+		hi = DirectX::XMFLOAT3(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+	}
+	if (memcmp(&lo, &bounds.boxMin, sizeof(lo)) != 0 || memcmp(&hi, &bounds.boxMax, sizeof(hi)) != 0)
+		return problem = "box isn't the min and max of the vertices", false;
+
+	//float rounding in the projections scales with how far out the mesh is
+	float reach = std::max({ fabsf(lo.x), fabsf(lo.y), fabsf(lo.z), fabsf(hi.x), fabsf(hi.y), fabsf(hi.z) });
+	float tolerance = std::max(reach, sqrtf((hi.x - lo.x) * (hi.x - lo.x) + (hi.y - lo.y) * (hi.y - lo.y) + (hi.z - lo.z) * (hi.z - lo.z))) * 1e-5f;
+
+	DirectX::XMFLOAT3 boxCenter((lo.x + hi.x) * 0.5f, (lo.y + hi.y) * 0.5f, (lo.z + hi.z) * 0.5f);
+	float boxCenterRadius = 0.0f;
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		const DirectX::XMFLOAT3& p = verts[i].Position;
+		const DirectX::XMFLOAT3& c = bounds.sphereCenter;
+		if (sqrtf((p.x - c.x) * (p.x - c.x) + (p.y - c.y) * (p.y - c.y) + (p.z - c.z) * (p.z - c.z)) > bounds.sphereRadius + tolerance)
+			return problem = "a vertex is outside the sphere", false;
+		boxCenterRadius = std::max(boxCenterRadius,
+			sqrtf((p.x - boxCenter.x) * (p.x - boxCenter.x) + (p.y - boxCenter.y) * (p.y - boxCenter.y) + (p.z - boxCenter.z) * (p.z - boxCenter.z)));
+	}
+	if (bounds.sphereRadius > boxCenterRadius + tolerance)
+		return problem = "sphere is bigger than the box center's", false;
+
+	//unit axes and half sizes; flat boxes have zero length axes, which get
+	//any direction square to the others
+	const OrientedBox& box = bounds.orientedBox;
+	DirectX::XMVECTOR units[3];
+	float halfSizes[3];
+	bool found[3] = {};
+	for (int k = 0; k < 3; k++)
+	{
+		DirectX::XMVECTOR axis = DirectX::XMLoadFloat3(&box.axes[k]);
+		halfSizes[k] = DirectX::XMVectorGetX(DirectX::XMVector3Length(axis));
+		found[k] = halfSizes[k] > 0.0f;
+		units[k] = found[k] ? DirectX::XMVectorScale(axis, 1.0f / halfSizes[k]) : DirectX::XMVectorZero();
+	}
+	for (int k = 0; k < 3; k++)
+	{
+		for (int world = 0; world < 3 && !found[k]; world++)
+		{
+			DirectX::XMVECTOR candidate = DirectX::XMVectorSet(world == 0 ? 1.0f : 0.0f, world == 1 ? 1.0f : 0.0f, world == 2 ? 1.0f : 0.0f, 0.0f);
+			for (int other = 0; other < 3; other++)
+			{
+				if (found[other])
+					candidate = DirectX::XMVectorSubtract(candidate, DirectX::XMVectorScale(units[other], DirectX::XMVectorGetX(DirectX::XMVector3Dot(candidate, units[other]))));
+			}
+			float length = DirectX::XMVectorGetX(DirectX::XMVector3Length(candidate));
+			if (length > 0.5f)
+			{
+				units[k] = DirectX::XMVectorScale(candidate, 1.0f / length);
+				found[k] = true;
+			}
+		}
+	}
+	for (int a = 0; a < 3; a++)
+	{
+		for (int b = a + 1; b < 3; b++)
+		{
+			if (fabsf(DirectX::XMVectorGetX(DirectX::XMVector3Dot(units[a], units[b]))) > 1e-4f)
+				return problem = "oriented box axes aren't square", false;
+		}
+	}
+
+	float nearest[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, farthest[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	DirectX::XMVECTOR center = DirectX::XMLoadFloat3(&box.center);
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		DirectX::XMVECTOR offset = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&verts[i].Position), center);
+		for (int k = 0; k < 3; k++)
+		{
+			float along = DirectX::XMVectorGetX(DirectX::XMVector3Dot(offset, units[k]));
+			nearest[k] = std::min(nearest[k], along);
+			farthest[k] = std::max(farthest[k], along);
+		}
+	}
+	for (int k = 0; k < 3; k++)
+	{
+		if (nearest[k] < -halfSizes[k] - tolerance || farthest[k] > halfSizes[k] + tolerance)
+			return problem = "a vertex is outside the oriented box", false;
+		if (nearest[k] > -halfSizes[k] + tolerance || farthest[k] < halfSizes[k] - tolerance)
+			return problem = "a side of the oriented box doesn't touch any vertex", false;
+	}
+	if (bounds.hasOrientedBox && !(halfSizes[0] * halfSizes[1] * halfSizes[2] * 8.0f < (hi.x - lo.x) * (hi.y - lo.y) * (hi.z - lo.z)))
+		return problem = "oriented box was kept without beating the box", false;
+	return true;
+}
+
+
+// Writes a wavy gridSize x gridSize heightfield as an OBJ with positions,
+// uvs and normals (about 210 bytes of text per grid point), the way scanned
+// and sculpted assets come out of other tools
+bool WriteSyntheticObj(const std::filesystem::path& path, unsigned int gridSize)
+{
+	FILE* file = fopen(path.string().c_str(), "wb");
+	if (!file)
+		return false;
+
+	std::string text;
+	char number[32];
+	auto appendFloat = [&](float value)
+	{
+		text += ' ';
+		text.append(number, std::to_chars(number, number + sizeof(number), value, std::chars_format::fixed, 6).ptr);
+	};
+	auto appendCorner = [&](size_t index)
+	{
+		//same index for position, uv and normal
+		text += ' ';
+		size_t start = text.size();
+		text.append(number, std::to_chars(number, number + sizeof(number), index).ptr);
+		std::string corner = text.substr(start);
+		text += '/';
+		text += corner;
+		text += '/';
+		text += corner;
+	};
+
+	//one row at a time, so the file can be far bigger than memory
+	bool written = true;
+	auto flush = [&]()
+	{
+		written = written && fwrite(text.data(), 1, text.size(), file) == text.size();
+		text.clear();
+	};
+
+	size_t points = (size_t)gridSize + 1;
+	for (size_t z = 0; z < points; z++)
+	{
+		for (size_t x = 0; x < points; x++)
+		{
+			float u = (float)x / gridSize, v = (float)z / gridSize;
+			float height = sinf(u * 40.0f) * cosf(v * 30.0f) * 0.05f;
+			text += 'v'; appendFloat(u * 10.0f - 5.0f); appendFloat(height); appendFloat(v * 10.0f - 5.0f); text += '\n';
+			text += "vt"; appendFloat(u); appendFloat(v); text += '\n';
+			text += "vn"; appendFloat(-cosf(u * 40.0f) * 0.2f); appendFloat(1.0f); appendFloat(sinf(v * 30.0f) * 0.15f); text += '\n';
+		}
+		flush();
+	}
+	for (size_t z = 0; z < gridSize; z++)
+	{
+		for (size_t x = 0; x < gridSize; x++)
+		{
+			size_t corner = z * points + x + 1;
+			text += 'f'; appendCorner(corner); appendCorner(corner + points); appendCorner(corner + 1); text += '\n';
+			text += 'f'; appendCorner(corner + 1); appendCorner(corner + points); appendCorner(corner + points + 1); text += '\n';
+		}
+		flush();
+	}
+
+	written = fclose(file) == 0 && written;
+	return written;
+}
+
+
+// Best of several parses on one thread and on every hardware thread,
+// false if the two results aren't identical
+bool ReportParsing(const char* name, const char* data, size_t size)
+{
+	//at least 4, so the chunks get stitched back together even on small machines
+	unsigned int threadCount = std::max(4u, std::thread::hardware_concurrency());
+	double megabytes = size / 1048576.0;
+
+	//enough runs to get past timer noise on the tiny models
+	int runs = (int)std::clamp(64.0 / std::max(megabytes, 0.001), 3.0, 200.0);
+	auto measure = [&](unsigned int threads, ObjData& out)
+	{
+		double best = 1e30;
+		for (int run = 0; run < runs; run++)
+		{
+			out = ObjData();
+			auto start = std::chrono::high_resolution_clock::now();
+			ObjLoader::ParseBuffer(data, size, out, threads);
+			best = std::min(best, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+		}
+		return best;
+	};
+	ObjData serial, parallel;
+	double serialSeconds = measure(1, serial);
+	double parallelSeconds = measure(threadCount, parallel);
+
+	auto same = [](const auto& a, const auto& b)
+	{
+		return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(a[0])) == 0);
+	};
+	bool matches = same(serial.positions, parallel.positions) && same(serial.uvs, parallel.uvs) &&
+		same(serial.normals, parallel.normals) && same(serial.corners, parallel.corners) &&
+		same(serial.triangleMaterials, parallel.triangleMaterials) && serial.materials == parallel.materials;
+
+	printf("%s: %.2f MB, %zu positions, %zu triangles\n", name, megabytes, serial.positions.size(), serial.corners.size() / 3);
+	printf("  1 thread %.0f MB/s, %u threads %.0f MB/s (%.1fx)%s\n", megabytes / serialSeconds, threadCount,
+		megabytes / parallelSeconds, serialSeconds / parallelSeconds, matches ? "" : ", results differ!");
+	return matches;
+}
+
+
+// Highest resident memory of this process so far, in bytes
+size_t GetPeakMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.PeakWorkingSetSize;
+#else
+	rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+	return (size_t)usage.ru_maxrss * 1024; //kilobytes on Linux
+#endif
+}
+
+
+// Streams a generated OBJ of about sourceBytes through ObjStreamer and checks
+// both the chunks it wrote and how much memory the process needed to do it,
+// false if peak resident memory went over the budget or triangles went missing
+bool ReportStreaming(size_t sourceBytes, size_t memoryBudget)
+{
+	std::filesystem::path directory = std::filesystem::temp_directory_path();
+	std::filesystem::path source = directory / "MeshConverter_stream_check.obj";
+	std::filesystem::path output = directory / "MeshConverter_stream_check.meshchunks";
+
+	//two triangles and around 210 bytes of text per grid point
+	unsigned int gridSize = std::max(1u, (unsigned int)sqrt(sourceBytes / 210.0));
+	auto start = std::chrono::high_resolution_clock::now();
+	if (!WriteSyntheticObj(source, gridSize))
+	{
+		printf("could not write %s\n", source.string().c_str());
+		std::filesystem::remove(source);
+		return false;
+	}
+	double writeSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	double sourceMegabytes = std::filesystem::file_size(source) / 1048576.0;
+
+	//measured before the output is mapped and read back, which is the caller's memory
+	ObjStreamStats stats = ObjStreamer::Import(source.wstring(), output.wstring(), memoryBudget);
+	size_t peakMemory = GetPeakMemory();
+	std::filesystem::remove(source);
+
+	uint64_t expectedTriangles = 2ull * gridSize * gridSize;
+	uint64_t chunkTriangles = 0;
+	bool chunksValid = true;
+	{
+		MeshChunksFile chunks(output.wstring());
+		chunksValid = chunks.IsValid() && chunks.GetHeader().triangleCount == expectedTriangles;
+		for (size_t c = 0; chunksValid && c < chunks.GetHeader().chunkCount; c++)
+		{
+			const MeshChunk& chunk = chunks.GetChunk(c);
+			const unsigned int* indices = chunks.GetIndices(chunk);
+			for (uint32_t i = 0; i < chunk.indexCount; i++)
+				chunksValid = chunksValid && indices[i] < chunk.vertexCount;
+			chunkTriangles += chunk.indexCount / 3;
+		}
+	}
+	std::filesystem::remove(output);
+
+	bool withinBudget = peakMemory <= memoryBudget;
+	bool complete = chunksValid && stats.triangleCount == expectedTriangles && chunkTriangles == expectedTriangles;
+	printf("generated %ux%u grid: %.0f MB written in %.1f s\n", gridSize, gridSize, sourceMegabytes, writeSeconds);
+	printf("  %llu triangles, %llu verts in %zu chunks (%zu position passes)%s\n",
+		(unsigned long long)stats.triangleCount, (unsigned long long)stats.vertexCount, stats.chunkCount, stats.positionWindows,
+		complete ? "" : ", triangles missing or chunks invalid!");
+	printf("  parse %.0f ms, bucket %.0f ms, cook %.0f ms\n", stats.parseMilliseconds, stats.bucketMilliseconds, stats.cookMilliseconds);
+	printf("  peak resident memory %.1f MB of a %.0f MB budget%s\n",
+		peakMemory / 1048576.0, memoryBudget / 1048576.0, withinBudget ? "" : ", over budget!");
+	return withinBudget && complete;
+}
+
+
+// Calls visit(name, generate) for each primitive MeshGenerator makes, at
+// detail segments around, where generate(mesh, cook) builds it; false if
+// any of the visits returned false
+// - Sphere and torus are detail x detail / 2, the cylinder detail x detail / 4
+//   and the cube detail / 4 per side, so a detail of 1024 gives each about
+//   a million triangles, the size real assets come in
+template<typename Visit>
+bool ForEachGeneratedShape(unsigned int detail, Visit visit)
+{
+	char name[64];
+	bool passed = true;
+	snprintf(name, sizeof(name), "sphere %ux%u", detail, detail / 2);
+	passed = visit(name, [=](CookedMesh& mesh, bool cook) { MeshGenerator::Sphere(detail, detail / 2, mesh, cook); }) && passed;
+	snprintf(name, sizeof(name), "torus %ux%u", detail, detail / 2);
+	passed = visit(name, [=](CookedMesh& mesh, bool cook)
+		{
+			MeshGenerator::Torus(detail, detail / 2, GeneratedTorusRadius, GeneratedTorusTubeRadius, mesh, cook);
+		}) && passed;
+	snprintf(name, sizeof(name), "cylinder %ux%u", detail, detail / 4);
+	passed = visit(name, [=](CookedMesh& mesh, bool cook) { MeshGenerator::Cylinder(detail, detail / 4, mesh, cook); }) && passed;
+	snprintf(name, sizeof(name), "cube %u", detail / 4);
+	passed = visit(name, [=](CookedMesh& mesh, bool cook) { MeshGenerator::Cube(detail / 4, mesh, cook); }) && passed;
+	return passed;
+}
+
+// Generates each shape cooked and hands it to check(name, mesh)
+template<typename Check>
+bool CheckGeneratedMeshes(unsigned int detail, Check check)
+{
+	CookedMesh mesh;
+	return ForEachGeneratedShape(detail, [&](const char* name, auto generate)
+		{
+			generate(mesh, true);
+			return check(name, mesh);
+		});
+}
+
+
+// Compression ratio and decode speed of the cache's vertex and index
+// streams, decoding is timed best of several runs
+// - Decoded vertices have to match byte for byte, and triangles the
+//   source ones up to a rotation (see MeshCodec::EncodeIndices)
+// - Cut short, corrupted, or decoded against one vertex fewer than the
+//   indices use, the streams must fail to decode or (corrupted) decode
+//   to indices that are all in range, and never write past the output
+bool ReportCodec(const char* name, const CookedMesh& mesh)
+{
+	const int runs = 10;
+	const int corruptions = 16;
+	const unsigned int guard = 0xCDCDCDCD;
+	std::vector<unsigned char> vertexData, indexData;
+	MeshCodec::EncodeVertices(mesh.vertices.data(), mesh.vertices.size(), sizeof(Vertex), vertexData);
+	MeshCodec::EncodeIndices(mesh.indices.data(), mesh.indices.size(), indexData);
+
+	std::vector<Vertex> vertices(mesh.vertices.size());
+	std::vector<unsigned int> indices(mesh.indices.size());
+	double vertexMs = 0.0, indexMs = 0.0;
+	for (int run = 0; run < runs; run++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		bool vertsOk = MeshCodec::DecodeVertices(vertices.data(), vertices.size(), sizeof(Vertex), vertexData.data(), vertexData.size());
+		auto middle = std::chrono::high_resolution_clock::now();
+		bool indicesOk = MeshCodec::DecodeIndices(indices.data(), indices.size(), vertices.size(), indexData.data(), indexData.size());
+		auto end = std::chrono::high_resolution_clock::now();
+		if (!vertsOk || !indicesOk)
+		{
+			printf("%s: decoding failed\n", name);
+			return false;
+		}
+
+		double v = std::chrono::duration<double, std::milli>(middle - start).count();
+		double i = std::chrono::duration<double, std::milli>(end - middle).count();
+		vertexMs = run == 0 ? v : std::min(vertexMs, v);
+		indexMs = run == 0 ? i : std::min(indexMs, i);
+	}
+
+	//rotate each triangle back to the source's first corner, then the buffers should be identical
+	bool trianglesMatch = true;
+	for (size_t t = 0; t < indices.size() && trianglesMatch; t += 3)
+	{
+		unsigned int* tri = &indices[t];
+		const unsigned int* source = &mesh.indices[t];
+		if (tri[1] == source[0])
+			std::rotate(tri, tri + 1, tri + 3);
+		else if (tri[2] == source[0])
+			std::rotate(tri, tri + 2, tri + 3);
+		trianglesMatch = tri[0] == source[0] && tri[1] == source[1] && tri[2] == source[2];
+	}
+	bool roundTrips = trianglesMatch && (vertices.empty() ||
+		memcmp(vertices.data(), mesh.vertices.data(), vertices.size() * sizeof(Vertex)) == 0) && (indices.empty() ||
+		memcmp(indices.data(), mesh.indices.data(), indices.size() * sizeof(unsigned int)) == 0);
+
+	//one extra entry past each output to catch writes past the end
+	std::vector<unsigned char> damaged;
+	std::vector<unsigned char> vertexBytes((vertices.size() + 1) * sizeof(Vertex));
+	indices.push_back(guard);
+	auto guardsIntact = [&]()
+	{
+		const unsigned char* tail = vertexBytes.data() + vertices.size() * sizeof(Vertex);
+		return std::all_of(tail, tail + sizeof(Vertex), [](unsigned char b) { return b == 0xCD; }) && indices.back() == guard;
+	};
+	auto decodeVertices = [&](const std::vector<unsigned char>& data, size_t size)
+	{
+		memset(vertexBytes.data(), 0xCD, vertexBytes.size());
+		return MeshCodec::DecodeVertices(vertexBytes.data(), vertices.size(), sizeof(Vertex), data.data(), size);
+	};
+	auto decodeIndices = [&](const std::vector<unsigned char>& data, size_t size, size_t vertexCount)
+	{
+		return MeshCodec::DecodeIndices(indices.data(), indices.size() - 1, vertexCount, data.data(), size);
+	};
+
+	//every stream is at least its header byte, so each of these cuts something off
+	bool truncatedFails = true;
+	for (size_t cut : { (size_t)1, (size_t)2, vertexData.size() / 2, vertexData.size() })
+		truncatedFails = truncatedFails && (cut > vertexData.size() || !decodeVertices(vertexData, vertexData.size() - cut));
+	for (size_t cut : { (size_t)1, (size_t)2, indexData.size() / 2, indexData.size() })
+		truncatedFails = truncatedFails && (cut > indexData.size() || !decodeIndices(indexData, indexData.size() - cut, vertices.size()));
+	truncatedFails = truncatedFails && guardsIntact();
+
+	//optimized meshes use every vertex, so the last index is always one too many
+	bool rangeFails = mesh.indices.empty() || !decodeIndices(indexData, indexData.size(), vertices.size() - 1);
+	if (!mesh.indices.empty())
+	{
+		std::vector<unsigned int> outOfRange = mesh.indices;
+		outOfRange[outOfRange.size() / 2] = (unsigned int)vertices.size();
+		std::vector<unsigned char> outOfRangeData;
+		MeshCodec::EncodeIndices(outOfRange.data(), outOfRange.size(), outOfRangeData);
+		rangeFails = rangeFails && !decodeIndices(outOfRangeData, outOfRangeData.size(), vertices.size());
+	}
+	rangeFails = rangeFails && guardsIntact();
+
+	//a flipped bit anywhere, the header byte first
+	std::mt19937 rng(16);
+	bool corruptionHandled = true;
+	for (int c = 0; c < corruptions && corruptionHandled; c++)
+	{
+		damaged = vertexData;
+		damaged[c == 0 ? 0 : rng() % damaged.size()] ^= (unsigned char)(1u << (rng() % 8));
+		bool vertsOk = decodeVertices(damaged, damaged.size());
+
+		damaged = indexData;
+		damaged[c == 0 ? 0 : rng() % damaged.size()] ^= (unsigned char)(1u << (rng() % 8));
+		bool indicesOk = decodeIndices(damaged, damaged.size(), vertices.size());
+		corruptionHandled = guardsIntact() && (c != 0 || (!vertsOk && !indicesOk)) &&
+			(!indicesOk || std::all_of(indices.begin(), indices.end() - 1, [&](unsigned int index) { return index < vertices.size(); }));
+	}
+
+	bool passed = roundTrips && truncatedFails && rangeFails && corruptionHandled;
+	size_t vertexBytesDecoded = vertices.size() * sizeof(Vertex);
+	size_t indexBytesDecoded = (indices.size() - 1) * sizeof(unsigned int);
+	printf("%s: vertices %zu -> %zu bytes (%.2fx), indices %zu -> %zu bytes (%.2fx, %.1f bits/triangle)\n", name,
+		vertexBytesDecoded, vertexData.size(), (double)vertexBytesDecoded / vertexData.size(),
+		indexBytesDecoded, indexData.size(), (double)indexBytesDecoded / indexData.size(), indexData.size() * 8.0 / (mesh.indices.size() / 3));
+	printf("  decode vertices %.2f GB/s, indices %.2f GB/s (of decoded data)%s%s%s%s%s\n",
+		vertexBytesDecoded / 1e9 / (vertexMs / 1000.0), indexBytesDecoded / 1e9 / (indexMs / 1000.0), passed ? "" : " FAILED:",
+		roundTrips ? "" : " decoded data differs", truncatedFails ? "" : " truncated streams decode",
+		rangeFails ? "" : " out of range indices decode", corruptionHandled ? "" : " corrupted streams not caught");
+	return passed;
+}
+
+// Dense generated meshes, the kind of sizes real assets come in
+bool ReportCodecGenerated()
+{
+	return CheckGeneratedMeshes(1024, ReportCodec);
+}
+
+
+// Times MeshGenerator with and without cooking, best of several runs, and
+// checks what it made; false if any triangle faces away from its vertex
+// normals or an analytic tangent is over GeneratedTangentTolerance degrees
+// from the one MeshTools::CalculateTangents gets from the triangles
+bool ReportGenerated(const char* name, const std::function<void(CookedMesh&, bool)>& generate)
+{
+	const int runs = 3;
+	const double GeneratedTangentTolerance = 1.0;
+
+	CookedMesh raw, cooked;
+	double rawMs = 0.0, cookedMs = 0.0;
+	for (int run = 0; run < runs; run++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		generate(raw, false);
+		auto middle = std::chrono::high_resolution_clock::now();
+		generate(cooked, true);
+		auto end = std::chrono::high_resolution_clock::now();
+
+		double r = std::chrono::duration<double, std::milli>(middle - start).count();
+		double c = std::chrono::duration<double, std::milli>(end - middle).count();
+		rawMs = run == 0 ? r : std::min(rawMs, r);
+		cookedMs = run == 0 ? c : std::min(cookedMs, c);
+	}
+
+	//clockwise from the front, so cross(b - a, c - a) points the way the vertex normals do
+	auto backFacing = [](const CookedMesh& mesh)
+	{
+		size_t count = 0;
+		for (size_t t = 0; t < mesh.indices.size(); t += 3)
+		{
+			const Vertex& a = mesh.vertices[mesh.indices[t]];
+			const Vertex& b = mesh.vertices[mesh.indices[t + 1]];
+			const Vertex& c = mesh.vertices[mesh.indices[t + 2]];
+			DirectX::XMVECTOR pa = DirectX::XMLoadFloat3(&a.Position);
+			DirectX::XMVECTOR face = DirectX::XMVector3Cross(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&b.Position), pa),
+				DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&c.Position), pa));
+			DirectX::XMVECTOR normals = DirectX::XMVectorAdd(DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&a.normal),
+				DirectX::XMLoadFloat3(&b.normal)), DirectX::XMLoadFloat3(&c.normal));
+			count += DirectX::XMVectorGetX(DirectX::XMVector3Dot(face, normals)) < 0.0f ? 1 : 0;
+		}
+		return count;
+	};
+	size_t rawBackFacing = backFacing(raw);
+	size_t cookedBackFacing = backFacing(cooked);
+
+	std::vector<Vertex> computed = cooked.vertices;
+	MeshTools::CalculateTangents(computed.data(), computed.size(), cooked.indices.data(), cooked.lods[0].indexCount);
+	double worstTangent = 0.0;
+	for (size_t i = 0; i < computed.size(); i++)
+	{
+		DirectX::XMVECTOR analytic = DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&cooked.vertices[i].tangent));
+		DirectX::XMVECTOR fromTriangles = DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&computed[i].tangent));
+		float cosine = DirectX::XMVectorGetX(DirectX::XMVector3Dot(analytic, fromTriangles));
+		double degrees = std::isnan(cosine) ? 180.0 : acos(std::clamp((double)cosine, -1.0, 1.0)) * 180.0 / 3.14159265358979323846;
+		worstTangent = std::max(worstTangent, degrees);
+	}
+
+	bool passed = rawBackFacing == 0 && cookedBackFacing == 0 && worstTangent <= GeneratedTangentTolerance;
+	double millions = cooked.lods[0].indexCount / 3 / 1e6;
+	printf("%s: %zu verts, %u triangles, %zu LODs, %zu meshlets\n", name, cooked.vertices.size(), cooked.lods[0].indexCount / 3,
+		cooked.lods.size(), cooked.meshlets.size());
+	printf("  %.1f ms per million triangles, %.1f ms cooked\n", rawMs / millions, cookedMs / millions);
+	printf("  %zu triangles (%zu cooked) face away from their normals, tangents up to %.3f degrees from computed ones%s\n",
+		rawBackFacing, cookedBackFacing, worstTangent, passed ? "" : " FAILED");
+	return passed;
+}
+
+bool ReportGeneratedShapes()
+{
+	return ForEachGeneratedShape(1024, ReportGenerated);
+}
+
+
+// VertexFormats::Convert hands Vertex <-> CompactVertex to VertexQuantize, this
+// runs the same vertices through the per-attribute path it takes for every
+// other pair of formats, which has to come out byte for byte the same
+template<CompactPositionFormat PositionFormat>
+bool ConvertsLikeQuantize(const std::vector<Vertex>& verts, const CompactVertexParams& params,
+	const std::vector<CompactVertex>& compact, const std::vector<Vertex>& decoded)
+{
+	typedef CompactVertexFormat<PositionFormat> Format;
+	VertexPositionRange range;
+	range.offset = params.positionOffset;
+	range.scale = params.positionScale;
+
+	std::vector<CompactVertex> encoded(verts.size());
+	std::vector<Vertex> decodedBack(verts.size());
+	VertexFormats::ConvertPerElement<StandardVertexFormat, Format>(verts.data(), verts.size(), encoded.data(), range);
+	VertexFormats::ConvertPerElement<Format, StandardVertexFormat>(compact.data(), compact.size(), decodedBack.data(), range);
+	return verts.empty() || (memcmp(encoded.data(), compact.data(), verts.size() * sizeof(CompactVertex)) == 0 &&
+		memcmp(decodedBack.data(), decoded.data(), verts.size() * sizeof(Vertex)) == 0);
+}
+
+// Round trips vertices through both CompactVertex position formats and checks
+// every component against the bounds in VertexQuantize.h
+bool ReportQuantization(const char* name, const std::vector<Vertex>& verts)
+{
+	size_t count = verts.size();
+	std::vector<CompactVertex> compact(count), compactSingles(count);
+	std::vector<Vertex> decoded(count), decodedSingles(count);
+
+	//angle between two directions, in degrees (atan2 stays accurate near 0)
+	auto degrees = [](const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+	{
+		double cx = (double)a.y * b.z - (double)a.z * b.y, cy = (double)a.z * b.x - (double)a.x * b.z, cz = (double)a.x * b.y - (double)a.y * b.x;
+		double dot = (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z;
+		return atan2(sqrt(cx * cx + cy * cy + cz * cz), dot) * 180.0 / 3.14159265358979323846;
+	};
+	//half floats keep 11 significant bits, below 2^-14 they're subnormal
+	auto halfError = [](float value) { return std::max(fabsf(value) * ldexpf(1.0f, -11), ldexpf(1.0f, -25)); };
+
+	bool passed = true;
+	printf("%s: %zu verts\n", name, count);
+	for (CompactPositionFormat format : { COMPACT_POSITION_UNORM16, COMPACT_POSITION_HALF })
+	{
+		CompactVertexParams params = VertexQuantize::MakeParams(verts.data(), count, format);
+		VertexQuantize::Encode(verts.data(), count, params, compact.data());
+		VertexQuantize::Decode(compact.data(), count, params, decoded.data());
+
+		//one at a time only ever takes the scalar path
+		for (size_t i = 0; i < count; i++)
+		{
+			VertexQuantize::Encode(&verts[i], 1, params, &compactSingles[i]);
+			VertexQuantize::Decode(&compact[i], 1, params, &decodedSingles[i]);
+		}
+		bool simdMatches = count == 0 || (memcmp(compact.data(), compactSingles.data(), count * sizeof(CompactVertex)) == 0 &&
+			memcmp(decoded.data(), decodedSingles.data(), count * sizeof(Vertex)) == 0);
+		bool formatMatches = format == COMPACT_POSITION_UNORM16 ?
+			ConvertsLikeQuantize<COMPACT_POSITION_UNORM16>(verts, params, compact, decoded) :
+			ConvertsLikeQuantize<COMPACT_POSITION_HALF>(verts, params, compact, decoded);
+
+		//errors as a fraction of their bound, anything over 1 fails
+		float worstPosition = 0.0f, worstUv = 0.0f, worstPositionRatio = 0.0f, worstUvRatio = 0.0f;
+		double worstDirection = 0.0;
+		const float* extent = &params.positionScale.x;
+		for (size_t i = 0; i < count; i++)
+		{
+			const float* original = &verts[i].Position.x;
+			const float* result = &decoded[i].Position.x;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float error = fabsf(result[axis] - original[axis]);
+				//half a quantization step, plus float rounding in offset + decoded * scale
+				float bound = format == COMPACT_POSITION_UNORM16 ?
+					extent[axis] / 131070.0f + (fabsf(original[axis]) + extent[axis]) * 1e-6f :
+					halfError(original[axis]);
+				worstPosition = std::max(worstPosition, error);
+				worstPositionRatio = std::max(worstPositionRatio, bound > 0.0f ? error / bound : (error > 0.0f ? 2.0f : 0.0f));
+			}
+			for (int axis = 0; axis < 2; axis++)
+			{
+				float error = fabsf((&decoded[i].uv.x)[axis] - (&verts[i].uv.x)[axis]);
+				worstUv = std::max(worstUv, error);
+				worstUvRatio = std::max(worstUvRatio, error / halfError((&verts[i].uv.x)[axis]));
+			}
+
+			//directions that can't be normalized have nothing to keep
+			const DirectX::XMFLOAT3& n = verts[i].normal;
+			const DirectX::XMFLOAT3& t = verts[i].tangent;
+			if (n.x * n.x + n.y * n.y + n.z * n.z > 1e-12f)
+				worstDirection = std::max(worstDirection, degrees(n, decoded[i].normal));
+			if (t.x * t.x + t.y * t.y + t.z * t.z > 1e-12f)
+				worstDirection = std::max(worstDirection, degrees(t, decoded[i].tangent));
+		}
+
+		bool ok = simdMatches && formatMatches && worstPositionRatio <= 1.0f && worstUvRatio <= 1.0f && worstDirection < 0.005;
+		passed = passed && ok;
+		printf("  %s positions: largest error %.2g (%.0f%% of its bound), uvs %.2g (%.0f%%), normals and tangents %.4f degrees%s%s%s\n",
+			format == COMPACT_POSITION_UNORM16 ? "unorm16" : "half", worstPosition, worstPositionRatio * 100.0f,
+			worstUv, worstUvRatio * 100.0f, worstDirection, simdMatches ? "" : ", SIMD and scalar differ",
+			formatMatches ? "" : ", VertexFormats and VertexQuantize differ", ok ? "" : " FAILED");
+	}
+	return passed;
+}
+
+// Generated meshes, plus random vertices with directions all over the sphere
+bool ReportQuantizationGenerated()
+{
+	bool passed = CheckGeneratedMeshes(256, [](const char* name, const CookedMesh& mesh) { return ReportQuantization(name, mesh.vertices); });
+
+	std::mt19937 rng(5);
+	std::normal_distribution<float> gaussian;
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<Vertex> verts(2000000);
+	for (Vertex& v : verts)
+	{
+		v.Position = DirectX::XMFLOAT3(unit(rng) * 50.0f, unit(rng) * 0.01f, unit(rng) * 1000.0f);
+		v.uv = DirectX::XMFLOAT2(unit(rng) * 4.0f, unit(rng));
+		v.normal = DirectX::XMFLOAT3(gaussian(rng), gaussian(rng), gaussian(rng));
+		v.tangent = DirectX::XMFLOAT3(gaussian(rng), gaussian(rng), gaussian(rng));
+	}
+	passed = ReportQuantization("random", verts) && passed;
+	return passed;
+}
+
+
+// CalculateTangents on one thread and on TangentCheckThreads against the
+// reference version, timing all three
+// - Threads only get used past 32k triangles each, smaller meshes run on
+//   one whatever they're given
+// - Split across threads the per vertex sums are added up in a different
+//   order, so those are compared to a tolerance instead of bit for bit
+bool ReportTangents(const char* name, const std::vector<Vertex>& source, const unsigned int* indices, size_t indexCount)
+{
+	const unsigned int TangentCheckThreads = 8;
+	const float TangentTolerance = 1e-4f;
+
+	std::vector<Vertex> reference = source, serial = source, parallel = source;
+	auto time = [](auto work)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		work();
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	};
+	double referenceMs = time([&]() { MeshTools::CalculateTangentsReference(reference.data(), reference.size(), indices, indexCount); });
+	double serialMs = time([&]() { MeshTools::CalculateTangents(serial.data(), serial.size(), indices, indexCount, 1); });
+	double parallelMs = time([&]() { MeshTools::CalculateTangents(parallel.data(), parallel.size(), indices, indexCount, TangentCheckThreads); });
+
+	size_t serialDifferences = 0;
+	float worstParallel = 0.0f;
+	for (size_t i = 0; i < source.size(); i++)
+	{
+		serialDifferences += memcmp(&serial[i].tangent, &reference[i].tangent, sizeof(DirectX::XMFLOAT3)) != 0 ? 1 : 0;
+
+		//degenerate uvs give NaNs either way
+		const float* a = &parallel[i].tangent.x;
+		const float* b = &reference[i].tangent.x;
+		for (int k = 0; k < 3; k++)
+			if (!(std::isnan(a[k]) && std::isnan(b[k])))
+				worstParallel = std::max(worstParallel, std::isnan(a[k]) || std::isnan(b[k]) ? INFINITY : fabsf(a[k] - b[k]));
+	}
+
+	bool passed = serialDifferences == 0 && worstParallel <= TangentTolerance;
+	printf("%s: %zu verts, %zu triangles\n", name, source.size(), indexCount / 3);
+	printf("  reference %.2f ms, 1 thread %.2f ms (%zu tangents differ), %u threads %.2f ms (largest difference %.2g)%s\n",
+		referenceMs, serialMs, serialDifferences, TangentCheckThreads, parallelMs, worstParallel, passed ? "" : " FAILED");
+	return passed;
+}
+
+// A 2M triangle grid with wavy uvs, and random triangles with random uvs
+// (lots of shared vertices, nothing smooth)
+bool ReportTangentsGenerated()
+{
+	bool passed = true;
+	const unsigned int GridSize = 1000;
+	std::vector<Vertex> gridVerts;
+	std::vector<unsigned int> gridIndices;
+	for (unsigned int z = 0; z <= GridSize; z++)
+	{
+		for (unsigned int x = 0; x <= GridSize; x++)
+		{
+			float u = (float)x / GridSize, v = (float)z / GridSize;
+			Vertex vertex = {};
+			vertex.Position = DirectX::XMFLOAT3(u * 10.0f - 5.0f, 0.0f, v * 10.0f - 5.0f);
+			vertex.uv = DirectX::XMFLOAT2(u + sinf(v * 20.0f) * 0.01f, v);
+			vertex.normal = DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
+			gridVerts.push_back(vertex);
+		}
+	}
+	for (unsigned int z = 0; z < GridSize; z++)
+	{
+		for (unsigned int x = 0; x < GridSize; x++)
+		{
+			unsigned int corner = z * (GridSize + 1) + x;
+			gridIndices.insert(gridIndices.end(), { corner, corner + GridSize + 1, corner + 1, corner + 1, corner + GridSize + 1, corner + GridSize + 2 });
+		}
+	}
+	passed = ReportTangents("grid 1000x1000", gridVerts, gridIndices.data(), gridIndices.size()) && passed;
+
+	std::mt19937 rng(8);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<Vertex> verts(30000);
+	for (Vertex& v : verts)
+	{
+		v.Position = DirectX::XMFLOAT3(unit(rng), unit(rng), unit(rng));
+		v.uv = DirectX::XMFLOAT2(unit(rng), unit(rng));
+		DirectX::XMStoreFloat3(&v.normal, DirectX::XMVector3Normalize(DirectX::XMVectorSet(unit(rng), unit(rng), unit(rng), 0.0f)));
+	}
+	std::vector<unsigned int> indices(300000 * 3);
+	for (unsigned int& index : indices)
+		index = (unsigned int)(rng() % verts.size());
+	passed = ReportTangents("random 300k triangles", verts, indices.data(), indices.size()) && passed;
+	return passed;
+}
+
+
+// MeshBounds with and without the oriented box, checked by CheckBounds,
+// and how much tighter than the axis aligned box each volume comes out
+bool ReportBounds(const char* name, const std::vector<Vertex>& verts)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	BoundingVolumes bounds = MeshBounds::Calculate(verts.data(), verts.size(), true);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	BoundingVolumes boxOnly = MeshBounds::Calculate(verts.data(), verts.size(), false);
+
+	const char* problem = nullptr;
+	const char* boxOnlyProblem = nullptr;
+	bool passed = CheckBounds(verts.data(), verts.size(), bounds, problem) &&
+		CheckBounds(verts.data(), verts.size(), boxOnly, boxOnlyProblem) && !boxOnly.hasOrientedBox;
+	if (!problem)
+		problem = boxOnlyProblem ? boxOnlyProblem : "oriented box fitted when it wasn't asked for";
+
+	float boxVolume = (bounds.boxMax.x - bounds.boxMin.x) * (bounds.boxMax.y - bounds.boxMin.y) * (bounds.boxMax.z - bounds.boxMin.z);
+	float sphereVolume = 4.0f / 3.0f * DirectX::XM_PI * bounds.sphereRadius * bounds.sphereRadius * bounds.sphereRadius;
+	const DirectX::XMFLOAT3* axes = bounds.orientedBox.axes;
+	float orientedVolume = 8.0f * sqrtf(axes[0].x * axes[0].x + axes[0].y * axes[0].y + axes[0].z * axes[0].z) *
+		sqrtf(axes[1].x * axes[1].x + axes[1].y * axes[1].y + axes[1].z * axes[1].z) * sqrtf(axes[2].x * axes[2].x + axes[2].y * axes[2].y + axes[2].z * axes[2].z);
+	printf("%s: %zu verts, %.2f ms, sphere %.0f%% of the box's volume, oriented box %s%.0f%%%s%s\n", name, verts.size(), ms,
+		boxVolume > 0.0f ? sphereVolume / boxVolume * 100.0f : 0.0f, bounds.hasOrientedBox ? "" : "(not kept) ",
+		boxVolume > 0.0f ? orientedVolume / boxVolume * 100.0f : 0.0f, passed ? "" : ", FAILED: ", passed ? "" : problem);
+	return passed;
+}
+
+// Generated meshes, random points in a rotated and stretched box (a count
+// that leaves an SSE tail), a tilted flat grid, and meshes too small for
+// a single SSE step
+bool ReportBoundsGenerated()
+{
+	bool passed = CheckGeneratedMeshes(256, [](const char* name, const CookedMesh& mesh) { return ReportBounds(name, mesh.vertices); });
+
+	std::mt19937 rng(19);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	DirectX::XMMATRIX rotation = DirectX::XMMatrixRotationRollPitchYaw(0.3f, 0.8f, -0.5f);
+	auto place = [&](float x, float y, float z)
+	{
+		DirectX::XMFLOAT3 p;
+		DirectX::XMStoreFloat3(&p, DirectX::XMVectorAdd(DirectX::XMVector3TransformNormal(DirectX::XMVectorSet(x, y, z, 0.0f), rotation),
+			DirectX::XMVectorSet(100.0f, -20.0f, 5.0f, 0.0f)));
+		return p;
+	};
+	std::vector<Vertex> verts(1000003);
+	for (Vertex& v : verts)
+		v.Position = place(unit(rng) * 10.0f, unit(rng) * 2.0f, unit(rng) * 0.5f);
+	passed = ReportBounds("random 1M", verts) && passed;
+
+	verts.clear();
+	for (int z = 0; z <= 50; z++)
+	{
+		for (int x = 0; x <= 50; x++)
+		{
+			Vertex v = {};
+			v.Position = place(x * 0.1f, 0.0f, z * 0.2f);
+			verts.push_back(v);
+		}
+	}
+	passed = ReportBounds("tilted flat grid", verts) && passed;
+
+	for (size_t count = 1; count <= 7; count++)
+	{
+		verts.resize(count);
+		for (Vertex& v : verts)
+			v.Position = place(unit(rng), unit(rng), unit(rng));
+		char name[32];
+		snprintf(name, sizeof(name), "random %zu", count);
+		passed = ReportBounds(name, verts) && passed;
+	}
+	return passed;
+}
+
+
+// Moller-Trumbore with the same steps as MeshBvh, either side counts
+bool RayHitsTriangle(const BvhRay& ray, const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b, const DirectX::XMFLOAT3& c,
+	float& distance, float& u, float& v)
+{
+	const DirectX::XMFLOAT3& d = ray.direction;
+	float e1x = b.x - a.x, e1y = b.y - a.y, e1z = b.z - a.z;
+	float e2x = c.x - a.x, e2y = c.y - a.y, e2z = c.z - a.z;
+	float px = d.y * e2z - d.z * e2y, py = d.z * e2x - d.x * e2z, pz = d.x * e2y - d.y * e2x;
+	float det = e1x * px + e1y * py + e1z * pz;
+	if (det == 0.0f)
+		return false;
+
+	float inverseDet = 1.0f / det;
+	float sx = ray.origin.x - a.x, sy = ray.origin.y - a.y, sz = ray.origin.z - a.z;
+	u = (sx * px + sy * py + sz * pz) * inverseDet;
+	if (u < 0.0f || u > 1.0f)
+		return false;
+
+	float qx = sy * e1z - sz * e1y, qy = sz * e1x - sx * e1z, qz = sx * e1y - sy * e1x;
+	v = (d.x * qx + d.y * qy + d.z * qz) * inverseDet;
+	if (v < 0.0f || u + v > 1.0f)
+		return false;
+
+	distance = (e2x * qx + e2y * qy + e2z * qz) * inverseDet;
+	return distance >= 0.0f && distance < ray.maxDistance;
+}
+
+// Distance from point to triangle abc, in doubles, from whichever of the
+// face, edges or corners is closest (the region tests from Real-Time
+// Collision Detection)
+double TriangleDistance(const DirectX::XMFLOAT3& point, const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b, const DirectX::XMFLOAT3& c)
+{
+	struct Vector { double x, y, z; };
+	auto sub = [](const Vector& u, const Vector& v) { return Vector{ u.x - v.x, u.y - v.y, u.z - v.z }; };
+	auto dot = [](const Vector& u, const Vector& v) { return u.x * v.x + u.y * v.y + u.z * v.z; };
+	auto along = [](const Vector& u, const Vector& v, double t) { return Vector{ u.x + v.x * t, u.y + v.y * t, u.z + v.z * t }; };
+
+	Vector p = { point.x, point.y, point.z }, pa = { a.x, a.y, a.z }, pb = { b.x, b.y, b.z }, pc = { c.x, c.y, c.z };
+	Vector ab = sub(pb, pa), ac = sub(pc, pa);
+	double d1 = dot(ab, sub(p, pa)), d2 = dot(ac, sub(p, pa));
+	double d3 = dot(ab, sub(p, pb)), d4 = dot(ac, sub(p, pb));
+	double d5 = dot(ab, sub(p, pc)), d6 = dot(ac, sub(p, pc));
+	double vc = d1 * d4 - d3 * d2, vb = d5 * d2 - d1 * d6, va = d3 * d6 - d5 * d4;
+
+	Vector closest;
+	if (d1 <= 0.0 && d2 <= 0.0)
+		closest = pa;
+	else if (d3 >= 0.0 && d4 <= d3)
+		closest = pb;
+	else if (d6 >= 0.0 && d5 <= d6)
+		closest = pc;
+	else if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+		closest = along(pa, ab, d1 / (d1 - d3));
+	else if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+		closest = along(pa, ac, d2 / (d2 - d6));
+	else if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0)
+		closest = along(pb, sub(pc, pb), (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	else
+		closest = along(along(pa, ab, vb / (va + vb + vc)), ac, vc / (va + vb + vc));
+
+	Vector offset = sub(p, closest);
+	return sqrt(dot(offset, offset));
+}
+
+
+// Bakes LOD0 into a dense and a sparse distance volume, and checks a spread
+// of samples from both against every triangle
+// - Stored samples have to be within half a voxel of the distance to the
+//   closest triangle, and a sparse volume's empty bricks can't claim the
+//   surface is more than half a voxel farther away than it is
+// - Closed meshes have their signs checked too, a sample being inside if
+//   rays out of it cross an odd number of triangles (majority of three, in
+//   case one goes through an edge); open ones only compare distances
+bool ReportSdf(const char* name, const CookedMesh& mesh, unsigned int resolution)
+{
+	const size_t SdfCheckSamples = 16384;
+
+	SdfBakeSettings settings;
+	settings.resolution = resolution;
+
+	SdfVolume dense, sparse;
+	SdfBakeStats denseStats = MeshSdf::Bake(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.lods[0].indexCount, settings, dense);
+	settings.sparse = true;
+	SdfBakeStats sparseStats = MeshSdf::Bake(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.lods[0].indexCount, settings, sparse);
+
+	printf("%s: %zu triangles, %ux%ux%u samples\n", name, denseStats.triangleCount, dense.size[0], dense.size[1], dense.size[2]);
+	printf("  BVH %.2f ms, %.1f KB\n", denseStats.bvhMilliseconds, denseStats.bvhBytes / 1024.0);
+	printf("  dense %.1f ms, %.2f MB\n", denseStats.bakeMilliseconds, denseStats.volumeBytes / 1048576.0);
+	printf("  sparse (%.0f sample band) %.1f ms, %zu of %zu bricks, %.2f MB\n", settings.narrowBand,
+		sparseStats.bakeMilliseconds, sparseStats.storedBricks, sparseStats.brickCount, sparseStats.volumeBytes / 1048576.0);
+
+	//welded like the baker does it, closed if every edge is used once each way
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<unsigned int> triangles;
+	MeshTools::BuildPositionStream(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.lods[0].indexCount, positions, triangles);
+	std::unordered_map<uint64_t, int> edges;
+	for (size_t t = 0; t < triangles.size(); t += 3)
+		for (int e = 0; e < 3; e++)
+			edges[(uint64_t)triangles[t + e] << 32 | triangles[t + (e + 1) % 3]]++;
+	bool closed = !triangles.empty() && std::all_of(edges.begin(), edges.end(), [&](const std::pair<const uint64_t, int>& edge)
+		{
+			auto reverse = edges.find(edge.first << 32 | edge.first >> 32);
+			return edge.second == 1 && reverse != edges.end() && reverse->second == 1;
+		});
+
+	auto crossings = [&](const DirectX::XMFLOAT3& point, const DirectX::XMFLOAT3& direction)
+	{
+		BvhRay ray = { point, direction, FLT_MAX };
+		size_t count = 0;
+		float distance, u, v;
+		for (size_t t = 0; t < triangles.size(); t += 3)
+			count += RayHitsTriangle(ray, positions[triangles[t]], positions[triangles[t + 1]], positions[triangles[t + 2]], distance, u, v) ? 1 : 0;
+		return count;
+	};
+
+	//every sample if there aren't many, otherwise a random spread of them
+	size_t sampleCount = (size_t)dense.size[0] * dense.size[1] * dense.size[2];
+	size_t checks = std::min(sampleCount, SdfCheckSamples);
+	std::mt19937 rng(18);
+	float worstDense = 0.0f, worstSparse = 0.0f;
+	size_t insideSamples = 0, wrongSigns = 0;
+	for (size_t i = 0; i < checks; i++)
+	{
+		size_t sample = checks == sampleCount ? i : rng() % sampleCount;
+		unsigned int x = (unsigned int)(sample % dense.size[0]);
+		unsigned int y = (unsigned int)(sample / dense.size[0] % dense.size[1]);
+		unsigned int z = (unsigned int)(sample / dense.size[0] / dense.size[1]);
+		DirectX::XMFLOAT3 point(dense.origin.x + x * dense.voxelSize, dense.origin.y + y * dense.voxelSize, dense.origin.z + z * dense.voxelSize);
+
+		double closest = DBL_MAX;
+		for (size_t t = 0; t < triangles.size(); t += 3)
+			closest = std::min(closest, TriangleDistance(point, positions[triangles[t]], positions[triangles[t + 1]], positions[triangles[t + 2]]));
+
+		bool inside = false;
+		if (closed)
+		{
+			int odd = (int)(crossings(point, DirectX::XMFLOAT3(0.31f, 0.77f, 0.56f)) % 2) +
+				(int)(crossings(point, DirectX::XMFLOAT3(-0.62f, 0.23f, -0.75f)) % 2) +
+				(int)(crossings(point, DirectX::XMFLOAT3(0.44f, -0.81f, 0.38f)) % 2);
+			inside = odd >= 2;
+			insideSamples += inside ? 1 : 0;
+		}
+		float expected = (float)(inside ? -closest : closest);
+
+		//right on the surface either sign will do
+		float denseValue = MeshSdf::GetSample(dense, x, y, z);
+		float sparseValue = MeshSdf::GetSample(sparse, x, y, z);
+		bool signKnown = closed && closest > dense.voxelSize * 1e-3;
+		wrongSigns += signKnown && (denseValue < 0.0f) != inside ? 1 : 0;
+		wrongSigns += signKnown && (sparseValue < 0.0f) != inside ? 1 : 0;
+		worstDense = std::max(worstDense, closed ? fabsf(denseValue - expected) : fabsf(fabsf(denseValue) - (float)closest));
+
+		size_t brick = ((size_t)(z / SdfBrickSize) * sparse.bricks[1] + y / SdfBrickSize) * sparse.bricks[0] + x / SdfBrickSize;
+		if (sparse.brickOffsets[brick] != SdfEmptyBrick)
+			worstSparse = std::max(worstSparse, closed ? fabsf(sparseValue - expected) : fabsf(fabsf(sparseValue) - (float)closest));
+		else
+			worstSparse = std::max(worstSparse, fabsf(sparseValue) - (float)closest);
+	}
+
+	float tolerance = dense.voxelSize * 0.5f;
+	bool passed = worstDense <= tolerance && worstSparse <= tolerance && wrongSigns == 0;
+	printf("  %zu samples checked against every triangle (%s), largest error %.3f voxels dense, %.3f sparse%s\n", checks,
+		closed ? "closed" : "open, distances only", worstDense / dense.voxelSize, worstSparse / dense.voxelSize, passed ? "" : " FAILED");
+	if (closed)
+		printf("  %zu inside, %zu signs wrong\n", insideSamples, wrongSigns);
+	return passed;
+}
+
+
+// Builds a BVH over LOD0 and times ray queries against it
+// - Camera rays: one per pixel of a 512x512 view of the whole mesh,
+//   packets are 2x2 pixel quads
+// - Random rays: between random points around and inside the bounds,
+//   packets are four unrelated rays
+// - A spread of packets from each set goes through Intersect and
+//   IntersectPacket and against every triangle; false if any of them
+//   miss, hit something else or hit at another distance
+bool ReportRays(const char* name, const CookedMesh& mesh)
+{
+	std::vector<DirectX::XMFLOAT3> positions(mesh.vertices.size());
+	for (size_t i = 0; i < positions.size(); i++)
+		positions[i] = mesh.vertices[i].Position;
+	unsigned int indexCount = mesh.lods[0].indexCount;
+
+	MeshBvh serial(positions.data(), positions.size(), mesh.indices.data(), indexCount, 1);
+	MeshBvh bvh(positions.data(), positions.size(), mesh.indices.data(), indexCount);
+	printf("%s: %u triangles, %zu nodes, %.1f MB\n", name, indexCount / 3, bvh.GetNodes().size(), bvh.GetMemoryBytes() / 1048576.0);
+	printf("  build %.1f ms on 1 thread, %.1f ms on %u\n", serial.GetBuildMilliseconds(), bvh.GetBuildMilliseconds(), std::max(1u, std::thread::hardware_concurrency()));
+
+	DirectX::XMFLOAT3 boundsMin, boundsMax;
+	MeshTools::CalculateBounds(mesh.vertices.data(), mesh.vertices.size(), boundsMin, boundsMax);
+	DirectX::XMFLOAT3 center((boundsMin.x + boundsMax.x) * 0.5f, (boundsMin.y + boundsMax.y) * 0.5f, (boundsMin.z + boundsMax.z) * 0.5f);
+	float radius = 0.5f * sqrtf((boundsMax.x - boundsMin.x) * (boundsMax.x - boundsMin.x) +
+		(boundsMax.y - boundsMin.y) * (boundsMax.y - boundsMin.y) + (boundsMax.z - boundsMin.z) * (boundsMax.z - boundsMin.z));
+
+	const unsigned int ViewSize = 512;
+	std::vector<BvhRay> cameraRays;
+	//looking at the center from slightly above, about 40 degrees wide
+	DirectX::XMFLOAT3 eye(center.x, center.y + radius, center.z - radius * 2.5f);
+	float forwardLength = sqrtf(radius * radius + radius * 2.5f * radius * 2.5f);
+	DirectX::XMFLOAT3 forward(0.0f, -radius / forwardLength, radius * 2.5f / forwardLength);
+	DirectX::XMFLOAT3 up(0.0f, forward.z, -forward.y);
+	for (unsigned int y = 0; y < ViewSize; y += 2)
+	{
+		for (unsigned int x = 0; x < ViewSize; x += 2)
+		{
+			//2x2 quads next to each other, so packets are neighbouring pixels
+			for (unsigned int quad = 0; quad < 4; quad++)
+			{
+				float px = ((x + (quad & 1)) + 0.5f) / ViewSize * 2.0f - 1.0f;
+				float py = ((y + (quad >> 1)) + 0.5f) / ViewSize * 2.0f - 1.0f;
+				BvhRay ray;
+				ray.origin = eye;
+				ray.direction = DirectX::XMFLOAT3(
+					px * 0.36f,
+					forward.y - up.y * py * 0.36f,
+					forward.z - up.z * py * 0.36f);
+				ray.maxDistance = FLT_MAX;
+				cameraRays.push_back(ray);
+			}
+		}
+	}
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	auto randomInBall = [&](float r)
+	{
+		DirectX::XMFLOAT3 p;
+		do
+			p = DirectX::XMFLOAT3(unit(rng), unit(rng), unit(rng));
+		while (p.x * p.x + p.y * p.y + p.z * p.z > 1.0f);
+		return DirectX::XMFLOAT3(center.x + p.x * r, center.y + p.y * r, center.z + p.z * r);
+	};
+	std::vector<BvhRay> randomRays(cameraRays.size());
+	for (BvhRay& ray : randomRays)
+	{
+		ray.origin = randomInBall(radius * 2.0f);
+		DirectX::XMFLOAT3 target = randomInBall(radius);
+		ray.direction = DirectX::XMFLOAT3(target.x - ray.origin.x, target.y - ray.origin.y, target.z - ray.origin.z);
+		ray.maxDistance = FLT_MAX;
+	}
+
+	//testing every triangle, in index order, the way the BVH is checked against
+	auto intersectAll = [&](const BvhRay& ray, BvhRayHit& hit)
+	{
+		BvhRay closer = ray;
+		bool found = false;
+		for (unsigned int i = 0; i < indexCount; i += 3)
+		{
+			float distance, u, v;
+			if (RayHitsTriangle(closer, positions[mesh.indices[i]], positions[mesh.indices[i + 1]], positions[mesh.indices[i + 2]], distance, u, v))
+			{
+				closer.maxDistance = distance;
+				found = true;
+				hit = { distance, i / 3, u, v };
+			}
+		}
+		return found;
+	};
+
+	//a ray through an edge, or through doubled up triangles, can pick either
+	//triangle, so the BVH's one only has to be hit exactly as close
+	size_t checkedRays = 0, mismatches = 0;
+	auto check = [&](const std::vector<BvhRay>& rays)
+	{
+		const size_t checkedPackets = 64;
+		for (size_t packet = 0; packet < checkedPackets; packet++)
+		{
+			size_t first = rays.size() / 4 * packet / checkedPackets * 4;
+			BvhRayHit packetHits[4];
+			unsigned int packetFound = bvh.IntersectPacket(&rays[first], packetHits);
+			for (size_t lane = 0; lane < 4; lane++)
+			{
+				const BvhRay& ray = rays[first + lane];
+				BvhRayHit expected = {}, single = {};
+				bool expectedFound = intersectAll(ray, expected);
+				auto matches = [&](bool found, const BvhRayHit& hit)
+				{
+					if (!found || !expectedFound || hit.triangle >= indexCount / 3)
+						return found == expectedFound;
+					const unsigned int* tri = &mesh.indices[hit.triangle * 3];
+					float distance, u, v;
+					return RayHitsTriangle(ray, positions[tri[0]], positions[tri[1]], positions[tri[2]], distance, u, v) &&
+						distance == expected.distance && hit.distance == expected.distance;
+				};
+				mismatches += matches(bvh.Intersect(ray, single), single) ? 0 : 1;
+				mismatches += matches((packetFound >> lane) & 1, packetHits[lane]) ? 0 : 1;
+				checkedRays++;
+			}
+		}
+	};
+	check(cameraRays);
+	check(randomRays);
+	printf("  %zu rays checked against every triangle, %zu single or packet hits disagree%s\n",
+		checkedRays, mismatches, mismatches == 0 ? "" : "!");
+
+	std::vector<BvhRayHit> hits(cameraRays.size());
+	auto measure = [&](const char* label, const std::vector<BvhRay>& rays)
+	{
+		double singleBest = 1e30, packetBest = 1e30;
+		size_t singleHits = 0, packetHits = 0;
+		for (int run = 0; run < 3; run++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			singleHits = 0;
+			for (size_t i = 0; i < rays.size(); i++)
+				singleHits += bvh.Intersect(rays[i], hits[i]) ? 1 : 0;
+			singleBest = std::min(singleBest, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+
+			start = std::chrono::high_resolution_clock::now();
+			packetHits = 0;
+			for (size_t i = 0; i + 4 <= rays.size(); i += 4)
+			{
+				unsigned int found = bvh.IntersectPacket(&rays[i], &hits[i]);
+				packetHits += (found & 1) + ((found >> 1) & 1) + ((found >> 2) & 1) + ((found >> 3) & 1);
+			}
+			packetBest = std::min(packetBest, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+		}
+		printf("  %s rays: %.2f Mrays/s single, %.2f Mrays/s packets, %.0f%% hit%s\n", label,
+			rays.size() / singleBest / 1e6, rays.size() / packetBest / 1e6, 100.0 * singleHits / rays.size(),
+			singleHits == packetHits ? "" : " (packets disagree!)");
+	};
+	measure("camera", cameraRays);
+	measure("random", randomRays);
+	return mismatches == 0;
+}
+
+
+bool ReportRaysGenerated()
+{
+	return CheckGeneratedMeshes(1024, ReportRays);
+}
+
+
+// Imports a .glb and cooks every mesh in it, timing both
+bool ReportGlb(const char* name, const std::wstring& source)
+{
+	MappedFile glb(source);
+	if (!glb.IsOpen())
+	{
+		printf("%s: could not open file\n", name);
+		return false;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	GlbScene scene;
+	GlbLoader::ParseBuffer(glb.GetData(), glb.GetSize(), scene);
+	double importMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	size_t triangles = 0;
+	for (const CookedMesh& mesh : scene.meshes)
+		triangles += mesh.indices.size() / 3;
+	printf("%s: %zu meshes, %zu nodes, %zu triangles\n", name, scene.meshes.size(), scene.nodes.size(), triangles);
+	printf("  import %.2f ms (%.0f MB/s)\n", importMs, glb.GetSize() / 1048576.0 / (importMs / 1000.0));
+
+	for (size_t m = 0; m < scene.meshes.size(); m++)
+	{
+		CookedMesh& mesh = scene.meshes[m];
+		MeshCookStats stats = MeshCache::Cook(mesh, !scene.meshHasTangents[m]);
+		printf("  mesh \"%s\": %zu verts, %u triangles, %zu subsets, %zu meshlets, %zu LODs (%.2f ms simplifying)%s\n",
+			scene.meshNames[m].c_str(), mesh.vertices.size(), mesh.lods[0].indexCount / 3, mesh.subsets.size(),
+			mesh.meshlets.size(), mesh.lods.size(), stats.lodMilliseconds, scene.meshHasTangents[m] ? ", own tangents" : "");
+	}
+	return true;
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (argc >= 2 && strcmp(argv[1], "--parse-bench") == 0)
+	{
+		int failures = 0;
+		for (int i = 2; i < argc; i++)
+		{
+			MappedFile obj(std::filesystem::path(argv[i]).wstring());
+			if (!obj.IsOpen())
+			{
+				printf("%s: could not open file\n", argv[i]);
+				failures++;
+				continue;
+			}
+			failures += ReportParsing(argv[i], obj.GetData(), obj.GetSize()) ? 0 : 1;
+		}
+
+		//around 200 MB, big enough that every thread gets several chunks
+		std::filesystem::path synthetic = std::filesystem::temp_directory_path() / "MeshConverter_parse_bench.obj";
+		if (!WriteSyntheticObj(synthetic, 1000))
+		{
+			printf("could not write %s\n", synthetic.string().c_str());
+			return 1;
+		}
+		{
+			MappedFile obj(synthetic.wstring());
+			failures += obj.IsOpen() && ReportParsing("generated 1000x1000 grid", obj.GetData(), obj.GetSize()) ? 0 : 1;
+		}
+		std::filesystem::remove(synthetic);
+		return failures == 0 ? 0 : 1;
+	}
+
+	if (argc >= 2 && argc <= 4 && strcmp(argv[1], "--stream-check") == 0)
+	{
+		size_t sourceBytes = (size_t)(argc > 2 ? strtoull(argv[2], nullptr, 10) : 4096) << 20;
+		size_t memoryBudget = (size_t)(argc > 3 ? strtoull(argv[3], nullptr, 10) : 256) << 20;
+		if (sourceBytes > 0 && memoryBudget > 0)
+			return ReportStreaming(sourceBytes, memoryBudget) ? 0 : 1;
+	}
+
+	if (argc == 2 && strcmp(argv[1], "--codec") == 0)
+		return ReportCodecGenerated() ? 0 : 1;
+
+	if (argc == 2 && strcmp(argv[1], "--generate") == 0)
+		return ReportGeneratedShapes() ? 0 : 1;
+
+	if (argc >= 2 && strcmp(argv[1], "--quantize") == 0)
+	{
+		bool passed = true;
+		for (int i = 2; i < argc; i++)
+		{
+			MappedFile obj(std::filesystem::path(argv[i]).wstring());
+			if (!obj.IsOpen())
+			{
+				printf("%s: could not open file\n", argv[i]);
+				passed = false;
+				continue;
+			}
+			CookedMesh mesh;
+			MeshCache::CookObj(obj.GetData(), obj.GetSize(), mesh);
+			passed = ReportQuantization(argv[i], mesh.vertices) && passed;
+		}
+		if (argc == 2)
+			passed = ReportQuantizationGenerated();
+		return passed ? 0 : 1;
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "--tangents") == 0)
+	{
+		bool passed = true;
+		for (int i = 2; i < argc; i++)
+		{
+			MappedFile obj(std::filesystem::path(argv[i]).wstring());
+			if (!obj.IsOpen())
+			{
+				printf("%s: could not open file\n", argv[i]);
+				passed = false;
+				continue;
+			}
+			CookedMesh mesh;
+			MeshCache::CookObj(obj.GetData(), obj.GetSize(), mesh);
+			passed = ReportTangents(argv[i], mesh.vertices, mesh.indices.data(), mesh.lods[0].indexCount) && passed;
+		}
+		if (argc == 2)
+			passed = ReportTangentsGenerated();
+		return passed ? 0 : 1;
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "--bounds") == 0)
+	{
+		bool passed = true;
+		for (int i = 2; i < argc; i++)
+		{
+			MappedFile obj(std::filesystem::path(argv[i]).wstring());
+			if (!obj.IsOpen())
+			{
+				printf("%s: could not open file\n", argv[i]);
+				passed = false;
+				continue;
+			}
+			CookedMesh mesh;
+			MeshCache::CookObj(obj.GetData(), obj.GetSize(), mesh);
+			passed = ReportBounds(argv[i], mesh.vertices) && passed;
+		}
+		if (argc == 2)
+			passed = ReportBoundsGenerated();
+		return passed ? 0 : 1;
+	}
+
+	if (argc == 2 && strcmp(argv[1], "--rays") == 0)
+		return ReportRaysGenerated() ? 0 : 1;
+
+	int first = 1;
+	size_t streamBudget = 0;
+	unsigned int sdfResolution = 0;
+	bool rays = false;
+	if (argc > 2 && strcmp(argv[1], "--stream") == 0)
+	{
+		streamBudget = (size_t)strtoull(argv[2], nullptr, 10) << 20;
+		first = 3;
+	}
+	else if (argc > 2 && strcmp(argv[1], "--sdf") == 0)
+	{
+		sdfResolution = (unsigned int)strtoul(argv[2], nullptr, 10);
+		first = 3;
+	}
+	else if (argc > 2 && strcmp(argv[1], "--rays") == 0)
+	{
+		rays = true;
+		first = 2;
+	}
+
+	if (argc <= first || (first == 3 && streamBudget == 0 && sdfResolution == 0))
+	{
+		printf("Usage: MeshConverter [--stream <megabytes>] <model.obj> [more.obj ...]\n");
+		printf("       MeshConverter <model.glb> [more.glb ...]\n");
+		printf("       MeshConverter --parse-bench [model.obj ...]\n");
+		printf("       MeshConverter --stream-check [megabytes] [budget megabytes]\n");
+		printf("       MeshConverter --codec\n");
+		printf("       MeshConverter --generate\n");
+		printf("       MeshConverter --quantize [model.obj ...]\n");
+		printf("       MeshConverter --tangents [model.obj ...]\n");
+		printf("       MeshConverter --sdf <resolution> <model.obj> [more.obj ...]\n");
+		printf("       MeshConverter --bounds [model.obj ...]\n");
+		printf("       MeshConverter --rays [model.obj ...]\n");
+		return 1;
+	}
+
+	int failures = 0;
+	for (int i = first; i < argc; i++)
+	{
+		std::wstring source = std::filesystem::path(argv[i]).wstring();
+		if (std::filesystem::path(argv[i]).extension() == ".glb")
+		{
+			if (!ReportGlb(argv[i], source))
+				failures++;
+			continue;
+		}
+
+		if (streamBudget > 0)
+		{
+			ObjStreamStats stats = ObjStreamer::Import(source, ObjStreamer::GetChunksPath(source), streamBudget);
+			printf("%s: %llu triangles, %llu verts in %zu chunks (%zu position passes)\n",
+				argv[i], (unsigned long long)stats.triangleCount, (unsigned long long)stats.vertexCount, stats.chunkCount, stats.positionWindows);
+			printf("  parse %.0f ms, bucket %.0f ms, cook %.0f ms\n",
+				stats.parseMilliseconds, stats.bucketMilliseconds, stats.cookMilliseconds);
+			continue;
+		}
+
+		MappedFile obj(source);
+		if (!obj.IsOpen())
+		{
+			printf("%s: could not open file\n", argv[i]);
+			failures++;
+			continue;
+		}
+
+		if (sdfResolution > 0)
+		{
+			CookedMesh mesh;
+			MeshCache::CookObj(obj.GetData(), obj.GetSize(), mesh);
+			if (!ReportSdf(argv[i], mesh, sdfResolution))
+				failures++;
+			continue;
+		}
+
+		if (rays)
+		{
+			CookedMesh mesh;
+			MeshCache::CookObj(obj.GetData(), obj.GetSize(), mesh);
+			if (!ReportRays(argv[i], mesh))
+				failures++;
+			continue;
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+
+		CookedMesh mesh;
+		MeshCookStats stats = MeshCache::CookObj(obj.GetData(), obj.GetSize(), mesh);
+		uint64_t sourceHash = MeshCache::HashBytes(obj.GetData(), obj.GetSize());
+
+		std::wstring cachePath = MeshCache::GetCachePath(source);
+		if (!MeshCache::Save(cachePath, sourceHash, stats.sourceVertexCount, mesh))
+		{
+			printf("%s: could not write cache file\n", argv[i]);
+			failures++;
+			continue;
+		}
+
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		printf("%s: %zu verts (%zu before welding), %zu triangles, %.2f ms\n",
+			argv[i], mesh.vertices.size(), stats.sourceVertexCount, (size_t)mesh.lods[0].indexCount / 3, ms);
+		printf("  import %.2f ms (%.0f MB/s)\n", stats.importMilliseconds, obj.GetSize() / 1048576.0 / (stats.importMilliseconds / 1000.0));
+
+		//simulated post-transform cache (16 entry FIFO)
+		printf("  ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+			stats.cacheBefore.acmr, stats.cacheAfter.acmr,
+			stats.cacheBefore.atvr, stats.cacheAfter.atvr);
+
+		bool meshletsValid = CheckMeshlets(mesh.meshlets, mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.lods[0].indexCount);
+		printf("  %zu meshlets, %.1f%% of triangles backface culled from outside views%s\n",
+			mesh.meshlets.size(), MeasureConeCulling(mesh.meshlets, mesh.vertices.data(), mesh.vertices.size(), mesh.lods[0].indexCount / 3) * 100.0f,
+			meshletsValid ? "" : ", meshlet bounds or cones are wrong!");
+		failures += meshletsValid ? 0 : 1;
+
+		//what the shadow pass draws instead (see Mesh::DrawDepthOnly)
+		std::vector<DirectX::XMFLOAT3> positions;
+		std::vector<unsigned int> positionIndices;
+		MeshTools::BuildPositionStream(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.lods[0].indexCount, positions, positionIndices);
+		VertexCacheStats positionCache = MeshOptimizer::AnalyzeVertexCache(positionIndices.data(), positionIndices.size(), positions.size());
+		bool streamMatches = MatchesPositionStream(mesh.vertices.data(), mesh.indices.data(), mesh.lods[0].indexCount, positions, positionIndices);
+		printf("  depth stream: %zu positions (%zu bytes instead of %zu), ACMR %.3f%s\n",
+			positions.size(), positions.size() * sizeof(DirectX::XMFLOAT3), mesh.vertices.size() * sizeof(Vertex), positionCache.acmr,
+			streamMatches ? "" : ", triangles differ from the mesh!");
+		failures += streamMatches ? 0 : 1;
+
+		//what Mesh culls and picks LODs with (see MeshBounds)
+		const char* boundsProblem = nullptr;
+		BoundingVolumes bounds = MeshBounds::Calculate(mesh.vertices.data(), mesh.vertices.size(), true);
+		bool boundsValid = CheckBounds(mesh.vertices.data(), mesh.vertices.size(), bounds, boundsProblem);
+		printf("  bounds: sphere radius %.3g, oriented box %s%s%s\n", bounds.sphereRadius, bounds.hasOrientedBox ? "kept" : "not kept",
+			boundsValid ? "" : ", ", boundsValid ? "" : boundsProblem);
+		failures += boundsValid ? 0 : 1;
+
+		//triangle counts and error (relative to the bounding box diagonal) per LOD
+		DirectX::XMFLOAT3 boundsMin, boundsMax;
+		MeshTools::CalculateBounds(mesh.vertices.data(), mesh.vertices.size(), boundsMin, boundsMax);
+		float dx = boundsMax.x - boundsMin.x, dy = boundsMax.y - boundsMin.y, dz = boundsMax.z - boundsMin.z;
+		float diagonal = sqrtf(dx * dx + dy * dy + dz * dz);
+		printf("  LODs (%.2f ms):", stats.lodMilliseconds);
+		for (const MeshLod& lod : mesh.lods)
+			printf(" %u (%.2f%%)", lod.indexCount / 3, diagonal > 0.0f ? lod.error / diagonal * 100.0f : 0.0f);
+		printf("\n");
+
+		failures += ReportCodec("  cache", mesh) ? 0 : 1;
+
+		//one draw per material, see GameEntity::Draw
+		for (size_t s = 0; s < mesh.subsets.size(); s++)
+		{
+			const MeshSubset& subset = mesh.subsets[s];
+			printf("  material \"%s\": %u triangles, %u meshlets, LODs", mesh.subsetMaterials[s].c_str(),
+				subset.lods[0].indexCount / 3, subset.meshletCount);
+			for (size_t lod = 1; lod < mesh.lods.size(); lod++)
+				printf(" %u", subset.lods[lod].indexCount / 3);
+			printf("\n");
+		}
+	}
+
+	return failures == 0 ? 0 : 1;
+}
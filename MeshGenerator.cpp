@@ -0,0 +1,338 @@
+#include "MeshGenerator.h"
+#include "MeshTools.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	struct VertexHash
+	{
+		size_t operator()(const Vertex& v) const
+		{
+			uint32_t bits[sizeof(Vertex) / 4];
+			memcpy(bits, &v, sizeof(Vertex));
+			uint64_t h = 0x9E3779B97F4A7C15ULL;
+			for (uint32_t b : bits)
+				h = (h ^ b) * 0x100000001B3ULL;
+			return (size_t)(h ^ (h >> 32));
+		}
+	};
+
+	struct VertexEqual
+	{
+		bool operator()(const Vertex& a, const Vertex& b) const { return memcmp(&a, &b, sizeof(Vertex)) == 0; }
+	};
+
+	inline XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	// Angle around a closed loop, with the last row or column landing
+	// exactly on the first so the seam vertices share positions
+	inline float LoopAngle(float t)
+	{
+		return (t < 1.0f ? t : 0.0f) * XM_2PI;
+	}
+
+	inline bool SamePosition(const Vertex& a, const Vertex& b)
+	{
+		return a.Position.x == b.Position.x && a.Position.y == b.Position.y && a.Position.z == b.Position.z;
+	}
+
+	// Adds a (columns + 1) x (rows + 1) grid of vertices from surface(u, v),
+	// with u and v from 0 to 1, and two triangles per cell
+	// - Triangles are wound to face along the vertex normals, and ones that
+	//   collapse to a line (like at a sphere's poles) are left out
+	// - Returns how far the flat triangles get from the real surface
+	//   (measured across the middle of each cell)
+	template<typename Surface>
+	float AddGrid(unsigned int columns, unsigned int rows, Surface surface, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		unsigned int first = (unsigned int)verts.size();
+		for (unsigned int r = 0; r <= rows; r++)
+		{
+			for (unsigned int c = 0; c <= columns; c++)
+				verts.push_back(surface((float)c / columns, (float)r / rows));
+		}
+
+		auto addTriangle = [&](unsigned int a, unsigned int b, unsigned int c)
+		{
+			const Vertex& va = verts[a];
+			const Vertex& vb = verts[b];
+			const Vertex& vc = verts[c];
+			if (SamePosition(va, vb) || SamePosition(vb, vc) || SamePosition(va, vc))
+				return;
+
+			//clockwise from the front means cross(b - a, c - a) points out
+			XMFLOAT3 e1(vb.Position.x - va.Position.x, vb.Position.y - va.Position.y, vb.Position.z - va.Position.z);
+			XMFLOAT3 e2(vc.Position.x - va.Position.x, vc.Position.y - va.Position.y, vc.Position.z - va.Position.z);
+			XMFLOAT3 n = Cross(e1, e2);
+			float facing =
+				n.x * (va.normal.x + vb.normal.x + vc.normal.x) +
+				n.y * (va.normal.y + vb.normal.y + vc.normal.y) +
+				n.z * (va.normal.z + vb.normal.z + vc.normal.z);
+			if (facing < 0.0f)
+				std::swap(b, c);
+			indices.insert(indices.end(), { a, b, c });
+		};
+
+		float error = 0.0f;
+		for (unsigned int r = 0; r < rows; r++)
+		{
+			for (unsigned int c = 0; c < columns; c++)
+			{
+				unsigned int a = first + r * (columns + 1) + c;
+				unsigned int b = a + 1;
+				unsigned int d = a + columns + 1;
+				addTriangle(a, d, b);
+				addTriangle(b, d, d + 1);
+
+				//the shared edge b-d crosses the middle of the cell
+				XMFLOAT3 middle = surface((c + 0.5f) / columns, (r + 0.5f) / rows).Position;
+				const XMFLOAT3& pb = verts[b].Position;
+				const XMFLOAT3& pd = verts[d].Position;
+				float dx = middle.x - (pb.x + pd.x) * 0.5f;
+				float dy = middle.y - (pb.y + pd.y) * 0.5f;
+				float dz = middle.z - (pb.z + pd.z) * 0.5f;
+				error = std::max(error, sqrtf(dx * dx + dy * dy + dz * dz));
+			}
+		}
+		return error;
+	}
+
+	// A flat, subdivided square centered on center, facing normal,
+	// with V running along down
+	void AddFace(const XMFLOAT3& center, const XMFLOAT3& normal, const XMFLOAT3& down, unsigned int columns, unsigned int rows,
+		std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		XMFLOAT3 tangent = Cross(down, normal);
+		AddGrid(columns, rows, [&](float u, float v)
+			{
+				float s = u * 2.0f - 1.0f;
+				float t = v * 2.0f - 1.0f;
+				Vertex vert = {};
+				vert.Position = XMFLOAT3(
+					center.x + tangent.x * s + down.x * t,
+					center.y + tangent.y * s + down.y * t,
+					center.z + tangent.z * s + down.z * t);
+				vert.uv = XMFLOAT2(u, v);
+				vert.normal = normal;
+				vert.tangent = tangent;
+				return vert;
+			}, verts, indices);
+	}
+
+	// A tessellation count scaled down for a lower LOD
+	inline unsigned int Scaled(unsigned int count, float detail, unsigned int minimum)
+	{
+		return std::max(minimum, (unsigned int)(count * detail + 0.5f));
+	}
+
+	// Runs build(columnDetail, rowDetail, verts, indices) for the full mesh
+	// and again for each LOD, then does the rest of what MeshCache::CookObj does
+	// (unless cook is false, then it stops after welding the full mesh)
+	// - LODs are regenerated at a lower tessellation instead of simplified,
+	//   which is exact and far cheaper for shapes like these
+	// - Each LOD halves the columns or the rows, alternating, so (with even
+	//   counts) its grid lines up with the one before and shares its vertices
+	template<typename Build>
+	void Cook(Build build, bool cook, CookedMesh& mesh)
+	{
+		mesh = {};
+		std::vector<Vertex>& verts = mesh.vertices;
+		std::vector<unsigned int>& indices = mesh.indices;
+		std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> welded;
+
+		std::vector<Vertex> levelVerts;
+		std::vector<unsigned int> levelIndices;
+		auto addLevel = [&](float columnDetail, float rowDetail)
+		{
+			levelVerts.clear();
+			levelIndices.clear();
+			float error = build(columnDetail, rowDetail, levelVerts, levelIndices);
+
+			//grid vertices that meet (like the middle of a cylinder cap) come
+			//out once per cell, so weld anything that's exactly identical
+			std::vector<unsigned int> remap(levelVerts.size());
+			welded.reserve(verts.size() + levelVerts.size());
+			for (size_t i = 0; i < levelVerts.size(); i++)
+			{
+				auto it = welded.emplace(levelVerts[i], (unsigned int)verts.size());
+				if (it.second)
+					verts.push_back(levelVerts[i]);
+				remap[i] = it.first->second;
+			}
+			for (unsigned int& index : levelIndices)
+				index = remap[index];
+			return error;
+		};
+
+		addLevel(1.0f, 1.0f);
+		indices = levelIndices;
+		if (!cook)
+		{
+			mesh.lods.push_back({ 0, (unsigned int)indices.size(), 0.0f });
+			return;
+		}
+		MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), verts.size());
+		mesh.meshlets = Meshlets::Build(verts.data(), verts.size(), indices.data(), indices.size());
+		mesh.lods.push_back({ 0, (unsigned int)indices.size(), 0.0f });
+
+		XMFLOAT3 boundsMin, boundsMax;
+		MeshTools::CalculateBounds(verts.data(), verts.size(), boundsMin, boundsMax);
+		float dx = boundsMax.x - boundsMin.x, dy = boundsMax.y - boundsMin.y, dz = boundsMax.z - boundsMin.z;
+		float maxError = sqrtf(dx * dx + dy * dy + dz * dz) * MeshLodMaxError;
+
+		//same triangle ratios (1/2, 1/4, 1/8) and stopping rules as MeshSimplifier::BuildLodChain
+		float columnDetail = 1.0f;
+		float rowDetail = 1.0f;
+		for (size_t level = 0; level < std::size(MeshLodRatios); level++)
+		{
+			if (level % 2 == 0)
+				columnDetail *= 0.5f;
+			else
+				rowDetail *= 0.5f;
+
+			float error = addLevel(columnDetail, rowDetail);
+			if (levelIndices.empty() || error > maxError || levelIndices.size() > mesh.lods.back().indexCount * 8 / 10)
+				break;
+
+			MeshOptimizer::OptimizeVertexCache(levelIndices.data(), levelIndices.size(), verts.size());
+			mesh.lods.push_back({ (unsigned int)indices.size(), (unsigned int)levelIndices.size(), error });
+			indices.insert(indices.end(), levelIndices.begin(), levelIndices.end());
+		}
+
+		//a rejected level may have added vertices nothing uses, fetch
+		//optimization drops those along with the reordering
+		MeshOptimizer::OptimizeVertexFetch(verts, indices.data(), indices.size());
+	}
+}
+
+
+// --------------------------------------------------------
+// Longitude runs along U and latitude along V, top to bottom
+// --------------------------------------------------------
+void MeshGenerator::Sphere(unsigned int segments, unsigned int rings, CookedMesh& mesh, bool cook)
+{
+	Cook([=](float columnDetail, float rowDetail, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+		{
+			return AddGrid(Scaled(segments, columnDetail, 3), Scaled(rings, rowDetail, 2), [](float u, float v)
+				{
+					float theta = LoopAngle(u);
+					float phi = v * XM_PI;
+
+					//exactly 0 at the poles, so each pole is one position
+					float ring = (v > 0.0f && v < 1.0f) ? sinf(phi) : 0.0f;
+					Vertex vert = {};
+					vert.normal = XMFLOAT3(ring * cosf(theta), cosf(phi), ring * sinf(theta));
+					vert.Position = vert.normal;
+					vert.uv = XMFLOAT2(u, v);
+					vert.tangent = XMFLOAT3(-sinf(theta), 0.0f, cosf(theta));
+					return vert;
+				}, verts, indices);
+		}, cook, mesh);
+}
+
+
+// --------------------------------------------------------
+// The side is wrapped like the sphere, the caps are polar
+// grids with planar UVs
+// --------------------------------------------------------
+void MeshGenerator::Cylinder(unsigned int segments, unsigned int rings, CookedMesh& mesh, bool cook)
+{
+	Cook([=](float columnDetail, float rowDetail, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+		{
+			unsigned int columns = Scaled(segments, columnDetail, 3);
+			float error = AddGrid(columns, Scaled(rings, rowDetail, 1), [](float u, float v)
+				{
+					float theta = LoopAngle(u);
+					Vertex vert = {};
+					vert.normal = XMFLOAT3(cosf(theta), 0.0f, sinf(theta));
+					vert.Position = XMFLOAT3(vert.normal.x, 1.0f - v * 2.0f, vert.normal.z);
+					vert.uv = XMFLOAT2(u, v);
+					vert.tangent = XMFLOAT3(-sinf(theta), 0.0f, cosf(theta));
+					return vert;
+				}, verts, indices);
+
+			for (float side : { 1.0f, -1.0f })
+			{
+				AddGrid(columns, std::max(1u, columns / 8), [side](float u, float v)
+					{
+						float theta = LoopAngle(u);
+						Vertex vert = {};
+						vert.Position = v > 0.0f ? XMFLOAT3(cosf(theta) * v, side, sinf(theta) * v) : XMFLOAT3(0.0f, side, 0.0f);
+						vert.uv = XMFLOAT2(vert.Position.x * 0.5f + 0.5f, vert.Position.z * -side * 0.5f + 0.5f);
+						vert.normal = XMFLOAT3(0.0f, side, 0.0f);
+						vert.tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
+						return vert;
+					}, verts, indices);
+			}
+			return error;
+		}, cook, mesh);
+}
+
+
+// --------------------------------------------------------
+// U goes around the ring, V around the tube starting from
+// the top
+// --------------------------------------------------------
+void MeshGenerator::Torus(unsigned int segments, unsigned int tubeSegments, float radius, float tubeRadius, CookedMesh& mesh, bool cook)
+{
+	Cook([=](float columnDetail, float rowDetail, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+		{
+			return AddGrid(Scaled(segments, columnDetail, 3), Scaled(tubeSegments, rowDetail, 3), [radius, tubeRadius](float u, float v)
+				{
+					float theta = LoopAngle(u);
+					float phi = XM_PIDIV2 - LoopAngle(v);
+					float ring = radius + tubeRadius * cosf(phi);
+					Vertex vert = {};
+					vert.Position = XMFLOAT3(ring * cosf(theta), tubeRadius * sinf(phi), ring * sinf(theta));
+					vert.uv = XMFLOAT2(u, v);
+					vert.normal = XMFLOAT3(cosf(phi) * cosf(theta), sinf(phi), cosf(phi) * sinf(theta));
+					vert.tangent = XMFLOAT3(-sinf(theta), 0.0f, cosf(theta));
+					return vert;
+				}, verts, indices);
+		}, cook, mesh);
+}
+
+
+void MeshGenerator::Cube(unsigned int subdivisions, CookedMesh& mesh, bool cook)
+{
+	//sides have V pointing down, the top and bottom toward -Z and +Z
+	const XMFLOAT3 faces[6][2] =
+	{
+		{ XMFLOAT3(1, 0, 0), XMFLOAT3(0, -1, 0) },
+		{ XMFLOAT3(-1, 0, 0), XMFLOAT3(0, -1, 0) },
+		{ XMFLOAT3(0, 0, 1), XMFLOAT3(0, -1, 0) },
+		{ XMFLOAT3(0, 0, -1), XMFLOAT3(0, -1, 0) },
+		{ XMFLOAT3(0, 1, 0), XMFLOAT3(0, 0, -1) },
+		{ XMFLOAT3(0, -1, 0), XMFLOAT3(0, 0, 1) },
+	};
+
+	Cook([&](float columnDetail, float rowDetail, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+		{
+			for (const auto& face : faces)
+				AddFace(face[0], face[0], face[1], Scaled(subdivisions, columnDetail, 1), Scaled(subdivisions, rowDetail, 1), verts, indices);
+			return 0.0f;
+		}, cook, mesh);
+}
+
+
+void MeshGenerator::Quad(unsigned int subdivisions, bool doubleSided, CookedMesh& mesh, bool cook)
+{
+	Cook([=](float columnDetail, float rowDetail, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+		{
+			unsigned int columns = Scaled(subdivisions, columnDetail, 1);
+			unsigned int rows = Scaled(subdivisions, rowDetail, 1);
+			AddFace(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 1, 0), XMFLOAT3(0, 0, -1), columns, rows, verts, indices);
+			if (doubleSided)
+				AddFace(XMFLOAT3(0, 0, 0), XMFLOAT3(0, -1, 0), XMFLOAT3(0, 0, 1), columns, rows, verts, indices);
+			return 0.0f;
+		}, cook, mesh);
+}
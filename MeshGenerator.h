@@ -0,0 +1,38 @@
+#pragma once
+#include "MeshCache.h"
+
+// Sizes of the shapes in Assets/Models, so generated meshes
+// can stand in for them without rescaling anything
+const float GeneratedTorusRadius = 0.7143f;
+const float GeneratedTorusTubeRadius = 0.2857f;
+
+// --------------------------------------------------------
+// Procedural versions of the primitive models
+//
+// - Everything fits in a -1 to 1 box like the OBJs, in the
+//   same left-handed, clockwise front face convention
+// - Normals and tangents are analytic, with UVs laid out
+//   the same way as the OBJs (N x T points along +V)
+// - Output is welded, cache optimized and split into meshlets
+//   like a cooked OBJ, but LODs are regenerated at lower
+//   tessellations instead of simplified
+// - Without cook it's only welded, one LOD with the triangles
+//   in the order they were generated and no meshlets
+// --------------------------------------------------------
+namespace MeshGenerator
+{
+	// UV sphere, radius 1 (32 x 16 matches sphere.obj)
+	void Sphere(unsigned int segments, unsigned int rings, CookedMesh& mesh, bool cook = true);
+
+	// Capped cylinder, radius 1 from y = -1 to 1
+	void Cylinder(unsigned int segments, unsigned int rings, CookedMesh& mesh, bool cook = true);
+
+	// Torus lying in the XZ plane (40 x 20 matches torus.obj)
+	void Torus(unsigned int segments, unsigned int tubeSegments, float radius, float tubeRadius, CookedMesh& mesh, bool cook = true);
+
+	// -1 to 1 cube, each face split into a subdivisions x subdivisions grid
+	void Cube(unsigned int subdivisions, CookedMesh& mesh, bool cook = true);
+
+	// -1 to 1 quad in the XZ plane facing +Y, optionally with a back face
+	void Quad(unsigned int subdivisions, bool doubleSided, CookedMesh& mesh, bool cook = true);
+}
@@ -0,0 +1,277 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Forsyth tuning values (see "Linear-Speed Vertex Cache Optimisation", Tom Forsyth)
+	const int CacheSize = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+	const int MaxValence = 64;
+
+	struct ScoreTables
+	{
+		float cache[CacheSize];
+		float valence[MaxValence];
+
+		ScoreTables()
+		{
+			for (int i = 0; i < CacheSize; i++)
+			{
+				if (i < 3)
+					cache[i] = LastTriScore;
+				else
+					cache[i] = powf(1.0f - (float)(i - 3) / (CacheSize - 3), CacheDecayPower);
+			}
+			valence[0] = 0.0f;
+			for (int i = 1; i < MaxValence; i++)
+				valence[i] = ValenceBoostScale * powf((float)i, -ValenceBoostPower);
+		}
+	};
+
+	const ScoreTables& GetScoreTables()
+	{
+		static ScoreTables tables;
+		return tables;
+	}
+
+	float VertexScore(int cachePosition, unsigned int remainingTris)
+	{
+		if (remainingTris == 0)
+			return -1.0f;
+
+		const ScoreTables& tables = GetScoreTables();
+		float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+		score += tables.valence[std::min<unsigned int>(remainingTris, MaxValence - 1)];
+		return score;
+	}
+}
+
+
+// --------------------------------------------------------
+// Greedy triangle ordering: repeatedly emit the triangle whose
+// vertices score highest, where score favors vertices that are
+// recently used (in a simulated LRU cache) and vertices with
+// few triangles left (so they can be retired from the cache)
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeVertexCache(unsigned int* indices, size_t numIndices, size_t numVerts)
+{
+	size_t numTris = numIndices / 3;
+	if (numTris == 0 || numVerts == 0)
+		return;
+
+	//triangle adjacency per vertex (compact offset + list)
+	std::vector<unsigned int> triCounts(numVerts, 0);
+	for (size_t i = 0; i < numTris * 3; i++)
+		triCounts[indices[i]]++;
+
+	std::vector<unsigned int> triOffsets(numVerts + 1, 0);
+	for (size_t v = 0; v < numVerts; v++)
+		triOffsets[v + 1] = triOffsets[v] + triCounts[v];
+
+	std::vector<unsigned int> adjacency(numTris * 3);
+	std::vector<unsigned int> fill(triOffsets.begin(), triOffsets.end() - 1);
+	for (size_t t = 0; t < numTris; t++)
+		for (int k = 0; k < 3; k++)
+			adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+
+	//"remaining" shrinks as triangles get emitted (adjacency is swap-removed)
+	std::vector<unsigned int> remaining = triCounts;
+	std::vector<int> cachePosition(numVerts, -1);
+	std::vector<float> vertexScores(numVerts);
+	for (size_t v = 0; v < numVerts; v++)
+		vertexScores[v] = VertexScore(-1, remaining[v]);
+
+	std::vector<float> triScores(numTris);
+	for (size_t t = 0; t < numTris; t++)
+		triScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+	std::vector<bool> emitted(numTris, false);
+	std::vector<unsigned int> output;
+	output.reserve(numTris * 3);
+
+	//cache holds up to CacheSize entries plus the 3 being pushed
+	unsigned int cache[CacheSize + 3];
+	int cacheCount = 0;
+
+	size_t scanCursor = 0;
+	long long bestTri = -1;
+	float bestScore = -1.0f;
+	for (size_t t = 0; t < numTris; t++)
+	{
+		if (triScores[t] > bestScore)
+		{
+			bestScore = triScores[t];
+			bestTri = (long long)t;
+		}
+	}
+
+	while (bestTri >= 0)
+	{
+		size_t tri = (size_t)bestTri;
+		emitted[tri] = true;
+		const unsigned int* triVerts = &indices[tri * 3];
+		output.insert(output.end(), triVerts, triVerts + 3);
+
+		//retire this triangle from its vertices' adjacency lists
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = triVerts[k];
+			unsigned int* list = &adjacency[triOffsets[v]];
+			for (unsigned int j = 0; j < remaining[v]; j++)
+			{
+				if (list[j] == tri)
+				{
+					list[j] = list[remaining[v] - 1];
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		//push the triangle's verts to the front of the LRU cache
+		unsigned int newCache[CacheSize + 3];
+		int newCount = 0;
+		for (int k = 0; k < 3; k++)
+			newCache[newCount++] = triVerts[k];
+		for (int c = 0; c < cacheCount; c++)
+		{
+			unsigned int v = cache[c];
+			if (v != triVerts[0] && v != triVerts[1] && v != triVerts[2])
+				newCache[newCount++] = v;
+		}
+
+		//anything pushed past the end falls out
+		for (int c = CacheSize; c < newCount; c++)
+		{
+			cachePosition[newCache[c]] = -1;
+			vertexScores[newCache[c]] = VertexScore(-1, remaining[newCache[c]]);
+		}
+		cacheCount = std::min(newCount, CacheSize);
+		std::copy(newCache, newCache + cacheCount, cache);
+
+		//rescore cached verts and the triangles that touch them
+		for (int c = 0; c < cacheCount; c++)
+		{
+			cachePosition[cache[c]] = c;
+			vertexScores[cache[c]] = VertexScore(c, remaining[cache[c]]);
+		}
+
+		bestTri = -1;
+		bestScore = -1.0f;
+		for (int c = 0; c < cacheCount; c++)
+		{
+			unsigned int v = cache[c];
+			const unsigned int* list = &adjacency[triOffsets[v]];
+			for (unsigned int j = 0; j < remaining[v]; j++)
+			{
+				unsigned int t = list[j];
+				float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+				triScores[t] = score;
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTri = t;
+				}
+			}
+		}
+
+		//nothing connected to the cache, so start somewhere new
+		if (bestTri < 0)
+		{
+			while (scanCursor < numTris && emitted[scanCursor])
+				scanCursor++;
+			if (scanCursor < numTris)
+				bestTri = (long long)scanCursor;
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& verts, unsigned int* indices, size_t numIndices)
+{
+	const unsigned int unused = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(verts.size(), unused);
+	std::vector<Vertex> reordered;
+	reordered.reserve(verts.size());
+
+	for (size_t i = 0; i < numIndices; i++)
+	{
+		unsigned int& newIndex = remap[indices[i]];
+		if (newIndex == unused)
+		{
+			newIndex = (unsigned int)reordered.size();
+			reordered.push_back(verts[indices[i]]);
+		}
+		indices[i] = newIndex;
+	}
+
+	verts.swap(reordered);
+}
+
+
+// --------------------------------------------------------
+// Runs the index buffer through a simulated post-transform
+// cache and counts vertex shader invocations
+// --------------------------------------------------------
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const unsigned int* indices, size_t numIndices, size_t numVerts,
+	unsigned int cacheSize, VertexCacheModel model)
+{
+	VertexCacheStats stats = {};
+	if (numIndices < 3 || numVerts == 0 || cacheSize == 0)
+		return stats;
+
+	size_t misses = 0;
+	std::vector<bool> used(numVerts, false);
+	size_t usedCount = 0;
+
+	if (model == VERTEX_CACHE_FIFO)
+	{
+		//a vert is cached if fewer than cacheSize misses happened since it was inserted
+		std::vector<size_t> insertedAt(numVerts, 0);
+		size_t clock = cacheSize + 1;
+		for (size_t i = 0; i < numIndices; i++)
+		{
+			unsigned int v = indices[i];
+			if (clock - insertedAt[v] > cacheSize)
+			{
+				insertedAt[v] = clock++;
+				misses++;
+			}
+			if (!used[v]) { used[v] = true; usedCount++; }
+		}
+	}
+	else
+	{
+		std::vector<unsigned int> cache;
+		cache.reserve(cacheSize + 1);
+		for (size_t i = 0; i < numIndices; i++)
+		{
+			unsigned int v = indices[i];
+			auto it = std::find(cache.begin(), cache.end(), v);
+			if (it == cache.end())
+			{
+				misses++;
+				cache.insert(cache.begin(), v);
+				if (cache.size() > cacheSize)
+					cache.pop_back();
+			}
+			else
+			{
+				std::rotate(cache.begin(), it, it + 1);
+			}
+			if (!used[v]) { used[v] = true; usedCount++; }
+		}
+	}
+
+	stats.acmr = (float)misses / (float)(numIndices / 3);
+	stats.atvr = usedCount ? (float)misses / (float)usedCount : 0.0f;
+	return stats;
+}
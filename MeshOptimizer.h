@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include "Vertex.h"
+
+// Simulated post-transform cache replacement policies
+enum VertexCacheModel
+{
+	VERTEX_CACHE_FIFO,
+	VERTEX_CACHE_LRU
+};
+
+// Results of running an index buffer through a simulated cache
+// - ACMR: average cache misses (vertex shader runs) per triangle, 0.5 is ideal for big grids
+// - ATVR: average transforms per vertex, 1.0 is ideal
+struct VertexCacheStats
+{
+	float acmr;
+	float atvr;
+};
+
+// --------------------------------------------------------
+// Index/vertex reordering passes for better GPU throughput
+//
+// - Pure CPU code, run once at cook time
+// - Typical order: vertex cache -> vertex fetch, with
+//   Meshlets::Build in between sorting for overdraw
+// --------------------------------------------------------
+namespace MeshOptimizer
+{
+	// Forsyth's linear-speed vertex cache optimization, reorders triangles
+	void OptimizeVertexCache(unsigned int* indices, size_t numIndices, size_t numVerts);
+
+	// Reorders vertices to match their first use in the index buffer so vertex
+	// fetch walks memory linearly; unused vertices are dropped
+	void OptimizeVertexFetch(std::vector<Vertex>& verts, unsigned int* indices, size_t numIndices);
+
+	VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t numIndices, size_t numVerts,
+		unsigned int cacheSize = 16, VertexCacheModel model = VERTEX_CACHE_FIFO);
+}
@@ -0,0 +1,304 @@
+#include "MeshSdf.h"
+#include "MeshBvh.h"
+#include "MeshTools.h"
+#include "WorkerThreads.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	inline XMFLOAT3 Sub(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	inline float Dot(const XMFLOAT3& a, const XMFLOAT3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline float Length(const XMFLOAT3& v) { return sqrtf(Dot(v, v)); }
+	inline XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+
+	inline void AddScaled(XMFLOAT3& sum, const XMFLOAT3& v, float s)
+	{
+		sum.x += v.x * s;
+		sum.y += v.y * s;
+		sum.z += v.z * s;
+	}
+
+	// Angle between the edges leaving p towards a and b
+	inline float CornerAngle(const XMFLOAT3& p, const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		XMFLOAT3 u = Sub(a, p), v = Sub(b, p);
+		float lengths = Length(u) * Length(v);
+		return lengths > 0.0f ? acosf(std::clamp(Dot(u, v) / lengths, -1.0f, 1.0f)) : 0.0f;
+	}
+
+	// Normals for telling inside from outside, whatever part of a
+	// triangle the closest point is on (Baerentzen and Aanaes 2005)
+	// - Face normals for faces, the sum of both faces for edges and
+	//   the angle weighted sum of every face for vertices
+	// - Only the sign of a dot product is ever needed, so none of
+	//   them are normalized
+	struct PseudoNormals
+	{
+		std::vector<XMFLOAT3> faces;
+		std::vector<XMFLOAT3> vertices;
+		std::vector<XMFLOAT3> edges;
+		std::vector<uint32_t> triangleEdges;	// AB, BC, CA for each triangle
+	};
+
+	void BuildPseudoNormals(const std::vector<XMFLOAT3>& positions, const std::vector<unsigned int>& indices, PseudoNormals& out)
+	{
+		size_t triangleCount = indices.size() / 3;
+		out.faces.resize(triangleCount);
+		out.vertices.assign(positions.size(), XMFLOAT3(0, 0, 0));
+		out.triangleEdges.resize(triangleCount * 3);
+
+		std::unordered_map<uint64_t, uint32_t> edgeIds;
+		edgeIds.reserve(triangleCount * 2);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			const unsigned int* tri = &indices[t * 3];
+			const XMFLOAT3& a = positions[tri[0]];
+			const XMFLOAT3& b = positions[tri[1]];
+			const XMFLOAT3& c = positions[tri[2]];
+
+			//clockwise front faces in a left handed space, so this points out
+			XMFLOAT3 normal = Cross(Sub(b, a), Sub(c, a));
+			float length = Length(normal);
+			if (length > 0.0f)
+				normal = XMFLOAT3(normal.x / length, normal.y / length, normal.z / length);
+			out.faces[t] = normal;
+
+			AddScaled(out.vertices[tri[0]], normal, CornerAngle(a, b, c));
+			AddScaled(out.vertices[tri[1]], normal, CornerAngle(b, c, a));
+			AddScaled(out.vertices[tri[2]], normal, CornerAngle(c, a, b));
+
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned int from = tri[e], to = tri[(e + 1) % 3];
+				uint64_t key = ((uint64_t)std::min(from, to) << 32) | std::max(from, to);
+				auto it = edgeIds.emplace(key, (uint32_t)out.edges.size());
+				if (it.second)
+					out.edges.push_back(XMFLOAT3(0, 0, 0));
+				AddScaled(out.edges[it.first->second], normal, 1.0f);
+				out.triangleEdges[t * 3 + e] = it.first->second;
+			}
+		}
+	}
+
+	struct BakeContext
+	{
+		const std::vector<unsigned int>* indices;
+		const PseudoNormals* normals;
+		const MeshBvh* bvh;
+	};
+
+	// Distance to the closest point on the mesh, negative inside
+	float SignedDistance(const BakeContext& context, const XMFLOAT3& p)
+	{
+		BvhClosestHit hit;
+		if (!context.bvh->FindClosest(p, FLT_MAX, hit))
+			return FLT_MAX;
+
+		const PseudoNormals& normals = *context.normals;
+		const unsigned int* tri = &(*context.indices)[hit.triangle * 3];
+		XMFLOAT3 normal;
+		switch (hit.feature)
+		{
+		case BVH_FEATURE_EDGE_AB: normal = normals.edges[normals.triangleEdges[hit.triangle * 3]]; break;
+		case BVH_FEATURE_EDGE_BC: normal = normals.edges[normals.triangleEdges[hit.triangle * 3 + 1]]; break;
+		case BVH_FEATURE_EDGE_CA: normal = normals.edges[normals.triangleEdges[hit.triangle * 3 + 2]]; break;
+		case BVH_FEATURE_VERTEX_A: normal = normals.vertices[tri[0]]; break;
+		case BVH_FEATURE_VERTEX_B: normal = normals.vertices[tri[1]]; break;
+		case BVH_FEATURE_VERTEX_C: normal = normals.vertices[tri[2]]; break;
+		default: normal = normals.faces[hit.triangle]; break;
+		}
+
+		float distance = sqrtf(hit.distanceSquared);
+		return Dot(Sub(p, hit.point), normal) < 0.0f ? -distance : distance;
+	}
+}
+
+
+// --------------------------------------------------------
+// Bakes the distance volume for a triangle list
+//
+// - Positions are welded first (ignoring UV/normal seams) so
+//   neighbouring triangles share edges and vertices, which
+//   the pseudo normals depend on
+// - Sparse bakes check each brick's center first and skip
+//   the brick if the surface can't be within the narrow band
+//   of any of its samples
+// --------------------------------------------------------
+SdfBakeStats MeshSdf::Bake(const Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices, const SdfBakeSettings& settings, SdfVolume& out)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	SdfBakeStats stats = {};
+
+	std::vector<XMFLOAT3> positions;
+	std::vector<unsigned int> positionIndices;
+	MeshTools::BuildPositionStream(verts, numVerts, indices, numIndices, positions, positionIndices);
+	stats.triangleCount = positionIndices.size() / 3;
+
+	PseudoNormals normals;
+	BuildPseudoNormals(positions, positionIndices, normals);
+	MeshBvh bvh(positions.data(), positions.size(), positionIndices.data(), positionIndices.size(), settings.threadCount);
+	stats.bvhMilliseconds = bvh.GetBuildMilliseconds();
+	stats.bvhBytes = bvh.GetMemoryBytes();
+	BakeContext context = { &positionIndices, &normals, &bvh };
+
+	//grid over the bounds plus padding, rounded up to whole bricks
+	XMFLOAT3 boundsMin(0, 0, 0), boundsMax(0, 0, 0);
+	MeshTools::CalculateBounds(verts, numVerts, boundsMin, boundsMax);
+	XMFLOAT3 extent = Sub(boundsMax, boundsMin);
+	float longest = std::max(std::max(extent.x, extent.y), extent.z);
+	unsigned int resolution = std::max(settings.resolution, 2 * settings.padding + 2);
+	out.voxelSize = longest > 0.0f ? longest / (resolution - 2 * settings.padding - 1) : 1.0f;
+	out.origin = XMFLOAT3(
+		boundsMin.x - settings.padding * out.voxelSize,
+		boundsMin.y - settings.padding * out.voxelSize,
+		boundsMin.z - settings.padding * out.voxelSize);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		//(the longest axis divides exactly, don't let rounding add a brick)
+		unsigned int samples = (unsigned int)ceilf((&extent.x)[axis] / out.voxelSize - 1e-3f) + 1 + 2 * settings.padding;
+		out.bricks[axis] = (samples + SdfBrickSize - 1) / SdfBrickSize;
+		out.size[axis] = out.bricks[axis] * SdfBrickSize;
+	}
+
+	size_t brickCount = (size_t)out.bricks[0] * out.bricks[1] * out.bricks[2];
+	out.brickOffsets.assign(brickCount, 0);
+	out.brickDistances.assign(brickCount, 0.0f);
+	stats.brickCount = brickCount;
+
+	unsigned int threadCount = settings.threadCount;
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = (unsigned int)std::min<size_t>(threadCount, brickCount);
+
+	auto BrickCorner = [&](size_t brick)
+		{
+			size_t x = brick % out.bricks[0];
+			size_t y = brick / out.bricks[0] % out.bricks[1];
+			size_t z = brick / out.bricks[0] / out.bricks[1];
+			return XMFLOAT3(
+				out.origin.x + x * SdfBrickSize * out.voxelSize,
+				out.origin.y + y * SdfBrickSize * out.voxelSize,
+				out.origin.z + z * SdfBrickSize * out.voxelSize);
+		};
+
+	//sparse: anything in a brick is within half its diagonal of the center
+	if (settings.sparse)
+	{
+		float halfDiagonal = (SdfBrickSize - 1) * out.voxelSize * sqrtf(3.0f) * 0.5f;
+		float band = settings.narrowBand * out.voxelSize;
+		std::atomic<size_t> nextBrick(0);
+		RunOnThreads(threadCount, [&]()
+			{
+				for (size_t brick = nextBrick++; brick < brickCount; brick = nextBrick++)
+				{
+					XMFLOAT3 corner = BrickCorner(brick);
+					float offset = (SdfBrickSize - 1) * 0.5f * out.voxelSize;
+					XMFLOAT3 center(corner.x + offset, corner.y + offset, corner.z + offset);
+					float distance = SignedDistance(context, center);
+					if (fabsf(distance) - halfDiagonal > band)
+					{
+						out.brickOffsets[brick] = SdfEmptyBrick;
+						out.brickDistances[brick] = copysignf(fabsf(distance) - halfDiagonal, distance);
+					}
+				}
+			});
+	}
+
+	std::vector<size_t> storedBricks;
+	storedBricks.reserve(brickCount);
+	for (size_t brick = 0; brick < brickCount; brick++)
+	{
+		if (out.brickOffsets[brick] == SdfEmptyBrick)
+			continue;
+		out.brickOffsets[brick] = (uint32_t)(storedBricks.size() * SdfBrickSize * SdfBrickSize * SdfBrickSize);
+		storedBricks.push_back(brick);
+	}
+	stats.storedBricks = storedBricks.size();
+	out.distances.resize(storedBricks.size() * SdfBrickSize * SdfBrickSize * SdfBrickSize);
+
+	//bricks take very different amounts of time, so threads grab them one at a time
+	std::atomic<size_t> nextBrick(0);
+	RunOnThreads(threadCount, [&]()
+		{
+			for (size_t i = nextBrick++; i < storedBricks.size(); i = nextBrick++)
+			{
+				size_t brick = storedBricks[i];
+				XMFLOAT3 corner = BrickCorner(brick);
+				float* samples = &out.distances[out.brickOffsets[brick]];
+				for (unsigned int z = 0; z < SdfBrickSize; z++)
+				{
+					for (unsigned int y = 0; y < SdfBrickSize; y++)
+					{
+						for (unsigned int x = 0; x < SdfBrickSize; x++)
+						{
+							XMFLOAT3 p(corner.x + x * out.voxelSize, corner.y + y * out.voxelSize, corner.z + z * out.voxelSize);
+							*samples++ = SignedDistance(context, p);
+						}
+					}
+				}
+			}
+		});
+
+	stats.volumeBytes = GetMemoryBytes(out);
+	stats.bakeMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return stats;
+}
+
+
+float MeshSdf::GetSample(const SdfVolume& volume, unsigned int x, unsigned int y, unsigned int z)
+{
+	size_t brick = ((size_t)(z / SdfBrickSize) * volume.bricks[1] + y / SdfBrickSize) * volume.bricks[0] + x / SdfBrickSize;
+	uint32_t offset = volume.brickOffsets[brick];
+	if (offset == SdfEmptyBrick)
+		return volume.brickDistances[brick];
+	return volume.distances[offset + ((z % SdfBrickSize) * SdfBrickSize + y % SdfBrickSize) * SdfBrickSize + x % SdfBrickSize];
+}
+
+
+float MeshSdf::Sample(const SdfVolume& volume, const XMFLOAT3& position)
+{
+	float grid[3] = {
+		(position.x - volume.origin.x) / volume.voxelSize,
+		(position.y - volume.origin.y) / volume.voxelSize,
+		(position.z - volume.origin.z) / volume.voxelSize };
+
+	unsigned int cell[3];
+	float t[3];
+	float outside = 0.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float last = (float)(volume.size[axis] - 1);
+		float clamped = std::clamp(grid[axis], 0.0f, last);
+		outside += (grid[axis] - clamped) * (grid[axis] - clamped);
+		cell[axis] = std::min((unsigned int)clamped, volume.size[axis] - 2);
+		t[axis] = clamped - cell[axis];
+	}
+
+	float corners[8];
+	for (int c = 0; c < 8; c++)
+		corners[c] = GetSample(volume, cell[0] + (c & 1), cell[1] + ((c >> 1) & 1), cell[2] + (c >> 2));
+
+	float x00 = corners[0] + (corners[1] - corners[0]) * t[0];
+	float x10 = corners[2] + (corners[3] - corners[2]) * t[0];
+	float x01 = corners[4] + (corners[5] - corners[4]) * t[0];
+	float x11 = corners[6] + (corners[7] - corners[6]) * t[0];
+	float y0 = x00 + (x10 - x00) * t[1];
+	float y1 = x01 + (x11 - x01) * t[1];
+	return y0 + (y1 - y0) * t[2] + sqrtf(outside) * volume.voxelSize;
+}
+
+
+size_t MeshSdf::GetMemoryBytes(const SdfVolume& volume)
+{
+	return volume.distances.size() * sizeof(float) +
+		volume.brickOffsets.size() * sizeof(uint32_t) +
+		volume.brickDistances.size() * sizeof(float);
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+#include "Vertex.h"
+
+// Samples per side of a brick; bricks are what the baker hands
+// out to threads and what sparse volumes leave out
+const unsigned int SdfBrickSize = 8;
+const uint32_t SdfEmptyBrick = ~0u;
+
+struct SdfBakeSettings
+{
+	unsigned int resolution = 64;	// Samples along the longest side of the mesh bounds
+	unsigned int padding = 2;		// Extra samples around the bounds
+	bool sparse = false;			// Leave out bricks with no surface within narrowBand of them
+	float narrowBand = 4.0f;		// In samples
+	unsigned int threadCount = 0;	// 0 picks one per hardware core
+};
+
+// Signed distances to a mesh on a grid of samples, negative inside
+// - Sample (x, y, z) sits at origin + (x, y, z) * voxelSize
+// - Stored in bricks of SdfBrickSize^3 samples, x fastest; dense
+//   volumes have every brick, sparse ones only those near the
+//   surface and a single value for the rest
+struct SdfVolume
+{
+	DirectX::XMFLOAT3 origin;
+	float voxelSize;
+	unsigned int size[3];		// Samples per axis, always a multiple of SdfBrickSize
+	unsigned int bricks[3];		// Bricks per axis
+	std::vector<uint32_t> brickOffsets;	// Start of each brick's samples, or SdfEmptyBrick
+	std::vector<float> brickDistances;	// For empty bricks, no sample in them is closer to the surface than this
+	std::vector<float> distances;
+};
+
+// How a bake went, for reporting
+struct SdfBakeStats
+{
+	size_t triangleCount;
+	double bvhMilliseconds;
+	size_t bvhBytes;
+	double bakeMilliseconds;	// Everything, including the BVH
+	size_t brickCount;
+	size_t storedBricks;
+	size_t volumeBytes;
+};
+
+// --------------------------------------------------------
+// Signed distance field baking for meshes
+//
+// - Distances come from closest point queries against a
+//   MeshBvh, bricks are spread over threads as they free up
+// - Inside/outside is decided by the angle weighted pseudo
+//   normal of whichever face, edge or vertex is closest, so
+//   meshes should be closed (holes leak a little sign error
+//   around them, nothing worse)
+// - Sparse volumes only pay for one query per empty brick,
+//   which is most of them at high resolutions
+// - Volumes are meant for soft shadows, AO and collision
+//   queries without going back to the triangles
+// --------------------------------------------------------
+namespace MeshSdf
+{
+	SdfBakeStats Bake(const Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices, const SdfBakeSettings& settings, SdfVolume& out);
+
+	// One stored sample, coordinates must be inside the volume
+	float GetSample(const SdfVolume& volume, unsigned int x, unsigned int y, unsigned int z);
+
+	// Trilinear filtered distance at a mesh space position
+	// - Outside the volume this is the distance at its nearest
+	//   edge plus the distance to it, an estimate
+	float Sample(const SdfVolume& volume, const DirectX::XMFLOAT3& position);
+
+	size_t GetMemoryBytes(const SdfVolume& volume);
+}
@@ -0,0 +1,396 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "MeshTools.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	// Symmetric 4x4 matrix measuring squared distance to a set of planes,
+	// weighted by triangle area so Error() is an average squared distance
+	struct Quadric
+	{
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+		double weight;
+
+		void AddPlane(double a, double b, double c, double d, double w)
+		{
+			a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+			b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+			c2 += w * c * c; cd += w * c * d;
+			d2 += w * d * d;
+			weight += w;
+		}
+
+		void Add(const Quadric& q)
+		{
+			a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+			b2 += q.b2; bc += q.bc; bd += q.bd;
+			c2 += q.c2; cd += q.cd;
+			d2 += q.d2;
+			weight += q.weight;
+		}
+
+		double Error(const XMFLOAT3& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double e =
+				a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+				b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+				c2 * z * z + 2 * cd * z +
+				d2;
+			return e > 0.0 && weight > 0.0 ? e / weight : 0.0;
+		}
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const XMFLOAT3& p) const
+		{
+			uint32_t bits[3];
+			memcpy(bits, &p, sizeof(bits));
+			return ((size_t)bits[0] * 73856093) ^ ((size_t)bits[1] * 19349663) ^ ((size_t)bits[2] * 83492791);
+		}
+	};
+
+	struct PositionEqual
+	{
+		bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+	};
+
+	// How different two normals can be (cos of ~25 degrees) before a vertex
+	// won't be moved onto the other side of a hard edge
+	const float MinSeamNormalDot = 0.9f;
+
+	struct Collapse
+	{
+		unsigned int from;
+		unsigned int to;
+		float cost;
+	};
+
+	inline XMFLOAT3 TriangleNormal(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+	{
+		float e1x = b.x - a.x, e1y = b.y - a.y, e1z = b.z - a.z;
+		float e2x = c.x - a.x, e2y = c.y - a.y, e2z = c.z - a.z;
+		return XMFLOAT3(e1y * e2z - e1z * e2y, e1z * e2x - e1x * e2z, e1x * e2y - e1y * e2x);
+	}
+
+	inline uint64_t EdgeKey(unsigned int a, unsigned int b)
+	{
+		return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+	}
+}
+
+
+// --------------------------------------------------------
+// Repeated passes of: find every edge collapse, sort them by
+// quadric error, then apply the cheapest ones that don't
+// touch each other or flip a triangle
+// --------------------------------------------------------
+size_t MeshSimplifier::Simplify(const Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices,
+	size_t targetIndexCount, float maxError, unsigned int* outIndices, float* resultError)
+{
+	std::vector<unsigned int> tris(indices, indices + numIndices);
+	size_t numTris = numIndices / 3;
+	size_t targetTris = targetIndexCount / 3;
+	double maxCost = (double)maxError * maxError;
+	double worstCost = 0.0;
+
+	//vertices that share a position (attribute seams) act as one for topology,
+	//and are linked in a ring so they can be collapsed together
+	std::vector<unsigned int> positionId(numVerts);
+	std::vector<unsigned int> nextWithPosition(numVerts);
+	{
+		std::unordered_map<XMFLOAT3, unsigned int, PositionHash, PositionEqual> firstWithPosition;
+		firstWithPosition.reserve(numVerts);
+		for (size_t v = 0; v < numVerts; v++)
+		{
+			auto it = firstWithPosition.emplace(verts[v].Position, (unsigned int)v).first;
+			positionId[v] = it->second;
+			nextWithPosition[v] = nextWithPosition[it->second];
+			nextWithPosition[it->second] = (unsigned int)v;
+			if (v == it->second)
+				nextWithPosition[v] = (unsigned int)v;
+		}
+	}
+
+	//lock borders and non-manifold edges (seams are fine, they slide along themselves)
+	std::vector<bool> locked(numVerts, false);
+	{
+		std::unordered_map<uint64_t, unsigned int> edgeUses;
+		edgeUses.reserve(numIndices);
+		for (size_t i = 0; i < numIndices; i += 3)
+		{
+			for (int k = 0; k < 3; k++)
+				edgeUses[EdgeKey(positionId[tris[i + k]], positionId[tris[i + (k + 1) % 3]])]++;
+		}
+
+		std::vector<bool> lockedPosition(numVerts, false);
+		for (const auto& edge : edgeUses)
+		{
+			if (edge.second != 2)
+			{
+				lockedPosition[edge.first >> 32] = true;
+				lockedPosition[edge.first & 0xFFFFFFFF] = true;
+			}
+		}
+		for (size_t v = 0; v < numVerts; v++)
+			locked[v] = lockedPosition[positionId[v]];
+	}
+
+	//plane quadrics, gathered per position so seam vertices see the whole surface
+	std::vector<Quadric> quadrics(numVerts, Quadric{});
+	for (size_t i = 0; i < numIndices; i += 3)
+	{
+		const XMFLOAT3& a = verts[tris[i]].Position;
+		XMFLOAT3 n = TriangleNormal(a, verts[tris[i + 1]].Position, verts[tris[i + 2]].Position);
+		double length = sqrt((double)n.x * n.x + (double)n.y * n.y + (double)n.z * n.z);
+		if (length == 0.0)
+			continue;
+
+		double nx = n.x / length, ny = n.y / length, nz = n.z / length;
+		double d = -(nx * a.x + ny * a.y + nz * a.z);
+		for (int k = 0; k < 3; k++)
+			quadrics[positionId[tris[i + k]]].AddPlane(nx, ny, nz, d, length * 0.5);
+	}
+
+	std::vector<unsigned int> adjacencyStart(numVerts + 1);
+	std::vector<unsigned int> adjacency;
+	std::vector<unsigned int> fill(numVerts);
+	std::vector<bool> touched(numVerts);
+	std::vector<Collapse> collapses;
+	std::vector<Collapse> group;
+
+	while (numTris > targetTris)
+	{
+		//vertex -> live triangle adjacency for this pass
+		std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+		for (size_t i = 0; i < numTris * 3; i++)
+			adjacencyStart[tris[i] + 1]++;
+		for (size_t v = 0; v < numVerts; v++)
+			adjacencyStart[v + 1] += adjacencyStart[v];
+		adjacency.resize(numTris * 3);
+		std::copy(adjacencyStart.begin(), adjacencyStart.end() - 1, fill.begin());
+		for (size_t i = 0; i < numTris * 3; i++)
+			adjacency[fill[tris[i]]++] = (unsigned int)(i / 3);
+
+		//every half-edge collapse away from an unlocked vertex
+		collapses.clear();
+		for (size_t i = 0; i < numTris * 3; i += 3)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int a = tris[i + k];
+				unsigned int b = tris[i + (k + 1) % 3];
+				Quadric q = quadrics[positionId[a]];
+				q.Add(quadrics[positionId[b]]);
+				if (!locked[a])
+					collapses.push_back({ a, b, (float)q.Error(verts[b].Position) });
+				if (!locked[b])
+					collapses.push_back({ b, a, (float)q.Error(verts[a].Position) });
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+		std::fill(touched.begin(), touched.end(), false);
+		size_t removed = 0;
+		size_t collapsed = 0;
+		for (const Collapse& c : collapses)
+		{
+			if (numTris - removed <= targetTris || c.cost > maxCost)
+				break;
+
+			//every vertex at the "from" position has to move, or the mesh would tear;
+			//each one goes to the vertex at the "to" position it shares a triangle with
+			//(keeping each side of a seam on its own side), or failing that the one
+			//with the closest normal
+			group.clear();
+			bool valid = true;
+			unsigned int v = c.from;
+			do
+			{
+				unsigned int target = ~0u;
+				for (unsigned int j = adjacencyStart[v]; j < adjacencyStart[v + 1] && target == ~0u; j++)
+				{
+					const unsigned int* t = &tris[adjacency[j] * 3];
+					for (int k = 0; k < 3; k++)
+					{
+						if (positionId[t[k]] == positionId[c.to])
+							target = t[k];
+					}
+				}
+				if (target == ~0u)
+				{
+					float bestDot = MinSeamNormalDot;
+					unsigned int candidate = c.to;
+					do
+					{
+						const XMFLOAT3& a = verts[v].normal;
+						const XMFLOAT3& b = verts[candidate].normal;
+						float d = a.x * b.x + a.y * b.y + a.z * b.z;
+						if (d >= bestDot && adjacencyStart[candidate] != adjacencyStart[candidate + 1])
+						{
+							bestDot = d;
+							target = candidate;
+						}
+						candidate = nextWithPosition[candidate];
+					} while (candidate != c.to);
+				}
+				if (target == ~0u || touched[v] || touched[target])
+				{
+					valid = false;
+					break;
+				}
+				group.push_back({ v, target, c.cost });
+				v = nextWithPosition[v];
+			} while (v != c.from);
+			if (!valid)
+				continue;
+
+			//reject collapses that flip (or flatten) a surviving triangle
+			const XMFLOAT3& target = verts[c.to].Position;
+			bool flips = false;
+			size_t dying = 0;
+			for (const Collapse& g : group)
+			{
+				for (unsigned int j = adjacencyStart[g.from]; j < adjacencyStart[g.from + 1] && !flips; j++)
+				{
+					const unsigned int* t = &tris[adjacency[j] * 3];
+					if (t[0] == g.to || t[1] == g.to || t[2] == g.to)
+					{
+						dying++;
+						continue;
+					}
+
+					XMFLOAT3 p[3], moved[3];
+					for (int k = 0; k < 3; k++)
+					{
+						p[k] = verts[t[k]].Position;
+						moved[k] = t[k] == g.from ? target : p[k];
+					}
+					XMFLOAT3 before = TriangleNormal(p[0], p[1], p[2]);
+					XMFLOAT3 after = TriangleNormal(moved[0], moved[1], moved[2]);
+					flips = before.x * after.x + before.y * after.y + before.z * after.z <= 0.0f;
+				}
+			}
+			if (flips)
+				continue;
+
+			//apply it, and freeze the neighbourhood so later collapses this pass see up to date triangles
+			for (const Collapse& g : group)
+			{
+				for (unsigned int j = adjacencyStart[g.from]; j < adjacencyStart[g.from + 1]; j++)
+				{
+					unsigned int* t = &tris[adjacency[j] * 3];
+					for (int k = 0; k < 3; k++)
+					{
+						touched[t[k]] = true;
+						if (t[k] == g.from)
+							t[k] = g.to;
+					}
+				}
+			}
+			quadrics[positionId[c.to]].Add(quadrics[positionId[c.from]]);
+			worstCost = std::max(worstCost, (double)c.cost);
+			removed += dying;
+			collapsed++;
+		}
+
+		if (collapsed == 0)
+			break;
+
+		//drop the triangles that collapsed to lines
+		size_t write = 0;
+		for (size_t i = 0; i < numTris * 3; i += 3)
+		{
+			unsigned int a = tris[i], b = tris[i + 1], c = tris[i + 2];
+			if (a == b || b == c || a == c)
+				continue;
+			tris[write++] = a;
+			tris[write++] = b;
+			tris[write++] = c;
+		}
+		numTris = write / 3;
+	}
+
+	std::copy(tris.begin(), tris.begin() + numTris * 3, outIndices);
+	if (resultError)
+		*resultError = (float)sqrt(worstCost);
+	return numTris * 3;
+}
+
+
+std::vector<MeshLod> MeshSimplifier::BuildLodChain(const Vertex* verts, size_t numVerts, std::vector<unsigned int>& indices)
+{
+	std::vector<MeshLod> lods;
+	size_t fullCount = indices.size();
+	lods.push_back({ 0, (unsigned int)fullCount, 0.0f });
+
+	XMFLOAT3 boundsMin, boundsMax;
+	MeshTools::CalculateBounds(verts, numVerts, boundsMin, boundsMax);
+	float dx = boundsMax.x - boundsMin.x, dy = boundsMax.y - boundsMin.y, dz = boundsMax.z - boundsMin.z;
+	float maxError = sqrtf(dx * dx + dy * dy + dz * dz) * MeshLodMaxError;
+
+	//every LOD starts from the full mesh, so errors are against the real surface
+	std::vector<unsigned int> lod(fullCount);
+	for (float ratio : MeshLodRatios)
+	{
+		size_t target = (size_t)(fullCount / 3 * ratio) * 3;
+		float error = 0.0f;
+		size_t count = Simplify(verts, numVerts, indices.data(), fullCount, target, maxError, lod.data(), &error);
+
+		//not worth another level if the error bound stopped it early
+		if (count == 0 || count > lods.back().indexCount * 8 / 10)
+			break;
+
+		MeshOptimizer::OptimizeVertexCache(lod.data(), count, numVerts);
+		lods.push_back({ (unsigned int)indices.size(), (unsigned int)count, error });
+		indices.insert(indices.end(), lod.begin(), lod.begin() + count);
+	}
+	return lods;
+}
+
+
+// --------------------------------------------------------
+// Builds each subset's chain separately, then lays the
+// levels out one after another with every subset's part
+// of a level next to each other
+// --------------------------------------------------------
+std::vector<MeshLod> MeshSimplifier::BuildLodChain(const Vertex* verts, size_t numVerts, std::vector<unsigned int>& indices,
+	MeshSubset* subsets, size_t numSubsets)
+{
+	std::vector<MeshLod> lods;
+	lods.push_back({ 0, (unsigned int)indices.size(), 0.0f });
+
+	std::vector<std::vector<unsigned int>> subsetIndices(numSubsets);
+	std::vector<std::vector<MeshLod>> subsetLods(numSubsets);
+	size_t levels = 1;
+	for (size_t s = 0; s < numSubsets; s++)
+	{
+		const MeshLod& full = subsets[s].lods[0];
+		subsetIndices[s].assign(indices.begin() + full.startIndex, indices.begin() + full.startIndex + full.indexCount);
+		subsetLods[s] = BuildLodChain(verts, numVerts, subsetIndices[s]);
+		levels = std::max(levels, subsetLods[s].size());
+	}
+
+	for (size_t level = 1; level < levels; level++)
+	{
+		MeshLod lod = { (unsigned int)indices.size(), 0, 0.0f };
+		for (size_t s = 0; s < numSubsets; s++)
+		{
+			const MeshLod& source = subsetLods[s][std::min(level, subsetLods[s].size() - 1)];
+			subsets[s].lods[level] = { (unsigned int)indices.size(), source.indexCount, source.error };
+			indices.insert(indices.end(), subsetIndices[s].begin() + source.startIndex,
+				subsetIndices[s].begin() + source.startIndex + source.indexCount);
+			lod.indexCount += source.indexCount;
+			lod.error = std::max(lod.error, source.error);
+		}
+		lods.push_back(lod);
+	}
+	return lods;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include "Vertex.h"
+
+// One level of detail: a range of the mesh's index buffer
+// - error is the simplifier's worst case distance from the
+//   full resolution surface, in the mesh's local units
+struct MeshLod
+{
+	unsigned int startIndex;
+	unsigned int indexCount;
+	float error;
+};
+
+// Triangle ratios for the generated chain (LOD0 is always the full mesh)
+const float MeshLodRatios[] = { 0.5f, 0.25f, 0.125f };
+const size_t MeshMaxLods = 1 + sizeof(MeshLodRatios) / sizeof(MeshLodRatios[0]);
+
+// Error limit for generated LODs, relative to the bounding box diagonal
+const float MeshLodMaxError = 0.02f;
+
+// The triangles of a mesh drawn with one material
+// - lods[i] lies inside the mesh's LOD i, subsets that ran out
+//   of LODs early repeat their coarsest one so every mesh LOD
+//   is still the whole mesh
+// - Meshlets (LOD0 only) are grouped by subset as well
+struct MeshSubset
+{
+	MeshLod lods[MeshMaxLods];
+	unsigned int firstMeshlet;
+	unsigned int meshletCount;
+};
+
+// --------------------------------------------------------
+// Quadric error metric simplification (Garland & Heckbert)
+//
+// - Only collapses edges onto existing vertices, so every
+//   LOD shares the original vertex buffer
+// - UV/normal seams only collapse along themselves and
+//   open borders are locked, so LODs don't tear
+// --------------------------------------------------------
+namespace MeshSimplifier
+{
+	// Writes at most numIndices indices to outIndices and returns how many
+	// were written; stops at targetIndexCount or when the next collapse
+	// would go over maxError (in mesh units)
+	size_t Simplify(const Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices,
+		size_t targetIndexCount, float maxError, unsigned int* outIndices, float* resultError = nullptr);
+
+	// Appends the LOD chain to the index buffer (which must hold just LOD0)
+	// and returns every LOD including LOD0
+	std::vector<MeshLod> BuildLodChain(const Vertex* verts, size_t numVerts, std::vector<unsigned int>& indices);
+
+	// Same, but each subset is simplified on its own so no triangle changes
+	// material; subsets[i].lods[0] must already hold its LOD0 range
+	std::vector<MeshLod> BuildLodChain(const Vertex* verts, size_t numVerts, std::vector<unsigned int>& indices,
+		MeshSubset* subsets, size_t numSubsets);
+}
@@ -0,0 +1,410 @@
+#include "MeshTools.h"
+#include "MeshOptimizer.h"
+#include "WorkerThreads.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define MESH_TOOLS_SSE 1
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	//triangles per thread before splitting up the tangent pass is worth it
+	const size_t MinTangentChunkSize = 1 << 15;
+
+	// Bitwise copy of a position, for welding
+	struct PositionKey
+	{
+		uint32_t bits[3];
+		bool operator==(const PositionKey& other) const { return memcmp(bits, other.bits, sizeof(bits)) == 0; }
+	};
+
+	struct PositionKeyHash
+	{
+		size_t operator()(const PositionKey& key) const
+		{
+			uint64_t h = 0x9E3779B97F4A7C15ULL;
+			for (uint32_t b : key.bits)
+				h = (h ^ b) * 0x100000001B3ULL;
+			return (size_t)(h ^ (h >> 32));
+		}
+	};
+
+	// Sums each triangle's (unnormalized) tangent into its three vertices
+	void AccumulateTangents(const Vertex* verts, const unsigned int* indices, size_t firstTri, size_t lastTri, XMFLOAT3* accum)
+	{
+		size_t t = firstTri;
+
+#ifdef MESH_TOOLS_SSE
+		//four triangles at a time; the math is in the same order as the
+		//scalar loop below so the results match it exactly
+		alignas(16) float tx[4], ty[4], tz[4];
+		for (; t + 4 <= lastTri; t += 4)
+		{
+			const unsigned int* tri = &indices[t * 3];
+
+			//Position and uv.x are adjacent, so one load and a transpose
+			//gives x/y/z/u for four vertices; v is gathered separately
+			__m128 x[3], y[3], z[3], u[3], v[3];
+			for (int k = 0; k < 3; k++)
+			{
+				const Vertex& p0 = verts[tri[k]];
+				const Vertex& p1 = verts[tri[3 + k]];
+				const Vertex& p2 = verts[tri[6 + k]];
+				const Vertex& p3 = verts[tri[9 + k]];
+				__m128 r0 = _mm_loadu_ps(&p0.Position.x);
+				__m128 r1 = _mm_loadu_ps(&p1.Position.x);
+				__m128 r2 = _mm_loadu_ps(&p2.Position.x);
+				__m128 r3 = _mm_loadu_ps(&p3.Position.x);
+				_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+				x[k] = r0;
+				y[k] = r1;
+				z[k] = r2;
+				u[k] = r3;
+				v[k] = _mm_setr_ps(p0.uv.y, p1.uv.y, p2.uv.y, p3.uv.y);
+			}
+
+			__m128 x1 = _mm_sub_ps(x[1], x[0]);
+			__m128 y1 = _mm_sub_ps(y[1], y[0]);
+			__m128 z1 = _mm_sub_ps(z[1], z[0]);
+			__m128 x2 = _mm_sub_ps(x[2], x[0]);
+			__m128 y2 = _mm_sub_ps(y[2], y[0]);
+			__m128 z2 = _mm_sub_ps(z[2], z[0]);
+
+			__m128 s1 = _mm_sub_ps(u[1], u[0]);
+			__m128 t1 = _mm_sub_ps(v[1], v[0]);
+			__m128 s2 = _mm_sub_ps(u[2], u[0]);
+			__m128 t2 = _mm_sub_ps(v[2], v[0]);
+
+			__m128 r = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1)));
+
+			_mm_store_ps(tx, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, x1), _mm_mul_ps(t1, x2)), r));
+			_mm_store_ps(ty, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, y1), _mm_mul_ps(t1, y2)), r));
+			_mm_store_ps(tz, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, z1), _mm_mul_ps(t1, z2)), r));
+
+			//scatter stays scalar, triangles can share vertices
+			for (int j = 0; j < 4; j++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					XMFLOAT3& sum = accum[tri[j * 3 + k]];
+					sum.x += tx[j];
+					sum.y += ty[j];
+					sum.z += tz[j];
+				}
+			}
+		}
+#endif
+
+		for (; t < lastTri; t++)
+		{
+			// Grab indices and vertices of the triangle
+			unsigned int i1 = indices[t * 3];
+			unsigned int i2 = indices[t * 3 + 1];
+			unsigned int i3 = indices[t * 3 + 2];
+			const Vertex* v1 = &verts[i1];
+			const Vertex* v2 = &verts[i2];
+			const Vertex* v3 = &verts[i3];
+
+			// Calculate vectors relative to triangle positions
+			float x1 = v2->Position.x - v1->Position.x;
+			float y1 = v2->Position.y - v1->Position.y;
+			float z1 = v2->Position.z - v1->Position.z;
+
+			float x2 = v3->Position.x - v1->Position.x;
+			float y2 = v3->Position.y - v1->Position.y;
+			float z2 = v3->Position.z - v1->Position.z;
+
+			// Do the same for vectors relative to triangle uv's
+			float s1 = v2->uv.x - v1->uv.x;
+			float t1 = v2->uv.y - v1->uv.y;
+
+			float s2 = v3->uv.x - v1->uv.x;
+			float t2 = v3->uv.y - v1->uv.y;
+
+			// Create vectors for tangent calculation
+			float r = 1.0f / (s1 * t2 - s2 * t1);
+
+			float tx = (t2 * x1 - t1 * x2) * r;
+			float ty = (t2 * y1 - t1 * y2) * r;
+			float tz = (t2 * z1 - t1 * z2) * r;
+
+			// Adjust tangents of each vert of the triangle
+			accum[i1].x += tx;
+			accum[i1].y += ty;
+			accum[i1].z += tz;
+
+			accum[i2].x += tx;
+			accum[i2].y += ty;
+			accum[i2].z += tz;
+
+			accum[i3].x += tx;
+			accum[i3].y += ty;
+			accum[i3].z += tz;
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Author: Chris Cascioli
+// Purpose: Calculates the tangents of the vertices in a mesh
+// 
+// - You are allowed to directly copy/paste this into your code base
+//   for assignments, given that you clearly cite that this is not
+//   code of your own design.
+//
+// - Code originally adapted from: http://www.terathon.com/code/tangent.html
+//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
+//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
+//
+// - Note: For this code to work, your Vertex format must
+//         contain an XMFLOAT3 called Tangent
+//
+// - Be sure to call this BEFORE creating your D3D vertex/index buffers
+//
+// - Triangles are done four at a time with SSE, and big meshes are
+//   split across threads that each sum into their own array; the
+//   arrays are added together per vertex before orthonormalizing
+// - With one thread the result is bit-identical to the scalar loop
+// --------------------------------------------------------
+void MeshTools::CalculateTangents(Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices, unsigned int threadCount)
+{
+	size_t numTris = numIndices / 3;
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	unsigned int chunkCount = (unsigned int)std::max<size_t>(1, std::min<size_t>(threadCount, numTris / MinTangentChunkSize));
+
+	// Each chunk of triangles sums into its own zeroed array
+	std::vector<std::vector<XMFLOAT3>> sums(chunkCount);
+	RunOnThreads(chunkCount, 0, numTris, [&](unsigned int chunk, size_t first, size_t last)
+		{
+			std::vector<XMFLOAT3>& sum = sums[chunk];
+			sum.assign(numVerts, XMFLOAT3(0, 0, 0));
+			AccumulateTangents(verts, indices, first, last, sum.data());
+		});
+
+	// Add the chunks together, then ensure all of the tangents
+	// are orthogonal to the normals
+	RunOnThreads(chunkCount, 0, numVerts, [&](unsigned int, size_t first, size_t last)
+		{
+			for (size_t i = first; i < last; i++)
+			{
+				XMFLOAT3 sum = sums[0][i];
+				for (size_t c = 1; c < chunkCount; c++)
+				{
+					sum.x += sums[c][i].x;
+					sum.y += sums[c][i].y;
+					sum.z += sums[c][i].z;
+				}
+
+				// Grab the two vectors
+				XMVECTOR normal = XMLoadFloat3(&verts[i].normal);
+				XMVECTOR tangent = XMLoadFloat3(&sum);
+
+				// Use Gram-Schmidt orthonormalize to ensure
+				// the normal and tangent are exactly 90 degrees apart
+				tangent = XMVector3Normalize(
+					tangent - normal * XMVector3Dot(normal, tangent));
+
+				// Store the tangent
+				XMStoreFloat3(&verts[i].tangent, tangent);
+			}
+		});
+}
+
+
+// Straight from the original, only the loop counters changed (size_t, and
+// stopping at the last whole triangle)
+void MeshTools::CalculateTangentsReference(Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices)
+{
+	// Reset tangents
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		verts[i].tangent = XMFLOAT3(0, 0, 0);
+	}
+
+	// Calculate tangents one whole triangle at a time
+	for (size_t i = 0; i + 3 <= numIndices;)
+	{
+		// Grab indices and vertices of first triangle
+		unsigned int i1 = indices[i++];
+		unsigned int i2 = indices[i++];
+		unsigned int i3 = indices[i++];
+		Vertex* v1 = &verts[i1];
+		Vertex* v2 = &verts[i2];
+		Vertex* v3 = &verts[i3];
+
+		// Calculate vectors relative to triangle positions
+		float x1 = v2->Position.x - v1->Position.x;
+		float y1 = v2->Position.y - v1->Position.y;
+		float z1 = v2->Position.z - v1->Position.z;
+
+		float x2 = v3->Position.x - v1->Position.x;
+		float y2 = v3->Position.y - v1->Position.y;
+		float z2 = v3->Position.z - v1->Position.z;
+
+		// Do the same for vectors relative to triangle uv's
+		float s1 = v2->uv.x - v1->uv.x;
+		float t1 = v2->uv.y - v1->uv.y;
+
+		float s2 = v3->uv.x - v1->uv.x;
+		float t2 = v3->uv.y - v1->uv.y;
+
+		// Create vectors for tangent calculation
+		float r = 1.0f / (s1 * t2 - s2 * t1);
+
+		float tx = (t2 * x1 - t1 * x2) * r;
+		float ty = (t2 * y1 - t1 * y2) * r;
+		float tz = (t2 * z1 - t1 * z2) * r;
+
+		// Adjust tangents of each vert of the triangle
+		v1->tangent.x += tx;
+		v1->tangent.y += ty;
+		v1->tangent.z += tz;
+
+		v2->tangent.x += tx;
+		v2->tangent.y += ty;
+		v2->tangent.z += tz;
+
+		v3->tangent.x += tx;
+		v3->tangent.y += ty;
+		v3->tangent.z += tz;
+	}
+
+	// Ensure all of the tangents are orthogonal to the normals
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		// Grab the two vectors
+		XMVECTOR normal = XMLoadFloat3(&verts[i].normal);
+		XMVECTOR tangent = XMLoadFloat3(&verts[i].tangent);
+
+		// Use Gram-Schmidt orthonormalize to ensure
+		// the normal and tangent are exactly 90 degrees apart
+		tangent = XMVector3Normalize(
+			tangent - normal * XMVector3Dot(normal, tangent));
+
+		// Store the tangent
+		XMStoreFloat3(&verts[i].tangent, tangent);
+	}
+}
+
+
+// --------------------------------------------------------
+// Axis aligned bounds of the vertex positions
+//
+// - SSE keeps two min/max pairs going so neighbouring
+//   vertices don't wait on each other
+// --------------------------------------------------------
+void MeshTools::CalculateBounds(const Vertex* verts, size_t numVerts, XMFLOAT3& boundsMin, XMFLOAT3& boundsMax)
+{
+	if (numVerts == 0)
+	{
+		boundsMin = XMFLOAT3(0, 0, 0);
+		boundsMax = XMFLOAT3(0, 0, 0);
+		return;
+	}
+
+	boundsMin = verts[0].Position;
+	boundsMax = verts[0].Position;
+	size_t i = 1;
+
+#ifdef MESH_TOOLS_SSE
+	//loading 4 floats also picks up uv.x, which is still inside the vertex
+	static_assert(offsetof(Vertex, Position) + sizeof(float) * 4 <= sizeof(Vertex), "position loads would run past the vertex");
+	__m128 min0 = _mm_loadu_ps(&verts[0].Position.x);
+	__m128 max0 = min0;
+	__m128 min1 = min0;
+	__m128 max1 = min0;
+	for (; i + 2 <= numVerts; i += 2)
+	{
+		__m128 p0 = _mm_loadu_ps(&verts[i].Position.x);
+		__m128 p1 = _mm_loadu_ps(&verts[i + 1].Position.x);
+		min0 = _mm_min_ps(min0, p0);
+		max0 = _mm_max_ps(max0, p0);
+		min1 = _mm_min_ps(min1, p1);
+		max1 = _mm_max_ps(max1, p1);
+	}
+	alignas(16) float lo[4], hi[4];
+	_mm_store_ps(lo, _mm_min_ps(min0, min1));
+	_mm_store_ps(hi, _mm_max_ps(max0, max1));
+	boundsMin = XMFLOAT3(lo[0], lo[1], lo[2]);
+	boundsMax = XMFLOAT3(hi[0], hi[1], hi[2]);
+#endif
+
+	for (; i < numVerts; i++)
+	{
+		const XMFLOAT3& p = verts[i].Position;
+		boundsMin.x = p.x < boundsMin.x ? p.x : boundsMin.x;
+		boundsMin.y = p.y < boundsMin.y ? p.y : boundsMin.y;
+		boundsMin.z = p.z < boundsMin.z ? p.z : boundsMin.z;
+		boundsMax.x = p.x > boundsMax.x ? p.x : boundsMax.x;
+		boundsMax.y = p.y > boundsMax.y ? p.y : boundsMax.y;
+		boundsMax.z = p.z > boundsMax.z ? p.z : boundsMax.z;
+	}
+}
+
+
+// --------------------------------------------------------
+// Depth-only passes don't care about UV or normal seams, so
+// vertices that only differ there can be merged, which means
+// fewer vertex shader runs on top of the smaller vertices
+//
+// - Triangles that collapse once welded (only possible when
+//   they had zero area to begin with) are dropped
+// - Positions end up in first-use order, like
+//   MeshOptimizer::OptimizeVertexFetch
+// --------------------------------------------------------
+void MeshTools::BuildPositionStream(const Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices,
+	std::vector<XMFLOAT3>& positions, std::vector<unsigned int>& positionIndices)
+{
+	//exact (bitwise) matches only, so nothing moves
+	std::unordered_map<PositionKey, unsigned int, PositionKeyHash> welded;
+	welded.reserve(numVerts);
+	std::vector<unsigned int> remap(numVerts);
+	std::vector<XMFLOAT3> unique;
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		PositionKey key;
+		memcpy(key.bits, &verts[i].Position, sizeof(key.bits));
+		auto it = welded.emplace(key, (unsigned int)unique.size());
+		if (it.second)
+			unique.push_back(verts[i].Position);
+		remap[i] = it.first->second;
+	}
+
+	positionIndices.clear();
+	positionIndices.reserve(numIndices);
+	for (size_t i = 0; i + 2 < numIndices; i += 3)
+	{
+		unsigned int a = remap[indices[i]];
+		unsigned int b = remap[indices[i + 1]];
+		unsigned int c = remap[indices[i + 2]];
+		if (a != b && b != c && a != c)
+			positionIndices.insert(positionIndices.end(), { a, b, c });
+	}
+
+	//fewer, shared vertices means a different best triangle order
+	MeshOptimizer::OptimizeVertexCache(positionIndices.data(), positionIndices.size(), unique.size());
+
+	std::vector<unsigned int> order(unique.size(), ~0u);
+	positions.clear();
+	positions.reserve(unique.size());
+	for (unsigned int& index : positionIndices)
+	{
+		if (order[index] == ~0u)
+		{
+			order[index] = (unsigned int)positions.size();
+			positions.push_back(unique[index]);
+		}
+		index = order[index];
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// CPU-side helpers for processing vertex/index data
+//
+// - None of these touch Direct3D, so they can be shared by
+//   Mesh and by offline tools like the MeshConverter
+// - threadCount of 0 picks one thread per hardware core
+// --------------------------------------------------------
+namespace MeshTools
+{
+	void CalculateTangents(Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices, unsigned int threadCount = 0);
+
+	// The original one triangle at a time version, kept as the
+	// reference MeshConverter --tangents checks the fast one against
+	void CalculateTangentsReference(Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices);
+
+	void CalculateBounds(const Vertex* verts, size_t numVerts, DirectX::XMFLOAT3& boundsMin, DirectX::XMFLOAT3& boundsMax);
+
+	// Positions welded on their own (ignoring UV/normal seams) with
+	// their own cache optimized indices, for depth-only passes
+	void BuildPositionStream(const Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices,
+		std::vector<DirectX::XMFLOAT3>& positions, std::vector<unsigned int>& positionIndices);
+}
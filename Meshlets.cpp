@@ -0,0 +1,336 @@
+#include "Meshlets.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	inline XMFLOAT3 Sub(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	inline float Dot(const XMFLOAT3& a, const XMFLOAT3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline float Length(const XMFLOAT3& a) { return sqrtf(Dot(a, a)); }
+
+	inline XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	// Below this the normals spread too far for the cone to ever reject
+	// anything useful (cos of ~84 degrees)
+	const float MinConeSpread = 0.1f;
+
+	void ComputeBounds(Meshlet& meshlet, const Vertex* verts, const unsigned int* indices)
+	{
+		const unsigned int* tris = indices + meshlet.startIndex;
+		unsigned int numIndices = meshlet.triangleCount * 3;
+
+		//sphere around the center of the box, good enough for small clusters
+		XMFLOAT3 boxMin = verts[tris[0]].Position;
+		XMFLOAT3 boxMax = boxMin;
+		for (unsigned int i = 1; i < numIndices; i++)
+		{
+			const XMFLOAT3& p = verts[tris[i]].Position;
+			boxMin = XMFLOAT3(std::min(boxMin.x, p.x), std::min(boxMin.y, p.y), std::min(boxMin.z, p.z));
+			boxMax = XMFLOAT3(std::max(boxMax.x, p.x), std::max(boxMax.y, p.y), std::max(boxMax.z, p.z));
+		}
+		meshlet.center = XMFLOAT3((boxMin.x + boxMax.x) * 0.5f, (boxMin.y + boxMax.y) * 0.5f, (boxMin.z + boxMax.z) * 0.5f);
+		meshlet.radius = 0.0f;
+		for (unsigned int i = 0; i < numIndices; i++)
+			meshlet.radius = std::max(meshlet.radius, Length(Sub(verts[tris[i]].Position, meshlet.center)));
+
+		//face normals (clockwise front faces, so this points out of the front)
+		std::vector<XMFLOAT3> normals;
+		normals.reserve(meshlet.triangleCount);
+		XMFLOAT3 axis(0, 0, 0);
+		for (unsigned int i = 0; i < numIndices; i += 3)
+		{
+			const XMFLOAT3& a = verts[tris[i]].Position;
+			const XMFLOAT3& b = verts[tris[i + 1]].Position;
+			const XMFLOAT3& c = verts[tris[i + 2]].Position;
+			XMFLOAT3 n = Cross(Sub(b, a), Sub(c, a));
+			float length = Length(n);
+			if (length == 0.0f)
+				continue;
+
+			n = XMFLOAT3(n.x / length, n.y / length, n.z / length);
+			normals.push_back(n);
+			axis = XMFLOAT3(axis.x + n.x, axis.y + n.y, axis.z + n.z);
+		}
+
+		meshlet.coneApex = meshlet.center;
+		meshlet.coneAxis = XMFLOAT3(0, 0, 0);
+		meshlet.coneCutoff = 1.0f;
+
+		float axisLength = Length(axis);
+		if (axisLength == 0.0f)
+			return;
+		axis = XMFLOAT3(axis.x / axisLength, axis.y / axisLength, axis.z / axisLength);
+
+		meshlet.coneAxis = axis;
+
+		float minDot = 1.0f;
+		for (const XMFLOAT3& n : normals)
+			minDot = std::min(minDot, Dot(n, axis));
+		if (minDot <= MinConeSpread)
+			return;
+
+		//slide the apex back along the axis until every triangle plane is
+		//in front of it, then "camera inside the cone" means all backfacing
+		float maxT = 0.0f;
+		size_t n = 0;
+		for (unsigned int i = 0; i < numIndices; i += 3)
+		{
+			const XMFLOAT3& a = verts[tris[i]].Position;
+			const XMFLOAT3& b = verts[tris[i + 1]].Position;
+			const XMFLOAT3& c = verts[tris[i + 2]].Position;
+			if (Length(Cross(Sub(b, a), Sub(c, a))) == 0.0f)
+				continue;
+
+			const XMFLOAT3& normal = normals[n++];
+			float t = Dot(Sub(meshlet.center, a), normal) / Dot(axis, normal);
+			maxT = std::max(maxT, t);
+		}
+
+		meshlet.coneApex = XMFLOAT3(meshlet.center.x - axis.x * maxT, meshlet.center.y - axis.y * maxT, meshlet.center.z - axis.z * maxT);
+		meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+	}
+}
+
+
+// --------------------------------------------------------
+// Greedy clustering: seed a meshlet with the next unused
+// triangle (in cache optimized order), then keep adding the
+// neighbouring triangle that brings in the fewest new verts,
+// breaking ties by how well it lines up with the meshlet's
+// average normal so the backface cones stay narrow
+//
+// Finished meshlets are sorted outward-facing first, since
+// those are the likeliest to hide the rest (Sander et al.
+// 2007), and the index buffer is rewritten to match
+// --------------------------------------------------------
+std::vector<Meshlet> Meshlets::Build(const Vertex* verts, size_t numVerts, unsigned int* indices, size_t numIndices)
+{
+	std::vector<Meshlet> meshlets;
+	size_t numTris = numIndices / 3;
+	if (numTris == 0)
+		return meshlets;
+
+	//vertex -> triangle adjacency
+	std::vector<unsigned int> adjacencyStart(numVerts + 1, 0);
+	for (size_t i = 0; i < numTris * 3; i++)
+		adjacencyStart[indices[i] + 1]++;
+	for (size_t v = 0; v < numVerts; v++)
+		adjacencyStart[v + 1] += adjacencyStart[v];
+	std::vector<unsigned int> adjacency(numTris * 3);
+	std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t i = 0; i < numTris * 3; i++)
+		adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+	std::vector<XMFLOAT3> triNormals(numTris);
+	for (size_t t = 0; t < numTris; t++)
+	{
+		const XMFLOAT3& a = verts[indices[t * 3]].Position;
+		XMFLOAT3 n = Cross(Sub(verts[indices[t * 3 + 1]].Position, a), Sub(verts[indices[t * 3 + 2]].Position, a));
+		float length = Length(n);
+		triNormals[t] = length > 0.0f ? XMFLOAT3(n.x / length, n.y / length, n.z / length) : XMFLOAT3(0, 0, 0);
+	}
+
+	std::vector<bool> emitted(numTris, false);
+	std::vector<unsigned int> lastMeshlet(numVerts, ~0u);
+	std::vector<unsigned int> meshletVerts;
+	std::vector<unsigned int> clusteredTris;
+	clusteredTris.reserve(numTris);
+
+	size_t seed = 0;
+	while (true)
+	{
+		while (seed < numTris && emitted[seed])
+			seed++;
+		if (seed == numTris)
+			break;
+
+		unsigned int id = (unsigned int)meshlets.size();
+		Meshlet current = {};
+		current.startIndex = (unsigned int)clusteredTris.size() * 3;
+		meshletVerts.clear();
+		XMFLOAT3 normalSum(0, 0, 0);
+
+		size_t next = seed;
+		while (next != numTris)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int v = indices[next * 3 + k];
+				if (lastMeshlet[v] != id)
+				{
+					lastMeshlet[v] = id;
+					meshletVerts.push_back(v);
+				}
+			}
+			clusteredTris.push_back((unsigned int)next);
+			emitted[next] = true;
+			current.triangleCount++;
+			normalSum = XMFLOAT3(normalSum.x + triNormals[next].x, normalSum.y + triNormals[next].y, normalSum.z + triNormals[next].z);
+			if (current.triangleCount == MeshletMaxTriangles)
+				break;
+
+			//best unused triangle touching the meshlet
+			size_t best = numTris;
+			unsigned int bestNew = 4;
+			float bestDot = -2.0f;
+			for (unsigned int v : meshletVerts)
+			{
+				for (unsigned int j = adjacencyStart[v]; j < adjacencyStart[v + 1]; j++)
+				{
+					unsigned int t = adjacency[j];
+					if (emitted[t])
+						continue;
+
+					unsigned int a = indices[t * 3], b = indices[t * 3 + 1], c = indices[t * 3 + 2];
+					unsigned int newVerts =
+						(lastMeshlet[a] != id) +
+						(lastMeshlet[b] != id && b != a) +
+						(lastMeshlet[c] != id && c != a && c != b);
+					if (meshletVerts.size() + newVerts > MeshletMaxVertices || newVerts > bestNew)
+						continue;
+
+					float d = Dot(triNormals[t], normalSum);
+					if (newVerts < bestNew || d > bestDot)
+					{
+						best = t;
+						bestNew = newVerts;
+						bestDot = d;
+					}
+				}
+			}
+			next = best;
+		}
+
+		current.vertexCount = (unsigned int)meshletVerts.size();
+		meshlets.push_back(current);
+	}
+
+	//within a meshlet, go back to the vertex cache optimized order
+	std::vector<unsigned int> clustered;
+	clustered.reserve(numTris * 3);
+	for (Meshlet& meshlet : meshlets)
+	{
+		auto first = clusteredTris.begin() + meshlet.startIndex / 3;
+		std::sort(first, first + meshlet.triangleCount);
+		for (auto t = first; t != first + meshlet.triangleCount; ++t)
+			clustered.insert(clustered.end(), indices + *t * 3, indices + *t * 3 + 3);
+		ComputeBounds(meshlet, verts, clustered.data());
+	}
+
+	//outward-facing meshlets first, so they can occlude the rest
+	XMFLOAT3 meshCenter(0, 0, 0);
+	for (const Meshlet& meshlet : meshlets)
+	{
+		float weight = (float)meshlet.triangleCount / numTris;
+		meshCenter = XMFLOAT3(meshCenter.x + meshlet.center.x * weight, meshCenter.y + meshlet.center.y * weight, meshCenter.z + meshlet.center.z * weight);
+	}
+	std::vector<float> sortKeys(meshlets.size());
+	std::vector<unsigned int> order(meshlets.size());
+	for (size_t i = 0; i < meshlets.size(); i++)
+	{
+		sortKeys[i] = Dot(Sub(meshlets[i].center, meshCenter), meshlets[i].coneAxis);
+		order[i] = (unsigned int)i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<Meshlet> sorted;
+	sorted.reserve(meshlets.size());
+	unsigned int* out = indices;
+	for (unsigned int i : order)
+	{
+		Meshlet meshlet = meshlets[i];
+		const unsigned int* source = clustered.data() + meshlet.startIndex;
+		meshlet.startIndex = (unsigned int)(out - indices);
+		out = std::copy(source, source + meshlet.triangleCount * 3, out);
+		sorted.push_back(meshlet);
+	}
+	return sorted;
+}
+
+
+void Meshlets::UpdateBounds(Meshlet* meshlets, size_t numMeshlets, const Vertex* verts, const unsigned int* indices)
+{
+	for (size_t i = 0; i < numMeshlets; i++)
+		ComputeBounds(meshlets[i], verts, indices);
+}
+
+
+// --------------------------------------------------------
+// Gribb/Hartmann plane extraction, using D3D's 0..w depth
+// --------------------------------------------------------
+MeshletCullParams Meshlets::MakeCullParams(const XMFLOAT4X4& m, const XMFLOAT3& localCameraPosition, bool coneCulling)
+{
+	MeshletCullParams params = {};
+	params.cameraPosition = localCameraPosition;
+	params.coneCulling = coneCulling;
+
+	//row vectors (v * M), so the planes come from the columns
+	XMFLOAT4 col0(m._11, m._21, m._31, m._41);
+	XMFLOAT4 col1(m._12, m._22, m._32, m._42);
+	XMFLOAT4 col2(m._13, m._23, m._33, m._43);
+	XMFLOAT4 col3(m._14, m._24, m._34, m._44);
+
+	params.frustum[0] = XMFLOAT4(col3.x + col0.x, col3.y + col0.y, col3.z + col0.z, col3.w + col0.w); //left
+	params.frustum[1] = XMFLOAT4(col3.x - col0.x, col3.y - col0.y, col3.z - col0.z, col3.w - col0.w); //right
+	params.frustum[2] = XMFLOAT4(col3.x + col1.x, col3.y + col1.y, col3.z + col1.z, col3.w + col1.w); //bottom
+	params.frustum[3] = XMFLOAT4(col3.x - col1.x, col3.y - col1.y, col3.z - col1.z, col3.w - col1.w); //top
+	params.frustum[4] = col2; //near
+	params.frustum[5] = XMFLOAT4(col3.x - col2.x, col3.y - col2.y, col3.z - col2.z, col3.w - col2.w); //far
+
+	//normalize so sphere radii can be compared directly
+	for (XMFLOAT4& plane : params.frustum)
+	{
+		float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		if (length > 0.0f)
+			plane = XMFLOAT4(plane.x / length, plane.y / length, plane.z / length, plane.w / length);
+	}
+	return params;
+}
+
+
+bool Meshlets::IsVisible(const Meshlet& meshlet, const MeshletCullParams& params)
+{
+	for (const XMFLOAT4& plane : params.frustum)
+	{
+		if (plane.x * meshlet.center.x + plane.y * meshlet.center.y + plane.z * meshlet.center.z + plane.w < -meshlet.radius)
+			return false;
+	}
+
+	if (params.coneCulling && meshlet.coneCutoff < 1.0f)
+	{
+		XMFLOAT3 toApex = Sub(meshlet.coneApex, params.cameraPosition);
+		if (Dot(toApex, meshlet.coneAxis) >= meshlet.coneCutoff * Length(toApex))
+			return false;
+	}
+	return true;
+}
+
+
+size_t Meshlets::Cull(const Meshlet* meshlets, size_t numMeshlets, const MeshletCullParams& params, std::vector<IndexRange>& ranges)
+{
+	size_t culled = 0;
+	bool extendLast = false;
+	for (size_t i = 0; i < numMeshlets; i++)
+	{
+		const Meshlet& meshlet = meshlets[i];
+		if (!IsVisible(meshlet, params))
+		{
+			culled += meshlet.triangleCount;
+			extendLast = false;
+			continue;
+		}
+
+		//neighbours in the index buffer become a single draw
+		if (extendLast)
+			ranges.back().indexCount += meshlet.triangleCount * 3;
+		else
+			ranges.push_back({ meshlet.startIndex, meshlet.triangleCount * 3 });
+		extendLast = true;
+	}
+	return culled;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "Vertex.h"
+
+// Limits match the common mesh shader sizes, so the clusters
+// stay useful if we ever move to GPU culling
+const unsigned int MeshletMaxVertices = 64;
+const unsigned int MeshletMaxTriangles = 124;
+
+// A contiguous run of triangles in a mesh's index buffer
+// - Bounds and cone are in the mesh's local space
+// - coneAxis is the average face normal
+// - coneCutoff of 1 means the normals are too spread out to cull
+struct Meshlet
+{
+	unsigned int startIndex;
+	unsigned int triangleCount;
+	unsigned int vertexCount;
+
+	DirectX::XMFLOAT3 center;
+	float radius;
+
+	DirectX::XMFLOAT3 coneApex;
+	DirectX::XMFLOAT3 coneAxis;
+	float coneCutoff;
+};
+
+// A range of indices to hand to DrawIndexed()
+struct IndexRange
+{
+	unsigned int startIndex;
+	unsigned int indexCount;
+};
+
+// Everything needed to cull meshlets for one view, in the mesh's local space
+struct MeshletCullParams
+{
+	DirectX::XMFLOAT4 frustum[6];		// Plane normals point inwards
+	DirectX::XMFLOAT3 cameraPosition;
+	bool coneCulling;					// Turn off for mirrored (negative scale) transforms
+};
+
+// --------------------------------------------------------
+// Splits a mesh into small clusters that can be rejected
+// as a whole on the CPU before drawing
+//
+// - Backface cones assume clockwise front faces (the D3D default)
+// --------------------------------------------------------
+namespace Meshlets
+{
+	// Reorders the triangles so each meshlet is contiguous, run the
+	// vertex cache optimizer first (meshlets are seeded in index order)
+	std::vector<Meshlet> Build(const Vertex* verts, size_t numVerts, unsigned int* indices, size_t numIndices);
+
+	// Recomputes bounds and cones for vertices that have moved (like a
+	// transformed copy of the mesh), keeping the same triangles in each
+	void UpdateBounds(Meshlet* meshlets, size_t numMeshlets, const Vertex* verts, const unsigned int* indices);
+
+	// Frustum planes from a world * view * projection matrix, which
+	// puts them in the mesh's local space
+	MeshletCullParams MakeCullParams(const DirectX::XMFLOAT4X4& worldViewProj, const DirectX::XMFLOAT3& localCameraPosition, bool coneCulling);
+
+	bool IsVisible(const Meshlet& meshlet, const MeshletCullParams& params);
+
+	// Appends the visible index ranges (adjacent meshlets merged)
+	// and returns how many triangles were rejected
+	size_t Cull(const Meshlet* meshlets, size_t numMeshlets, const MeshletCullParams& params, std::vector<IndexRange>& ranges);
+}
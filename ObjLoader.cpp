@@ -0,0 +1,647 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define OBJ_LOADER_SSE2 1
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	//chunks smaller than this aren't worth spinning up a thread for
+	const size_t MinChunkSize = 1 << 20;
+
+	//stop accumulating digits past this so the mantissa can't overflow
+	const uint64_t MaxMantissa = 100000000000000000ULL;
+
+	//exactly representable powers of ten
+	const double Pow10[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	//bits for ObjCorner members that still hold chunk-relative indices
+	const unsigned char RelativePosition = 1;
+	const unsigned char RelativeUV = 2;
+	const unsigned char RelativeNormal = 4;
+
+	//triangles before a chunk's first usemtl, which continue the previous chunk's material
+	const unsigned int InheritMaterial = ~0u;
+
+	// Everything parsed out of one newline-aligned chunk of the file
+	struct ChunkResult
+	{
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT2> uvs;
+		std::vector<XMFLOAT3> normals;
+		std::vector<ObjCorner> corners;
+
+		//negative (relative) indices can't be made absolute until we know
+		//how many elements came before this chunk, so remember where they are
+		std::vector<size_t> positionFixups;
+		std::vector<size_t> uvFixups;
+		std::vector<size_t> normalFixups;
+
+		//material ids are local to the chunk until they're stitched together
+		std::vector<std::string> materials;
+		std::vector<unsigned int> triangleMaterials;
+		unsigned int lastMaterial = InheritMaterial;
+		std::vector<std::string> materialLibraries;
+	};
+
+	inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+	inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+	inline const char* SkipSpaces(const char* p, const char* end)
+	{
+		while (p < end && IsSpace(*p)) p++;
+		return p;
+	}
+
+	inline const char* SkipToken(const char* p, const char* end)
+	{
+		while (p < end && !IsSpace(*p) && *p != '\n') p++;
+		return p;
+	}
+
+	// True if the line starts with keyword followed by a space (or nothing)
+	inline bool IsKeyword(const char* p, const char* lineEnd, const char* keyword)
+	{
+		size_t length = strlen(keyword);
+		return (size_t)(lineEnd - p) >= length && memcmp(p, keyword, length) == 0 &&
+			(p + length == lineEnd || IsSpace(p[length]));
+	}
+
+	// The rest of the line without leading or trailing spaces
+	std::string TrimmedLine(const char* p, const char* lineEnd)
+	{
+		p = SkipSpaces(p, lineEnd);
+		while (lineEnd > p && IsSpace(lineEnd[-1])) lineEnd--;
+		return std::string(p, lineEnd);
+	}
+
+	// Texture maps can have options before the file name ("map_Kd -s 2 2 1 wood.png")
+	std::string LastToken(const char* p, const char* lineEnd)
+	{
+		while (lineEnd > p && IsSpace(lineEnd[-1])) lineEnd--;
+		const char* start = lineEnd;
+		while (start > p && !IsSpace(start[-1])) start--;
+		return std::string(start, lineEnd);
+	}
+
+	// Finds the next '\n' (or end), 16 bytes at a time where SSE2 is available
+	const char* FindNewline(const char* p, const char* end)
+	{
+#ifdef OBJ_LOADER_SSE2
+		const __m128i newline = _mm_set1_epi8('\n');
+		while (end - p >= 16)
+		{
+			__m128i block = _mm_loadu_si128((const __m128i*)p);
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+			if (mask)
+				return p + std::countr_zero(mask);
+			p += 16;
+		}
+#endif
+		while (p < end && *p != '\n') p++;
+		return p;
+	}
+
+	// Hand rolled replacement for strtof/sscanf("%f")
+	// - Handles sign, fraction and exponent
+	// - Always advances past the current token, even if it's garbage
+	float ParseFloat(const char*& p, const char* end)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			p++;
+		}
+
+		uint64_t mantissa = 0;
+		int exponent = 0;
+		while (p < end && IsDigit(*p))
+		{
+			if (mantissa < MaxMantissa) mantissa = mantissa * 10 + (*p - '0');
+			else exponent++;
+			p++;
+		}
+
+		if (p < end && *p == '.')
+		{
+			p++;
+			while (p < end && IsDigit(*p))
+			{
+				if (mantissa < MaxMantissa)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					exponent--;
+				}
+				p++;
+			}
+		}
+
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			p++;
+			bool negativeExp = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				negativeExp = *p == '-';
+				p++;
+			}
+			int e = 0;
+			while (p < end && IsDigit(*p))
+			{
+				if (e < 10000) e = e * 10 + (*p - '0');
+				p++;
+			}
+			exponent += negativeExp ? -e : e;
+		}
+
+		double value = (double)mantissa;
+		if (mantissa != 0)
+		{
+			while (exponent > 22) { value *= 1e22; exponent -= 22; }
+			while (exponent < -22) { value /= 1e22; exponent += 22; }
+			value = exponent < 0 ? value / Pow10[-exponent] : value * Pow10[exponent];
+		}
+
+		p = SkipToken(p, end);
+		return (float)(negative ? -value : value);
+	}
+
+	inline long long ParseInt(const char*& p, const char* end)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			p++;
+		}
+		long long value = 0;
+		while (p < end && IsDigit(*p))
+		{
+			value = value * 10 + (*p - '0');
+			p++;
+		}
+		return negative ? -value : value;
+	}
+
+	// Converts an OBJ index into our 1-based form
+	// - Negative indices are relative to the current element count, which
+	//   we only know for this chunk, so they get flagged for fixup later
+	inline unsigned int ResolveIndex(long long raw, size_t localCount, bool& relative)
+	{
+		relative = raw < 0;
+		if (raw >= 0)
+			return (unsigned int)raw;
+		return (unsigned int)(int)((long long)localCount + raw + 1);
+	}
+
+	void ParseChunk(const char* p, const char* end, ChunkResult& out)
+	{
+		//reused between face lines to avoid allocations
+		std::vector<ObjCorner> polygon;
+		std::vector<unsigned char> polygonFlags;
+		unsigned int material = InheritMaterial;
+
+		while (p < end)
+		{
+			p = SkipSpaces(p, end);
+			const char* lineEnd = FindNewline(p, end);
+
+			if (p + 1 < lineEnd && p[0] == 'v' && p[1] == 'n')
+			{
+				const char* c = p + 2;
+				XMFLOAT3 norm(0, 0, 0);
+				c = SkipSpaces(c, lineEnd); if (c < lineEnd) norm.x = ParseFloat(c, lineEnd);
+				c = SkipSpaces(c, lineEnd); if (c < lineEnd) norm.y = ParseFloat(c, lineEnd);
+				c = SkipSpaces(c, lineEnd); if (c < lineEnd) norm.z = ParseFloat(c, lineEnd);
+				out.normals.push_back(norm);
+			}
+			else if (p + 1 < lineEnd && p[0] == 'v' && p[1] == 't')
+			{
+				const char* c = p + 2;
+				XMFLOAT2 uv(0, 0);
+				c = SkipSpaces(c, lineEnd); if (c < lineEnd) uv.x = ParseFloat(c, lineEnd);
+				c = SkipSpaces(c, lineEnd); if (c < lineEnd) uv.y = ParseFloat(c, lineEnd);
+				out.uvs.push_back(uv);
+			}
+			else if (p < lineEnd && p[0] == 'v' && (p + 1 == lineEnd || IsSpace(p[1])))
+			{
+				const char* c = p + 1;
+				XMFLOAT3 pos(0, 0, 0);
+				c = SkipSpaces(c, lineEnd); if (c < lineEnd) pos.x = ParseFloat(c, lineEnd);
+				c = SkipSpaces(c, lineEnd); if (c < lineEnd) pos.y = ParseFloat(c, lineEnd);
+				c = SkipSpaces(c, lineEnd); if (c < lineEnd) pos.z = ParseFloat(c, lineEnd);
+				out.positions.push_back(pos);
+			}
+			else if (p < lineEnd && p[0] == 'f' && (p + 1 == lineEnd || IsSpace(p[1])))
+			{
+				polygon.clear();
+				polygonFlags.clear();
+
+				//read every "v", "v/vt", "v//vn" or "v/vt/vn" corner on the line
+				const char* c = p + 1;
+				while (true)
+				{
+					c = SkipSpaces(c, lineEnd);
+					if (c >= lineEnd || !(IsDigit(*c) || *c == '-' || *c == '+'))
+						break;
+
+					ObjCorner corner = {};
+					unsigned char flags = 0;
+					bool relative = false;
+
+					corner.position = ResolveIndex(ParseInt(c, lineEnd), out.positions.size(), relative);
+					if (relative) flags |= RelativePosition;
+
+					if (c < lineEnd && *c == '/')
+					{
+						c++;
+						if (c < lineEnd && *c != '/')
+						{
+							corner.uv = ResolveIndex(ParseInt(c, lineEnd), out.uvs.size(), relative);
+							if (relative) flags |= RelativeUV;
+						}
+						if (c < lineEnd && *c == '/')
+						{
+							c++;
+							corner.normal = ResolveIndex(ParseInt(c, lineEnd), out.normals.size(), relative);
+							if (relative) flags |= RelativeNormal;
+						}
+					}
+					c = SkipToken(c, lineEnd);
+
+					polygon.push_back(corner);
+					polygonFlags.push_back(flags);
+				}
+
+				//fan the polygon into triangles (0, i, i+1)
+				for (size_t i = 1; i + 1 < polygon.size(); i++)
+				{
+					size_t tri[3] = { 0, i, i + 1 };
+					for (size_t t : tri)
+					{
+						size_t cornerIndex = out.corners.size();
+						out.corners.push_back(polygon[t]);
+						if (polygonFlags[t] & RelativePosition) out.positionFixups.push_back(cornerIndex);
+						if (polygonFlags[t] & RelativeUV) out.uvFixups.push_back(cornerIndex);
+						if (polygonFlags[t] & RelativeNormal) out.normalFixups.push_back(cornerIndex);
+					}
+					out.triangleMaterials.push_back(material);
+				}
+			}
+			else if (IsKeyword(p, lineEnd, "usemtl"))
+			{
+				std::string name = TrimmedLine(p + 6, lineEnd);
+				auto it = std::find(out.materials.begin(), out.materials.end(), name);
+				material = (unsigned int)(it - out.materials.begin());
+				if (it == out.materials.end())
+					out.materials.push_back(name);
+			}
+			else if (IsKeyword(p, lineEnd, "mtllib"))
+			{
+				//one line can list several libraries
+				const char* c = p + 6;
+				while ((c = SkipSpaces(c, lineEnd)) < lineEnd)
+				{
+					const char* name = c;
+					c = SkipToken(c, lineEnd);
+					out.materialLibraries.emplace_back(name, c);
+				}
+			}
+
+			//anything else (comments, groups, smoothing...) is skipped
+			p = lineEnd + 1;
+		}
+		out.lastMaterial = material;
+	}
+
+	// Hash for welding identical face corners
+	struct ObjCornerHash
+	{
+		size_t operator()(const ObjCorner& c) const
+		{
+			uint64_t h = (uint64_t)c.position * 0x9E3779B97F4A7C15ULL;
+			h ^= (uint64_t)c.uv * 0xC2B2AE3D27D4EB4FULL + (h >> 29);
+			h ^= (uint64_t)c.normal * 0x165667B19E3779F9ULL + (h >> 31);
+			return (size_t)(h ^ (h >> 32));
+		}
+	};
+
+	template<typename T>
+	void AppendRange(std::vector<T>& dest, size_t offset, const std::vector<T>& src)
+	{
+		if (!src.empty())
+			std::copy(src.begin(), src.end(), dest.begin() + offset);
+	}
+}
+
+
+// --------------------------------------------------------
+// Memory maps the file and parses it in place
+// --------------------------------------------------------
+void ObjLoader::ParseFile(const std::wstring& objFile, ObjData& out, unsigned int threadCount)
+{
+	MappedFile file(objFile);
+
+	// Check for successful open
+	if (!file.IsOpen())
+		throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
+
+	ParseBuffer(file.GetData(), file.GetSize(), out, threadCount);
+}
+
+
+void ObjLoader::ParseBuffer(const char* data, size_t size, ObjData& out, unsigned int threadCount)
+{
+	ParseBlock(data, size, 0, 0, 0, out, threadCount);
+}
+
+
+// --------------------------------------------------------
+// Splits the buffer into newline-aligned chunks, parses
+// each on its own thread, then concatenates the results
+// --------------------------------------------------------
+void ObjLoader::ParseBlock(const char* data, size_t size, size_t positionsBefore, size_t uvsBefore, size_t normalsBefore,
+	ObjData& out, unsigned int threadCount)
+{
+	out = {};
+	if (!data || size == 0)
+		return;
+
+	//pick a chunk count based on the file size and available cores
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, size / MinChunkSize));
+
+	//chunk boundaries always sit just past a newline
+	std::vector<const char*> bounds(chunkCount + 1);
+	bounds[0] = data;
+	bounds[chunkCount] = data + size;
+	for (size_t i = 1; i < chunkCount; i++)
+	{
+		const char* guess = std::max(bounds[i - 1], data + size * i / chunkCount);
+		const char* newline = FindNewline(guess, data + size);
+		bounds[i] = newline < data + size ? newline + 1 : data + size;
+	}
+
+	//parse everything (the first chunk runs on this thread)
+	std::vector<ChunkResult> chunks(chunkCount);
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < chunkCount; i++)
+		workers.emplace_back(ParseChunk, bounds[i], bounds[i + 1], std::ref(chunks[i]));
+	ParseChunk(bounds[0], bounds[1], chunks[0]);
+	for (auto& w : workers)
+		w.join();
+
+	//size the output once so the chunks can be copied straight in
+	size_t positionCount = 0, uvCount = 0, normalCount = 0, cornerCount = 0;
+	for (auto& c : chunks)
+	{
+		positionCount += c.positions.size();
+		uvCount += c.uvs.size();
+		normalCount += c.normals.size();
+		cornerCount += c.corners.size();
+	}
+	out.positions.resize(positionCount);
+	out.uvs.resize(uvCount);
+	out.normals.resize(normalCount);
+	out.corners.resize(cornerCount);
+
+	//stitch the chunks back together, resolving relative indices as we go
+	size_t positionBase = 0, uvBase = 0, normalBase = 0, cornerBase = 0;
+	for (auto& c : chunks)
+	{
+		for (size_t i : c.positionFixups) c.corners[i].position = (unsigned int)((long long)(positionsBefore + positionBase) + (int)c.corners[i].position);
+		for (size_t i : c.uvFixups) c.corners[i].uv = (unsigned int)((long long)(uvsBefore + uvBase) + (int)c.corners[i].uv);
+		for (size_t i : c.normalFixups) c.corners[i].normal = (unsigned int)((long long)(normalsBefore + normalBase) + (int)c.corners[i].normal);
+
+		AppendRange(out.positions, positionBase, c.positions);
+		AppendRange(out.uvs, uvBase, c.uvs);
+		AppendRange(out.normals, normalBase, c.normals);
+		AppendRange(out.corners, cornerBase, c.corners);
+
+		positionBase += c.positions.size();
+		uvBase += c.uvs.size();
+		normalBase += c.normals.size();
+		cornerBase += c.corners.size();
+
+		out.materialLibraries.insert(out.materialLibraries.end(), c.materialLibraries.begin(), c.materialLibraries.end());
+	}
+
+	//files without usemtl keep triangleMaterials empty
+	bool usesMaterials = false;
+	for (auto& c : chunks)
+		usesMaterials |= !c.materials.empty();
+	if (!usesMaterials)
+		return;
+
+	//give materials file-wide ids, carrying the active one across chunk boundaries
+	auto materialId = [&](const std::string& name)
+	{
+		auto it = std::find(out.materials.begin(), out.materials.end(), name);
+		if (it != out.materials.end())
+			return (unsigned int)(it - out.materials.begin());
+		out.materials.push_back(name);
+		return (unsigned int)out.materials.size() - 1;
+	};
+
+	out.triangleMaterials.reserve(cornerCount / 3);
+	unsigned int current = InheritMaterial;
+	std::vector<unsigned int> remap;
+	for (auto& c : chunks)
+	{
+		remap.resize(c.materials.size());
+		for (size_t i = 0; i < c.materials.size(); i++)
+			remap[i] = materialId(c.materials[i]);
+
+		for (unsigned int m : c.triangleMaterials)
+		{
+			if (m != InheritMaterial)
+				out.triangleMaterials.push_back(remap[m]);
+			else
+			{
+				//faces before the first usemtl in the whole file
+				if (current == InheritMaterial)
+					current = materialId("");
+				out.triangleMaterials.push_back(current);
+			}
+		}
+		if (c.lastMaterial != InheritMaterial)
+			current = remap[c.lastMaterial];
+	}
+}
+
+
+// --------------------------------------------------------
+// Converts parsed OBJ data to our Vertex format
+//
+// - Corners are welded on their (position, uv, normal) index
+//   triple, so each unique combination becomes one Vertex and
+//   the index buffer actually gets reused
+//
+// Handedness conversion adapted from Chris Cascioli's
+// original OBJ loading code:
+// - The model is most likely in a right-handed space, so
+//   invert the Z position and normal Z, and flip the winding
+// - Flip the UV's V since DirectX defines (0,0) as the top
+//   left of the texture
+// --------------------------------------------------------
+void ObjLoader::BuildVertices(const ObjData& obj, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	verts.clear();
+	indices.clear();
+	indices.reserve(obj.corners.size());
+
+	//most closed meshes end up with far fewer verts than corners
+	verts.reserve(obj.corners.size() / 2);
+	std::unordered_map<ObjCorner, unsigned int, ObjCornerHash> welded;
+	welded.reserve(obj.corners.size() / 2);
+
+	auto weld = [&](const ObjCorner& c)
+	{
+		auto it = welded.find(c);
+		if (it != welded.end())
+			return it->second;
+
+		if (c.position == 0 || c.position > obj.positions.size() ||
+			c.uv > obj.uvs.size() ||
+			c.normal > obj.normals.size())
+			throw std::out_of_range("OBJ face references a vertex attribute that doesn't exist");
+
+		Vertex v = {};
+		v.Position = obj.positions[c.position - 1];
+		v.uv = c.uv ? obj.uvs[c.uv - 1] : XMFLOAT2(0, 0);
+		v.normal = c.normal ? obj.normals[c.normal - 1] : XMFLOAT3(0, 0, 0);
+
+		v.uv.y = 1.0f - v.uv.y;
+		v.Position.z *= -1.0f;
+		v.normal.z *= -1.0f;
+
+		unsigned int index = (unsigned int)verts.size();
+		verts.push_back(v);
+		welded.emplace(c, index);
+		return index;
+	};
+
+	for (size_t i = 0; i + 2 < obj.corners.size(); i += 3)
+	{
+		//flip the winding order: 0, 2, 1
+		indices.push_back(weld(obj.corners[i]));
+		indices.push_back(weld(obj.corners[i + 2]));
+		indices.push_back(weld(obj.corners[i + 1]));
+	}
+}
+
+
+// --------------------------------------------------------
+// Reads a .mtl library and makes its texture paths
+// relative to the working directory instead of the file
+// --------------------------------------------------------
+bool ObjLoader::ParseMaterialFile(const std::wstring& mtlFile, std::vector<ObjMaterial>& out)
+{
+	MappedFile file(mtlFile);
+	if (!file.IsOpen())
+		return false;
+
+	size_t first = out.size();
+	ParseMaterialBuffer(file.GetData(), file.GetSize(), out);
+
+	std::filesystem::path folder = std::filesystem::path(mtlFile).parent_path();
+	for (size_t i = first; i < out.size(); i++)
+	{
+		for (std::string* map : { &out[i].diffuseMap, &out[i].normalMap })
+		{
+			if (!map->empty() && std::filesystem::path(*map).is_relative())
+				*map = (folder / *map).string();
+		}
+	}
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Pulls the PBR-relevant values out of each newmtl block
+//
+// - Without a Pr (roughness) line, the Blinn-Phong Ns
+//   exponent is converted with alpha = sqrt(2 / (Ns + 2)),
+//   and roughness = sqrt(alpha) to match our shaders
+// --------------------------------------------------------
+void ObjLoader::ParseMaterialBuffer(const char* data, size_t size, std::vector<ObjMaterial>& out)
+{
+	const char* p = data;
+	const char* end = data + size;
+	ObjMaterial* current = nullptr;
+	bool explicitRoughness = false;
+
+	while (p < end)
+	{
+		p = SkipSpaces(p, end);
+		const char* lineEnd = FindNewline(p, end);
+
+		if (IsKeyword(p, lineEnd, "newmtl"))
+		{
+			ObjMaterial material = {};
+			material.name = TrimmedLine(p + 6, lineEnd);
+			out.push_back(material);
+			current = &out.back();
+			explicitRoughness = false;
+		}
+		else if (current && IsKeyword(p, lineEnd, "Kd"))
+		{
+			const char* c = p + 2;
+			c = SkipSpaces(c, lineEnd); if (c < lineEnd) current->diffuse.x = ParseFloat(c, lineEnd);
+			c = SkipSpaces(c, lineEnd); if (c < lineEnd) current->diffuse.y = ParseFloat(c, lineEnd);
+			c = SkipSpaces(c, lineEnd); if (c < lineEnd) current->diffuse.z = ParseFloat(c, lineEnd);
+		}
+		else if (current && !explicitRoughness && IsKeyword(p, lineEnd, "Ns"))
+		{
+			const char* c = SkipSpaces(p + 2, lineEnd);
+			float exponent = c < lineEnd ? ParseFloat(c, lineEnd) : 0.0f;
+			current->roughness = sqrtf(sqrtf(2.0f / (std::max(exponent, 0.0f) + 2.0f)));
+		}
+		else if (current && IsKeyword(p, lineEnd, "Pr"))
+		{
+			const char* c = SkipSpaces(p + 2, lineEnd);
+			if (c < lineEnd)
+			{
+				current->roughness = std::clamp(ParseFloat(c, lineEnd), 0.0f, 1.0f);
+				explicitRoughness = true;
+			}
+		}
+		else if (current && IsKeyword(p, lineEnd, "d"))
+		{
+			const char* c = SkipSpaces(p + 1, lineEnd);
+			if (c < lineEnd) current->opacity = ParseFloat(c, lineEnd);
+		}
+		else if (current && IsKeyword(p, lineEnd, "Tr"))
+		{
+			const char* c = SkipSpaces(p + 2, lineEnd);
+			if (c < lineEnd) current->opacity = 1.0f - ParseFloat(c, lineEnd);
+		}
+		else if (current && IsKeyword(p, lineEnd, "map_Kd"))
+			current->diffuseMap = LastToken(p + 6, lineEnd);
+		else if (current && (IsKeyword(p, lineEnd, "norm") || IsKeyword(p, lineEnd, "map_Bump") || IsKeyword(p, lineEnd, "bump")))
+			current->normalMap = LastToken(SkipToken(p, lineEnd), lineEnd);
+
+		//anything else (Ka, Ks, illum, comments...) is skipped
+		p = lineEnd + 1;
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+#include "Vertex.h"
+
+// One face corner of an OBJ file
+// - Indices are 1-based like the file itself, 0 means "not present"
+struct ObjCorner
+{
+	unsigned int position;
+	unsigned int uv;
+	unsigned int normal;
+
+	bool operator==(const ObjCorner& other) const
+	{
+		return position == other.position && uv == other.uv && normal == other.normal;
+	}
+};
+
+// Raw contents of an OBJ file
+// - Polygons are already fanned into triangles (3 corners each)
+// - Nothing has been flipped into left-handed space yet
+struct ObjData
+{
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<DirectX::XMFLOAT2> uvs;
+	std::vector<DirectX::XMFLOAT3> normals;
+	std::vector<ObjCorner> corners;
+
+	std::vector<std::string> materialLibraries;	// mtllib file names, relative to the OBJ
+	std::vector<std::string> materials;	// usemtl names in order of first use ("" for faces before any usemtl)
+	std::vector<unsigned int> triangleMaterials;	// Index into materials per triangle, empty if the file has no usemtl
+};
+
+// One newmtl block of a .mtl file, just the parts our materials can use
+struct ObjMaterial
+{
+	std::string name;
+	DirectX::XMFLOAT3 diffuse = DirectX::XMFLOAT3(1, 1, 1);	// Kd
+	float roughness = 1.0f;	// Pr, or converted from the Ns specular exponent
+	float opacity = 1.0f;	// d, or 1 - Tr
+	std::string diffuseMap;	// map_Kd, relative to the .mtl file's folder
+	std::string normalMap;	// norm, map_Bump or bump
+};
+
+// --------------------------------------------------------
+// Fast .OBJ parsing
+//
+// - The file is memory mapped and scanned in place, no
+//   per-line copies and no sscanf
+// - Large files are split into newline-aligned chunks that
+//   are parsed on separate threads and stitched back together
+// - threadCount of 0 picks one thread per hardware core
+// --------------------------------------------------------
+namespace ObjLoader
+{
+	void ParseFile(const std::wstring& objFile, ObjData& out, unsigned int threadCount = 0);
+	void ParseBuffer(const char* data, size_t size, ObjData& out, unsigned int threadCount = 0);
+
+	// For files streamed through in blocks of whole lines: relative (negative)
+	// indices are resolved as if the elements of the earlier blocks came first
+	void ParseBlock(const char* data, size_t size, size_t positionsBefore, size_t uvsBefore, size_t normalsBefore,
+		ObjData& out, unsigned int threadCount = 0);
+
+	// Turns parsed OBJ data into DirectX-ready vertices and indices
+	// (welded, left-handed, flipped V and flipped winding)
+	void BuildVertices(const ObjData& obj, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+	// Appends every material in a .mtl library, returns false if the file couldn't be opened
+	bool ParseMaterialFile(const std::wstring& mtlFile, std::vector<ObjMaterial>& out);
+	void ParseMaterialBuffer(const char* data, size_t size, std::vector<ObjMaterial>& out);
+}
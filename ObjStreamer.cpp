@@ -0,0 +1,487 @@
+#include "ObjStreamer.h"
+#include "MeshOptimizer.h"
+#include "MeshTools.h"
+#include "ObjLoader.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	//cells per axis of the bucketing grid, 64^3 counters
+	const unsigned int GridBits = 6;
+	const unsigned int GridCellCount = 1 << (GridBits * 3);
+
+	//rough peak bytes per triangle while cooking a bucket: corners, the
+	//welding map, vertices, indices and the optimizers' scratch space
+	const size_t CookBytesPerTriangle = 320;
+
+	//limits on how much of a file is read (or buffered per bucket) at once
+	const size_t MinBlockSize = 1 << 16;
+	const size_t MaxBlockSize = 1 << 26;
+
+	//indices this close together in a file are read in one go when gathering
+	const size_t GatherGap = 256;
+	const size_t MaxGatherRun = 1 << 16;
+
+	// Temporary files, removed again however the import ends
+	struct SpillFiles
+	{
+		std::filesystem::path positions;
+		std::filesystem::path uvs;
+		std::filesystem::path normals;
+		std::filesystem::path corners;
+		std::filesystem::path buckets;
+
+		SpillFiles(const std::wstring& outputFile)
+		{
+			positions = outputFile + L".positions.tmp";
+			uvs = outputFile + L".uvs.tmp";
+			normals = outputFile + L".normals.tmp";
+			corners = outputFile + L".corners.tmp";
+			buckets = outputFile + L".buckets.tmp";
+		}
+
+		~SpillFiles()
+		{
+			std::error_code ignored;
+			for (const auto& path : { positions, uvs, normals, corners, buckets })
+				std::filesystem::remove(path, ignored);
+		}
+	};
+
+	// Where one bucket's triangles landed in the bucket spill file
+	struct BucketBlock
+	{
+		uint64_t offset;
+		size_t cornerCount;
+	};
+
+	template<typename T>
+	void Append(std::ofstream& out, const std::vector<T>& data)
+	{
+		out.write((const char*)data.data(), sizeof(T) * data.size());
+		if (!out.good())
+			throw std::runtime_error("Error writing streaming import data: out of disk space?");
+	}
+
+	template<typename T>
+	void ReadAt(std::ifstream& in, uint64_t offset, size_t count, T* out)
+	{
+		in.seekg((std::streamoff)offset);
+		in.read((char*)out, (std::streamsize)(sizeof(T) * count));
+		if ((size_t)in.gcount() != sizeof(T) * count)
+			throw std::runtime_error("Error reading streaming import data: temporary file is truncated");
+	}
+
+	// Reads the elements at sorted, unique, 0-based indices, merging
+	// nearby indices into single reads
+	template<typename T>
+	void Gather(std::ifstream& in, const std::vector<unsigned int>& indices, std::vector<T>& out)
+	{
+		out.resize(indices.size());
+		std::vector<T> run;
+		for (size_t i = 0; i < indices.size();)
+		{
+			size_t last = i;
+			while (last + 1 < indices.size() &&
+				indices[last + 1] - indices[last] <= GatherGap &&
+				indices[last + 1] - indices[i] < MaxGatherRun)
+				last++;
+
+			run.resize(indices[last] - indices[i] + 1);
+			ReadAt(in, (uint64_t)indices[i] * sizeof(T), run.size(), run.data());
+			for (size_t j = i; j <= last; j++)
+				out[j] = run[indices[j] - indices[i]];
+			i = last + 1;
+		}
+	}
+
+	// Sorted unique 0-based versions of a set of 1-based OBJ indices (0s dropped)
+	std::vector<unsigned int> UniqueIndices(const std::vector<ObjCorner>& corners, unsigned int ObjCorner::* member)
+	{
+		std::vector<unsigned int> unique;
+		unique.reserve(corners.size());
+		for (const ObjCorner& c : corners)
+		{
+			if (c.*member)
+				unique.push_back(c.*member - 1);
+		}
+		std::sort(unique.begin(), unique.end());
+		unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+		return unique;
+	}
+
+	// Turns a 1-based OBJ index into a 1-based index into the unique list
+	inline unsigned int Remap(unsigned int index, const std::vector<unsigned int>& unique)
+	{
+		if (index == 0)
+			return 0;
+		return (unsigned int)(std::lower_bound(unique.begin(), unique.end(), index - 1) - unique.begin()) + 1;
+	}
+
+	// Interleaves the bits of a grid cell's coordinates, so cells
+	// that are close in space are (mostly) close in the order
+	unsigned int MortonCell(const XMFLOAT3& p, const XMFLOAT3& boundsMin, const XMFLOAT3& cellScale)
+	{
+		const float maxCell = (float)((1 << GridBits) - 1);
+		unsigned int x = (unsigned int)std::clamp((p.x - boundsMin.x) * cellScale.x, 0.0f, maxCell);
+		unsigned int y = (unsigned int)std::clamp((p.y - boundsMin.y) * cellScale.y, 0.0f, maxCell);
+		unsigned int z = (unsigned int)std::clamp((p.z - boundsMin.z) * cellScale.z, 0.0f, maxCell);
+
+		unsigned int cell = 0;
+		for (unsigned int bit = 0; bit < GridBits; bit++)
+		{
+			cell |= ((x >> bit) & 1) << (bit * 3);
+			cell |= ((y >> bit) & 1) << (bit * 3 + 1);
+			cell |= ((z >> bit) & 1) << (bit * 3 + 2);
+		}
+		return cell;
+	}
+
+	// Calls visit(corners, firstPosition) for every triangle
+	// - Positions may not fit in memory, so they're loaded a window at a
+	//   time and the corners are re-read once per window; each triangle is
+	//   visited in the window holding its first corner
+	// - Returns how many windows it took
+	template<typename Visit>
+	size_t ForEachTriangle(const SpillFiles& files, uint64_t positionCount, uint64_t cornerCount,
+		size_t windowSize, size_t blockCorners, Visit visit)
+	{
+		std::ifstream positionFile(files.positions, std::ios::binary);
+		std::vector<XMFLOAT3> window;
+		std::vector<ObjCorner> block;
+
+		size_t windows = 0;
+		for (uint64_t windowStart = 0; windowStart < positionCount; windowStart += windowSize)
+		{
+			window.resize((size_t)std::min<uint64_t>(windowSize, positionCount - windowStart));
+			ReadAt(positionFile, windowStart * sizeof(XMFLOAT3), window.size(), window.data());
+			windows++;
+
+			std::ifstream cornerFile(files.corners, std::ios::binary);
+			for (uint64_t blockStart = 0; blockStart < cornerCount; blockStart += blockCorners)
+			{
+				block.resize((size_t)std::min<uint64_t>(blockCorners, cornerCount - blockStart));
+				ReadAt(cornerFile, blockStart * sizeof(ObjCorner), block.size(), block.data());
+
+				for (size_t i = 0; i < block.size(); i += 3)
+				{
+					uint64_t position = block[i].position;
+					if (position == 0 || position > positionCount)
+						throw std::out_of_range("OBJ face references a vertex attribute that doesn't exist");
+					if (position - 1 >= windowStart && position - 1 < windowStart + window.size())
+						visit(&block[i], window[(size_t)(position - 1 - windowStart)]);
+				}
+			}
+		}
+		return windows;
+	}
+}
+
+
+MeshChunksFile::MeshChunksFile(const std::wstring& path) :
+	file(path),
+	valid(false),
+	header(nullptr),
+	chunks(nullptr)
+{
+	if (!file.IsOpen() || file.GetSize() < sizeof(MeshChunksHeader))
+		return;
+
+	header = (const MeshChunksHeader*)file.GetData();
+	if (header->magic != MeshChunksMagic ||
+		header->version != MeshChunksVersion ||
+		header->vertexStride != sizeof(Vertex) ||
+		header->tableOffset + (uint64_t)header->chunkCount * sizeof(MeshChunk) != file.GetSize())
+		return;
+
+	chunks = (const MeshChunk*)(file.GetData() + header->tableOffset);
+	for (uint32_t i = 0; i < header->chunkCount; i++)
+	{
+		if (chunks[i].vertexOffset + (uint64_t)chunks[i].vertexCount * sizeof(Vertex) > header->tableOffset ||
+			chunks[i].indexOffset + (uint64_t)chunks[i].indexCount * sizeof(unsigned int) > header->tableOffset ||
+			chunks[i].indexCount % 3 != 0)
+			return;
+	}
+	valid = true;
+}
+
+
+// --------------------------------------------------------
+// Four stages, only the last of which builds vertices:
+// - Parse: OBJ text -> attribute and corner spill files
+// - Count: triangles per grid cell -> buckets that fit the budget
+// - Distribute: corners -> per-bucket blocks in one spill file
+// - Cook: each bucket -> weld, optimize, tangents -> output
+// --------------------------------------------------------
+ObjStreamStats ObjStreamer::Import(const std::wstring& objFile, const std::wstring& outputFile, size_t memoryBudget, unsigned int threadCount)
+{
+	ObjStreamStats stats = {};
+	SpillFiles files(outputFile);
+
+	//split the budget between the stages' big allocations
+	size_t blockSize = std::clamp(memoryBudget / 16, MinBlockSize, MaxBlockSize);
+	size_t blockCorners = blockSize / sizeof(ObjCorner) / 3 * 3;
+	size_t windowSize = std::max(MinBlockSize, memoryBudget / 4) / sizeof(XMFLOAT3);
+	size_t maxBucketTriangles = std::max<size_t>(1024, memoryBudget / 2 / CookBytesPerTriangle);
+
+	//parse the OBJ a block of whole lines at a time
+	auto stageStart = std::chrono::high_resolution_clock::now();
+	uint64_t positionCount = 0, uvCount = 0, normalCount = 0, cornerCount = 0;
+	XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	{
+		std::ifstream obj(std::filesystem::path(objFile), std::ios::binary);
+		if (!obj.is_open())
+			throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
+
+		std::ofstream positionFile(files.positions, std::ios::binary | std::ios::trunc);
+		std::ofstream uvFile(files.uvs, std::ios::binary | std::ios::trunc);
+		std::ofstream normalFile(files.normals, std::ios::binary | std::ios::trunc);
+		std::ofstream cornerFile(files.corners, std::ios::binary | std::ios::trunc);
+
+		std::vector<char> text(blockSize);
+		size_t carry = 0;
+		ObjData parsed;
+		while (true)
+		{
+			obj.read(text.data() + carry, (std::streamsize)(text.size() - carry));
+			size_t size = carry + (size_t)obj.gcount();
+			bool done = size < text.size();
+
+			//stop after the last newline, the rest goes in the next block
+			size_t end = size;
+			if (!done)
+			{
+				while (end > 0 && text[end - 1] != '\n')
+					end--;
+				if (end == 0)
+				{
+					//one line longer than the whole block
+					carry = size;
+					text.resize(text.size() * 2);
+					continue;
+				}
+			}
+
+			ObjLoader::ParseBlock(text.data(), end, (size_t)positionCount, (size_t)uvCount, (size_t)normalCount, parsed, threadCount);
+			for (const XMFLOAT3& p : parsed.positions)
+			{
+				boundsMin = XMFLOAT3(std::min(boundsMin.x, p.x), std::min(boundsMin.y, p.y), std::min(boundsMin.z, p.z));
+				boundsMax = XMFLOAT3(std::max(boundsMax.x, p.x), std::max(boundsMax.y, p.y), std::max(boundsMax.z, p.z));
+			}
+			Append(positionFile, parsed.positions);
+			Append(uvFile, parsed.uvs);
+			Append(normalFile, parsed.normals);
+			Append(cornerFile, parsed.corners);
+			positionCount += parsed.positions.size();
+			uvCount += parsed.uvs.size();
+			normalCount += parsed.normals.size();
+			cornerCount += parsed.corners.size();
+
+			if (done)
+				break;
+			carry = size - end;
+			std::copy(text.begin() + end, text.begin() + size, text.begin());
+		}
+	}
+	if (cornerCount > 0 && positionCount == 0)
+		throw std::out_of_range("OBJ face references a vertex attribute that doesn't exist");
+	if (std::max({ positionCount, uvCount, normalCount }) > UINT32_MAX)
+		throw std::out_of_range("OBJ has more vertex attributes than 32-bit indices can address");
+	stats.triangleCount = cornerCount / 3;
+	stats.parseMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - stageStart).count();
+	stageStart = std::chrono::high_resolution_clock::now();
+
+	//count triangles per cell, bucketed by their first corner
+	XMFLOAT3 cellScale(0, 0, 0);
+	{
+		float cells = (float)(1 << GridBits);
+		float dx = boundsMax.x - boundsMin.x, dy = boundsMax.y - boundsMin.y, dz = boundsMax.z - boundsMin.z;
+		cellScale = XMFLOAT3(dx > 0 ? cells / dx : 0, dy > 0 ? cells / dy : 0, dz > 0 ? cells / dz : 0);
+	}
+	std::vector<uint64_t> cellTriangles(GridCellCount, 0);
+	stats.positionWindows = ForEachTriangle(files, positionCount, cornerCount, windowSize, blockCorners,
+		[&](const ObjCorner*, const XMFLOAT3& position)
+		{
+			cellTriangles[MortonCell(position, boundsMin, cellScale)]++;
+		});
+
+	//walk the cells in Morton order, starting a new bucket whenever the next
+	//cell won't fit; cells that are too big on their own get a run of buckets
+	std::vector<uint32_t> cellFirstBucket(GridCellCount, 0);
+	std::vector<uint64_t> bucketTriangles;
+	bool bucketFull = true;
+	for (unsigned int cell = 0; cell < GridCellCount; cell++)
+	{
+		uint64_t count = cellTriangles[cell];
+		if (count == 0)
+			continue;
+
+		if (count > maxBucketTriangles)
+		{
+			cellFirstBucket[cell] = (uint32_t)bucketTriangles.size();
+			for (uint64_t left = count; left > 0; left -= std::min<uint64_t>(left, maxBucketTriangles))
+				bucketTriangles.push_back(std::min<uint64_t>(left, maxBucketTriangles));
+			bucketFull = true;
+			continue;
+		}
+
+		if (bucketFull || bucketTriangles.back() + count > maxBucketTriangles)
+			bucketTriangles.push_back(0);
+		cellFirstBucket[cell] = (uint32_t)bucketTriangles.size() - 1;
+		bucketTriangles.back() += count;
+		bucketFull = false;
+	}
+
+	//send every triangle's corners to its bucket, buffering a block per bucket
+	std::vector<std::vector<BucketBlock>> bucketBlocks(bucketTriangles.size());
+	{
+		size_t bufferCorners = std::clamp<size_t>(memoryBudget / 8 / sizeof(ObjCorner) / std::max<size_t>(1, bucketTriangles.size()),
+			MinBlockSize / sizeof(ObjCorner), MaxBlockSize / sizeof(ObjCorner)) / 3 * 3;
+		std::vector<std::vector<ObjCorner>> buffers(bucketTriangles.size());
+		std::ofstream bucketFile(files.buckets, std::ios::binary | std::ios::trunc);
+		uint64_t offset = 0;
+
+		auto flush = [&](size_t bucket)
+		{
+			std::vector<ObjCorner>& buffer = buffers[bucket];
+			if (buffer.empty())
+				return;
+			Append(bucketFile, buffer);
+			bucketBlocks[bucket].push_back({ offset, buffer.size() });
+			offset += sizeof(ObjCorner) * buffer.size();
+			buffer.clear();
+		};
+
+		//reused as a per-cell running count to split up oversized cells
+		std::fill(cellTriangles.begin(), cellTriangles.end(), 0);
+		ForEachTriangle(files, positionCount, cornerCount, windowSize, blockCorners,
+			[&](const ObjCorner* corners, const XMFLOAT3& position)
+			{
+				unsigned int cell = MortonCell(position, boundsMin, cellScale);
+				size_t bucket = cellFirstBucket[cell] + (size_t)(cellTriangles[cell]++ / maxBucketTriangles);
+
+				std::vector<ObjCorner>& buffer = buffers[bucket];
+				if (buffer.capacity() == 0)
+					buffer.reserve(bufferCorners);
+				buffer.insert(buffer.end(), corners, corners + 3);
+				if (buffer.size() >= bufferCorners)
+					flush(bucket);
+			});
+		for (size_t b = 0; b < buffers.size(); b++)
+			flush(b);
+	}
+	std::vector<uint64_t>().swap(cellTriangles);
+	std::vector<uint32_t>().swap(cellFirstBucket);
+	stats.bucketMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - stageStart).count();
+	stageStart = std::chrono::high_resolution_clock::now();
+
+	//cook each bucket on its own and append it to the output
+	std::ofstream out(std::filesystem::path(outputFile), std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		throw std::invalid_argument("Error opening output file: Invalid file path or file is inaccessible");
+
+	MeshChunksHeader header = {};
+	header.magic = MeshChunksMagic;
+	header.version = MeshChunksVersion;
+	header.vertexStride = sizeof(Vertex);
+	header.triangleCount = stats.triangleCount;
+	header.boundsMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+	header.boundsMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	out.write((const char*)&header, sizeof(header));
+
+	std::vector<MeshChunk> chunks;
+	{
+		std::ifstream bucketFile(files.buckets, std::ios::binary);
+		std::ifstream positionFile(files.positions, std::ios::binary);
+		std::ifstream uvFile(files.uvs, std::ios::binary);
+		std::ifstream normalFile(files.normals, std::ios::binary);
+
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		for (size_t b = 0; b < bucketBlocks.size(); b++)
+		{
+			ObjData bucket;
+			std::vector<ObjCorner>& corners = bucket.corners;
+			for (const BucketBlock& block : bucketBlocks[b])
+			{
+				corners.resize(corners.size() + block.cornerCount);
+				ReadAt(bucketFile, block.offset, block.cornerCount, corners.data() + corners.size() - block.cornerCount);
+			}
+			if (corners.empty())
+				continue;
+
+			//pull in just the attributes this bucket uses, renumbered to match
+			{
+				std::vector<unsigned int> positions = UniqueIndices(corners, &ObjCorner::position);
+				std::vector<unsigned int> uvs = UniqueIndices(corners, &ObjCorner::uv);
+				std::vector<unsigned int> normals = UniqueIndices(corners, &ObjCorner::normal);
+				if ((!uvs.empty() && uvs.back() >= uvCount) || (!normals.empty() && normals.back() >= normalCount))
+					throw std::out_of_range("OBJ face references a vertex attribute that doesn't exist");
+
+				Gather(positionFile, positions, bucket.positions);
+				Gather(uvFile, uvs, bucket.uvs);
+				Gather(normalFile, normals, bucket.normals);
+				for (ObjCorner& c : corners)
+				{
+					c.position = Remap(c.position, positions);
+					c.uv = Remap(c.uv, uvs);
+					c.normal = Remap(c.normal, normals);
+				}
+			}
+
+			//the same pipeline as MeshCache::CookObj, minus meshlets and LODs
+			ObjLoader::BuildVertices(bucket, verts, indices);
+			bucket = {};
+			MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), verts.size());
+			MeshOptimizer::OptimizeVertexFetch(verts, indices.data(), indices.size());
+			MeshTools::CalculateTangents(verts.data(), verts.size(), indices.data(), indices.size(), threadCount);
+
+			MeshChunk chunk = {};
+			chunk.vertexOffset = (uint64_t)out.tellp();
+			chunk.vertexCount = (uint32_t)verts.size();
+			Append(out, verts);
+			chunk.indexOffset = (uint64_t)out.tellp();
+			chunk.indexCount = (uint32_t)indices.size();
+			Append(out, indices);
+			MeshTools::CalculateBounds(verts.data(), verts.size(), chunk.boundsMin, chunk.boundsMax);
+			chunks.push_back(chunk);
+
+			header.boundsMin = XMFLOAT3(std::min(header.boundsMin.x, chunk.boundsMin.x), std::min(header.boundsMin.y, chunk.boundsMin.y), std::min(header.boundsMin.z, chunk.boundsMin.z));
+			header.boundsMax = XMFLOAT3(std::max(header.boundsMax.x, chunk.boundsMax.x), std::max(header.boundsMax.y, chunk.boundsMax.y), std::max(header.boundsMax.z, chunk.boundsMax.z));
+			stats.vertexCount += verts.size();
+		}
+	}
+	if (chunks.empty())
+	{
+		header.boundsMin = XMFLOAT3(0, 0, 0);
+		header.boundsMax = XMFLOAT3(0, 0, 0);
+	}
+
+	//chunk table last, then go back and fill in the header
+	header.chunkCount = (uint32_t)chunks.size();
+	header.tableOffset = (uint64_t)out.tellp();
+	Append(out, chunks);
+	out.seekp(0);
+	out.write((const char*)&header, sizeof(header));
+	if (!out.good())
+		throw std::runtime_error("Error writing streaming import data: out of disk space?");
+
+	stats.chunkCount = chunks.size();
+	stats.cookMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - stageStart).count();
+	return stats;
+}
+
+
+std::wstring ObjStreamer::GetChunksPath(const std::wstring& sourceFile)
+{
+	return sourceFile + L".meshchunks";
+}
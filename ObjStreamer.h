@@ -0,0 +1,100 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include "MappedFile.h"
+#include "Vertex.h"
+
+const uint32_t MeshChunksVersion = 1;
+const uint32_t MeshChunksMagic = 0x4B48434D; // "MCHK"
+
+// --------------------------------------------------------
+// Header at the start of every .meshchunks file
+// - Each chunk's vertices and 32-bit indices (relative to
+//   the chunk's own vertices) follow one after another
+// - The chunk table is written last, at tableOffset
+// --------------------------------------------------------
+struct MeshChunksHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexStride;
+	uint32_t chunkCount;
+	uint64_t tableOffset;
+	uint64_t triangleCount;	// Across every chunk
+	DirectX::XMFLOAT3 boundsMin;
+	DirectX::XMFLOAT3 boundsMax;
+};
+static_assert(sizeof(MeshChunksHeader) == 56, "MeshChunksHeader layout changed, bump MeshChunksVersion");
+
+// One spatially coherent, independently cooked piece of the mesh
+struct MeshChunk
+{
+	uint64_t vertexOffset;	// Byte offsets from the start of the file
+	uint64_t indexOffset;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	DirectX::XMFLOAT3 boundsMin;
+	DirectX::XMFLOAT3 boundsMax;
+};
+static_assert(sizeof(MeshChunk) == 48, "MeshChunk layout changed, bump MeshChunksVersion");
+
+
+// --------------------------------------------------------
+// A memory mapped, validated .meshchunks file
+//
+// - Chunks point straight into the mapping, so one can be
+//   streamed into buffers without touching the others
+// --------------------------------------------------------
+class MeshChunksFile
+{
+public:
+	MeshChunksFile(const std::wstring& path);
+
+	bool IsValid() const { return valid; }
+	const MeshChunksHeader& GetHeader() const { return *header; }
+	const MeshChunk& GetChunk(size_t index) const { return chunks[index]; }
+	const Vertex* GetVertices(const MeshChunk& chunk) const { return (const Vertex*)(file.GetData() + chunk.vertexOffset); }
+	const unsigned int* GetIndices(const MeshChunk& chunk) const { return (const unsigned int*)(file.GetData() + chunk.indexOffset); }
+
+private:
+	MappedFile file;
+	bool valid;
+	const MeshChunksHeader* header;
+	const MeshChunk* chunks;
+};
+
+
+// What happened during a streaming import, for reporting
+struct ObjStreamStats
+{
+	uint64_t triangleCount;
+	uint64_t vertexCount;	// After welding, summed over chunks
+	size_t chunkCount;
+	size_t positionWindows;	// Passes needed to see every position
+	double parseMilliseconds;
+	double bucketMilliseconds;
+	double cookMilliseconds;
+};
+
+
+// --------------------------------------------------------
+// Out-of-core OBJ import for meshes too big to load whole
+//
+// - The OBJ is read in blocks and its attributes and faces
+//   are spilled to temporary files next to the output
+// - Triangles are sorted into spatial buckets on disk (a
+//   Morton ordered grid, split to fit the budget), then each
+//   bucket is welded, optimized and given tangents on its own
+//   and appended to the output
+// - memoryBudget is a soft cap in bytes on what the importer
+//   itself allocates; vertices on bucket borders are duplicated
+//   and their tangents only see their own bucket's triangles
+// --------------------------------------------------------
+namespace ObjStreamer
+{
+	ObjStreamStats Import(const std::wstring& objFile, const std::wstring& outputFile, size_t memoryBudget, unsigned int threadCount = 0);
+
+	// Where the chunked output for a given source file lives
+	std::wstring GetChunksPath(const std::wstring& sourceFile);
+}
@@ -0,0 +1,140 @@
+#include "RangeAllocator.h"
+#include <algorithm>
+#include <stdexcept>
+
+RangeAllocator::RangeAllocator(uint32_t capacity) :
+	capacity(capacity),
+	used(0)
+{
+	if (capacity > 0)
+		AddFreeBlock(0, capacity);
+}
+
+
+RangeHandle RangeAllocator::Allocate(uint32_t size)
+{
+	if (size == 0)
+		throw std::invalid_argument("Can't allocate an empty range");
+
+	//smallest free block that fits, lowest offset on ties
+	auto fit = freeBySize.lower_bound({ size, 0 });
+	if (fit == freeBySize.end())
+		return InvalidRange;
+
+	uint32_t offset = fit->second;
+	uint32_t blockSize = fit->first;
+	RemoveFreeBlock(freeByOffset.find(offset));
+	if (blockSize > size)
+		AddFreeBlock(offset + size, blockSize - size);
+
+	RangeHandle handle;
+	if (!unusedHandles.empty())
+	{
+		handle = unusedHandles.back();
+		unusedHandles.pop_back();
+	}
+	else
+	{
+		handle = (RangeHandle)ranges.size();
+		ranges.push_back({});
+	}
+	ranges[handle] = { offset, size, true };
+	used += size;
+	return handle;
+}
+
+
+void RangeAllocator::Free(RangeHandle handle)
+{
+	if (handle >= ranges.size() || !ranges[handle].live)
+		throw std::invalid_argument("Range handle isn't allocated");
+
+	Range& range = ranges[handle];
+	range.live = false;
+	used -= range.size;
+	unusedHandles.push_back(handle);
+
+	//merge with the free blocks on either side
+	uint32_t offset = range.offset;
+	uint32_t size = range.size;
+	auto next = freeByOffset.lower_bound(offset);
+	if (next != freeByOffset.end() && next->first == offset + size)
+	{
+		size += next->second;
+		next = std::next(next);
+		RemoveFreeBlock(std::prev(next));
+	}
+	if (next != freeByOffset.begin())
+	{
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset)
+		{
+			offset = prev->first;
+			size += prev->second;
+			RemoveFreeBlock(prev);
+		}
+	}
+	AddFreeBlock(offset, size);
+}
+
+
+void RangeAllocator::Grow(uint32_t newCapacity)
+{
+	if (newCapacity <= capacity)
+		return;
+
+	//extend the last free block if it runs to the end
+	uint32_t offset = capacity;
+	uint32_t size = newCapacity - capacity;
+	if (!freeByOffset.empty())
+	{
+		auto last = std::prev(freeByOffset.end());
+		if (last->first + last->second == capacity)
+		{
+			offset = last->first;
+			size += last->second;
+			RemoveFreeBlock(last);
+		}
+	}
+	AddFreeBlock(offset, size);
+	capacity = newCapacity;
+}
+
+
+std::vector<RangeMove> RangeAllocator::Defragment()
+{
+	std::vector<RangeMove> moves;
+	for (RangeHandle handle = 0; handle < ranges.size(); handle++)
+	{
+		if (ranges[handle].live)
+			moves.push_back({ handle, ranges[handle].offset, 0, ranges[handle].size });
+	}
+	std::sort(moves.begin(), moves.end(), [](const RangeMove& a, const RangeMove& b) { return a.from < b.from; });
+
+	uint32_t offset = 0;
+	for (RangeMove& move : moves)
+	{
+		move.to = offset;
+		ranges[move.handle].offset = offset;
+		offset += move.size;
+	}
+
+	freeByOffset.clear();
+	freeBySize.clear();
+	if (offset < capacity)
+		AddFreeBlock(offset, capacity - offset);
+	return moves;
+}
+
+
+void RangeAllocator::AddFreeBlock(uint32_t offset, uint32_t size)
+{
+	freeByOffset.emplace(offset, size);
+	freeBySize.emplace(size, offset);
+}
+
+void RangeAllocator::RemoveFreeBlock(std::map<uint32_t, uint32_t>::iterator block)
+{
+	freeBySize.erase({ block->second, block->first });
+	freeByOffset.erase(block);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+
+// Identifies one allocation, stays the same when defragmenting moves it
+typedef uint32_t RangeHandle;
+const RangeHandle InvalidRange = ~0u;
+
+// Where a range was and where it is now, after Defragment()
+struct RangeMove
+{
+	RangeHandle handle;
+	uint32_t from;
+	uint32_t to;
+	uint32_t size;
+};
+
+
+// --------------------------------------------------------
+// Hands out ranges of [0, capacity) from a free list
+//
+// - Units are up to the caller (vertices, indices, bytes)
+// - Best fit, with neighbouring free blocks merged when a
+//   range is freed
+// - Nothing here touches the GPU, so the owner decides what
+//   moving or growing actually means (see GeometryPool)
+// --------------------------------------------------------
+class RangeAllocator
+{
+public:
+	RangeAllocator(uint32_t capacity);
+
+	// InvalidRange if no single free block is big enough
+	RangeHandle Allocate(uint32_t size);
+	void Free(RangeHandle handle);
+
+	uint32_t GetOffset(RangeHandle handle) const { return ranges[handle].offset; }
+	uint32_t GetSize(RangeHandle handle) const { return ranges[handle].size; }
+
+	// Adds free space at the end, existing ranges stay put
+	void Grow(uint32_t newCapacity);
+
+	// Packs every live range toward offset 0, keeping their order,
+	// and returns where each one went (from == to if it didn't move)
+	// - Moves are sorted by offset and only ever go down, so they
+	//   can be applied in place in order, like memmove
+	std::vector<RangeMove> Defragment();
+
+	uint32_t GetCapacity() const { return capacity; }
+	uint32_t GetUsed() const { return used; }
+	uint32_t GetLargestFree() const { return freeBySize.empty() ? 0 : freeBySize.rbegin()->first; }
+	size_t GetFreeBlockCount() const { return freeByOffset.size(); }
+
+private:
+	struct Range
+	{
+		uint32_t offset;
+		uint32_t size;
+		bool live;
+	};
+
+	uint32_t capacity;
+	uint32_t used;
+
+	//handles index this, dead entries get reused
+	std::vector<Range> ranges;
+	std::vector<RangeHandle> unusedHandles;
+
+	//free blocks by offset (for merging) and by size (for best fit)
+	std::map<uint32_t, uint32_t> freeByOffset;
+	std::set<std::pair<uint32_t, uint32_t>> freeBySize;
+
+	void AddFreeBlock(uint32_t offset, uint32_t size);
+	void RemoveFreeBlock(std::map<uint32_t, uint32_t>::iterator block);
+};
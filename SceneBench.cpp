@@ -0,0 +1,1082 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EntityStore.h"
+#include "FixedTimestep.h"
+#include "MeshGenerator.h"
+#include "RangeAllocator.h"
+#include "StaticBatcher.h"
+#include "Transform.h"
+#include "TransformPool.h"
+
+// --------------------------------------------------------
+// Offline benchmarks for the scene side of the engine, the
+// parts that don't need a device
+//
+// Usage: SceneBench --transforms
+//        SceneBench --hierarchy
+//        SceneBench --entities
+//        SceneBench --timestep
+//        SceneBench --batch <entities>
+//        SceneBench --allocator
+//
+// - --transforms times moving and rebuilding matrices for
+//   10k to 1M transforms, one Transform object each against
+//   a TransformPool, then Transform's cached basis vectors
+//   and analytic inverse transpose against building them
+//   from scratch, failing if the two disagree by more than
+//   float rounding
+// - --hierarchy times TransformPool updates of wide and deep
+//   parent/child trees, moving everything, the roots, or a few
+//   nodes here and there, then fails if any world matrix isn't
+//   its parent chain composed after random reparenting and
+//   dirtying, on one thread and on four
+// - --entities times draw and shadow style loops over 100k
+//   and 1M entities kept in an EntityStore, against one
+//   shared_ptr per entity the way Game used to keep them
+// - --timestep runs FixedTimestep off a fake clock and fails
+//   if step counts, the per frame limit, dropped steps or
+//   alpha aren't exactly what the frames add up to
+// - --batch builds a scene of static entities out of the
+//   generated primitives and reports what batching does to
+//   it (see StaticBatcher)
+// - --allocator churns random allocations through a
+//   RangeAllocator, defragmenting and growing the way
+//   GeometryPool does, and fails if any range overlaps or
+//   loses its contents, then times steady state churn
+// --------------------------------------------------------
+
+// Moves every transform (or every tenth) and reads back both matrices, the way
+// a frame of drawing does, with separate Transform objects and with a pool
+void ReportTransforms()
+{
+	unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+	for (size_t count : { (size_t)10000, (size_t)100000, (size_t)1000000 })
+	{
+		std::mt19937 rng(42);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::vector<DirectX::XMFLOAT3> positions(count), rotations(count), scales(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			positions[i] = DirectX::XMFLOAT3(unit(rng) * 100.0f, unit(rng) * 100.0f, unit(rng) * 100.0f);
+			rotations[i] = DirectX::XMFLOAT3(unit(rng) * DirectX::XM_PI, unit(rng) * DirectX::XM_PI, unit(rng) * DirectX::XM_PI);
+			scales[i] = DirectX::XMFLOAT3(0.5f + unit(rng) * 0.4f, 1.0f + unit(rng) * 0.5f, 2.0f + unit(rng));
+		}
+
+		std::vector<std::shared_ptr<Transform>> objects(count);
+		TransformPool pool((unsigned int)count);
+		for (size_t i = 0; i < count; i++)
+		{
+			objects[i] = std::make_shared<Transform>();
+			objects[i]->SetRotation(rotations[i]);
+			objects[i]->SetScale(scales[i]);
+			uint32_t slot = pool.Add();
+			pool.SetRotation(slot, rotations[i]);
+			pool.SetScale(slot, scales[i]);
+		}
+
+		//checksum of what was read, so none of it gets optimized out
+		float sink = 0.0f;
+		auto frame = [&](size_t step, float offset, auto move, auto update, auto read)
+		{
+			double best = 1e30;
+			for (int run = 0; run < 5; run++)
+			{
+				auto start = std::chrono::high_resolution_clock::now();
+				for (size_t i = 0; i < count; i += step)
+					move(i, DirectX::XMFLOAT3(positions[i].x + offset * run, positions[i].y, positions[i].z));
+				update();
+				for (size_t i = 0; i < count; i++)
+					sink += read(i);
+				best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+			}
+			return best;
+		};
+
+		printf("%zu transforms:\n", count);
+		for (size_t step : { (size_t)1, (size_t)10 })
+		{
+			double objectMs = frame(step, 1.0f,
+				[&](size_t i, const DirectX::XMFLOAT3& p) { objects[i]->SetPosition(p); },
+				[]() {},
+				[&](size_t i) { return objects[i]->GetWorldMatrix()._41 + objects[i]->GetWorldInverseTransposeMatrix()._11; });
+			double serialMs = frame(step, 2.0f,
+				[&](size_t i, const DirectX::XMFLOAT3& p) { pool.SetPosition((uint32_t)i, p); },
+				[&]() { pool.Update(1); },
+				[&](size_t i) { return pool.GetWorldMatrix((uint32_t)i)._41 + pool.GetWorldInverseTransposeMatrix((uint32_t)i)._11; });
+			double parallelMs = frame(step, 3.0f,
+				[&](size_t i, const DirectX::XMFLOAT3& p) { pool.SetPosition((uint32_t)i, p); },
+				[&]() { pool.Update(threadCount); },
+				[&](size_t i) { return pool.GetWorldMatrix((uint32_t)i)._41 + pool.GetWorldInverseTransposeMatrix((uint32_t)i)._11; });
+			printf("  %s moved: Transform %.2f ms, pool %.2f ms (%.1fx), pool on %u threads %.2f ms (%.1fx)\n",
+				step == 1 ? "all" : "10%", objectMs, serialMs, objectMs / serialMs, threadCount, parallelMs, objectMs / parallelMs);
+		}
+
+		//both end up where the last parallel run left them; inverse transpose translations are
+		//position over scale, so those are compared relative to that
+		float worstRotation = 0.0f, worstTranslation = 0.0f;
+		for (size_t i = 0; i < count; i++)
+		{
+			DirectX::XMFLOAT3 p = pool.GetPosition((uint32_t)i);
+			objects[i]->SetPosition(p);
+			DirectX::XMFLOAT4X4 a = objects[i]->GetWorldMatrix(), b = pool.GetWorldMatrix((uint32_t)i);
+			DirectX::XMFLOAT4X4 c = objects[i]->GetWorldInverseTransposeMatrix(), d = pool.GetWorldInverseTransposeMatrix((uint32_t)i);
+			float reach = 1.0f + (fabsf(p.x) + fabsf(p.y) + fabsf(p.z)) / std::min(scales[i].x, std::min(scales[i].y, scales[i].z));
+			for (int row = 0; row < 4; row++)
+			{
+				for (int column = 0; column < 4; column++)
+				{
+					float difference = std::max(fabsf(a.m[row][column] - b.m[row][column]), fabsf(c.m[row][column] - d.m[row][column]));
+					if (row < 3 && column < 3)
+						worstRotation = std::max(worstRotation, difference);
+					else
+						worstTranslation = std::max(worstTranslation, difference / reach);
+				}
+			}
+		}
+		printf("  largest difference from Transform: %.2g in rotation and scale, %.2g (relative) in translation%s\n",
+			worstRotation, worstTranslation, sink == 12345.0f ? " " : "");
+	}
+}
+
+
+// Largest difference the fast path may have from the general one, well above
+// float rounding in either but far below anything that would show
+const float TransformFastPathTolerance = 1e-5f;
+
+// Camera style basis reads (right, up and forward, twice a frame) and matrix rebuilds of
+// unpooled Transforms, against what they used to do: a quaternion per axis read, and
+// composing the matrices then inverting the transpose in general
+// - False if any basis vector or matrix is further than the tolerance from the general path
+bool ReportTransformFastPath()
+{
+	using namespace DirectX;
+	const size_t count = 100000;
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<XMFLOAT3> positions(count), rotations(count), scales(count);
+	std::vector<std::shared_ptr<Transform>> objects(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		positions[i] = XMFLOAT3(unit(rng) * 100.0f, unit(rng) * 100.0f, unit(rng) * 100.0f);
+		rotations[i] = XMFLOAT3(unit(rng) * XM_PIDIV2, unit(rng) * XM_PI, unit(rng) * XM_PI);
+		scales[i] = XMFLOAT3(0.5f + unit(rng) * 0.4f, 1.0f + unit(rng) * 0.5f, 2.0f + unit(rng));
+		objects[i] = std::make_shared<Transform>();
+		objects[i]->SetPosition(positions[i]);
+		objects[i]->SetRotation(rotations[i]);
+		objects[i]->SetScale(scales[i]);
+	}
+
+	auto rotateAxis = [](const XMFLOAT3& rot, XMVECTOR axis)
+	{
+		XMFLOAT3 result;
+		XMStoreFloat3(&result, XMVector3Rotate(axis, XMQuaternionRotationRollPitchYaw(rot.x, rot.y, rot.z)));
+		return result;
+	};
+	auto genericMatrices = [](const XMFLOAT3& p, const XMFLOAT3& r, const XMFLOAT3& s, XMFLOAT4X4& world, XMFLOAT4X4& inverseTranspose)
+	{
+		XMMATRIX m = XMMatrixScaling(s.x, s.y, s.z) * XMMatrixRotationRollPitchYaw(r.x, r.y, r.z) * XMMatrixTranslation(p.x, p.y, p.z);
+		XMStoreFloat4x4(&world, m);
+		XMStoreFloat4x4(&inverseTranspose, XMMatrixInverse(0, XMMatrixTranspose(m)));
+	};
+
+	//checksum of what was read, so none of it gets optimized out
+	float sink = 0.0f;
+	auto best = [&](auto work)
+	{
+		double fastest = 1e30;
+		for (int run = 0; run < 5; run++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			work(run);
+			fastest = std::min(fastest, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+		}
+		return fastest;
+	};
+
+	double genericBasisMs = best([&](int)
+	{
+		for (size_t i = 0; i < count; i++)
+			for (int read = 0; read < 2; read++)
+				sink += rotateAxis(rotations[i], XMVectorSet(1, 0, 0, 0)).x + rotateAxis(rotations[i], XMVectorSet(0, 1, 0, 0)).y +
+					rotateAxis(rotations[i], XMVectorSet(0, 0, 1, 0)).z;
+	});
+	double cachedBasisMs = best([&](int)
+	{
+		for (size_t i = 0; i < count; i++)
+			for (int read = 0; read < 2; read++)
+				sink += objects[i]->GetRight().x + objects[i]->GetUp().y + objects[i]->GetForward().z;
+	});
+
+	//everything moves and turns, then both matrices are read
+	double genericMatrixMs = best([&](int run)
+	{
+		XMFLOAT4X4 world, inverseTranspose;
+		for (size_t i = 0; i < count; i++)
+		{
+			XMFLOAT3 rot(rotations[i].x, rotations[i].y + 0.01f * run, rotations[i].z);
+			genericMatrices(positions[i], rot, scales[i], world, inverseTranspose);
+			sink += world._41 + inverseTranspose._11;
+		}
+	});
+	double analyticMatrixMs = best([&](int run)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			objects[i]->SetRotation(rotations[i].x, rotations[i].y + 0.01f * run, rotations[i].z);
+			sink += objects[i]->GetWorldMatrix()._41 + objects[i]->GetWorldInverseTransposeMatrix()._11;
+		}
+	});
+
+	//inverse transpose translations are position over scale, so those are compared relative to that
+	float worstBasis = 0.0f, worstRotation = 0.0f, worstTranslation = 0.0f;
+	for (size_t i = 0; i < count; i++)
+	{
+		objects[i]->SetRotation(rotations[i]);
+		XMFLOAT3 axes[3] = { objects[i]->GetRight(), objects[i]->GetUp(), objects[i]->GetForward() };
+		for (int k = 0; k < 3; k++)
+		{
+			XMFLOAT3 expected = rotateAxis(rotations[i], XMVectorSet(k == 0 ? 1.0f : 0.0f, k == 1 ? 1.0f : 0.0f, k == 2 ? 1.0f : 0.0f, 0));
+			worstBasis = std::max(worstBasis, std::max(fabsf(axes[k].x - expected.x), std::max(fabsf(axes[k].y - expected.y), fabsf(axes[k].z - expected.z))));
+		}
+
+		XMFLOAT4X4 world, inverseTranspose;
+		genericMatrices(positions[i], rotations[i], scales[i], world, inverseTranspose);
+		XMFLOAT4X4 a = objects[i]->GetWorldMatrix(), b = objects[i]->GetWorldInverseTransposeMatrix();
+		const XMFLOAT3& p = positions[i];
+		float reach = 1.0f + (fabsf(p.x) + fabsf(p.y) + fabsf(p.z)) / std::min(scales[i].x, std::min(scales[i].y, scales[i].z));
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				float difference = std::max(fabsf(a.m[row][column] - world.m[row][column]), fabsf(b.m[row][column] - inverseTranspose.m[row][column]));
+				if (row < 3 && column < 3)
+					worstRotation = std::max(worstRotation, difference);
+				else
+					worstTranslation = std::max(worstTranslation, difference / reach);
+			}
+		}
+	}
+
+	printf("%zu Transforms, fast path:\n", count);
+	printf("  basis reads: quaternion per axis %.2f ms, cached %.2f ms (%.1fx)\n", genericBasisMs, cachedBasisMs, genericBasisMs / cachedBasisMs);
+	printf("  matrix rebuilds: general inverse %.2f ms, analytic %.2f ms (%.1fx)\n", genericMatrixMs, analyticMatrixMs, genericMatrixMs / analyticMatrixMs);
+	bool matches = worstBasis <= TransformFastPathTolerance && worstRotation <= TransformFastPathTolerance &&
+		worstTranslation <= TransformFastPathTolerance;
+	printf("  largest difference from the general path: %.2g in basis vectors, %.2g in rotation and scale, %.2g (relative) in translation%s%s\n",
+		worstBasis, worstRotation, worstTranslation, matches ? "" : ", over tolerance!", sink == 12345.0f ? " " : "");
+	return matches;
+}
+
+
+// Update() times for one tree shape; parentOf gives each slot's parent (slot 0 is a root)
+template <typename ParentOf>
+void ReportHierarchy(const char* name, size_t count, ParentOf parentOf)
+{
+	TransformPool pool((unsigned int)count);
+	std::vector<uint32_t> roots;
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t slot = pool.Add();
+		uint32_t parent = parentOf(slot);
+		pool.SetParent(slot, parent);
+		pool.SetPosition(slot, DirectX::XMFLOAT3(0.0f, 0.01f, 0.0f));
+		pool.SetRotation(slot, DirectX::XMFLOAT3(0.001f, 0.002f, 0.0f));
+		if (parent == TransformPool::NoParent)
+			roots.push_back(slot);
+	}
+	auto start = std::chrono::high_resolution_clock::now();
+	pool.Update(1);
+	printf("%s, %zu transforms (first update %.1f ms, tree included)\n", name, count,
+		std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+
+	std::mt19937 rng(7);
+	unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+	auto measure = [&](const char* label, auto move)
+	{
+		double best[2] = { 1e30, 1e30 };
+		size_t rebuilt = 0;
+		for (int run = 0; run < 6; run++)
+		{
+			move((float)run);
+			auto start = std::chrono::high_resolution_clock::now();
+			rebuilt = pool.Update(run % 2 == 0 ? 1 : threadCount);
+			best[run % 2] = std::min(best[run % 2], std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+		}
+		printf("  %-14s %8zu rebuilt, %7.2f ms on 1 thread, %7.2f ms on %u\n", label, rebuilt, best[0], best[1], threadCount);
+	};
+	measure("everything", [&](float t) { for (size_t i = 0; i < count; i++) pool.SetPosition((uint32_t)i, DirectX::XMFLOAT3(t * 0.001f, 0.01f, 0.0f)); });
+	measure("roots", [&](float t) { for (uint32_t root : roots) pool.SetPosition(root, DirectX::XMFLOAT3(t, 0.0f, 0.0f)); });
+	measure("1% anywhere", [&](float t) { for (size_t i = 0; i < count / 100; i++) pool.SetRotation((uint32_t)(rng() % count), DirectX::XMFLOAT3(t * 0.01f, 0.0f, 0.0f)); });
+	measure("nothing", [](float) {});
+}
+
+
+void ReportHierarchies()
+{
+	for (size_t count : { (size_t)100000, (size_t)1000000 })
+	{
+		//a root with 100 children, each with the same share of the rest
+		size_t perBranch = (count - 101) / 100 + 1;
+		ReportHierarchy("wide: 3 levels, 100 branches", count, [&](uint32_t slot)
+		{
+			return slot == 0 ? TransformPool::NoParent : slot <= 100 ? 0 : 1 + (slot - 101) / (uint32_t)perBranch;
+		});
+		ReportHierarchy("deep: chains of 1000", count, [](uint32_t slot)
+		{
+			return slot % 1000 == 0 ? TransformPool::NoParent : slot - 1;
+		});
+	}
+}
+
+// Random forests of pooled transforms, checked against composing each slot's
+// own matrix with its parent chain, one slot at a time
+// - A thousand slots make a random tree and the rest hang off them, so the
+//   levels below are wide enough to be split across threads
+// - Each round either dirties a few slots (and a few near the top, so whole
+//   subtrees follow) or reparents, detaches, removes and re-adds some; moves
+//   that would make a slot its own ancestor have to throw, and only those
+bool CheckHierarchy(unsigned int seed, size_t count, unsigned int threadCount)
+{
+	const uint32_t TreeSize = 1000;
+	const float Tolerance = 1e-4f;
+
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	TransformPool pool((unsigned int)count);
+	std::vector<uint32_t> parents(count, TransformPool::NoParent);
+	std::vector<bool> alive(count, true);
+	auto randomize = [&](uint32_t slot)
+	{
+		pool.SetPosition(slot, DirectX::XMFLOAT3(unit(rng) * 10.0f, unit(rng) * 10.0f, unit(rng) * 10.0f));
+		pool.SetRotation(slot, DirectX::XMFLOAT3(unit(rng) * DirectX::XM_PI, unit(rng) * DirectX::XM_PI, unit(rng) * DirectX::XM_PI));
+		pool.SetScale(slot, DirectX::XMFLOAT3(1.0f + unit(rng) * 0.2f, 1.0f + unit(rng) * 0.2f, 1.0f + unit(rng) * 0.2f));
+	};
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t slot = pool.Add();
+		uint32_t parent = i == 0 || rng() % 8 == 0 ? TransformPool::NoParent : (uint32_t)(rng() % std::min(i, TreeSize));
+		pool.SetParent(slot, parent);
+		parents[slot] = parent;
+		randomize(slot);
+	}
+
+	auto isAncestor = [&](uint32_t ancestor, uint32_t slot)
+	{
+		for (uint32_t i = slot; i != TransformPool::NoParent; i = parents[i])
+			if (i == ancestor)
+				return true;
+		return false;
+	};
+
+	std::string error;
+	auto reparent = [&](uint32_t slot, uint32_t parent)
+	{
+		bool threw = false;
+		try { pool.SetParent(slot, parent); }
+		catch (const std::invalid_argument&) { threw = true; }
+		bool cycle = parent != TransformPool::NoParent && isAncestor(slot, parent);
+		if (threw != cycle)
+			error = cycle ? "a cycle was accepted" : "a valid parent was refused";
+		else if (!cycle)
+			parents[slot] = parent;
+	};
+
+	//every live slot against its own matrix times its parent's, composed from the top
+	std::vector<DirectX::XMFLOAT4X4> reference(count);
+	std::vector<bool> composed(count);
+	auto compose = [&](auto& self, uint32_t slot) -> DirectX::XMMATRIX
+	{
+		if (!composed[slot])
+		{
+			DirectX::XMFLOAT3 p = pool.GetPosition(slot), r = pool.GetRotation(slot), s = pool.GetScale(slot);
+			DirectX::XMMATRIX world = DirectX::XMMatrixScaling(s.x, s.y, s.z) * DirectX::XMMatrixRotationRollPitchYaw(r.x, r.y, r.z) * DirectX::XMMatrixTranslation(p.x, p.y, p.z);
+			if (parents[slot] != TransformPool::NoParent)
+				world = world * self(self, parents[slot]);
+			DirectX::XMStoreFloat4x4(&reference[slot], world);
+			composed[slot] = true;
+		}
+		return DirectX::XMLoadFloat4x4(&reference[slot]);
+	};
+	float worst = 0.0f;
+	auto check = [&]()
+	{
+		pool.Update(threadCount);
+		std::fill(composed.begin(), composed.end(), false);
+		for (uint32_t slot = 0; slot < count; slot++)
+		{
+			if (!alive[slot])
+				continue;
+			if (pool.GetParent(slot) != parents[slot])
+				error = "a parent isn't the one that was set";
+
+			DirectX::XMMATRIX world = compose(compose, slot);
+			DirectX::XMFLOAT4X4 inverseTranspose;
+			DirectX::XMStoreFloat4x4(&inverseTranspose, DirectX::XMMatrixTranspose(DirectX::XMMatrixInverse(nullptr, world)));
+			const DirectX::XMFLOAT4X4* expected[2] = { &reference[slot], &inverseTranspose };
+			const DirectX::XMFLOAT4X4* pooled[2] = { &pool.GetWorldMatrix(slot), &pool.GetWorldInverseTransposeMatrix(slot) };
+			for (int m = 0; m < 2; m++)
+			{
+				//relative to the matrix's largest element, translations grow down the tree
+				float largest = 1.0f, difference = 0.0f;
+				for (int row = 0; row < 4; row++)
+				{
+					for (int column = 0; column < 4; column++)
+					{
+						largest = std::max(largest, fabsf(expected[m]->m[row][column]));
+						difference = std::max(difference, fabsf(expected[m]->m[row][column] - pooled[m]->m[row][column]));
+					}
+				}
+				worst = std::max(worst, difference / largest);
+			}
+		}
+		if (error.empty() && !(worst <= Tolerance))
+			error = "a world matrix differs from its parent chain";
+		return error.empty();
+	};
+
+	bool passed = check();
+	for (int round = 0; passed && round < 6; round++)
+	{
+		if (round % 2 == 0)
+		{
+			for (size_t i = 0; i < count / 100; i++)
+			{
+				uint32_t slot = (uint32_t)(rng() % count);
+				if (alive[slot])
+					randomize(slot);
+			}
+			for (int i = 0; i < 10; i++)
+				randomize((uint32_t)(rng() % 10));
+		}
+		else
+		{
+			for (size_t i = 0; i < count / 100; i++)
+			{
+				uint32_t slot = (uint32_t)(rng() % count);
+				uint32_t parent = rng() % 4 == 0 ? TransformPool::NoParent : (uint32_t)(rng() % (rng() % 2 == 0 ? TreeSize : count));
+				if (alive[slot] && (parent == TransformPool::NoParent || alive[parent]))
+					reparent(slot, parent);
+			}
+			for (int i = 0; i < 10; i++)
+			{
+				//its children lose their parent, and the slot comes back with none
+				uint32_t slot = (uint32_t)(rng() % count);
+				if (!alive[slot])
+					continue;
+				pool.Remove(slot);
+				alive[slot] = false;
+				for (uint32_t& parent : parents)
+					if (parent == slot)
+						parent = TransformPool::NoParent;
+				parents[slot] = TransformPool::NoParent;
+
+				uint32_t added = pool.Add();
+				alive[added] = true;
+				randomize(added);
+			}
+		}
+		passed = check();
+	}
+
+	printf("hierarchy check, seed %u, %zu transforms on %u thread%s: largest difference %.2g%s%s\n", seed, count, threadCount,
+		threadCount == 1 ? "" : "s", worst, passed ? "" : ", ", error.c_str());
+	return passed;
+}
+
+
+// Stand-ins for what Game's draw and shadow loops read from Mesh, Material and
+// Camera (the real ones need a device), and a GameEntity as it used to be
+namespace EntityBench
+{
+	struct Mesh { unsigned int indexCount; size_t subsetCount; };
+	struct Material { float roughness; };
+	struct View { DirectX::XMFLOAT4X4 viewProj; };
+
+	struct TransformRef
+	{
+		std::shared_ptr<Transform> transform;
+		TransformPool* pool;
+		uint32_t slot;
+
+		TransformRef(std::shared_ptr<Transform> transform) : transform(transform), pool(transform->GetPool()), slot(transform->GetPoolSlot()) {}
+		DirectX::XMFLOAT4X4 GetWorldMatrix() const
+		{
+			if (!pool)
+				return transform->GetWorldMatrix();
+			pool->UpdateSlot(slot);
+			return pool->GetWorldMatrix(slot);
+		}
+	};
+	struct MeshRef { std::shared_ptr<Mesh> mesh; };
+	struct MaterialRef { std::shared_ptr<Material> mat; std::vector<std::shared_ptr<Material>> subsetMats; };
+	struct DrawState { size_t culledTriangles = 0; unsigned int currentLod = 0; };
+	struct StaticEntity {};
+
+	class OldEntity
+	{
+	public:
+		OldEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> mat) : mesh(mesh), transform(std::make_shared<Transform>()), mat(mat) {}
+		std::shared_ptr<Mesh> GetMesh() { return mesh; }
+		std::shared_ptr<Transform> GetTransform() { return transform; }
+		std::shared_ptr<Material> GetSubsetMat(size_t) { return mat; }
+		float Draw(std::shared_ptr<View> view, std::shared_ptr<Transform> drawn, std::shared_ptr<Material> prepared)
+		{
+			culledTriangles = mesh->indexCount / 3;
+			return drawn->GetWorldMatrix()._41 * prepared->roughness + view->viewProj._11;
+		}
+
+	private:
+		std::shared_ptr<Mesh> mesh;
+		std::shared_ptr<Transform> transform;
+		std::shared_ptr<Material> mat;
+		std::vector<std::shared_ptr<Material>> subsetMats;
+		size_t culledTriangles = 0;
+		unsigned int currentLod = 0;
+		bool isStatic = false;
+	};
+}
+
+// A draw pass (transform, mesh, material and draw state of every entity) and a
+// shadow pass (transform and mesh) with pooled transforms, as Game runs them
+// - Old entities are timed in creation order and shuffled, the way the heap
+//   ends up once entities have come and gone
+// - A tenth of the store's entities are static, so queries span two archetypes
+void ReportEntities()
+{
+	using namespace EntityBench;
+	std::vector<std::shared_ptr<Mesh>> meshes;
+	std::vector<std::shared_ptr<Material>> materials;
+	for (unsigned int i = 0; i < 16; i++)
+	{
+		meshes.push_back(std::make_shared<Mesh>(Mesh{ 3000 + i * 300, 1 }));
+		materials.push_back(std::make_shared<Material>(Material{ 0.1f * (i % 10) }));
+	}
+	auto view = std::make_shared<View>();
+	DirectX::XMStoreFloat4x4(&view->viewProj, DirectX::XMMatrixIdentity());
+
+	for (size_t count : { (size_t)100000, (size_t)1000000 })
+	{
+		std::mt19937 rng(99);
+		auto pool = std::make_shared<TransformPool>((unsigned int)count * 2);
+		Transform::SetPool(pool);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		std::vector<std::shared_ptr<OldEntity>> oldEntities(count);
+		for (size_t i = 0; i < count; i++)
+			oldEntities[i] = std::make_shared<OldEntity>(meshes[i % meshes.size()], materials[i % materials.size()]);
+		double oldCreateMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		start = std::chrono::high_resolution_clock::now();
+		EntityStore store;
+		for (size_t i = 0; i < count; i++)
+		{
+			EntityHandle entity = store.Create(TransformRef{ std::make_shared<Transform>() }, MeshRef{ meshes[i % meshes.size()] },
+				MaterialRef{ materials[i % materials.size()], {} }, DrawState());
+			if (i % 10 == 0)
+				store.Add(entity, StaticEntity());
+		}
+		double storeCreateMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		std::uniform_real_distribution<float> unit(-100.0f, 100.0f);
+		for (auto& entity : oldEntities)
+			entity->GetTransform()->SetPosition(unit(rng), unit(rng), unit(rng));
+		store.Each<TransformRef>([&](EntityHandle, TransformRef& transform) { transform.transform->SetPosition(unit(rng), unit(rng), unit(rng)); });
+		pool->Update();
+
+		//checksum of what was read, so none of it gets optimized out
+		float sink = 0.0f;
+		auto best = [&](auto pass)
+		{
+			double fastest = 1e30;
+			for (int run = 0; run < 5; run++)
+			{
+				auto runStart = std::chrono::high_resolution_clock::now();
+				pass();
+				fastest = std::min(fastest, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - runStart).count());
+			}
+			return fastest;
+		};
+
+		//the old loops, shared_ptrs copied wherever Game and GameEntity copied them
+		auto oldDraw = [&]()
+		{
+			for (auto& entity : oldEntities)
+			{
+				std::shared_ptr<Material> mat = entity->GetSubsetMat(0);
+				sink += entity->Draw(view, entity->GetTransform(), mat);
+			}
+		};
+		auto oldShadow = [&]()
+		{
+			for (auto& e : oldEntities)
+				sink += e->GetTransform()->GetWorldMatrix()._41 + (float)e->GetMesh()->indexCount;
+		};
+		double oldDrawMs = best(oldDraw);
+		double oldShadowMs = best(oldShadow);
+		std::shuffle(oldEntities.begin(), oldEntities.end(), rng);
+		double shuffledDrawMs = best(oldDraw);
+		double shuffledShadowMs = best(oldShadow);
+
+		double storeDrawMs = best([&]()
+		{
+			View& frameView = *view;
+			store.Each<TransformRef, MeshRef, MaterialRef, DrawState>([&](EntityHandle, TransformRef& transform, MeshRef& mesh, MaterialRef& mats, DrawState& state)
+			{
+				state.culledTriangles = mesh.mesh->indexCount / 3;
+				sink += transform.GetWorldMatrix()._41 * mats.mat->roughness + frameView.viewProj._11;
+			});
+		});
+		double storeShadowMs = best([&]()
+		{
+			store.Each<TransformRef, MeshRef>([&](EntityHandle, TransformRef& transform, MeshRef& mesh)
+			{
+				sink += transform.GetWorldMatrix()._41 + (float)mesh.mesh->indexCount;
+			});
+		});
+
+		size_t staticCount = 0;
+		store.Each<StaticEntity>([&](EntityHandle, StaticEntity&) { staticCount++; });
+
+		printf("%zu entities (%zu static in their own archetype)%s:\n", count, staticCount, sink == 12345.0f ? " " : "");
+		printf("  create: shared_ptr each %.2f ms, store %.2f ms\n", oldCreateMs, storeCreateMs);
+		printf("  draw loop: shared_ptr each %.2f ms (shuffled %.2f ms), store %.2f ms (%.1fx, %.1fx shuffled)\n",
+			oldDrawMs, shuffledDrawMs, storeDrawMs, oldDrawMs / storeDrawMs, shuffledDrawMs / storeDrawMs);
+		printf("  shadow loop: shared_ptr each %.2f ms (shuffled %.2f ms), store %.2f ms (%.1fx, %.1fx shuffled)\n",
+			oldShadowMs, shuffledShadowMs, storeShadowMs, oldShadowMs / storeShadowMs, shuffledShadowMs / storeShadowMs);
+
+		oldEntities.clear();
+		Transform::SetPool(nullptr);
+	}
+}
+
+
+// FixedTimestep driven by a fake clock, so every expected step count and alpha is
+// exact; false (after printing what went wrong) if any of them are off
+bool CheckTimestep()
+{
+	bool passed = true;
+	auto check = [&](bool condition, const char* what)
+	{
+		if (!condition)
+			printf("  %s\n", what);
+		passed = passed && condition;
+	};
+
+	//one frame's worth: Advance() and then every step it said there were
+	auto frame = [&](FixedTimestep& timestep, int64_t ticks)
+	{
+		unsigned int pending = timestep.Advance(ticks);
+		unsigned int taken = 0;
+		while (timestep.Step())
+			taken++;
+		check(taken == pending, "Step() didn't hand out what Advance() returned");
+		return taken;
+	};
+
+	//an hour of 144 Hz frames on a QueryPerformanceCounter style clock, none of it lost
+	const int64_t ticksPerSecond = 10000000;
+	{
+		FixedTimestep timestep(ticksPerSecond, 60, 8);
+		int64_t now = 0;
+		uint64_t steps = 0;
+		bool alphaInRange = true, atMostOne = true;
+		for (int i = 0; i < 144 * 3600; i++)
+		{
+			now += ticksPerSecond / 144;
+			unsigned int taken = frame(timestep, ticksPerSecond / 144);
+			atMostOne = atMostOne && taken <= 1;
+			alphaInRange = alphaInRange && timestep.GetAlpha() >= 0.0f && timestep.GetAlpha() < 1.0f;
+			steps += taken;
+		}
+		check(atMostOne, "144 Hz: more than one 60 Hz step in a frame");
+		check(alphaInRange, "144 Hz: alpha outside [0, 1)");
+		check(steps == (uint64_t)(now * 60 / ticksPerSecond) && steps == timestep.GetStepCount(), "144 Hz: steps drifted from the clock over an hour");
+		check(timestep.GetDroppedSteps() == 0, "144 Hz: steps were dropped");
+		printf("an hour at 144 Hz: %llu steps, %.6f s simulated\n", (unsigned long long)steps, timestep.GetSimulationTime());
+	}
+
+	//frames exactly one step long, and exactly two
+	{
+		FixedTimestep timestep(60000, 60, 8);
+		uint64_t steps = 0;
+		for (int i = 0; i < 60; i++)
+			steps += frame(timestep, 1000);
+		check(steps == 60 && timestep.GetAlpha() == 0.0f, "60 Hz frames: not one step each with nothing left over");
+
+		FixedTimestep halfRate(3000000, 60, 8);
+		bool twoEach = true;
+		for (int i = 0; i < 10; i++)
+			twoEach = frame(halfRate, 100000) == 2 && twoEach;
+		check(twoEach, "30 Hz frames: not two steps each");
+	}
+
+	//a one second hitch: the limit's worth of steps, the rest dropped, the fraction kept
+	{
+		FixedTimestep timestep(1200000, 60, 5);
+		check(frame(timestep, 1200000 + 10000) == 5, "hitch: maxStepsPerFrame wasn't applied");
+		check(timestep.GetDroppedSteps() == 55, "hitch: dropped the wrong number of steps");
+		check(fabsf(timestep.GetAlpha() - 0.5f) < 1e-6f, "hitch: alpha isn't the half step left over");
+		check(frame(timestep, 10000) == 1 && timestep.GetAlpha() == 0.0f, "hitch: the next frame didn't finish the half step");
+		check(frame(timestep, -100) == 0 && timestep.GetAlpha() == 0.0f, "negative frame time counted");
+
+		//steps still waiting count against the limit too
+		FixedTimestep small(600, 60, 3);
+		check(small.Advance(20) == 2, "limit: two steps weren't waiting");
+		check(small.Advance(20) == 3 && small.GetDroppedSteps() == 1, "limit: waiting steps weren't clamped");
+		frame(small, 0);
+		check(small.GetStepCount() == 3 && fabs(small.GetSimulationTime() - 0.05) < 1e-12, "limit: step count or simulation time off");
+	}
+
+	//changing the rate keeps how far into the next step it is
+	{
+		FixedTimestep timestep(1200000, 60, 8);
+		frame(timestep, 10000);
+		float alpha = timestep.GetAlpha();
+		timestep.SetStepsPerSecond(120);
+		check(fabsf(timestep.GetAlpha() - alpha) < 1e-6f, "SetStepsPerSecond: alpha changed");
+		check(frame(timestep, 5000) == 1 && timestep.GetAlpha() == 0.0f, "SetStepsPerSecond: the rest of the step is the wrong length");
+	}
+
+	//jittery frames give the same steps and alphas every time, adding up to the clock
+	{
+		std::mt19937 rng(5);
+		FixedTimestep a(ticksPerSecond, 90, 1000), b(ticksPerSecond, 90, 1000);
+		int64_t now = 0;
+		uint64_t steps = 0;
+		bool same = true;
+		for (int i = 0; i < 100000; i++)
+		{
+			int64_t ticks = rng() % (ticksPerSecond / 20);
+			unsigned int taken = frame(a, ticks);
+			same = same && taken == frame(b, ticks) && a.GetAlpha() == b.GetAlpha();
+			now += ticks;
+			steps += taken;
+		}
+		check(same, "jitter: two runs over the same frames differ");
+		check(steps == (uint64_t)(now * 90 / ticksPerSecond), "jitter: steps drifted from the clock");
+	}
+
+	bool threw = false;
+	try { FixedTimestep timestep(0); }
+	catch (const std::invalid_argument&) { threw = true; }
+	check(threw, "a clock with no ticks per second was accepted");
+
+	printf("fixed timestep %s\n", passed ? "checks passed" : "checks failed");
+	return passed;
+}
+
+// A grid of entities with random primitives, materials and transforms
+// (some mirrored), the way Game would hand them to the batcher
+void ReportBatching(size_t entityCount)
+{
+	const unsigned int materialCount = 10;
+
+	CookedMesh shapes[4];
+	MeshGenerator::Sphere(32, 16, shapes[0]);
+	MeshGenerator::Torus(40, 20, GeneratedTorusRadius, GeneratedTorusTubeRadius, shapes[1]);
+	MeshGenerator::Cylinder(32, 1, shapes[2]);
+	MeshGenerator::Cube(1, shapes[3]);
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	size_t gridSize = (size_t)ceilf(sqrtf((float)entityCount));
+	std::vector<StaticBatchSource> sources(entityCount);
+	for (size_t i = 0; i < entityCount; i++)
+	{
+		const CookedMesh& shape = shapes[random() % 4];
+		float scale = 0.5f + unit(random) * 1.5f;
+		DirectX::XMMATRIX world =
+			DirectX::XMMatrixScaling(unit(random) < 0.1f ? -scale : scale, scale, scale) *
+			DirectX::XMMatrixRotationRollPitchYaw(0.0f, unit(random) * DirectX::XM_2PI, 0.0f) *
+			DirectX::XMMatrixTranslation((float)(i % gridSize) * 4.0f, 0.0f, (float)(i / gridSize) * 4.0f);
+
+		StaticBatchSource& source = sources[i];
+		source.vertices = shape.vertices.data();
+		source.vertexCount = shape.vertices.size();
+		source.indices = shape.indices.data();
+		source.indexCount = shape.lods[0].indexCount;
+		source.meshlets = shape.meshlets.data();
+		source.meshletCount = shape.meshlets.size();
+		DirectX::XMStoreFloat4x4(&source.world, world);
+		source.material = random() % materialCount;
+	}
+
+	std::vector<StaticBatch> batches;
+	StaticBatchStats stats = StaticBatcher::Build(sources.data(), sources.size(), batches);
+
+	size_t shortIndexBatches = 0;
+	size_t meshletCount = 0;
+	for (const StaticBatch& batch : batches)
+	{
+		shortIndexBatches += batch.mesh.vertices.size() <= 65536 ? 1 : 0;
+		meshletCount += batch.mesh.meshlets.size();
+	}
+
+	//unbatched, Game::Draw prepares the material and draws once per entity
+	printf("%zu static entities, %zu materials: %zu triangles, %zu verts\n",
+		stats.sourceCount, stats.materialCount, stats.triangleCount, stats.vertexCount);
+	printf("  draw calls and material setups %zu -> %zu (%.1fx fewer)\n",
+		stats.sourceCount, stats.batchCount, (float)stats.sourceCount / std::max<size_t>(stats.batchCount, 1));
+	printf("  %zu of %zu batches on 16-bit indices, %zu meshlets, built in %.2f ms\n",
+		shortIndexBatches, stats.batchCount, meshletCount, stats.milliseconds);
+}
+
+// Random allocate/free churn through a RangeAllocator, handled the way
+// GeometryPool handles a failed allocation (defragment if there's room in
+// total, otherwise double), with a buffer of tags standing in for the GPU
+// one, false if any range overlaps, moves or loses its contents, or free
+// space goes missing
+bool CheckRangeAllocator(unsigned int seed, size_t operationCount)
+{
+	std::mt19937 rng(seed);
+	RangeAllocator allocator(1 << 12);
+	std::vector<uint32_t> memory(allocator.GetCapacity(), 0);
+	std::vector<RangeHandle> live;
+	std::vector<uint32_t> tags;	// By handle, what the range was filled with
+	uint32_t nextTag = 1;
+	size_t defragments = 0, grows = 0, peakLive = 0;
+	std::string error;
+
+	//mostly small ranges, now and then a big one, like meshes
+	auto randomSize = [&]()
+	{
+		uint32_t size = 1u << (rng() % 12);
+		return size + (uint32_t)(rng() % size);
+	};
+
+	//every live range in bounds, not overlapping, still holding its tag
+	auto check = [&]()
+	{
+		std::vector<std::pair<uint32_t, RangeHandle>> byOffset;
+		uint64_t used = 0;
+		for (RangeHandle handle : live)
+		{
+			byOffset.push_back({ allocator.GetOffset(handle), handle });
+			used += allocator.GetSize(handle);
+		}
+		std::sort(byOffset.begin(), byOffset.end());
+		uint32_t end = 0;
+		for (auto& [offset, handle] : byOffset)
+		{
+			uint32_t size = allocator.GetSize(handle);
+			if (offset < end || (uint64_t)offset + size > allocator.GetCapacity())
+				return error = "ranges overlap or run past the end", false;
+			for (uint32_t i = offset; i < offset + size; i++)
+			{
+				if (memory[i] != tags[handle])
+					return error = "a range lost its contents", false;
+			}
+			end = offset + size;
+		}
+		if (used != allocator.GetUsed())
+			return error = "used doesn't match the live ranges", false;
+		if (allocator.GetLargestFree() > allocator.GetCapacity() - allocator.GetUsed())
+			return error = "largest free block is bigger than the free space", false;
+		return true;
+	};
+
+	auto defragment = [&]()
+	{
+		std::vector<RangeMove> moves = allocator.Defragment();
+		uint32_t packed = 0;
+		for (size_t i = 0; i < moves.size(); i++)
+		{
+			const RangeMove& move = moves[i];
+			if (move.to != packed || move.to > move.from || (i > 0 && move.from <= moves[i - 1].from) ||
+				move.size != allocator.GetSize(move.handle) || move.to != allocator.GetOffset(move.handle))
+				return error = "defragment moves aren't packed and in order", false;
+			memmove(memory.data() + move.to, memory.data() + move.from, move.size * sizeof(uint32_t));
+			packed += move.size;
+		}
+		if (moves.size() != live.size() || packed != allocator.GetUsed() ||
+			allocator.GetLargestFree() != allocator.GetCapacity() - allocator.GetUsed() || allocator.GetFreeBlockCount() > 1)
+			return error = "defragment left more than one free block", false;
+		defragments++;
+		return true;
+	};
+
+	auto allocate = [&](uint32_t size)
+	{
+		RangeHandle handle = allocator.Allocate(size);
+		if (handle == InvalidRange && allocator.GetLargestFree() >= size)
+			return error = "allocation failed with a free block big enough", false;
+		if (handle == InvalidRange && allocator.GetCapacity() - allocator.GetUsed() >= size)
+		{
+			if (!defragment())
+				return false;
+			handle = allocator.Allocate(size);
+		}
+		else if (handle == InvalidRange)
+		{
+			uint32_t capacity = std::max(allocator.GetCapacity() * 2, allocator.GetUsed() + size);
+			allocator.Grow(capacity);
+			memory.resize(capacity, 0);
+			grows++;
+			handle = allocator.Allocate(size);
+		}
+		if (handle == InvalidRange)
+			return error = "allocation failed after defragmenting or growing", false;
+
+		if (handle >= tags.size())
+			tags.resize(handle + 1);
+		tags[handle] = nextTag++;
+		std::fill(memory.begin() + allocator.GetOffset(handle), memory.begin() + allocator.GetOffset(handle) + size, tags[handle]);
+		live.push_back(handle);
+		return true;
+	};
+
+	bool passed = true;
+	for (size_t op = 0; passed && op < operationCount; op++)
+	{
+		//live count wanders between empty and a few thousand
+		size_t target = 1000 + (size_t)(900 * sinf(op * 0.0005f));
+		if (!live.empty() && rng() % (2 * target) < live.size())
+		{
+			size_t pick = rng() % live.size();
+			allocator.Free(live[pick]);
+			live[pick] = live.back();
+			live.pop_back();
+		}
+		else
+			passed = allocate(randomSize());
+
+		if (passed && rng() % 5000 == 0)
+			passed = defragment();
+		if (passed && op % 97 == 0)
+			passed = check();
+		peakLive = std::max(peakLive, live.size());
+	}
+
+	//with everything freed, the blocks have to merge back into one
+	for (RangeHandle handle : live)
+		allocator.Free(handle);
+	live.clear();
+	if (passed && (allocator.GetUsed() != 0 || allocator.GetFreeBlockCount() != 1 || allocator.GetLargestFree() != allocator.GetCapacity()))
+		passed = false, error = "free blocks didn't merge back into one";
+
+	printf("seed %u: %zu operations, up to %zu live ranges, %zu defragments, grown %zu times to %u%s%s\n",
+		seed, operationCount, peakLive, defragments, grows, allocator.GetCapacity(), passed ? "" : ", ", error.c_str());
+	return passed;
+}
+
+
+// Steady state churn on a pool sized like a level's worth of geometry:
+// how fast allocate and free are, and how fragmented the free space gets
+void ReportRangeAllocatorChurn(size_t liveCount, size_t operationCount)
+{
+	std::mt19937 rng(99);
+	auto randomSize = [&]()
+	{
+		uint32_t size = 1u << (rng() % 14);
+		return size + (uint32_t)(rng() % size);
+	};
+
+	//ranges average around 1750, so this starts about 80% full
+	RangeAllocator allocator((uint32_t)(liveCount * 2200));
+	std::vector<RangeHandle> live;
+	while (live.size() < liveCount)
+		live.push_back(allocator.Allocate(randomSize()));
+
+	//sizes picked up front, so only the allocator gets timed
+	std::vector<uint32_t> sizes(operationCount);
+	std::vector<uint32_t> picks(operationCount);
+	for (size_t i = 0; i < operationCount; i++)
+	{
+		sizes[i] = randomSize();
+		picks[i] = (uint32_t)(rng() % liveCount);
+	}
+
+	size_t failures = 0, repacks = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < operationCount; i++)
+	{
+		allocator.Free(live[picks[i]]);
+		RangeHandle handle = allocator.Allocate(sizes[i]);
+		if (handle == InvalidRange)
+		{
+			failures++;
+			if (allocator.GetCapacity() - allocator.GetUsed() >= sizes[i])
+			{
+				allocator.Defragment();
+				repacks++;
+			}
+			else
+				allocator.Grow(allocator.GetCapacity() * 2);
+			handle = allocator.Allocate(sizes[i]);
+		}
+		live[picks[i]] = handle;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	uint32_t freeSpace = allocator.GetCapacity() - allocator.GetUsed();
+	printf("churn, %zu live ranges: %.0f ns per free + allocate, %zu failed (%zu repacks)\n",
+		liveCount, seconds * 1e9 / operationCount, failures, repacks);
+	printf("  %.1f%% occupied, %zu free blocks, largest is %.1f%% of the free space\n",
+		100.0 * allocator.GetUsed() / allocator.GetCapacity(), allocator.GetFreeBlockCount(),
+		100.0 * allocator.GetLargestFree() / std::max(freeSpace, 1u));
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc == 2 && strcmp(argv[1], "--transforms") == 0)
+	{
+		ReportTransforms();
+		return ReportTransformFastPath() ? 0 : 1;
+	}
+
+	if (argc == 2 && strcmp(argv[1], "--hierarchy") == 0)
+	{
+		ReportHierarchies();
+		bool passed = CheckHierarchy(11, 300000, 1);
+		passed = CheckHierarchy(11, 300000, 4) && passed;
+		return passed ? 0 : 1;
+	}
+
+	if (argc == 2 && strcmp(argv[1], "--entities") == 0)
+	{
+		ReportEntities();
+		return 0;
+	}
+
+	if (argc == 2 && strcmp(argv[1], "--timestep") == 0)
+		return CheckTimestep() ? 0 : 1;
+
+	if (argc == 3 && strcmp(argv[1], "--batch") == 0)
+	{
+		size_t entityCount = (size_t)strtoull(argv[2], nullptr, 10);
+		if (entityCount > 0)
+		{
+			ReportBatching(entityCount);
+			return 0;
+		}
+	}
+
+	if (argc == 2 && strcmp(argv[1], "--allocator") == 0)
+	{
+		bool passed = true;
+		for (unsigned int seed = 1; seed <= 4; seed++)
+			passed = CheckRangeAllocator(seed, 200000) && passed;
+		ReportRangeAllocatorChurn(10000, 1000000);
+		ReportRangeAllocatorChurn(100000, 1000000);
+		return passed ? 0 : 1;
+	}
+
+	printf("Usage: SceneBench --transforms\n");
+	printf("       SceneBench --hierarchy\n");
+	printf("       SceneBench --entities\n");
+	printf("       SceneBench --timestep\n");
+	printf("       SceneBench --batch <entities>\n");
+	printf("       SceneBench --allocator\n");
+	return 1;
+}
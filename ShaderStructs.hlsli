@@ -4,6 +4,8 @@
 // Struct representing a single vertex worth of data
 // - This should match the vertex definition in our C++ code
 // - By "match", I mean the size, order and number of members
+// - The input layout is built from StandardVertexFormat in VertexFormat.h,
+//   and creating it fails if the semantics here don't line up
 // - The name of the struct itself is unimportant, but should be descriptive
 // - Each variable must have a semantic, which defines its usage
 struct VertexShaderInput
@@ -19,6 +21,27 @@ struct VertexShaderInput
     float3 tangent: TANGENT;
 };
 
+// Quantized version of VertexShaderInput (matches CompactVertex in Vertex.h)
+// - The input layout (from CompactVertexFormat) does the unpacking, so everything arrives as floats:
+//   POSITION is R16G16B16A16_FLOAT or _UNORM, TEXCOORD is R16G16_FLOAT,
+//   NORMAL and TANGENT are R16G16_SNORM
+// - Use DecodeCompactVertex() to turn it back into a VertexShaderInput
+struct CompactVertexShaderInput
+{
+    float4 localPosition : POSITION; // XYZ position, W tangent handedness
+    float2 uv : TEXCOORD;
+    float2 normal : NORMAL; // Octahedral encoded
+    float2 tangent : TANGENT; // Octahedral encoded
+};
+
+// Just the position, for depth-only passes
+// - Matches both the separate position stream (see Mesh::DrawDepthOnly)
+//   and the start of a full Vertex
+struct DepthVertexShaderInput
+{
+    float3 localPosition : POSITION; // XYZ position
+};
+
 // Struct representing the data we're sending down the pipeline
 // - Should match our pixel shader's input (hence the name: Vertex to Pixel)
 // - At a minimum, we need a piece of data defined tagged as SV_POSITION
@@ -45,6 +68,33 @@ struct VertexToPixel_Sky
     float3 sampleDir : DIRECTION; // For cube map sampling
 };
 
+//octahedral [-1,1]^2 back to a unit vector (see VertexQuantize::DecodeOctahedral)
+float3 DecodeOctahedral(float2 e)
+{
+    float3 n = float3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy -= t * (n.xy >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+//unpacks a compact vertex, positionOffset/positionScale come from CompactVertexParams
+//(0 and 1 for half float positions)
+VertexShaderInput DecodeCompactVertex(CompactVertexShaderInput input, float3 positionOffset, float3 positionScale)
+{
+    VertexShaderInput output;
+    output.localPosition = positionOffset + input.localPosition.xyz * positionScale;
+    output.uv = input.uv;
+    output.normal = DecodeOctahedral(input.normal);
+    output.tangent = DecodeOctahedral(input.tangent);
+    return output;
+}
+
+//tangent handedness stored in the compact position's w
+float GetCompactHandedness(CompactVertexShaderInput input)
+{
+    return input.localPosition.w >= 0.5 ? 1.0 : -1.0;
+}
+
 //function to make a smooth color change using sin
 float3 GetColorShift(float t)
 {
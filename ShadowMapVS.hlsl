@@ -12,7 +12,7 @@ cbuffer externalData : register(b0)
 // --------------------------------------------------------
 // A simplified vertex shader for rendering to a shadow map
 // --------------------------------------------------------
-float4 main(VertexShaderInput input) : SV_POSITION
+float4 main(DepthVertexShaderInput input) : SV_POSITION
 {
     matrix shadowWVP = mul(projection, mul(view, world));
     return mul(shadowWVP, float4(input.localPosition, 1.0f));
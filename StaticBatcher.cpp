@@ -0,0 +1,171 @@
+#include "StaticBatcher.h"
+#include "MeshTools.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace DirectX;
+
+namespace
+{
+	// Bits per axis of the Morton code sources are sorted by
+	const unsigned int SortGridBits = 10;
+
+	unsigned int MortonCode(const XMFLOAT3& p, const XMFLOAT3& boundsMin, const XMFLOAT3& cellScale)
+	{
+		const float maxCell = (float)((1 << SortGridBits) - 1);
+		unsigned int x = (unsigned int)std::clamp((p.x - boundsMin.x) * cellScale.x, 0.0f, maxCell);
+		unsigned int y = (unsigned int)std::clamp((p.y - boundsMin.y) * cellScale.y, 0.0f, maxCell);
+		unsigned int z = (unsigned int)std::clamp((p.z - boundsMin.z) * cellScale.z, 0.0f, maxCell);
+
+		unsigned int code = 0;
+		for (unsigned int bit = 0; bit < SortGridBits; bit++)
+		{
+			code |= ((x >> bit) & 1) << (bit * 3);
+			code |= ((y >> bit) & 1) << (bit * 3 + 1);
+			code |= ((z >> bit) & 1) << (bit * 3 + 2);
+		}
+		return code;
+	}
+
+	inline XMFLOAT3 Translation(const XMFLOAT4X4& world)
+	{
+		return XMFLOAT3(world._41, world._42, world._43);
+	}
+}
+
+
+StaticBatchStats StaticBatcher::Build(const StaticBatchSource* sources, size_t numSources, std::vector<StaticBatch>& batches, size_t maxVertices)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	StaticBatchStats stats = {};
+	stats.sourceCount = numSources;
+	batches.clear();
+	if (numSources == 0)
+		return stats;
+
+	//sort by material, then along a Morton curve through the sources'
+	//origins so each batch covers a compact part of the world
+	XMFLOAT3 originMin = Translation(sources[0].world);
+	XMFLOAT3 originMax = originMin;
+	for (size_t i = 1; i < numSources; i++)
+	{
+		XMFLOAT3 origin = Translation(sources[i].world);
+		XMStoreFloat3(&originMin, XMVectorMin(XMLoadFloat3(&originMin), XMLoadFloat3(&origin)));
+		XMStoreFloat3(&originMax, XMVectorMax(XMLoadFloat3(&originMax), XMLoadFloat3(&origin)));
+	}
+	const float cells = (float)(1 << SortGridBits);
+	XMFLOAT3 cellScale(
+		originMax.x > originMin.x ? cells / (originMax.x - originMin.x) : 0.0f,
+		originMax.y > originMin.y ? cells / (originMax.y - originMin.y) : 0.0f,
+		originMax.z > originMin.z ? cells / (originMax.z - originMin.z) : 0.0f);
+
+	std::vector<std::pair<uint64_t, unsigned int>> order(numSources);
+	for (size_t i = 0; i < numSources; i++)
+	{
+		uint64_t code = MortonCode(Translation(sources[i].world), originMin, cellScale);
+		order[i] = { ((uint64_t)sources[i].material << 32) | code, (unsigned int)i };
+	}
+	std::sort(order.begin(), order.end());
+
+	std::vector<unsigned int> remap;
+	std::vector<Vertex> localVerts;
+	std::vector<unsigned int> localIndices;
+	StaticBatch* batch = nullptr;
+	for (size_t i = 0; i < numSources; i++)
+	{
+		unsigned int sourceIndex = order[i].second;
+		const StaticBatchSource& source = sources[sourceIndex];
+		if (i == 0 || source.material != sources[order[i - 1].second].material)
+			stats.materialCount++;
+		if (source.indexCount == 0)
+			continue;
+
+		//only keep the vertices LOD0 actually uses
+		remap.assign(source.vertexCount, ~0u);
+		localIndices.resize(source.indexCount);
+		unsigned int usedVerts = 0;
+		for (size_t j = 0; j < source.indexCount; j++)
+		{
+			unsigned int& slot = remap[source.indices[j]];
+			if (slot == ~0u)
+				slot = usedVerts++;
+			localIndices[j] = slot;
+		}
+
+		XMMATRIX world = XMLoadFloat4x4(&source.world);
+		XMVECTOR det = XMMatrixDeterminant(world);
+		XMMATRIX invTranspose = XMMatrixTranspose(XMMatrixInverse(nullptr, world));
+		localVerts.resize(usedVerts);
+		for (size_t v = 0; v < source.vertexCount; v++)
+		{
+			if (remap[v] == ~0u)
+				continue;
+
+			const Vertex& in = source.vertices[v];
+			Vertex& out = localVerts[remap[v]];
+			out.uv = in.uv;
+			XMStoreFloat3(&out.Position, XMVector3TransformCoord(XMLoadFloat3(&in.Position), world));
+			XMStoreFloat3(&out.normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&in.normal), invTranspose)));
+			XMStoreFloat3(&out.tangent, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&in.tangent), world)));
+		}
+
+		//mirroring turns clockwise triangles counter-clockwise
+		if (XMVectorGetX(det) < 0.0f)
+		{
+			for (size_t j = 0; j < localIndices.size(); j += 3)
+				std::swap(localIndices[j + 1], localIndices[j + 2]);
+		}
+
+		//meshlets are per source, so they never straddle two ranges
+		std::vector<Meshlet> meshlets;
+		if (source.meshletCount > 0)
+		{
+			meshlets.assign(source.meshlets, source.meshlets + source.meshletCount);
+			for (Meshlet& meshlet : meshlets)
+				meshlet.startIndex -= source.meshletIndexBase;
+			Meshlets::UpdateBounds(meshlets.data(), meshlets.size(), localVerts.data(), localIndices.data());
+		}
+		else
+		{
+			meshlets = Meshlets::Build(localVerts.data(), localVerts.size(), localIndices.data(), localIndices.size());
+		}
+
+		if (batch == nullptr || batch->material != source.material ||
+			(!batch->mesh.vertices.empty() && batch->mesh.vertices.size() + usedVerts > maxVertices))
+		{
+			batches.emplace_back();
+			batch = &batches.back();
+			batch->material = source.material;
+		}
+
+		CookedMesh& mesh = batch->mesh;
+		unsigned int baseVertex = (unsigned int)mesh.vertices.size();
+		unsigned int startIndex = (unsigned int)mesh.indices.size();
+		mesh.vertices.insert(mesh.vertices.end(), localVerts.begin(), localVerts.end());
+		for (unsigned int index : localIndices)
+			mesh.indices.push_back(baseVertex + index);
+		for (Meshlet& meshlet : meshlets)
+		{
+			meshlet.startIndex += startIndex;
+			mesh.meshlets.push_back(meshlet);
+		}
+
+		StaticBatchRange range = {};
+		range.source = sourceIndex;
+		range.startIndex = startIndex;
+		range.indexCount = (unsigned int)localIndices.size();
+		MeshTools::CalculateBounds(localVerts.data(), localVerts.size(), range.boundsMin, range.boundsMax);
+		batch->ranges.push_back(range);
+	}
+
+	//no simplified LODs, a batch spans too much of the world to pick one
+	for (StaticBatch& b : batches)
+	{
+		b.mesh.lods = { { 0, (unsigned int)b.mesh.indices.size(), 0.0f } };
+		stats.vertexCount += b.mesh.vertices.size();
+		stats.triangleCount += b.mesh.indices.size() / 3;
+	}
+	stats.batchCount = batches.size();
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return stats;
+}
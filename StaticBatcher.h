@@ -0,0 +1,74 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "MeshCache.h"
+#include "Meshlets.h"
+#include "Vertex.h"
+
+// Most vertices a batch can hold, so its indices still fit in 16 bits
+const size_t StaticBatchMaxVertices = 65536;
+
+// One static entity's geometry (or one subset of it), placed in the world
+struct StaticBatchSource
+{
+	const Vertex* vertices;
+	size_t vertexCount;
+	const unsigned int* indices;	// LOD0 only
+	size_t indexCount;
+	const Meshlet* meshlets;	// Optional, LOD0's meshlets get refit instead of rebuilt
+	size_t meshletCount;
+	unsigned int meshletIndexBase;	// Where indices starts in the buffer the meshlets' startIndex counts from
+	DirectX::XMFLOAT4X4 world;
+	unsigned int material;	// Anything that tells materials apart, batches never mix two
+};
+
+// Where one source ended up inside a batch's index buffer
+struct StaticBatchRange
+{
+	unsigned int source;	// Index into the sources given to Build()
+	unsigned int startIndex;
+	unsigned int indexCount;
+	DirectX::XMFLOAT3 boundsMin;	// World space
+	DirectX::XMFLOAT3 boundsMax;
+};
+
+// Pre-transformed geometry for a group of sources sharing a material
+// - mesh is in world space (draw it with an identity transform) and
+//   has a single LOD
+// - Meshlets never straddle two ranges, so both can be used for culling
+struct StaticBatch
+{
+	unsigned int material;
+	CookedMesh mesh;
+	std::vector<StaticBatchRange> ranges;
+};
+
+// What a batching pass did, for reporting
+struct StaticBatchStats
+{
+	size_t sourceCount;
+	size_t materialCount;
+	size_t batchCount;	// Draw calls (and material switches) left
+	size_t vertexCount;
+	size_t triangleCount;
+	double milliseconds;
+};
+
+
+// --------------------------------------------------------
+// Merges static geometry into as few draws as possible
+//
+// - Sources are grouped by material and sorted spatially,
+//   then transformed into world space and appended to the
+//   batch for that material
+// - A new batch is started whenever the current one would go
+//   over maxVertices; a source bigger than that on its own
+//   gets a batch to itself
+// - Mirrored transforms have their winding flipped so front
+//   faces stay clockwise
+// --------------------------------------------------------
+namespace StaticBatcher
+{
+	StaticBatchStats Build(const StaticBatchSource* sources, size_t numSources, std::vector<StaticBatch>& batches,
+		size_t maxVertices = StaticBatchMaxVertices);
+}
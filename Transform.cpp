@@ -1,119 +1,175 @@
 #include "Transform.h"
+#include "TransformPool.h"
 #include <DirectXMath.h>
+#include <stdexcept>
 using namespace DirectX;
 
-Transform::Transform() : position(0, 0, 0), rotation(0, 0, 0), scale(1, 1, 1), isDirty(true) {
+Transform::Transform() : position(0, 0, 0), rotation(0, 0, 0), scale(1, 1, 1), isDirty(true), version(0), isBasisDirty(true), pool(transformPool), poolSlot(0) {
     XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
     XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixIdentity());
+    if (pool)
+        poolSlot = pool->Add();
+}
+
+Transform::~Transform() {
+    if (pool)
+        pool->Remove(poolSlot);
+}
+
+void Transform::SetParent(std::shared_ptr<Transform> parent) {
+    if (!pool || (parent && parent->pool != pool))
+        throw std::invalid_argument("Transform::SetParent needs both transforms in the same TransformPool");
+    pool->SetParent(poolSlot, parent ? parent->poolSlot : TransformPool::NoParent);
+    this->parent = parent;
 }
 
 void Transform::UpdateMatrices() {
+    //pooled matrices are normally rebuilt in bulk, this only catches changes since then
+    if (pool) {
+        pool->UpdateSlot(poolSlot);
+        return;
+    }
     if (!isDirty) return;
-    XMMATRIX trans = XMMatrixTranslation(position.x, position.y, position.z);
-    XMMATRIX rot = XMMatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
-    XMMATRIX scl = XMMatrixScaling(scale.x, scale.y, scale.z);
-    XMMATRIX world = scl * rot * trans;
-    XMStoreFloat4x4(&worldMatrix, world);
-    XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixInverse(0, XMMatrixTranspose(world)));
+    UpdateBasis();
+
+    //scale * rotation * translation is just the basis rows scaled, with the position under them;
+    //its inverse is (translation^-1)(rotation^T)(scale^-1), so transposed that's the basis rows
+    //over the scale, with the position pulled back through them in the last column
+    const XMFLOAT3* rows[3] = { &right, &up, &forward };
+    const float scales[3] = { scale.x, scale.y, scale.z };
+    const float pos[3] = { position.x, position.y, position.z };
+    for (int i = 0; i < 3; i++) {
+        const float* row = &rows[i]->x;
+        float inverseScale = 1.0f / scales[i];
+        for (int j = 0; j < 3; j++) {
+            worldMatrix.m[i][j] = row[j] * scales[i];
+            worldInverseTransposeMatrix.m[i][j] = row[j] * inverseScale;
+        }
+        worldMatrix.m[i][3] = 0.0f;
+        worldInverseTransposeMatrix.m[i][3] = -(pos[0] * row[0] + pos[1] * row[1] + pos[2] * row[2]) * inverseScale;
+        worldMatrix.m[3][i] = pos[i];
+        worldInverseTransposeMatrix.m[3][i] = 0.0f;
+    }
+    worldMatrix._44 = worldInverseTransposeMatrix._44 = 1.0f;
     isDirty = false;
+    version++;
+}
+
+void Transform::UpdateBasis() {
+    if (!isBasisDirty) return;
+    XMFLOAT3 rot = GetPitchYawRoll();
+    XMVECTOR rotQuat = XMQuaternionRotationRollPitchYaw(rot.x, rot.y, rot.z);
+    XMStoreFloat4(&rotationQuaternion, rotQuat);
+    //rows of the rotation matrix are where the local axes end up
+    XMFLOAT4X4 rotMatrix;
+    XMStoreFloat4x4(&rotMatrix, XMMatrixRotationQuaternion(rotQuat));
+    right = XMFLOAT3(rotMatrix._11, rotMatrix._12, rotMatrix._13);
+    up = XMFLOAT3(rotMatrix._21, rotMatrix._22, rotMatrix._23);
+    forward = XMFLOAT3(rotMatrix._31, rotMatrix._32, rotMatrix._33);
+    isBasisDirty = false;
 }
 
 void Transform::SetPosition(float x, float y, float z) {
-    position = { x, y, z };
-    isDirty = true;
+    SetPosition(XMFLOAT3(x, y, z));
 }
 
 void Transform::SetPosition(XMFLOAT3 pos) {
+    if (pool) {
+        pool->SetPosition(poolSlot, pos);
+        return;
+    }
     position = pos;
     isDirty = true;
 }
 
 void Transform::SetRotation(float pitch, float yaw, float roll) {
-    rotation = { pitch, yaw, roll };
-    isDirty = true;
+    SetRotation(XMFLOAT3(pitch, yaw, roll));
 }
 
 void Transform::SetRotation(XMFLOAT3 rot) {
+    isBasisDirty = true;
+    if (pool) {
+        pool->SetRotation(poolSlot, rot);
+        return;
+    }
     rotation = rot;
     isDirty = true;
 }
 
 void Transform::SetScale(float x, float y, float z) {
-    scale = { x, y, z };
-    isDirty = true;
+    SetScale(XMFLOAT3(x, y, z));
 }
 
 void Transform::SetScale(XMFLOAT3 scl) {
+    if (pool) {
+        pool->SetScale(poolSlot, scl);
+        return;
+    }
     scale = scl;
     isDirty = true;
 }
 
-XMFLOAT3 Transform::GetPosition() const { return position; }
-XMFLOAT3 Transform::GetPitchYawRoll() const { return rotation; }
-XMFLOAT3 Transform::GetScale() const { return scale; }
+XMFLOAT3 Transform::GetPosition() const { return pool ? pool->GetPosition(poolSlot) : position; }
+XMFLOAT3 Transform::GetPitchYawRoll() const { return pool ? pool->GetRotation(poolSlot) : rotation; }
+XMFLOAT3 Transform::GetScale() const { return pool ? pool->GetScale(poolSlot) : scale; }
 
 XMFLOAT4X4 Transform::GetWorldMatrix() {
     UpdateMatrices();
-    return worldMatrix;
+    return pool ? pool->GetWorldMatrix(poolSlot) : worldMatrix;
 }
 
 XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix() {
     UpdateMatrices();
-    return worldInverseTransposeMatrix;
+    return pool ? pool->GetWorldInverseTransposeMatrix(poolSlot) : worldInverseTransposeMatrix;
+}
+
+unsigned int Transform::GetWorldMatrixVersion() {
+    UpdateMatrices();
+    return pool ? pool->GetVersion(poolSlot) : version;
+}
+
+XMFLOAT4 Transform::GetRotationQuaternion() {
+    UpdateBasis();
+    return rotationQuaternion;
 }
 
 void Transform::MoveAbsolute(float x, float y, float z) {
-    position.x += x;
-    position.y += y;
-    position.z += z;
-    isDirty = true;
+    XMFLOAT3 pos = GetPosition();
+    SetPosition(pos.x + x, pos.y + y, pos.z + z);
 }
 
 void Transform::MoveAbsolute(XMFLOAT3 offset) {
-    position.x += offset.x;
-    position.y += offset.y;
-    position.z += offset.z;
-    isDirty = true;
+    MoveAbsolute(offset.x, offset.y, offset.z);
 }
 
 void Transform::Rotate(float pitch, float yaw, float roll) {
-    rotation.x += pitch;
-    rotation.y += yaw;
-    rotation.z += roll;
-    isDirty = true;
+    XMFLOAT3 rot = GetPitchYawRoll();
+    SetRotation(rot.x + pitch, rot.y + yaw, rot.z + roll);
 }
 
 void Transform::Rotate(XMFLOAT3 rot) {
-    rotation.x += rot.x;
-    rotation.y += rot.y;
-    rotation.z += rot.z;
-    isDirty = true;
+    Rotate(rot.x, rot.y, rot.z);
 }
 
 void Transform::Scale(float x, float y, float z) {
-    scale.x *= x;
-    scale.y *= y;
-    scale.z *= z;
-    isDirty = true;
+    XMFLOAT3 scl = GetScale();
+    SetScale(scl.x * x, scl.y * y, scl.z * z);
 }
 
 void Transform::Scale(XMFLOAT3 scl) {
-    scale.x *= scl.x;
-    scale.y *= scl.y;
-    scale.z *= scl.z;
-    isDirty = true;
+    Scale(scl.x, scl.y, scl.z);
 }
 
 //move along our "local" axis
 void Transform::MoveRelative(float x, float y, float z)
 {
-    XMVECTOR movement = XMVectorSet(x, y, z, 0);
-    //a quaternion for ration based p/y/r
-    XMVECTOR rotQuat = XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
-    //perform rotation of desired movment
-    XMVECTOR dir = XMVector3Rotate(movement, rotQuat);
+    UpdateBasis();
+    //rotating the movement is the same as stepping along each local axis
+    XMVECTOR dir = XMLoadFloat3(&right) * x + XMLoadFloat3(&up) * y + XMLoadFloat3(&forward) * z;
     //store rotated direction and add to our position
-    XMStoreFloat3(&position, XMLoadFloat3(&position) + dir); 
+    XMFLOAT3 pos = GetPosition();
+    XMStoreFloat3(&pos, XMLoadFloat3(&pos) + dir);
+    SetPosition(pos);
 }
 
 void Transform::MoveRelative(XMFLOAT3 offset)
@@ -123,30 +179,18 @@ void Transform::MoveRelative(XMFLOAT3 offset)
 
 XMFLOAT3 Transform::GetRight() 
 {
-    XMVECTOR right = XMVectorSet(1,0,0,0);
-    XMVECTOR rotQuat = XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
-    XMVECTOR dir = XMVector3Rotate(right, rotQuat);
-    XMFLOAT3 result;
-    XMStoreFloat3(&result, dir);
-    return result;
+    UpdateBasis();
+    return right;
 }
 
 XMFLOAT3 Transform::GetUp() 
 {
-    XMVECTOR up = XMVectorSet(0, 1, 0, 0);
-    XMVECTOR rotQuat = XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
-    XMVECTOR dir = XMVector3Rotate(up, rotQuat);
-    XMFLOAT3 result;
-    XMStoreFloat3(&result, dir);
-    return result;
+    UpdateBasis();
+    return up;
 }
 
 XMFLOAT3 Transform::GetForward() 
 {
-    XMVECTOR forward = XMVectorSet(0, 0, 1, 0);
-    XMVECTOR rotQuat = XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
-    XMVECTOR dir = XMVector3Rotate(forward, rotQuat);
-    XMFLOAT3 result;
-    XMStoreFloat3(&result, dir);
-    return result;
+    UpdateBasis();
+    return forward;
 }
\ No newline at end of file
@@ -1,10 +1,28 @@
 #pragma once
 #include <DirectXMath.h>
+#include <cstdint>
+#include <memory>
+
+class TransformPool;
 
 class Transform
 {
 public:
     Transform();
+    ~Transform();
+
+    Transform(const Transform&) = delete; //would share its pool slot
+    Transform& operator=(const Transform&) = delete;
+
+    //transforms created while a pool is set keep everything in it, so
+    //TransformPool::Update() can rebuild their matrices together
+    static void SetPool(std::shared_ptr<TransformPool> pool) { transformPool = pool; }
+
+    //the parent's world matrix is applied after this one's, so position, rotation
+    //and scale (and everything that gets them) become relative to the parent;
+    //both have to be in the same pool, nullptr detaches
+    void SetParent(std::shared_ptr<Transform> parent);
+    std::shared_ptr<Transform> GetParent() { return parent; }
 
     // Setters
     void SetPosition(float x, float y, float z);
@@ -20,6 +38,12 @@ public:
     DirectX::XMFLOAT3 GetScale() const;
     DirectX::XMFLOAT4X4 GetWorldMatrix();
     DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
+    unsigned int GetWorldMatrixVersion(); //changes whenever the world matrix does, for caching things made from it
+    DirectX::XMFLOAT4 GetRotationQuaternion();
+
+    //where the transform lives when it's pooled (nullptr if it isn't), neither changes after it's made
+    TransformPool* GetPool() const { return pool.get(); }
+    uint32_t GetPoolSlot() const { return poolSlot; }
 
     // Transformers
     void MoveAbsolute(float x, float y, float z);
@@ -37,13 +61,26 @@ public:
     DirectX::XMFLOAT3 GetForward();
 
 private:
+    //used unless the transform lives in a pool
     DirectX::XMFLOAT3 position;
     DirectX::XMFLOAT3 rotation; // Pitch, Yaw, Roll
     DirectX::XMFLOAT3 scale;
     DirectX::XMFLOAT4X4 worldMatrix;
     DirectX::XMFLOAT4X4 worldInverseTransposeMatrix;
     bool isDirty;
+    unsigned int version;
+
+    //rebuilt from pitch/yaw/roll the first time they're needed after a rotation,
+    //pooled or not (the pool only keeps the angles)
+    DirectX::XMFLOAT4 rotationQuaternion;
+    DirectX::XMFLOAT3 right, up, forward;
+    bool isBasisDirty;
+
+    std::shared_ptr<TransformPool> pool;
+    uint32_t poolSlot;
+    std::shared_ptr<Transform> parent;
+    inline static std::shared_ptr<TransformPool> transformPool;
 
     void UpdateMatrices();
+    void UpdateBasis();
 };
-
@@ -0,0 +1,579 @@
+#include "TransformPool.h"
+#include "WorkerThreads.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TRANSFORM_POOL_SSE 1
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	//a thread is only worth starting for at least this many slots (in 64 slot words)
+	const size_t MinWordsPerThread = 256;
+
+#ifdef TRANSFORM_POOL_SSE
+	//sine and cosine of four angles, the same polynomials XMVectorSinCos uses
+	void SinCos(__m128 angles, __m128& sine, __m128& cosine)
+	{
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+
+		//into [-pi, pi], then folded into [-pi/2, pi/2] with the cosine's sign flipped where it was folded
+		__m128 turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(angles, _mm_set1_ps(XM_1DIV2PI))));
+		__m128 x = _mm_sub_ps(angles, _mm_mul_ps(turns, _mm_set1_ps(XM_2PI)));
+		__m128 sign = _mm_and_ps(x, signMask);
+		__m128 reflected = _mm_sub_ps(_mm_or_ps(_mm_set1_ps(XM_PI), sign), x);
+		__m128 folded = _mm_cmpgt_ps(_mm_andnot_ps(signMask, x), _mm_set1_ps(XM_PIDIV2));
+		x = _mm_or_ps(_mm_and_ps(folded, reflected), _mm_andnot_ps(folded, x));
+		__m128 cosineSign = _mm_and_ps(folded, signMask);
+
+		__m128 x2 = _mm_mul_ps(x, x);
+		__m128 s = _mm_set1_ps(-2.3889859e-08f);
+		s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(2.7525562e-06f));
+		s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(-0.00019840874f));
+		s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(0.0083333310f));
+		s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(-0.16666667f));
+		s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(1.0f));
+		sine = _mm_mul_ps(s, x);
+
+		__m128 c = _mm_set1_ps(-2.6051615e-07f);
+		c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(2.4760495e-05f));
+		c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-0.0013888378f));
+		c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(0.041666638f));
+		c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-0.5f));
+		c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(1.0f));
+		cosine = _mm_xor_ps(c, cosineSign);
+	}
+
+	//row'th rows of four matrices, given as one vector per column
+	void StoreRows(XMFLOAT4X4* const matrices[4], int row, __m128 c0, __m128 c1, __m128 c2, __m128 c3, unsigned int mask)
+	{
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		if (mask & 1) _mm_storeu_ps(matrices[0]->m[row], c0);
+		if (mask & 2) _mm_storeu_ps(matrices[1]->m[row], c1);
+		if (mask & 4) _mm_storeu_ps(matrices[2]->m[row], c2);
+		if (mask & 8) _mm_storeu_ps(matrices[3]->m[row], c3);
+	}
+#endif
+
+	//out = a * b, out can't be either of them
+	void Multiply(const XMFLOAT4X4& a, const XMFLOAT4X4& b, XMFLOAT4X4& out)
+	{
+#ifdef TRANSFORM_POOL_SSE
+		__m128 rows[4] = { _mm_loadu_ps(b.m[0]), _mm_loadu_ps(b.m[1]), _mm_loadu_ps(b.m[2]), _mm_loadu_ps(b.m[3]) };
+		for (int i = 0; i < 4; i++)
+		{
+			__m128 row = _mm_mul_ps(_mm_set1_ps(a.m[i][0]), rows[0]);
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[i][1]), rows[1]));
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[i][2]), rows[2]));
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[i][3]), rows[3]));
+			_mm_storeu_ps(out.m[i], row);
+		}
+#else
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+				out.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+		}
+#endif
+	}
+
+	//mask of the bits of word that fall in [begin, end)
+	uint64_t RangeMask(size_t word, size_t begin, size_t end)
+	{
+		size_t first = std::max(begin, word * 64) - word * 64;
+		size_t last = std::min(end, word * 64 + 64) - word * 64;
+		if (first >= last)
+			return 0;
+		uint64_t mask = last == 64 ? ~0ull : (1ull << last) - 1;
+		return mask & ~((1ull << first) - 1);
+	}
+
+	//calls visit(i) for every set bit i in [begin, end)
+	template <typename Visit>
+	void ForEachBit(const std::vector<uint64_t>& bits, size_t begin, size_t end, Visit visit)
+	{
+		for (size_t word = begin / 64; word * 64 < end; word++)
+		{
+			uint64_t set = bits[word] & RangeMask(word, begin, end);
+			while (set)
+			{
+				visit((uint32_t)(word * 64 + std::countr_zero(set)));
+				set &= set - 1;
+			}
+		}
+	}
+
+	//sets the bits in [begin, end), returns how many weren't set already
+	size_t SetBits(std::vector<uint64_t>& bits, size_t begin, size_t end)
+	{
+		size_t added = 0;
+		for (size_t word = begin / 64; word * 64 < end; word++)
+		{
+			uint64_t mask = RangeMask(word, begin, end);
+			added += std::popcount(mask & ~bits[word]);
+			bits[word] |= mask;
+		}
+		return added;
+	}
+
+	void ClearBits(std::vector<uint64_t>& bits, size_t begin, size_t end)
+	{
+		for (size_t word = begin / 64; word * 64 < end; word++)
+			bits[word] &= ~RangeMask(word, begin, end);
+	}
+
+	unsigned int ThreadsFor(unsigned int threadCount, size_t words)
+	{
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		return (unsigned int)std::max<size_t>(1, std::min<size_t>(threadCount, words / MinWordsPerThread));
+	}
+}
+
+TransformPool::TransformPool(unsigned int capacity) :
+	slotCount(0),
+	hierarchyChanged(false)
+{
+	Reserve(capacity);
+}
+
+// --------------------------------------------------------
+// Capacity is kept to whole bitset words, which also keeps
+// every group of four inside the arrays
+// --------------------------------------------------------
+void TransformPool::Reserve(uint32_t capacity)
+{
+	capacity = (capacity + 63) & ~63u;
+	if (capacity <= dirty.size() * 64)
+		return;
+
+	for (std::vector<float>* component : { &positionX, &positionY, &positionZ, &pitch, &yaw, &roll })
+		component->resize(capacity, 0.0f);
+	for (std::vector<float>* component : { &scaleX, &scaleY, &scaleZ })
+		component->resize(capacity, 1.0f);
+	worldMatrices.resize(capacity);
+	worldInverseTransposeMatrices.resize(capacity);
+	versions.resize(capacity, 0);
+	dirty.resize(capacity / 64, 0);
+	parents.resize(capacity, NoParent);
+	childCounts.resize(capacity, 0);
+}
+
+uint32_t TransformPool::Add()
+{
+	uint32_t slot;
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		if (slotCount == dirty.size() * 64)
+			Reserve(std::max<uint32_t>(slotCount * 2, 64));
+		slot = slotCount++;
+	}
+
+	positionX[slot] = positionY[slot] = positionZ[slot] = 0.0f;
+	pitch[slot] = yaw[slot] = roll[slot] = 0.0f;
+	scaleX[slot] = scaleY[slot] = scaleZ[slot] = 1.0f;
+	XMStoreFloat4x4(&worldMatrices[slot], XMMatrixIdentity());
+	XMStoreFloat4x4(&worldInverseTransposeMatrices[slot], XMMatrixIdentity());
+	versions[slot]++;
+	return slot;
+}
+
+void TransformPool::Remove(uint32_t slot)
+{
+	SetParent(slot, NoParent);
+	if (childCounts[slot] > 0)
+	{
+		for (uint32_t child = 0; child < slotCount; child++)
+		{
+			if (parents[child] == slot)
+				SetParent(child, NoParent);
+		}
+	}
+
+	//it's out of the hierarchy now, whenever that gets rebuilt
+	if (slot < hierarchyIndices.size())
+		hierarchyIndices[slot] = NoParent;
+	dirty[slot / 64] &= ~(1ull << (slot % 64));
+	freeSlots.push_back(slot);
+}
+
+// --------------------------------------------------------
+// The slot's own values are kept, so it ends up in the same
+// place relative to its new parent; it's marked dirty since
+// its matrices move between the local and world arrays
+// --------------------------------------------------------
+void TransformPool::SetParent(uint32_t slot, uint32_t parent)
+{
+	if (parents[slot] == parent)
+		return;
+	for (uint32_t ancestor = parent; ancestor != NoParent; ancestor = parents[ancestor])
+	{
+		if (ancestor == slot)
+			throw std::invalid_argument("TransformPool::SetParent would make a slot its own ancestor");
+	}
+
+	if (parents[slot] != NoParent)
+		childCounts[parents[slot]]--;
+	if (parent != NoParent)
+		childCounts[parent]++;
+	parents[slot] = parent;
+	hierarchyChanged = true;
+	MarkDirty(slot);
+}
+
+void TransformPool::SetPosition(uint32_t slot, const XMFLOAT3& position)
+{
+	positionX[slot] = position.x;
+	positionY[slot] = position.y;
+	positionZ[slot] = position.z;
+	MarkDirty(slot);
+}
+
+void TransformPool::SetRotation(uint32_t slot, const XMFLOAT3& pitchYawRoll)
+{
+	pitch[slot] = pitchYawRoll.x;
+	yaw[slot] = pitchYawRoll.y;
+	roll[slot] = pitchYawRoll.z;
+	MarkDirty(slot);
+}
+
+void TransformPool::SetScale(uint32_t slot, const XMFLOAT3& scale)
+{
+	scaleX[slot] = scale.x;
+	scaleY[slot] = scale.y;
+	scaleZ[slot] = scale.z;
+	MarkDirty(slot);
+}
+
+
+// --------------------------------------------------------
+// World is scale * rotation * translation, with the same
+// roll, pitch, yaw order as XMMatrixRotationRollPitchYaw
+// - Each slot always goes through the whole group of four,
+//   so a slot comes out the same whether it was rebuilt by
+//   Update() or UpdateSlot()
+// - Slots with a parent get their local matrices, the world
+//   ones are composed afterwards
+// --------------------------------------------------------
+void TransformPool::RebuildGroup(uint32_t first, unsigned int mask)
+{
+	XMFLOAT4X4* world[4];
+	XMFLOAT4X4* inverseTranspose[4];
+	for (uint32_t lane = 0; lane < 4; lane++)
+	{
+		uint32_t index = GetHierarchyIndex(first + lane);
+		if (index == NoParent)
+		{
+			world[lane] = &worldMatrices[first + lane];
+			inverseTranspose[lane] = &worldInverseTransposeMatrices[first + lane];
+		}
+		else if (hierarchy[index].parent == NoParent)
+		{
+			world[lane] = &hierarchyWorldMatrices[index];
+			inverseTranspose[lane] = &hierarchyWorldInverseTransposeMatrices[index];
+		}
+		else
+		{
+			world[lane] = &hierarchyLocalMatrices[index];
+			inverseTranspose[lane] = &hierarchyLocalInverseTransposeMatrices[index];
+		}
+	}
+
+#ifdef TRANSFORM_POOL_SSE
+	__m128 sp, cp, sy, cy, sr, cr;
+	SinCos(_mm_loadu_ps(&pitch[first]), sp, cp);
+	SinCos(_mm_loadu_ps(&yaw[first]), sy, cy);
+	SinCos(_mm_loadu_ps(&roll[first]), sr, cr);
+
+	//rotation rows
+	__m128 srsp = _mm_mul_ps(sr, sp);
+	__m128 crsp = _mm_mul_ps(cr, sp);
+	__m128 r[3][3] =
+	{
+		{ _mm_add_ps(_mm_mul_ps(cr, cy), _mm_mul_ps(srsp, sy)), _mm_mul_ps(sr, cp), _mm_sub_ps(_mm_mul_ps(srsp, cy), _mm_mul_ps(cr, sy)) },
+		{ _mm_sub_ps(_mm_mul_ps(crsp, sy), _mm_mul_ps(sr, cy)), _mm_mul_ps(cr, cp), _mm_add_ps(_mm_mul_ps(sr, sy), _mm_mul_ps(crsp, cy)) },
+		{ _mm_mul_ps(cp, sy), _mm_xor_ps(sp, _mm_set1_ps(-0.0f)), _mm_mul_ps(cp, cy) }
+	};
+
+	__m128 scale[3] = { _mm_loadu_ps(&scaleX[first]), _mm_loadu_ps(&scaleY[first]), _mm_loadu_ps(&scaleZ[first]) };
+	__m128 position[3] = { _mm_loadu_ps(&positionX[first]), _mm_loadu_ps(&positionY[first]), _mm_loadu_ps(&positionZ[first]) };
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	for (int i = 0; i < 3; i++)
+	{
+		StoreRows(world, i, _mm_mul_ps(r[i][0], scale[i]), _mm_mul_ps(r[i][1], scale[i]), _mm_mul_ps(r[i][2], scale[i]), zero, mask);
+
+		//the inverse is (translation^-1)(rotation^T)(scale^-1), transposed that's rotation rows over the scale
+		__m128 inverseScale = _mm_div_ps(one, scale[i]);
+		__m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(position[0], r[i][0]), _mm_mul_ps(position[1], r[i][1])), _mm_mul_ps(position[2], r[i][2]));
+		StoreRows(inverseTranspose, i, _mm_mul_ps(r[i][0], inverseScale), _mm_mul_ps(r[i][1], inverseScale), _mm_mul_ps(r[i][2], inverseScale),
+			_mm_sub_ps(zero, _mm_mul_ps(along, inverseScale)), mask);
+	}
+	StoreRows(world, 3, position[0], position[1], position[2], one, mask);
+	StoreRows(inverseTranspose, 3, zero, zero, zero, one, mask);
+#else
+	for (uint32_t slot = first; slot < first + 4; slot++)
+	{
+		if (!(mask & (1u << (slot - first))))
+			continue;
+
+		float sp = sinf(pitch[slot]), cp = cosf(pitch[slot]);
+		float sy = sinf(yaw[slot]), cy = cosf(yaw[slot]);
+		float sr = sinf(roll[slot]), cr = cosf(roll[slot]);
+		float r[3][3] =
+		{
+			{ cr * cy + sr * sp * sy, sr * cp, sr * sp * cy - cr * sy },
+			{ cr * sp * sy - sr * cy, cr * cp, sr * sy + cr * sp * cy },
+			{ cp * sy, -sp, cp * cy }
+		};
+		float scale[3] = { scaleX[slot], scaleY[slot], scaleZ[slot] };
+		float position[3] = { positionX[slot], positionY[slot], positionZ[slot] };
+
+		XMFLOAT4X4& slotWorld = *world[slot - first];
+		XMFLOAT4X4& slotInverseTranspose = *inverseTranspose[slot - first];
+		for (int i = 0; i < 3; i++)
+		{
+			float inverseScale = 1.0f / scale[i];
+			float along = position[0] * r[i][0] + position[1] * r[i][1] + position[2] * r[i][2];
+			for (int j = 0; j < 3; j++)
+			{
+				slotWorld.m[i][j] = r[i][j] * scale[i];
+				slotInverseTranspose.m[i][j] = r[i][j] * inverseScale;
+			}
+			slotWorld.m[i][3] = 0.0f;
+			slotInverseTranspose.m[i][3] = -along * inverseScale;
+			slotWorld.m[3][i] = position[i];
+			slotInverseTranspose.m[3][i] = 0.0f;
+		}
+		slotWorld.m[3][3] = slotInverseTranspose.m[3][3] = 1.0f;
+	}
+#endif
+
+	for (uint32_t lane = 0; lane < 4; lane++)
+	{
+		if (mask & (1u << lane))
+			versions[first + lane]++;
+	}
+}
+
+size_t TransformPool::UpdateWords(size_t firstWord, size_t endWord)
+{
+	size_t rebuilt = 0;
+	for (size_t word = firstWord; word < endWord; word++)
+	{
+		uint64_t bits = dirty[word];
+		while (bits)
+		{
+			//whole group of four around the lowest dirty slot
+			unsigned int group = 0;
+			while (!(bits & (0xFull << group)))
+				group += 4;
+			unsigned int mask = (unsigned int)(bits >> group) & 0xF;
+			RebuildGroup((uint32_t)(word * 64 + group), mask);
+			bits &= ~(0xFull << group);
+			rebuilt += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+		}
+		dirty[word] = 0;
+	}
+	return rebuilt;
+}
+
+
+// --------------------------------------------------------
+// Threads each take a run of whole bitset words, so none of
+// them ever write the same word or matrix cache line
+// - Hierarchy nodes whose own values changed are noted first,
+//   since rebuilding clears the dirty bits
+// --------------------------------------------------------
+size_t TransformPool::Update(unsigned int threadCount)
+{
+	if (hierarchyChanged)
+		RebuildHierarchy();
+
+	size_t wordCount = (slotCount + 63) / 64;
+	if (!hierarchy.empty())
+	{
+		ForEachBit(dirty, 0, slotCount, [&](uint32_t slot)
+		{
+			uint32_t index = GetHierarchyIndex(slot);
+			if (index != NoParent)
+				changed[index / 64] |= 1ull << (index % 64);
+		});
+	}
+
+	unsigned int updateThreads = ThreadsFor(threadCount, wordCount);
+	std::vector<size_t> rebuilt(updateThreads, 0);
+	RunOnThreads(updateThreads, 0, wordCount, [&](unsigned int t, size_t firstWord, size_t endWord) { rebuilt[t] = UpdateWords(firstWord, endWord); });
+
+	size_t total = hierarchy.empty() ? 0 : UpdateHierarchy(threadCount);
+	for (size_t count : rebuilt)
+		total += count;
+	return total;
+}
+
+void TransformPool::UpdateSlot(uint32_t slot)
+{
+	if (hierarchyChanged)
+		RebuildHierarchy();
+
+	uint32_t index = GetHierarchyIndex(slot);
+	if (index == NoParent)
+	{
+		if (!IsDirty(slot))
+			return;
+		RebuildGroup(slot & ~3u, 1u << (slot & 3));
+		dirty[slot / 64] &= ~(1ull << (slot % 64));
+		return;
+	}
+
+	//everything from the highest dirty ancestor down to the slot is out of date
+	uint32_t highest = NoParent;
+	for (uint32_t i = index; i != NoParent; i = hierarchy[i].parent)
+	{
+		if (IsDirty(hierarchy[i].slot))
+			highest = i;
+	}
+	if (highest == NoParent)
+		return;
+
+	std::vector<uint32_t> path;
+	for (uint32_t i = index; ; i = hierarchy[i].parent)
+	{
+		path.push_back(i);
+		if (i == highest)
+			break;
+	}
+
+	//dirty bits stay set, Update() still has to pass the change on to the rest of the subtree
+	for (size_t i = path.size(); i-- > 0;)
+	{
+		const HierarchyNode& node = hierarchy[path[i]];
+		if (IsDirty(node.slot))
+			RebuildGroup(node.slot & ~3u, 1u << (node.slot & 3));
+		if (node.parent != NoParent)
+			ComposeWorld(path[i]);
+	}
+}
+
+
+// --------------------------------------------------------
+// Roots (slots without a parent but with children) first,
+// then their children and so on, children in slot order
+// - Matrices don't move over to the new order, everything in
+//   the old or new hierarchy is just rebuilt instead
+// --------------------------------------------------------
+void TransformPool::RebuildHierarchy()
+{
+	for (uint32_t i = 0; i < hierarchy.size(); i++)
+	{
+		if (hierarchyIndices[hierarchy[i].slot] == i)
+			MarkDirty(hierarchy[i].slot);
+	}
+
+	//children of each slot, by counting sort on the parent
+	std::vector<uint32_t> childStarts(slotCount + 1, 0);
+	for (uint32_t slot = 0; slot < slotCount; slot++)
+		childStarts[slot + 1] = childStarts[slot] + childCounts[slot];
+	std::vector<uint32_t> children(childStarts[slotCount]);
+	std::vector<uint32_t> cursors(childStarts.begin(), childStarts.end() - 1);
+	for (uint32_t slot = 0; slot < slotCount; slot++)
+	{
+		if (parents[slot] != NoParent)
+			children[cursors[parents[slot]]++] = slot;
+	}
+
+	hierarchy.clear();
+	for (uint32_t slot = 0; slot < slotCount; slot++)
+	{
+		if (parents[slot] == NoParent && childCounts[slot] > 0)
+			hierarchy.push_back({ slot, NoParent, 0, 0 });
+	}
+
+	levelStarts.assign(1, 0);
+	while (levelStarts.back() < hierarchy.size())
+	{
+		uint32_t begin = levelStarts.back();
+		uint32_t end = (uint32_t)hierarchy.size();
+		for (uint32_t i = begin; i < end; i++)
+		{
+			uint32_t slot = hierarchy[i].slot;
+			hierarchy[i].firstChild = (uint32_t)hierarchy.size();
+			hierarchy[i].childCount = childCounts[slot];
+			for (uint32_t c = childStarts[slot]; c < childStarts[slot + 1]; c++)
+				hierarchy.push_back({ children[c], i, 0, 0 });
+		}
+		levelStarts.push_back(end);
+	}
+
+	hierarchyIndices.assign(slotCount, NoParent);
+	for (uint32_t i = 0; i < hierarchy.size(); i++)
+	{
+		hierarchyIndices[hierarchy[i].slot] = i;
+		MarkDirty(hierarchy[i].slot);
+	}
+	hierarchyLocalMatrices.resize(hierarchy.size());
+	hierarchyLocalInverseTransposeMatrices.resize(hierarchy.size());
+	hierarchyWorldMatrices.resize(hierarchy.size());
+	hierarchyWorldInverseTransposeMatrices.resize(hierarchy.size());
+	changed.assign((hierarchy.size() + 63) / 64, 0);
+	hierarchyChanged = false;
+}
+
+void TransformPool::ComposeWorld(uint32_t index)
+{
+	uint32_t parent = hierarchy[index].parent;
+	Multiply(hierarchyLocalMatrices[index], hierarchyWorldMatrices[parent], hierarchyWorldMatrices[index]);
+	Multiply(hierarchyLocalInverseTransposeMatrices[index], hierarchyWorldInverseTransposeMatrices[parent], hierarchyWorldInverseTransposeMatrices[index]);
+	versions[hierarchy[index].slot]++;
+}
+
+
+// --------------------------------------------------------
+// One level at a time, each only depends on the one above
+// - Changed nodes of a level get composed (roots are already
+//   done, their world matrices are their own), then mark their
+//   children, which sit next to each other in the level below
+// - Inverse transposes compose the same way as the matrices,
+//   (AB)^-T = A^-T B^-T
+// - Returns how many nodes changed only because of a parent
+// --------------------------------------------------------
+size_t TransformPool::UpdateHierarchy(unsigned int threadCount)
+{
+	size_t propagated = 0;
+	for (size_t level = 0; level + 1 < levelStarts.size(); level++)
+	{
+		size_t begin = levelStarts[level];
+		size_t end = levelStarts[level + 1];
+		if (level > 0)
+		{
+			//threads split the level on whole words, only reading the bits
+			size_t firstWord = begin / 64;
+			size_t endWord = (end + 63) / 64;
+			RunOnThreads(ThreadsFor(threadCount, endWord - firstWord), firstWord, endWord, [&](unsigned int, size_t wordBegin, size_t wordEnd)
+			{
+				ForEachBit(changed, std::max(begin, wordBegin * 64), std::min(end, wordEnd * 64), [&](uint32_t i) { ComposeWorld(i); });
+			});
+		}
+
+		ForEachBit(changed, begin, end, [&](uint32_t i)
+		{
+			const HierarchyNode& node = hierarchy[i];
+			if (node.childCount > 0)
+				propagated += SetBits(changed, node.firstChild, node.firstChild + node.childCount);
+		});
+		ClearBits(changed, begin, end);
+	}
+	return propagated;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// Positions, rotations and scales of many transforms, each
+// component in its own array so matrices can be rebuilt in
+// bulk rather than one object at a time
+//
+// - Slots are handed out by Add() and reused after Remove()
+// - Setting anything marks the slot in a dirty bitset, and
+//   Update() rebuilds the world and inverse transpose
+//   matrices of every dirty slot in one pass: four slots at
+//   a time with SSE, spread over threads when there are
+//   enough of them to be worth it
+// - Inverse transposes come straight from the rotation and
+//   scale (rows of the rotation over the scale), there's no
+//   general 4x4 inverse; zero scales give infinities
+// - Slots can have a parent slot, whose world matrix is applied
+//   after their own (so position, rotation and scale are relative
+//   to it). Slots with a parent or children are also kept in
+//   breadth first order, children of a node next to each other,
+//   and Update() composes their world matrices level by level;
+//   only descendants of something that changed are visited, and
+//   wide levels are spread over threads
+// - A slot that's still dirty (or has a dirty ancestor) has out
+//   of date matrices, UpdateSlot() brings just that one up to
+//   date (Transform does this when asked for a matrix between
+//   Update() calls)
+// --------------------------------------------------------
+class TransformPool
+{
+public:
+	static constexpr uint32_t NoParent = ~0u;
+
+	TransformPool(unsigned int capacity = 0);
+
+	uint32_t Add();	// At the origin, unrotated and unscaled
+	void Remove(uint32_t slot);	// Its children lose their parent
+
+	// NoParent detaches; throws std::invalid_argument if the slot
+	// would end up its own ancestor
+	void SetParent(uint32_t slot, uint32_t parent);
+	uint32_t GetParent(uint32_t slot) const { return parents[slot]; }
+
+	void SetPosition(uint32_t slot, const DirectX::XMFLOAT3& position);
+	void SetRotation(uint32_t slot, const DirectX::XMFLOAT3& pitchYawRoll);
+	void SetScale(uint32_t slot, const DirectX::XMFLOAT3& scale);
+
+	DirectX::XMFLOAT3 GetPosition(uint32_t slot) const { return DirectX::XMFLOAT3(positionX[slot], positionY[slot], positionZ[slot]); }
+	DirectX::XMFLOAT3 GetRotation(uint32_t slot) const { return DirectX::XMFLOAT3(pitch[slot], yaw[slot], roll[slot]); }
+	DirectX::XMFLOAT3 GetScale(uint32_t slot) const { return DirectX::XMFLOAT3(scaleX[slot], scaleY[slot], scaleZ[slot]); }
+	const DirectX::XMFLOAT4X4& GetWorldMatrix(uint32_t slot) const	// Parents included
+	{
+		uint32_t index = GetHierarchyIndex(slot);
+		return index == NoParent ? worldMatrices[slot] : hierarchyWorldMatrices[index];
+	}
+	const DirectX::XMFLOAT4X4& GetWorldInverseTransposeMatrix(uint32_t slot) const
+	{
+		uint32_t index = GetHierarchyIndex(slot);
+		return index == NoParent ? worldInverseTransposeMatrices[slot] : hierarchyWorldInverseTransposeMatrices[index];
+	}
+	unsigned int GetVersion(uint32_t slot) const { return versions[slot]; } //changes whenever the slot's matrices do
+	bool IsDirty(uint32_t slot) const { return (dirty[slot / 64] >> (slot % 64)) & 1; } //its own values changed, not counting parents
+
+	// Rebuilds every dirty slot and its descendants, returns how many there were
+	// - threadCount 0 picks one per hardware core, fewer are used
+	//   when there isn't enough to go around
+	size_t Update(unsigned int threadCount = 0);
+	void UpdateSlot(uint32_t slot);
+
+	size_t GetCount() const { return slotCount - freeSlots.size(); }
+
+private:
+	// A slot with a parent or children, in breadth first order
+	struct HierarchyNode
+	{
+		uint32_t slot;
+		uint32_t parent;		// Index in hierarchy, NoParent for roots
+		uint32_t firstChild;	// Index in hierarchy
+		uint32_t childCount;
+	};
+
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> pitch, yaw, roll;
+	std::vector<float> scaleX, scaleY, scaleZ;
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+	std::vector<DirectX::XMFLOAT4X4> worldInverseTransposeMatrices;
+	std::vector<unsigned int> versions;
+	std::vector<uint64_t> dirty;	// One bit per slot
+	std::vector<uint32_t> freeSlots;
+	uint32_t slotCount;				// Slots ever handed out, including freed ones
+
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> childCounts;
+
+	// Rebuilt whenever a parent changes; each level of the tree is
+	// the range levelStarts[i] to levelStarts[i + 1]
+	// - Matrices of slots in the hierarchy live in its order rather
+	//   than in the slot arrays, so composing them walks each level
+	//   front to back; local ones are only used below the roots
+	std::vector<HierarchyNode> hierarchy;
+	std::vector<uint32_t> levelStarts;
+	std::vector<uint32_t> hierarchyIndices;	// Per slot, NoParent for slots not in it
+	std::vector<DirectX::XMFLOAT4X4> hierarchyLocalMatrices;
+	std::vector<DirectX::XMFLOAT4X4> hierarchyLocalInverseTransposeMatrices;
+	std::vector<DirectX::XMFLOAT4X4> hierarchyWorldMatrices;
+	std::vector<DirectX::XMFLOAT4X4> hierarchyWorldInverseTransposeMatrices;
+	std::vector<uint64_t> changed;			// One bit per hierarchy node, during Update()
+	bool hierarchyChanged;
+
+	void Reserve(uint32_t capacity);
+	void MarkDirty(uint32_t slot) { dirty[slot / 64] |= 1ull << (slot % 64); }
+	uint32_t GetHierarchyIndex(uint32_t slot) const { return slot < hierarchyIndices.size() ? hierarchyIndices[slot] : NoParent; }
+
+	// Rebuilds the slots of one group of four (first is a multiple
+	// of four) whose bits are set in mask
+	void RebuildGroup(uint32_t first, unsigned int mask);
+	size_t UpdateWords(size_t firstWord, size_t endWord);
+
+	void RebuildHierarchy();
+	size_t UpdateHierarchy(unsigned int threadCount);
+	void ComposeWorld(uint32_t index);
+};
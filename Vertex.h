@@ -1,11 +1,14 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <cstdint>
 
 // --------------------------------------------------------
 // A custom vertex definition
 //
 // You will eventually ADD TO this, and/or make more of these!
+// (and describe them in VertexFormat.h, which input layouts
+// and conversions are generated from)
 // --------------------------------------------------------
 struct Vertex
 {
@@ -13,4 +16,26 @@ struct Vertex
 	DirectX::XMFLOAT2 uv;
 	DirectX::XMFLOAT3 normal;
 	DirectX::XMFLOAT3 tangent;
-};
\ No newline at end of file
+};
+
+// --------------------------------------------------------
+// A quantized version of Vertex (20 bytes instead of 44)
+//
+// - Position: half floats, or 16-bit unorms relative to the
+//   mesh bounds (see CompactPositionFormat)
+// - Position.w: tangent handedness, >= 0.5 means +1
+// - UV: half floats
+// - Normal and tangent: octahedral encoded, 16-bit snorms
+//
+// See VertexQuantize for encoding/decoding and
+// CompactVertexShaderInput in ShaderStructs.hlsli for the
+// shader side
+// --------------------------------------------------------
+struct CompactVertex
+{
+	uint16_t Position[4];
+	uint16_t uv[2];
+	int16_t normal[2];
+	int16_t tangent[2];
+};
+static_assert(sizeof(CompactVertex) == 20, "CompactVertex should be tightly packed");
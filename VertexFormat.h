@@ -0,0 +1,378 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include "Vertex.h"
+#include "VertexQuantize.h"
+
+// How one attribute is stored in a vertex buffer
+enum VertexElementFormat
+{
+	VERTEX_ELEMENT_FLOAT2,
+	VERTEX_ELEMENT_FLOAT3,
+	VERTEX_ELEMENT_FLOAT4,
+	VERTEX_ELEMENT_HALF2,
+	VERTEX_ELEMENT_HALF4,
+	VERTEX_ELEMENT_UNORM16X4,	// Positions are relative to a VertexPositionRange
+	VERTEX_ELEMENT_OCT16		// Octahedral encoded unit vector, two 16-bit snorms
+};
+
+// One attribute of a vertex format
+// - semantic matches the HLSL semantic of the shader input
+struct VertexElement
+{
+	const char* semantic;
+	VertexElementFormat format;
+	uint32_t offset;
+};
+
+// Maps UNORM16X4 positions onto mesh space
+// - position = offset + decoded * scale (see VertexQuantize::MakeParams)
+struct VertexPositionRange
+{
+	DirectX::XMFLOAT3 offset = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	DirectX::XMFLOAT3 scale = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
+};
+
+constexpr uint32_t VertexElementSize(VertexElementFormat format)
+{
+	switch (format)
+	{
+	case VERTEX_ELEMENT_FLOAT2: return 8;
+	case VERTEX_ELEMENT_FLOAT3: return 12;
+	case VERTEX_ELEMENT_FLOAT4: return 16;
+	case VERTEX_ELEMENT_HALF2: return 4;
+	case VERTEX_ELEMENT_HALF4: return 8;
+	case VERTEX_ELEMENT_UNORM16X4: return 8;
+	case VERTEX_ELEMENT_OCT16: return 4;
+	}
+	return 0;
+}
+
+
+// --------------------------------------------------------
+// Vertex format descriptors
+//
+// - Each one names the C++ vertex struct and lists its
+//   attributes in order, with the offsets taken from the
+//   struct itself
+// - The attribute list is the single description of a layout:
+//   input layouts (see VertexInputLayout.h) and conversions
+//   between layouts (VertexFormats::Convert) are generated
+//   from it at compile time
+// - Keep semantics and order in sync with the matching struct
+//   in ShaderStructs.hlsli, CreateInputLayout() fails if they
+//   don't match the shader
+// --------------------------------------------------------
+
+// Vertex, matches VertexShaderInput
+struct StandardVertexFormat
+{
+	typedef Vertex VertexType;
+	static constexpr VertexElement elements[] =
+	{
+		{ "POSITION", VERTEX_ELEMENT_FLOAT3, offsetof(Vertex, Position) },
+		{ "TEXCOORD", VERTEX_ELEMENT_FLOAT2, offsetof(Vertex, uv) },
+		{ "NORMAL", VERTEX_ELEMENT_FLOAT3, offsetof(Vertex, normal) },
+		{ "TANGENT", VERTEX_ELEMENT_FLOAT3, offsetof(Vertex, tangent) },
+	};
+};
+
+// CompactVertex, matches CompactVertexShaderInput
+// - Position.w is left for the tangent handedness, converting
+//   from a format without it fills in 1 (right handed)
+template<CompactPositionFormat PositionFormat>
+struct CompactVertexFormat
+{
+	typedef CompactVertex VertexType;
+	static constexpr CompactPositionFormat positionFormat = PositionFormat;
+	static constexpr VertexElement elements[] =
+	{
+		{ "POSITION", PositionFormat == COMPACT_POSITION_HALF ? VERTEX_ELEMENT_HALF4 : VERTEX_ELEMENT_UNORM16X4, offsetof(CompactVertex, Position) },
+		{ "TEXCOORD", VERTEX_ELEMENT_HALF2, offsetof(CompactVertex, uv) },
+		{ "NORMAL", VERTEX_ELEMENT_OCT16, offsetof(CompactVertex, normal) },
+		{ "TANGENT", VERTEX_ELEMENT_OCT16, offsetof(CompactVertex, tangent) },
+	};
+};
+
+// Position only stream for depth passes, matches DepthVertexShaderInput
+// - Also fits the start of a Vertex, so the same layout works
+//   on full vertex buffers with a stride of sizeof(Vertex)
+struct DepthVertexFormat
+{
+	typedef DirectX::XMFLOAT3 VertexType;
+	static constexpr VertexElement elements[] =
+	{
+		{ "POSITION", VERTEX_ELEMENT_FLOAT3, 0 },
+	};
+};
+
+
+namespace VertexFormats
+{
+	constexpr bool SameSemantic(const char* a, const char* b)
+	{
+		while (*a != '\0' && *a == *b)
+		{
+			a++;
+			b++;
+		}
+		return *a == *b;
+	}
+
+	template<typename Format>
+	constexpr size_t ElementCount() { return sizeof(Format::elements) / sizeof(VertexElement); }
+
+	// Index of the element with the given semantic, -1 if there isn't one
+	template<typename Format>
+	constexpr int FindElement(const char* semantic)
+	{
+		for (size_t i = 0; i < ElementCount<Format>(); i++)
+		{
+			if (SameSemantic(Format::elements[i].semantic, semantic))
+				return (int)i;
+		}
+		return -1;
+	}
+
+	// Elements in order, 4-byte aligned (as D3D11 requires), not
+	// overlapping and adding up to exactly the size of the struct
+	template<typename Format>
+	constexpr bool IsTightlyPacked()
+	{
+		uint32_t end = 0;
+		for (const VertexElement& element : Format::elements)
+		{
+			if (element.offset != end || element.offset % 4 != 0)
+				return false;
+			end = element.offset + VertexElementSize(element.format);
+		}
+		return end == sizeof(typename Format::VertexType);
+	}
+
+	// Bytes per vertex the elements add up to, the buffer stride
+	template<typename Format>
+	constexpr uint32_t Stride()
+	{
+		uint32_t end = 0;
+		for (const VertexElement& element : Format::elements)
+			end = element.offset + VertexElementSize(element.format) > end ? element.offset + VertexElementSize(element.format) : end;
+		return end;
+	}
+
+	// Offset of the element with the given semantic, ~0 if there isn't one
+	template<typename Format>
+	constexpr uint32_t ElementOffset(const char* semantic)
+	{
+		int element = FindElement<Format>(semantic);
+		return element >= 0 ? Format::elements[element].offset : ~0u;
+	}
+
+	template<typename Format>
+	constexpr bool HasUniqueSemantics()
+	{
+		for (size_t i = 0; i < ElementCount<Format>(); i++)
+		{
+			if (FindElement<Format>(Format::elements[i].semantic) != (int)i)
+				return false;
+		}
+		return true;
+	}
+
+	template<typename Format>
+	constexpr bool IsValid() { return IsTightlyPacked<Format>() && HasUniqueSemantics<Format>(); }
+
+	// Reads one element into four floats, components the format
+	// doesn't have keep their (0, 0, 0, 1) defaults
+	template<VertexElementFormat Format>
+	inline void LoadElement(const unsigned char* in, float out[4])
+	{
+		if constexpr (Format == VERTEX_ELEMENT_FLOAT2 || Format == VERTEX_ELEMENT_FLOAT3 || Format == VERTEX_ELEMENT_FLOAT4)
+			memcpy(out, in, VertexElementSize(Format));
+		else if constexpr (Format == VERTEX_ELEMENT_HALF2 || Format == VERTEX_ELEMENT_HALF4)
+		{
+			uint16_t halves[4];
+			memcpy(halves, in, VertexElementSize(Format));
+			for (uint32_t k = 0; k < VertexElementSize(Format) / 2; k++)
+				out[k] = VertexQuantize::HalfToFloat(halves[k]);
+		}
+		else if constexpr (Format == VERTEX_ELEMENT_UNORM16X4)
+		{
+			//a multiply like VertexQuantize's, so both decode to the same bits
+			uint16_t values[4];
+			memcpy(values, in, sizeof(values));
+			for (int k = 0; k < 4; k++)
+				out[k] = values[k] * (1.0f / 65535.0f);
+		}
+		else if constexpr (Format == VERTEX_ELEMENT_OCT16)
+		{
+			int16_t values[2];
+			memcpy(values, in, sizeof(values));
+			DirectX::XMFLOAT3 v = VertexQuantize::DecodeOctahedral(values);
+			memcpy(out, &v, sizeof(v));
+		}
+	}
+
+	template<VertexElementFormat Format>
+	inline void StoreElement(const float in[4], unsigned char* out)
+	{
+		if constexpr (Format == VERTEX_ELEMENT_FLOAT2 || Format == VERTEX_ELEMENT_FLOAT3 || Format == VERTEX_ELEMENT_FLOAT4)
+			memcpy(out, in, VertexElementSize(Format));
+		else if constexpr (Format == VERTEX_ELEMENT_HALF2 || Format == VERTEX_ELEMENT_HALF4)
+		{
+			uint16_t halves[4];
+			for (uint32_t k = 0; k < VertexElementSize(Format) / 2; k++)
+				halves[k] = VertexQuantize::FloatToHalf(in[k]);
+			memcpy(out, halves, VertexElementSize(Format));
+		}
+		else if constexpr (Format == VERTEX_ELEMENT_UNORM16X4)
+		{
+			uint16_t values[4];
+			for (int k = 0; k < 4; k++)
+				values[k] = (uint16_t)lrintf((in[k] < 0.0f ? 0.0f : in[k] > 1.0f ? 1.0f : in[k]) * 65535.0f);
+			memcpy(out, values, sizeof(values));
+		}
+		else if constexpr (Format == VERTEX_ELEMENT_OCT16)
+		{
+			int16_t values[2];
+			VertexQuantize::EncodeOctahedral(DirectX::XMFLOAT3(in[0], in[1], in[2]), values);
+			memcpy(out, values, sizeof(values));
+		}
+	}
+
+	// Converts element Target of To from whatever From has with the same semantic
+	// - Everything is resolved at compile time, what's left is the
+	//   load/store pair (or a plain copy when the formats match)
+	template<typename From, typename To, size_t Target>
+	inline void ConvertElement(const unsigned char* in, unsigned char* out,
+		const VertexPositionRange& range, const DirectX::XMFLOAT3& invScale)
+	{
+		constexpr VertexElement target = To::elements[Target];
+		constexpr int source = FindElement<From>(target.semantic);
+		constexpr bool isPosition = SameSemantic(target.semantic, "POSITION");
+
+		if constexpr (source >= 0 && From::elements[source].format == target.format)
+		{
+			memcpy(out + target.offset, in + From::elements[source].offset, VertexElementSize(target.format));
+		}
+		else
+		{
+			//attributes the source doesn't have get the same defaults the input assembler uses
+			float value[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			if constexpr (source >= 0)
+			{
+				constexpr VertexElementFormat sourceFormat = From::elements[source].format;
+				LoadElement<sourceFormat>(in + From::elements[source].offset, value);
+				if constexpr (isPosition && sourceFormat == VERTEX_ELEMENT_UNORM16X4)
+				{
+					value[0] = range.offset.x + value[0] * range.scale.x;
+					value[1] = range.offset.y + value[1] * range.scale.y;
+					value[2] = range.offset.z + value[2] * range.scale.z;
+				}
+			}
+			if constexpr (isPosition && target.format == VERTEX_ELEMENT_UNORM16X4)
+			{
+				value[0] = (value[0] - range.offset.x) * invScale.x;
+				value[1] = (value[1] - range.offset.y) * invScale.y;
+				value[2] = (value[2] - range.offset.z) * invScale.z;
+			}
+			StoreElement<target.format>(value, out + target.offset);
+		}
+	}
+
+	template<typename From, typename To, size_t... Targets>
+	inline void ConvertVertex(const unsigned char* in, unsigned char* out,
+		const VertexPositionRange& range, const DirectX::XMFLOAT3& invScale, std::index_sequence<Targets...>)
+	{
+		(ConvertElement<From, To, Targets>(in, out, range, invScale), ...);
+	}
+
+	// Convert one attribute at a time, whatever the formats
+	// (MeshConverter --quantize checks this against VertexQuantize)
+	template<typename From, typename To>
+	void ConvertPerElement(const typename From::VertexType* in, size_t count, typename To::VertexType* out,
+		const VertexPositionRange& range = VertexPositionRange())
+	{
+		static_assert(IsValid<From>() && IsValid<To>(), "Vertex formats must be tightly packed with unique semantics");
+		DirectX::XMFLOAT3 invScale(
+			range.scale.x != 0.0f ? 1.0f / range.scale.x : 0.0f,
+			range.scale.y != 0.0f ? 1.0f / range.scale.y : 0.0f,
+			range.scale.z != 0.0f ? 1.0f / range.scale.z : 0.0f);
+
+		const unsigned char* source = (const unsigned char*)in;
+		unsigned char* target = (unsigned char*)out;
+		for (size_t i = 0; i < count; i++)
+		{
+			ConvertVertex<From, To>(
+				source + i * sizeof(typename From::VertexType),
+				target + i * sizeof(typename To::VertexType),
+				range, invScale, std::make_index_sequence<ElementCount<To>()>());
+		}
+	}
+
+	// Converts vertices between any two formats, matching attributes by semantic
+	// - Attributes To doesn't have are dropped, the ones From doesn't
+	//   have come out as (0, 0, 0, 1)
+	// - range is only used for UNORM16X4 positions
+	// - Vertex <-> CompactVertex goes through VertexQuantize's SIMD
+	//   paths instead, which give the same bytes about 3x faster
+	template<typename From, typename To>
+	void Convert(const typename From::VertexType* in, size_t count, typename To::VertexType* out,
+		const VertexPositionRange& range = VertexPositionRange())
+	{
+		static_assert(IsValid<From>() && IsValid<To>(), "Vertex formats must be tightly packed with unique semantics");
+		if constexpr (std::is_same_v<From, To>)
+		{
+			memcpy(out, in, sizeof(typename From::VertexType) * count);
+		}
+		else if constexpr (std::is_same_v<From, StandardVertexFormat> && requires { To::positionFormat; })
+		{
+			CompactVertexParams params = { To::positionFormat, range.offset, range.scale };
+			VertexQuantize::Encode(in, count, params, out);
+		}
+		else if constexpr (requires { From::positionFormat; } && std::is_same_v<To, StandardVertexFormat>)
+		{
+			CompactVertexParams params = { From::positionFormat, range.offset, range.scale };
+			VertexQuantize::Decode(in, count, params, out);
+		}
+		else
+		{
+			ConvertPerElement<From, To>(in, count, out, range);
+		}
+	}
+}
+
+static_assert(VertexFormats::IsValid<StandardVertexFormat>(), "Vertex and StandardVertexFormat are out of sync");
+static_assert(VertexFormats::IsValid<CompactVertexFormat<COMPACT_POSITION_HALF>>(), "CompactVertex and CompactVertexFormat are out of sync");
+static_assert(VertexFormats::IsValid<CompactVertexFormat<COMPACT_POSITION_UNORM16>>(), "CompactVertex and CompactVertexFormat are out of sync");
+static_assert(VertexFormats::IsValid<DepthVertexFormat>(), "DepthVertexFormat should be a tightly packed position");
+
+//spelled out against the structs, so moving or resizing a member breaks the build here
+static_assert(VertexFormats::Stride<StandardVertexFormat>() == sizeof(Vertex) &&
+	VertexFormats::ElementOffset<StandardVertexFormat>("POSITION") == offsetof(Vertex, Position) &&
+	VertexFormats::ElementOffset<StandardVertexFormat>("TEXCOORD") == offsetof(Vertex, uv) &&
+	VertexFormats::ElementOffset<StandardVertexFormat>("NORMAL") == offsetof(Vertex, normal) &&
+	VertexFormats::ElementOffset<StandardVertexFormat>("TANGENT") == offsetof(Vertex, tangent),
+	"StandardVertexFormat doesn't match Vertex's offsets and size");
+namespace VertexFormats
+{
+	template<CompactPositionFormat PositionFormat>
+	constexpr bool MatchesCompactVertex()
+	{
+		typedef CompactVertexFormat<PositionFormat> Format;
+		return Stride<Format>() == sizeof(CompactVertex) &&
+			ElementOffset<Format>("POSITION") == offsetof(CompactVertex, Position) &&
+			ElementOffset<Format>("TEXCOORD") == offsetof(CompactVertex, uv) &&
+			ElementOffset<Format>("NORMAL") == offsetof(CompactVertex, normal) &&
+			ElementOffset<Format>("TANGENT") == offsetof(CompactVertex, tangent);
+	}
+}
+static_assert(VertexFormats::MatchesCompactVertex<COMPACT_POSITION_HALF>() && VertexFormats::MatchesCompactVertex<COMPACT_POSITION_UNORM16>(),
+	"CompactVertexFormat doesn't match CompactVertex's offsets and size");
+static_assert(VertexFormats::Stride<DepthVertexFormat>() == sizeof(DirectX::XMFLOAT3) &&
+	VertexFormats::ElementOffset<DepthVertexFormat>("POSITION") == offsetof(Vertex, Position),
+	"DepthVertexFormat should be a float3 that also lines up with Vertex::Position");
@@ -0,0 +1,88 @@
+#pragma once
+#include <array>
+#include <d3d11.h>
+#include <d3dcompiler.h>
+#include <stdexcept>
+#include <string>
+#include <wrl/client.h>
+#include "VertexFormat.h"
+
+constexpr DXGI_FORMAT VertexElementDxgiFormat(VertexElementFormat format)
+{
+	switch (format)
+	{
+	case VERTEX_ELEMENT_FLOAT2: return DXGI_FORMAT_R32G32_FLOAT;
+	case VERTEX_ELEMENT_FLOAT3: return DXGI_FORMAT_R32G32B32_FLOAT;
+	case VERTEX_ELEMENT_FLOAT4: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+	case VERTEX_ELEMENT_HALF2: return DXGI_FORMAT_R16G16_FLOAT;
+	case VERTEX_ELEMENT_HALF4: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+	case VERTEX_ELEMENT_UNORM16X4: return DXGI_FORMAT_R16G16B16A16_UNORM;
+	case VERTEX_ELEMENT_OCT16: return DXGI_FORMAT_R16G16_SNORM;
+	}
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+// --------------------------------------------------------
+// D3D11 input layouts built from the vertex format
+// descriptors in VertexFormat.h
+//
+// - The element descriptions are generated at compile time,
+//   with explicit offsets instead of guessing formats from
+//   shader reflection (which can't tell a float4 from a
+//   packed R16G16B16A16)
+// - Everything is in slot 0, per vertex
+// --------------------------------------------------------
+namespace VertexFormats
+{
+	template<typename Format>
+	constexpr std::array<D3D11_INPUT_ELEMENT_DESC, ElementCount<Format>()> InputElements()
+	{
+		static_assert(IsValid<Format>(), "Vertex formats must be tightly packed with unique semantics");
+		std::array<D3D11_INPUT_ELEMENT_DESC, ElementCount<Format>()> descs = {};
+		for (size_t i = 0; i < descs.size(); i++)
+		{
+			const VertexElement& element = Format::elements[i];
+			descs[i] = { element.semantic, 0, VertexElementDxgiFormat(element.format), 0, element.offset, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+		}
+		return descs;
+	}
+
+	// Creates the input layout for a compiled vertex shader (.cso)
+	// - Returns null if the file can't be read, so SimpleVertexShader
+	//   falls back to reflection and reports the missing file itself
+	// - Throws if the format doesn't match the shader's input
+	//   signature, which means the C++ and HLSL structs drifted apart
+	template<typename Format>
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> CreateInputLayout(ID3D11Device* device, const std::wstring& shaderFile)
+	{
+		static constexpr std::array<D3D11_INPUT_ELEMENT_DESC, ElementCount<Format>()> elements = InputElements<Format>();
+
+		Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
+		if (FAILED(D3DReadFileToBlob(shaderFile.c_str(), shaderBlob.GetAddressOf())))
+			return nullptr;
+
+		Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+		HRESULT hr = device->CreateInputLayout(
+			elements.data(),
+			(UINT)elements.size(),
+			shaderBlob->GetBufferPointer(),
+			shaderBlob->GetBufferSize(),
+			inputLayout.GetAddressOf());
+		if (FAILED(hr))
+			throw std::runtime_error("Vertex format doesn't match the vertex shader's input signature");
+		return inputLayout;
+	}
+}
+
+//the descriptions D3D gets have to carry the struct offsets through unchanged
+//(CompactVertex offsets are the same for either position format)
+static_assert(VertexFormats::InputElements<StandardVertexFormat>()[0].AlignedByteOffset == offsetof(Vertex, Position) &&
+	VertexFormats::InputElements<StandardVertexFormat>()[1].AlignedByteOffset == offsetof(Vertex, uv) &&
+	VertexFormats::InputElements<StandardVertexFormat>()[2].AlignedByteOffset == offsetof(Vertex, normal) &&
+	VertexFormats::InputElements<StandardVertexFormat>()[3].AlignedByteOffset == offsetof(Vertex, tangent),
+	"Vertex input layout doesn't match Vertex");
+static_assert(VertexFormats::InputElements<CompactVertexFormat<COMPACT_POSITION_UNORM16>>()[0].AlignedByteOffset == offsetof(CompactVertex, Position) &&
+	VertexFormats::InputElements<CompactVertexFormat<COMPACT_POSITION_UNORM16>>()[1].AlignedByteOffset == offsetof(CompactVertex, uv) &&
+	VertexFormats::InputElements<CompactVertexFormat<COMPACT_POSITION_UNORM16>>()[2].AlignedByteOffset == offsetof(CompactVertex, normal) &&
+	VertexFormats::InputElements<CompactVertexFormat<COMPACT_POSITION_UNORM16>>()[3].AlignedByteOffset == offsetof(CompactVertex, tangent),
+	"CompactVertex input layout doesn't match CompactVertex");
@@ -0,0 +1,410 @@
+#include "VertexQuantize.h"
+#include "MeshTools.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define VERTEX_QUANTIZE_SSE2 1
+#endif
+
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#include <immintrin.h>
+#define VERTEX_QUANTIZE_F16C 1
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	inline uint32_t FloatBits(float f) { uint32_t u; memcpy(&u, &f, 4); return u; }
+	inline float BitsFloat(uint32_t u) { float f; memcpy(&f, &u, 4); return f; }
+
+	inline float Clamp(float v, float lo, float hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+	//tangent handedness lives in position.w, our tangents are always right handed for now
+	inline uint16_t HandednessValue(CompactPositionFormat format)
+	{
+		return format == COMPACT_POSITION_HALF ? VertexQuantize::FloatToHalf(1.0f) : (uint16_t)0xFFFF;
+	}
+
+	void EncodeScalar(const Vertex& v, const CompactVertexParams& params, const XMFLOAT3& invScale, CompactVertex& out)
+	{
+		const float* p = &v.Position.x;
+		const float* offset = &params.positionOffset.x;
+		const float* inv = &invScale.x;
+		for (int k = 0; k < 3; k++)
+		{
+			if (params.positionFormat == COMPACT_POSITION_HALF)
+				out.Position[k] = VertexQuantize::FloatToHalf(p[k]);
+			else
+				out.Position[k] = (uint16_t)lrintf(Clamp((p[k] - offset[k]) * inv[k], 0.0f, 1.0f) * 65535.0f);
+		}
+		out.Position[3] = HandednessValue(params.positionFormat);
+		out.uv[0] = VertexQuantize::FloatToHalf(v.uv.x);
+		out.uv[1] = VertexQuantize::FloatToHalf(v.uv.y);
+		VertexQuantize::EncodeOctahedral(v.normal, out.normal);
+		VertexQuantize::EncodeOctahedral(v.tangent, out.tangent);
+	}
+
+	//unorms are scaled by a multiply, like the SIMD path, so both give the same bits
+	void DecodeScalar(const CompactVertex& v, const CompactVertexParams& params, Vertex& out)
+	{
+		float* p = &out.Position.x;
+		const float* offset = &params.positionOffset.x;
+		const float* scale = &params.positionScale.x;
+		for (int k = 0; k < 3; k++)
+		{
+			if (params.positionFormat == COMPACT_POSITION_HALF)
+				p[k] = VertexQuantize::HalfToFloat(v.Position[k]);
+			else
+				p[k] = offset[k] + (v.Position[k] * (1.0f / 65535.0f)) * scale[k];
+		}
+		out.uv.x = VertexQuantize::HalfToFloat(v.uv[0]);
+		out.uv.y = VertexQuantize::HalfToFloat(v.uv[1]);
+		out.normal = VertexQuantize::DecodeOctahedral(v.normal);
+		out.tangent = VertexQuantize::DecodeOctahedral(v.tangent);
+	}
+
+#ifdef VERTEX_QUANTIZE_SSE2
+	inline __m128 Abs4(__m128 v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+
+	inline __m128 Select4(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+	// +1 or -1 with the sign of v (both zeros count as positive, same as the scalar path)
+	inline __m128 SignNotZero4(__m128 v) { return Select4(_mm_cmpge_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f), _mm_set1_ps(-1.0f)); }
+
+	// Octahedral encode of four vectors (SoA), results as snorm16 in x[0..3], y[0..3]
+	inline void EncodeOctahedral4(__m128 x, __m128 y, __m128 z, int16_t outX[4], int16_t outY[4])
+	{
+		__m128 l1 = _mm_add_ps(_mm_add_ps(Abs4(x), Abs4(y)), Abs4(z));
+		__m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(l1, _mm_set1_ps(1e-20f)));
+		__m128 ox = _mm_mul_ps(x, inv);
+		__m128 oy = _mm_mul_ps(y, inv);
+
+		//fold the lower hemisphere over the diagonals
+		__m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+		__m128 fx = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), Abs4(oy)), SignNotZero4(ox));
+		__m128 fy = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), Abs4(ox)), SignNotZero4(oy));
+		ox = Select4(lower, fx, ox);
+		oy = Select4(lower, fy, oy);
+
+		__m128 lo = _mm_set1_ps(-1.0f);
+		__m128 hi = _mm_set1_ps(1.0f);
+		__m128 scale = _mm_set1_ps(32767.0f);
+		__m128i qx = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(ox, lo), hi), scale));
+		__m128i qy = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(oy, lo), hi), scale));
+
+		alignas(16) int16_t packed[8];
+		_mm_store_si128((__m128i*)packed, _mm_packs_epi32(qx, qy));
+		memcpy(outX, packed, sizeof(int16_t) * 4);
+		memcpy(outY, packed + 4, sizeof(int16_t) * 4);
+	}
+
+	// Octahedral decode of four snorm16 pairs into SoA vectors (normalized)
+	inline void DecodeOctahedral4(__m128 qx, __m128 qy, __m128& x, __m128& y, __m128& z)
+	{
+		__m128 lo = _mm_set1_ps(-1.0f);
+		__m128 inv = _mm_set1_ps(1.0f / 32767.0f);
+		x = _mm_max_ps(_mm_mul_ps(qx, inv), lo);
+		y = _mm_max_ps(_mm_mul_ps(qy, inv), lo);
+		z = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), Abs4(x)), Abs4(y));
+
+		//unfold the lower hemisphere
+		__m128 t = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), z), _mm_setzero_ps());
+		x = _mm_sub_ps(x, _mm_mul_ps(t, SignNotZero4(x)));
+		y = _mm_sub_ps(y, _mm_mul_ps(t, SignNotZero4(y)));
+
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+		__m128 invLength = _mm_div_ps(_mm_set1_ps(1.0f), length);
+		x = _mm_mul_ps(x, invLength);
+		y = _mm_mul_ps(y, invLength);
+		z = _mm_mul_ps(z, invLength);
+	}
+
+	// Four floats to four unorm16s, without needing SSE4.1's unsigned pack
+	inline void QuantizeUnorm16x4(__m128 v, uint16_t out[4])
+	{
+		__m128 clamped = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		__m128i q = _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(65535.0f)));
+		q = _mm_sub_epi32(q, _mm_set1_epi32(32768));
+		__m128i packed = _mm_xor_si128(_mm_packs_epi32(q, q), _mm_set1_epi16((short)0x8000));
+
+		alignas(16) uint16_t lanes[8];
+		_mm_store_si128((__m128i*)lanes, packed);
+		memcpy(out, lanes, sizeof(uint16_t) * 4);
+	}
+
+	inline void FloatToHalf4(__m128 v, uint16_t out[4])
+	{
+#ifdef VERTEX_QUANTIZE_F16C
+		__m128i h = _mm_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT);
+		_mm_storel_epi64((__m128i*)out, h);
+#else
+		alignas(16) float lanes[4];
+		_mm_store_ps(lanes, v);
+		for (int k = 0; k < 4; k++)
+			out[k] = VertexQuantize::FloatToHalf(lanes[k]);
+#endif
+	}
+
+	inline __m128 HalfToFloat4(const uint16_t in[4])
+	{
+#ifdef VERTEX_QUANTIZE_F16C
+		return _mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)in));
+#else
+		return _mm_setr_ps(
+			VertexQuantize::HalfToFloat(in[0]), VertexQuantize::HalfToFloat(in[1]),
+			VertexQuantize::HalfToFloat(in[2]), VertexQuantize::HalfToFloat(in[3]));
+#endif
+	}
+#endif
+}
+
+
+// --------------------------------------------------------
+// Picks the offset/scale that maps the mesh bounds onto
+// the full 16-bit range
+// --------------------------------------------------------
+CompactVertexParams VertexQuantize::MakeParams(const Vertex* verts, size_t numVerts, CompactPositionFormat format)
+{
+	CompactVertexParams params = {};
+	params.positionFormat = format;
+	params.positionOffset = XMFLOAT3(0, 0, 0);
+	params.positionScale = XMFLOAT3(1, 1, 1);
+
+	if (format == COMPACT_POSITION_UNORM16)
+	{
+		XMFLOAT3 boundsMin, boundsMax;
+		MeshTools::CalculateBounds(verts, numVerts, boundsMin, boundsMax);
+		params.positionOffset = boundsMin;
+		params.positionScale = XMFLOAT3(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z);
+	}
+	return params;
+}
+
+
+void VertexQuantize::Encode(const Vertex* verts, size_t numVerts, const CompactVertexParams& params, CompactVertex* out)
+{
+	//flat axes (zero extent) just map everything to 0
+	XMFLOAT3 invScale(
+		params.positionScale.x != 0.0f ? 1.0f / params.positionScale.x : 0.0f,
+		params.positionScale.y != 0.0f ? 1.0f / params.positionScale.y : 0.0f,
+		params.positionScale.z != 0.0f ? 1.0f / params.positionScale.z : 0.0f);
+
+	size_t i = 0;
+#ifdef VERTEX_QUANTIZE_SSE2
+	const uint16_t handedness = HandednessValue(params.positionFormat);
+	for (; i + 4 <= numVerts; i += 4)
+	{
+		const Vertex* v = verts + i;
+		CompactVertex* o = out + i;
+
+		//gather four verts worth of each component (AoS -> SoA)
+		__m128 px = _mm_setr_ps(v[0].Position.x, v[1].Position.x, v[2].Position.x, v[3].Position.x);
+		__m128 py = _mm_setr_ps(v[0].Position.y, v[1].Position.y, v[2].Position.y, v[3].Position.y);
+		__m128 pz = _mm_setr_ps(v[0].Position.z, v[1].Position.z, v[2].Position.z, v[3].Position.z);
+		__m128 u = _mm_setr_ps(v[0].uv.x, v[1].uv.x, v[2].uv.x, v[3].uv.x);
+		__m128 w = _mm_setr_ps(v[0].uv.y, v[1].uv.y, v[2].uv.y, v[3].uv.y);
+		__m128 nx = _mm_setr_ps(v[0].normal.x, v[1].normal.x, v[2].normal.x, v[3].normal.x);
+		__m128 ny = _mm_setr_ps(v[0].normal.y, v[1].normal.y, v[2].normal.y, v[3].normal.y);
+		__m128 nz = _mm_setr_ps(v[0].normal.z, v[1].normal.z, v[2].normal.z, v[3].normal.z);
+		__m128 tx = _mm_setr_ps(v[0].tangent.x, v[1].tangent.x, v[2].tangent.x, v[3].tangent.x);
+		__m128 ty = _mm_setr_ps(v[0].tangent.y, v[1].tangent.y, v[2].tangent.y, v[3].tangent.y);
+		__m128 tz = _mm_setr_ps(v[0].tangent.z, v[1].tangent.z, v[2].tangent.z, v[3].tangent.z);
+
+		uint16_t qx[4], qy[4], qz[4], qu[4], qv[4];
+		int16_t nqx[4], nqy[4], tqx[4], tqy[4];
+		if (params.positionFormat == COMPACT_POSITION_HALF)
+		{
+			FloatToHalf4(px, qx);
+			FloatToHalf4(py, qy);
+			FloatToHalf4(pz, qz);
+		}
+		else
+		{
+			QuantizeUnorm16x4(_mm_mul_ps(_mm_sub_ps(px, _mm_set1_ps(params.positionOffset.x)), _mm_set1_ps(invScale.x)), qx);
+			QuantizeUnorm16x4(_mm_mul_ps(_mm_sub_ps(py, _mm_set1_ps(params.positionOffset.y)), _mm_set1_ps(invScale.y)), qy);
+			QuantizeUnorm16x4(_mm_mul_ps(_mm_sub_ps(pz, _mm_set1_ps(params.positionOffset.z)), _mm_set1_ps(invScale.z)), qz);
+		}
+		FloatToHalf4(u, qu);
+		FloatToHalf4(w, qv);
+		EncodeOctahedral4(nx, ny, nz, nqx, nqy);
+		EncodeOctahedral4(tx, ty, tz, tqx, tqy);
+
+		//scatter back out (SoA -> AoS)
+		for (int k = 0; k < 4; k++)
+		{
+			o[k].Position[0] = qx[k];
+			o[k].Position[1] = qy[k];
+			o[k].Position[2] = qz[k];
+			o[k].Position[3] = handedness;
+			o[k].uv[0] = qu[k];
+			o[k].uv[1] = qv[k];
+			o[k].normal[0] = nqx[k];
+			o[k].normal[1] = nqy[k];
+			o[k].tangent[0] = tqx[k];
+			o[k].tangent[1] = tqy[k];
+		}
+	}
+#endif
+
+	for (; i < numVerts; i++)
+		EncodeScalar(verts[i], params, invScale, out[i]);
+}
+
+
+void VertexQuantize::Decode(const CompactVertex* verts, size_t numVerts, const CompactVertexParams& params, Vertex* out)
+{
+	size_t i = 0;
+#ifdef VERTEX_QUANTIZE_SSE2
+	for (; i + 4 <= numVerts; i += 4)
+	{
+		const CompactVertex* v = verts + i;
+		Vertex* o = out + i;
+
+		uint16_t qx[4], qy[4], qz[4], qu[4], qv[4];
+		for (int k = 0; k < 4; k++)
+		{
+			qx[k] = v[k].Position[0];
+			qy[k] = v[k].Position[1];
+			qz[k] = v[k].Position[2];
+			qu[k] = v[k].uv[0];
+			qv[k] = v[k].uv[1];
+		}
+
+		__m128 px, py, pz;
+		if (params.positionFormat == COMPACT_POSITION_HALF)
+		{
+			px = HalfToFloat4(qx);
+			py = HalfToFloat4(qy);
+			pz = HalfToFloat4(qz);
+		}
+		else
+		{
+			__m128 inv = _mm_set1_ps(1.0f / 65535.0f);
+			px = _mm_add_ps(_mm_set1_ps(params.positionOffset.x), _mm_mul_ps(_mm_mul_ps(_mm_setr_ps(qx[0], qx[1], qx[2], qx[3]), inv), _mm_set1_ps(params.positionScale.x)));
+			py = _mm_add_ps(_mm_set1_ps(params.positionOffset.y), _mm_mul_ps(_mm_mul_ps(_mm_setr_ps(qy[0], qy[1], qy[2], qy[3]), inv), _mm_set1_ps(params.positionScale.y)));
+			pz = _mm_add_ps(_mm_set1_ps(params.positionOffset.z), _mm_mul_ps(_mm_mul_ps(_mm_setr_ps(qz[0], qz[1], qz[2], qz[3]), inv), _mm_set1_ps(params.positionScale.z)));
+		}
+		__m128 u = HalfToFloat4(qu);
+		__m128 w = HalfToFloat4(qv);
+
+		__m128 nx, ny, nz, tx, ty, tz;
+		DecodeOctahedral4(
+			_mm_setr_ps(v[0].normal[0], v[1].normal[0], v[2].normal[0], v[3].normal[0]),
+			_mm_setr_ps(v[0].normal[1], v[1].normal[1], v[2].normal[1], v[3].normal[1]),
+			nx, ny, nz);
+		DecodeOctahedral4(
+			_mm_setr_ps(v[0].tangent[0], v[1].tangent[0], v[2].tangent[0], v[3].tangent[0]),
+			_mm_setr_ps(v[0].tangent[1], v[1].tangent[1], v[2].tangent[1], v[3].tangent[1]),
+			tx, ty, tz);
+
+		alignas(16) float lanes[11][4];
+		_mm_store_ps(lanes[0], px); _mm_store_ps(lanes[1], py); _mm_store_ps(lanes[2], pz);
+		_mm_store_ps(lanes[3], u); _mm_store_ps(lanes[4], w);
+		_mm_store_ps(lanes[5], nx); _mm_store_ps(lanes[6], ny); _mm_store_ps(lanes[7], nz);
+		_mm_store_ps(lanes[8], tx); _mm_store_ps(lanes[9], ty); _mm_store_ps(lanes[10], tz);
+		for (int k = 0; k < 4; k++)
+		{
+			o[k].Position = XMFLOAT3(lanes[0][k], lanes[1][k], lanes[2][k]);
+			o[k].uv = XMFLOAT2(lanes[3][k], lanes[4][k]);
+			o[k].normal = XMFLOAT3(lanes[5][k], lanes[6][k], lanes[7][k]);
+			o[k].tangent = XMFLOAT3(lanes[8][k], lanes[9][k], lanes[10][k]);
+		}
+	}
+#endif
+
+	for (; i < numVerts; i++)
+		DecodeScalar(verts[i], params, out[i]);
+}
+
+
+// --------------------------------------------------------
+// Float -> half with round-to-nearest-even
+// (after Fabian Giesen's float_to_half_fast3_rtne)
+// --------------------------------------------------------
+uint16_t VertexQuantize::FloatToHalf(float value)
+{
+	uint32_t x = FloatBits(value);
+	uint32_t sign = x & 0x80000000u;
+	x ^= sign;
+
+	uint16_t result;
+	if (x >= 0x47800000u)
+	{
+		//too big for a half: infinity (or NaN stays NaN)
+		result = x > 0x7F800000u ? 0x7E00 : 0x7C00;
+	}
+	else if (x < 0x38800000u)
+	{
+		//subnormal or zero, let the FPU do the rounding
+		float f = BitsFloat(x) + BitsFloat(0x3F000000u);
+		result = (uint16_t)(FloatBits(f) - 0x3F000000u);
+	}
+	else
+	{
+		uint32_t mantissaOdd = (x >> 13) & 1;
+		x += ((uint32_t)(15 - 127) << 23) + 0xFFF;
+		x += mantissaOdd;
+		result = (uint16_t)(x >> 13);
+	}
+	return (uint16_t)((sign >> 16) | result);
+}
+
+
+float VertexQuantize::HalfToFloat(uint16_t value)
+{
+	const uint32_t shiftedExp = 0x7C00u << 13;
+	uint32_t bits = (uint32_t)(value & 0x7FFF) << 13;
+	uint32_t exp = shiftedExp & bits;
+	bits += (uint32_t)(127 - 15) << 23;
+
+	if (exp == shiftedExp)
+	{
+		//infinity or NaN
+		bits += (uint32_t)(128 - 16) << 23;
+	}
+	else if (exp == 0)
+	{
+		//zero or subnormal, renormalize
+		bits += 1 << 23;
+		bits = FloatBits(BitsFloat(bits) - BitsFloat(113u << 23));
+	}
+
+	bits |= (uint32_t)(value & 0x8000) << 16;
+	return BitsFloat(bits);
+}
+
+
+void VertexQuantize::EncodeOctahedral(const XMFLOAT3& n, int16_t out[2])
+{
+	float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	float inv = 1.0f / (l1 > 1e-20f ? l1 : 1e-20f);
+	float x = n.x * inv;
+	float y = n.y * inv;
+	if (n.z < 0.0f)
+	{
+		float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = fx;
+		y = fy;
+	}
+	out[0] = (int16_t)lrintf(Clamp(x, -1.0f, 1.0f) * 32767.0f);
+	out[1] = (int16_t)lrintf(Clamp(y, -1.0f, 1.0f) * 32767.0f);
+}
+
+
+XMFLOAT3 VertexQuantize::DecodeOctahedral(const int16_t in[2])
+{
+	float x = Clamp(in[0] * (1.0f / 32767.0f), -1.0f, 1.0f);
+	float y = Clamp(in[1] * (1.0f / 32767.0f), -1.0f, 1.0f);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+	float t = z < 0.0f ? -z : 0.0f;
+	x -= t * (x >= 0.0f ? 1.0f : -1.0f);
+	y -= t * (y >= 0.0f ? 1.0f : -1.0f);
+
+	float length = sqrtf(x * x + y * y + z * z);
+	float inv = length > 0.0f ? 1.0f / length : 0.0f;
+	return XMFLOAT3(x * inv, y * inv, z * inv);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include "Vertex.h"
+
+// How CompactVertex positions are stored
+enum CompactPositionFormat
+{
+	COMPACT_POSITION_HALF,		// Half floats, no bounds needed
+	COMPACT_POSITION_UNORM16	// 16-bit unorms across the mesh bounds (usually more precise)
+};
+
+// Everything needed to turn CompactVertex positions back into mesh space
+// - position = positionOffset + decoded * positionScale
+// - Half positions just use offset 0 and scale 1
+struct CompactVertexParams
+{
+	CompactPositionFormat positionFormat;
+	DirectX::XMFLOAT3 positionOffset;
+	DirectX::XMFLOAT3 positionScale;
+};
+
+// --------------------------------------------------------
+// Conversion between Vertex and CompactVertex
+//
+// - Encode/Decode work four vertices at a time with SSE2
+//   (plus F16C for half floats when the compiler has it)
+//   and fall back to the scalar helpers below otherwise
+//
+// Worst case error, per component:
+// - UNORM16 position: extent / 131070 (half a quantization step)
+// - Half position/uv: |value| * 2^-11 (values under 2^-14 are
+//   subnormal with an absolute error of 2^-25)
+// - Octahedral normal/tangent: under 0.005 degrees
+// (MeshConverter --quantize checks all of these)
+//
+// - Mesh stores CompactVertex when built with
+//   SetBuildCompactVertices, and CompactVS.hlsl draws it
+// --------------------------------------------------------
+namespace VertexQuantize
+{
+	CompactVertexParams MakeParams(const Vertex* verts, size_t numVerts, CompactPositionFormat format);
+	void Encode(const Vertex* verts, size_t numVerts, const CompactVertexParams& params, CompactVertex* out);
+	void Decode(const CompactVertex* verts, size_t numVerts, const CompactVertexParams& params, Vertex* out);
+
+	// Scalar building blocks
+	uint16_t FloatToHalf(float value);
+	float HalfToFloat(uint16_t value);
+	void EncodeOctahedral(const DirectX::XMFLOAT3& n, int16_t out[2]);
+	DirectX::XMFLOAT3 DecodeOctahedral(const int16_t in[2]);
+}
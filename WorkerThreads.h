@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Splits [begin, end) into threadCount runs and calls work(thread, runBegin, runEnd)
+// for each on its own thread, the calling thread taking the first; returns once
+// they're all done
+template<typename Work>
+void RunOnThreads(unsigned int threadCount, size_t begin, size_t end, Work work)
+{
+	auto split = [&](unsigned int t) { return begin + (end - begin) * t / threadCount; };
+	std::vector<std::thread> workers;
+	for (unsigned int t = 1; t < threadCount; t++)
+		workers.emplace_back([&, t]() { work(t, split(t), split(t + 1)); });
+	work(0u, split(0), split(1));
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+// Runs work() on threadCount threads, the calling thread included, for work
+// that hands itself out (an atomic counter, a task queue)
+template<typename Work>
+void RunOnThreads(unsigned int threadCount, Work work)
+{
+	RunOnThreads(threadCount, 0, threadCount, [&](unsigned int, size_t, size_t) { work(); });
+}